@@ -3,6 +3,8 @@
 #include "quartz/defines.h"
 #include "quartz/core/application.h"
 #include "quartz/core/ecs.h"
+#include "quartz/assets/asset_manager.h"
+#include "quartz/assets/gltf_loader.h"
 #include "quartz/logging/logger.h"
 #include "quartz/platform/input/input.h"
 
@@ -22,6 +24,11 @@ double DeltaTime(); // Previous frame's delta time
 double Time();      // Total real time
 uint32_t WindowWidth();
 uint32_t WindowHeight();
+AssetManager& Assets();
+// Rendering
+// Each step of bias doubles the screen space error allowed when selecting LODs
+void SetLodBias(float bias);
+float LodBias();
 
 } // namespace Quartz
 
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Quartz
+{
+
+class Mesh;
+class Texture;
+
+// Generational reference to an asset owned by the AssetManager
+// A handle becomes stale once its asset is unloaded, even if the slot is reused
+template<typename T>
+struct AssetHandle
+{
+  uint32_t index      = ~0u;
+  uint32_t generation = 0;
+
+  inline bool IsNull() const { return index == ~0u; }
+
+  bool operator==(const AssetHandle& other) const
+  {
+    return index == other.index && generation == other.generation;
+  }
+
+  bool operator!=(const AssetHandle& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+typedef AssetHandle<Mesh>    MeshHandle;
+typedef AssetHandle<Texture> TextureHandle;
+
+} // namespace Quartz
@@ -0,0 +1,609 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/hash.h"
+#include "quartz/assets/asset_manager.h"
+#include "quartz/assets/qmesh.h"
+#include "quartz/assets/qtex.h"
+#include "quartz/core/jobs.h"
+
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+#include <string.h>
+
+namespace Quartz
+{
+
+// Keys
+// ============================================================
+
+static const uint64_t g_pathKeySeed    = 0x51a7e0f1c0d3a5e1ull;
+static const uint64_t g_contentKeySeed = 0x0c0de7e57c0a7e17ull;
+
+static uint64_t FloatBits(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// The same file imported with different processing is a different mesh
+// Residency is not part of it, a loaded mesh restores its CPU data in place instead
+static uint64_t MeshPathKey(const std::string& normalizedPath, const MeshImportInfo& importInfo)
+{
+  uint64_t key = HashString(normalizedPath.c_str(), g_pathKeySeed);
+  key = HashCombine(key, (uint64_t)importInfo.weld.mode);
+  key = HashCombine(key, FloatBits(importInfo.weld.positionEpsilon));
+  key = HashCombine(key, (uint64_t)importInfo.optimize);
+  key = HashCombine(key, importInfo.optimization.cacheSize);
+  key = HashCombine(key, FloatBits(importInfo.optimization.overdrawThreshold));
+  key = HashCombine(key, (uint64_t)importInfo.generateLods);
+  key = HashCombine(key, importInfo.lod.maxLodCount);
+  key = HashCombine(key, FloatBits(importInfo.lod.reductionRatio));
+  key = HashCombine(key, FloatBits(importInfo.lod.simplify.uvWeight));
+  key = HashCombine(key, FloatBits(importInfo.lod.simplify.normalWeight));
+  key = HashCombine(key, FloatBits(importInfo.lod.simplify.maxError));
+  key = HashCombine(key, (uint64_t)importInfo.buildMeshlets);
+  key = HashCombine(key, importInfo.meshletMinTriangleCount);
+  return key;
+}
+
+// The same file loaded with different settings is a different texture
+static uint64_t TextureKey(const std::string& normalizedPath, TextureFormat format, TextureFilterMode filtering, TextureSampleMode sampleMode)
+{
+  uint64_t key = HashString(normalizedPath.c_str(), g_pathKeySeed);
+  return HashCombine(key, ((uint64_t)format << 16) | ((uint64_t)filtering << 8) | (uint64_t)sampleMode);
+}
+
+static bool IsCookedMeshPath(const std::string& path)
+{
+  const size_t extensionLength = sizeof(QMESH_EXTENSION) - 1;
+  return path.size() >= extensionLength && path.compare(path.size() - extensionLength, extensionLength, QMESH_EXTENSION) == 0;
+}
+
+static bool IsCookedTexturePath(const std::string& path)
+{
+  const size_t extensionLength = sizeof(QTEX_EXTENSION) - 1;
+  return path.size() >= extensionLength && path.compare(path.size() - extensionLength, extensionLength, QTEX_EXTENSION) == 0;
+}
+
+std::string AssetManager::NormalizePath(const char* path)
+{
+  std::error_code error;
+  std::filesystem::path fsPath = std::filesystem::weakly_canonical(std::filesystem::path(path), error);
+  if (error)
+  {
+    fsPath = std::filesystem::path(path).lexically_normal();
+  }
+
+  std::string normal = fsPath.generic_string();
+#ifdef QTZ_PLATFORM_WIN32
+  // Windows paths are case-insensitive
+  std::transform(normal.begin(), normal.end(), normal.begin(), [](char c) { return (char)tolower(c); });
+#endif // QTZ_PLATFORM_WIN32
+  return normal;
+}
+
+// Cooked assets
+// ============================================================
+
+void AssetManager::SetCookedDirectory(const char* sourceDirectory, const char* cookedDirectory, bool requireCooked)
+{
+  m_sourceDirectory = NormalizePath(sourceDirectory);
+  m_cookedDirectory = std::filesystem::path(cookedDirectory).generic_string();
+  m_requireCooked = requireCooked;
+}
+
+bool AssetManager::ResolveCookedPath(const std::string& normalizedPath, const char* cookedExtension, std::string* outPath) const
+{
+  *outPath = normalizedPath;
+  if (m_cookedDirectory.empty())
+  {
+    return true;
+  }
+
+  std::filesystem::path relative = std::filesystem::path(normalizedPath).lexically_relative(m_sourceDirectory);
+  if (relative.empty() || *relative.begin() == "..")
+  {
+    // Outside of the cooked tree
+    return !m_requireCooked;
+  }
+
+  std::string cookedPath = m_cookedDirectory + "/" + relative.generic_string() + cookedExtension;
+  if (std::filesystem::exists(cookedPath))
+  {
+    *outPath = cookedPath;
+    return true;
+  }
+
+  if (m_requireCooked)
+  {
+    QTZ_ERROR("\"{}\" has not been cooked, run quartz-cook on \"{}\"", normalizedPath, m_sourceDirectory);
+    return false;
+  }
+
+  QTZ_WARNING("\"{}\" has not been cooked, importing the source", normalizedPath);
+  return true;
+}
+
+// Meshes
+// ============================================================
+
+MeshHandle AssetManager::LoadMesh(const char* path, MeshImportInfo importInfo)
+{
+  std::string normalizedPath = NormalizePath(path);
+  uint64_t key = MeshPathKey(normalizedPath, importInfo);
+
+  auto existing = m_meshLookup.find(key);
+  if (existing != m_meshLookup.end())
+  {
+    Mesh* mesh = m_meshes.Get(existing->second);
+    if (importInfo.residency == Mesh_Residency_CpuAndGpu && mesh->LoadCpuData() != Quartz_Success)
+    {
+      QTZ_WARNING("Failed to restore CPU data for mesh \"{}\"", path);
+    }
+
+    m_meshes.AddReference(existing->second);
+    return existing->second;
+  }
+
+  std::string loadPath;
+  Mesh mesh;
+  if (!ResolveCookedPath(normalizedPath, QMESH_EXTENSION, &loadPath)
+    || mesh.Init(loadPath.c_str(), importInfo) != Quartz_Success)
+  {
+    QTZ_ERROR("Asset manager failed to load mesh \"{}\"", path);
+    return MeshHandle{};
+  }
+
+  MeshHandle handle = m_meshes.Insert(std::move(mesh), key);
+  m_meshLookup[key] = handle;
+  return handle;
+}
+
+MeshHandle AssetManager::LoadMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshResidency residency)
+{
+  return LoadMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), residency);
+}
+
+MeshHandle AssetManager::LoadMesh(
+  const Vertex* vertices,
+  uint64_t vertexCount,
+  const uint32_t* indices,
+  uint64_t indexCount,
+  MeshResidency residency)
+{
+  uint64_t key = HashBytes(vertices, vertexCount * sizeof(Vertex), g_contentKeySeed);
+  key = HashBytes(indices, indexCount * sizeof(uint32_t), key);
+
+  // A hash alone is not trusted, meshes with other counts are loaded separately
+  auto existing = m_meshContentLookup.find(key);
+  const bool matches = existing != m_meshContentLookup.end()
+    && existing->second.vertexCount == vertexCount
+    && existing->second.indexCount == indexCount;
+  if (matches)
+  {
+    m_meshes.AddReference(existing->second.handle);
+    return existing->second.handle;
+  }
+
+  Mesh mesh;
+  if (mesh.Init(vertices, vertexCount, indices, indexCount, residency) != Quartz_Success)
+  {
+    QTZ_ERROR("Asset manager failed to create mesh from memory");
+    return MeshHandle{};
+  }
+
+  MeshHandle handle = m_meshes.Insert(std::move(mesh), key);
+  if (existing == m_meshContentLookup.end())
+  {
+    m_meshContentLookup[key] = { handle, vertexCount, indexCount };
+  }
+  return handle;
+}
+
+Mesh* AssetManager::Get(MeshHandle handle)
+{
+  return m_meshes.Get(handle);
+}
+
+void AssetManager::Acquire(MeshHandle handle)
+{
+  if (!m_meshes.IsAlive(handle))
+  {
+    QTZ_ERROR("Attempting to acquire a stale mesh handle");
+    return;
+  }
+
+  m_meshes.AddReference(handle);
+}
+
+void AssetManager::Release(MeshHandle handle)
+{
+  if (!m_meshes.IsAlive(handle))
+  {
+    QTZ_WARNING("Attempting to release a stale mesh handle");
+    return;
+  }
+
+  if (m_meshes.RemoveReference(handle))
+  {
+    // Only the lookup that still points at this mesh forgets it
+    const uint64_t key = m_meshes.Key(handle);
+    auto path = m_meshLookup.find(key);
+    if (path != m_meshLookup.end() && path->second == handle)
+    {
+      m_meshLookup.erase(path);
+    }
+    auto content = m_meshContentLookup.find(key);
+    if (content != m_meshContentLookup.end() && content->second.handle == handle)
+    {
+      m_meshContentLookup.erase(content);
+    }
+
+    // Frames in flight may still be drawing it
+    m_meshes.Get(handle)->Retire();
+    m_meshes.Erase(handle);
+  }
+}
+
+// Textures
+// ============================================================
+
+TextureHandle AssetManager::LoadTexture(const char* path, TextureFormat format, TextureFilterMode filtering, TextureSampleMode sampleMode)
+{
+  std::string normalizedPath = NormalizePath(path);
+  uint64_t key = TextureKey(normalizedPath, format, filtering, sampleMode);
+
+  auto existing = m_textureLookup.find(key);
+  if (existing != m_textureLookup.end())
+  {
+    m_textures.AddReference(existing->second);
+    return existing->second;
+  }
+
+  std::string loadPath;
+  if (!ResolveCookedPath(normalizedPath, QTEX_EXTENSION, &loadPath))
+  {
+    QTZ_ERROR("Asset manager failed to load texture \"{}\"", path);
+    return TextureHandle{};
+  }
+
+  Texture texture;
+  texture.format = format;
+  texture.filtering = filtering;
+  texture.sampleMode = sampleMode;
+  TextureDecodeData data;
+  data.streamExtent = TextureStreamExtent(loadPath);
+  if (texture.Decode(loadPath.c_str(), &data) != Quartz_Success || texture.Init(&data) != Quartz_Success)
+  {
+    QTZ_ERROR("Asset manager failed to load texture \"{}\"", path);
+    return TextureHandle{};
+  }
+
+  TextureHandle handle = m_textures.Insert(std::move(texture), key);
+  m_textureLookup[key] = handle;
+  m_streamer.Register(handle, m_textures.Get(handle), loadPath.c_str());
+  return handle;
+}
+
+Texture* AssetManager::Get(TextureHandle handle)
+{
+  return m_textures.Get(handle);
+}
+
+void AssetManager::Acquire(TextureHandle handle)
+{
+  if (!m_textures.IsAlive(handle))
+  {
+    QTZ_ERROR("Attempting to acquire a stale texture handle");
+    return;
+  }
+
+  m_textures.AddReference(handle);
+}
+
+void AssetManager::Release(TextureHandle handle)
+{
+  if (!m_textures.IsAlive(handle))
+  {
+    QTZ_WARNING("Attempting to release a stale texture handle");
+    return;
+  }
+
+  if (m_textures.RemoveReference(handle))
+  {
+    // Frames in flight may still be sampling it
+    m_streamer.Unregister(m_textures.Get(handle));
+    m_textures.Get(handle)->Retire();
+    m_textureLookup.erase(m_textures.Key(handle));
+    m_textures.Erase(handle);
+  }
+}
+
+// Streaming
+// ============================================================
+
+QuartzResult AssetManager::EnableTextureStreaming(const TextureStreamingSettings& settings)
+{
+  if (m_textures.Count())
+  {
+    QTZ_WARNING("Texture streaming enabled with {} textures loaded, they stay fully resident", m_textures.Count());
+  }
+
+  QTZ_ATTEMPT(m_streamer.Init(settings));
+  return Quartz_Success;
+}
+
+uint32_t AssetManager::TextureStreamExtent(const std::string& loadPath) const
+{
+  return (m_streamer.IsEnabled() && IsCookedTexturePath(loadPath)) ? m_streamer.Settings().initialExtent : 0;
+}
+
+QuartzResult AssetManager::UpdateTextureStreaming(uint64_t frameIndex, std::vector<const Texture*>* outChanged)
+{
+  QTZ_ATTEMPT(m_streamer.Update(&m_textures, frameIndex, outChanged));
+  return Quartz_Success;
+}
+
+// Batches
+// ============================================================
+
+struct PendingAssetLoad
+{
+  uint32_t request;
+  uint64_t key;
+  std::string loadPath; // Resolved to the cooked version where there is one
+  uint64_t fileSize;
+
+  QuartzResult result = Quartz_Failure; // Of the decode, then of the upload
+  MeshImportData mesh;
+  Texture texture;
+  TextureDecodeData pixels;
+};
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+QuartzResult AssetManager::LoadBatch(
+  const std::vector<AssetLoadRequest>& requests,
+  std::vector<AssetLoadResult>* outResults,
+  AssetBatchStats* outStats)
+{
+  auto batchStart = std::chrono::steady_clock::now();
+  std::vector<AssetLoadResult>& results = *outResults;
+  results.assign(requests.size(), AssetLoadResult{});
+
+  // Plan ==============================
+  // Assets already loaded, or requested earlier in the batch, are resolved by the single loads once the batch is in
+
+  std::vector<PendingAssetLoad> pending;
+  std::vector<std::pair<uint32_t, uint64_t>> deferred;
+  std::unordered_set<uint64_t> scheduled;
+  pending.reserve(requests.size());
+
+  for (uint32_t i = 0; i < requests.size(); i++)
+  {
+    const AssetLoadRequest& request = requests[i];
+    PendingAssetLoad load;
+    load.request = i;
+
+    if (request.type == Asset_Type_Mesh)
+    {
+      std::string normalizedPath = NormalizePath(request.path);
+      load.key = MeshPathKey(normalizedPath, request.meshImport);
+      if (m_meshLookup.count(load.key) || scheduled.count(load.key))
+      {
+        deferred.push_back({ i, load.key });
+        continue;
+      }
+
+      if (!ResolveCookedPath(normalizedPath, QMESH_EXTENSION, &load.loadPath))
+      {
+        QTZ_ERROR("Asset manager failed to load mesh \"{}\"", request.path);
+        continue;
+      }
+    }
+    else
+    {
+      std::string normalizedPath = NormalizePath(request.path);
+      load.key = TextureKey(normalizedPath, request.textureFormat, request.textureFiltering, request.textureSampleMode);
+      if (m_textureLookup.count(load.key) || scheduled.count(load.key))
+      {
+        deferred.push_back({ i, load.key });
+        continue;
+      }
+
+      if (!ResolveCookedPath(normalizedPath, QTEX_EXTENSION, &load.loadPath))
+      {
+        QTZ_ERROR("Asset manager failed to load texture \"{}\"", request.path);
+        continue;
+      }
+      load.texture.format = request.textureFormat;
+      load.texture.filtering = request.textureFiltering;
+      load.texture.sampleMode = request.textureSampleMode;
+      load.pixels.streamExtent = TextureStreamExtent(load.loadPath);
+    }
+
+    std::error_code error;
+    load.fileSize = std::filesystem::file_size(load.loadPath, error);
+    if (error)
+    {
+      load.fileSize = 0;
+    }
+
+    scheduled.insert(load.key);
+    pending.push_back(std::move(load));
+  }
+
+  // Largest files first so one big asset does not start last and leave the other workers idle
+  std::stable_sort(pending.begin(), pending.end(), [](const PendingAssetLoad& a, const PendingAssetLoad& b)
+  {
+    return a.fileSize > b.fileSize;
+  });
+
+  // Decode ==============================
+
+  auto decodeStart = std::chrono::steady_clock::now();
+  ParallelFor((uint32_t)pending.size(), [&](uint32_t index)
+  {
+    PendingAssetLoad& load = pending[index];
+    const AssetLoadRequest& request = requests[load.request];
+    auto start = std::chrono::steady_clock::now();
+
+    if (request.type == Asset_Type_Mesh)
+    {
+      // Cooked meshes are uploaded straight from their mapped file, there is nothing to decode
+      load.result = IsCookedMeshPath(load.loadPath) ? Quartz_Success : ImportMesh(
+        load.loadPath.c_str(),
+        request.meshImport,
+        &load.mesh.vertices,
+        &load.mesh.indices,
+        &load.mesh.lods,
+        &load.mesh.meshlets);
+    }
+    else
+    {
+      load.result = load.texture.Decode(load.loadPath.c_str(), &load.pixels);
+    }
+
+    results[load.request].decodeSeconds = SecondsSince(start);
+  });
+  double decodeSeconds = SecondsSince(decodeStart);
+
+  // Upload ==============================
+
+  auto uploadStart = std::chrono::steady_clock::now();
+  for (PendingAssetLoad& load : pending)
+  {
+    const AssetLoadRequest& request = requests[load.request];
+    AssetLoadResult& result = results[load.request];
+    auto start = std::chrono::steady_clock::now();
+
+    if (request.type == Asset_Type_Mesh)
+    {
+      Mesh mesh;
+      if (load.result == Quartz_Success)
+      {
+        load.result = IsCookedMeshPath(load.loadPath)
+          ? mesh.InitFromCooked(load.loadPath.c_str(), request.meshImport.residency)
+          : mesh.Init(load.loadPath.c_str(), request.meshImport, &load.mesh);
+      }
+
+      if (load.result == Quartz_Success)
+      {
+        result.mesh = m_meshes.Insert(std::move(mesh), load.key);
+        m_meshLookup[load.key] = result.mesh;
+      }
+      else
+      {
+        QTZ_ERROR("Asset manager failed to load mesh \"{}\"", request.path);
+      }
+      load.mesh = MeshImportData{};
+    }
+    else
+    {
+      if (load.result == Quartz_Success)
+      {
+        load.result = load.texture.Init(&load.pixels);
+      }
+
+      if (load.result == Quartz_Success)
+      {
+        result.texture = m_textures.Insert(std::move(load.texture), load.key);
+        m_textureLookup[load.key] = result.texture;
+        m_streamer.Register(result.texture, m_textures.Get(result.texture), load.loadPath.c_str());
+      }
+      else
+      {
+        QTZ_ERROR("Asset manager failed to load texture \"{}\"", request.path);
+      }
+    }
+
+    result.result = load.result;
+    result.uploadSeconds = SecondsSince(start);
+  }
+
+  // Everything else is now a lookup, requests for assets that just failed are not retried
+  for (const auto& entry : deferred)
+  {
+    const AssetLoadRequest& request = requests[entry.first];
+    AssetLoadResult& result = results[entry.first];
+    if (request.type == Asset_Type_Mesh)
+    {
+      if (m_meshLookup.count(entry.second))
+      {
+        result.mesh = LoadMesh(request.path, request.meshImport);
+        result.result = result.mesh.IsNull() ? Quartz_Failure : Quartz_Success;
+      }
+    }
+    else if (m_textureLookup.count(entry.second))
+    {
+      result.texture = LoadTexture(request.path, request.textureFormat, request.textureFiltering, request.textureSampleMode);
+      result.result = result.texture.IsNull() ? Quartz_Failure : Quartz_Success;
+    }
+  }
+  double uploadSeconds = SecondsSince(uploadStart);
+
+  // Report ==============================
+
+  AssetBatchStats stats = {};
+  stats.totalSeconds = SecondsSince(batchStart);
+  stats.decodeSeconds = decodeSeconds;
+  stats.uploadSeconds = uploadSeconds;
+  for (const PendingAssetLoad& load : pending)
+  {
+    stats.loadedCount += load.result == Quartz_Success;
+  }
+  for (const AssetLoadResult& result : results)
+  {
+    stats.decodeCpuSeconds += result.decodeSeconds;
+    stats.failedCount += result.result != Quartz_Success;
+  }
+
+  QTZ_INFO(
+    "Loaded {} of {} assets in {:.3f}s ({} failed)\n    Decode : {:.3f}s on {} workers ({:.3f}s of work)\n    Upload : {:.3f}s",
+    stats.loadedCount, requests.size(), stats.totalSeconds, stats.failedCount,
+    stats.decodeSeconds, JobWorkerCount(), stats.decodeCpuSeconds, stats.uploadSeconds);
+
+  if (outStats)
+  {
+    *outStats = stats;
+  }
+
+  return stats.failedCount ? Quartz_Failure : Quartz_Success;
+}
+
+// Shutdown
+// ============================================================
+
+void AssetManager::Shutdown()
+{
+  // Stops the background reads before the files they read are closed
+  m_streamer.Shutdown();
+
+  if (m_meshes.Count() || m_textures.Count())
+  {
+    QTZ_DEBUG("Asset manager unloading {} meshes and {} textures still referenced", m_meshes.Count(), m_textures.Count());
+  }
+
+  for (uint32_t i = 0; i < m_meshes.Count(); i++)
+  {
+    m_meshes.DenseAt(i).Shutdown();
+  }
+  m_meshes.Clear();
+  m_meshLookup.clear();
+  m_meshContentLookup.clear();
+
+  for (uint32_t i = 0; i < m_textures.Count(); i++)
+  {
+    m_textures.DenseAt(i).Shutdown();
+  }
+  m_textures.Clear();
+  m_textureLookup.clear();
+}
+
+} // namespace Quartz
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/assets/asset_handle.h"
+#include "quartz/assets/asset_pool.h"
+#include "quartz/assets/texture_streamer.h"
+#include "quartz/rendering/defines.h"
+#include "quartz/rendering/mesh.h"
+#include "quartz/rendering/texture.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Quartz
+{
+
+// Batches
+// ============================================================
+
+enum AssetType
+{
+  Asset_Type_Mesh,
+  Asset_Type_Texture
+};
+
+struct AssetLoadRequest
+{
+  AssetType type;
+  const char* path;
+
+  MeshImportInfo meshImport = {};
+
+  TextureFormat textureFormat = Texture_Format_RGBA8;
+  TextureFilterMode textureFiltering = Texture_Filter_Linear;
+  TextureSampleMode textureSampleMode = Texture_Sample_Wrap;
+};
+
+struct AssetLoadResult
+{
+  QuartzResult result = Quartz_Failure;
+  // Only the one matching the request's type is set
+  MeshHandle mesh;
+  TextureHandle texture;
+
+  double decodeSeconds = 0.0; // Reading and processing the file on a job worker
+  double uploadSeconds = 0.0; // Creating the gpu resources on the calling thread
+};
+
+struct AssetBatchStats
+{
+  double totalSeconds;
+  double decodeSeconds; // Wall time until every decode finished
+  double uploadSeconds;
+  double decodeCpuSeconds; // Summed across workers
+  uint32_t loadedCount; // Excludes assets that were already loaded
+  uint32_t failedCount;
+};
+
+// Asset manager
+// ============================================================
+
+// Owns all loaded meshes and textures
+// Loads are deduplicated by normalized path and import settings (or content hash and counts for in-memory data)
+// Every Load*() and Acquire() adds a reference, Release() removes one and unloads the asset at zero
+// Unloaded gpu resources are retired to the renderer, frames in flight may still use them
+class AssetManager
+{
+public:
+  void Shutdown();
+
+  // Redirects loads of source files under sourceDirectory to their cooked versions
+  void SetCookedDirectory(const char* sourceDirectory, const char* cookedDirectory, bool requireCooked);
+
+  // Meshes
+  // Requesting Mesh_Residency_CpuAndGpu for an already loaded gpu-only mesh restores its CPU data
+  MeshHandle LoadMesh(const char* path, MeshImportInfo importInfo = {});
+  MeshHandle LoadMesh(
+    const std::vector<Vertex>& vertices,
+    const std::vector<uint32_t>& indices,
+    MeshResidency residency = Mesh_Residency_Gpu);
+  MeshHandle LoadMesh(
+    const Vertex* vertices,
+    uint64_t vertexCount,
+    const uint32_t* indices,
+    uint64_t indexCount,
+    MeshResidency residency = Mesh_Residency_Gpu);
+  // Stays valid until the mesh's last reference is released, loading or releasing other meshes never moves it
+  Mesh* Get(MeshHandle handle);
+  void Acquire(MeshHandle handle);
+  void Release(MeshHandle handle);
+  uint32_t ReferenceCount(MeshHandle handle) const { return m_meshes.ReferenceCount(handle); }
+
+  // Textures
+  TextureHandle LoadTexture(
+    const char* path,
+    TextureFormat format = Texture_Format_RGBA8,
+    TextureFilterMode filtering = Texture_Filter_Linear,
+    TextureSampleMode sampleMode = Texture_Sample_Wrap);
+  // Stays valid until the texture's last reference is released, loading or releasing other textures never moves it
+  // Materials and the texture streamer hold on to it
+  Texture* Get(TextureHandle handle);
+  void Acquire(TextureHandle handle);
+  void Release(TextureHandle handle);
+  uint32_t ReferenceCount(TextureHandle handle) const { return m_textures.ReferenceCount(handle); }
+
+  // Cooked textures loaded afterwards start with their small levels and stream the rest (see texture_streamer.h)
+  QuartzResult EnableTextureStreaming(const TextureStreamingSettings& settings);
+  inline const TextureStreamer& Streamer() const { return m_streamer; }
+  // Once per visible use of a texture each frame, pixelsPerUv is how many pixels one unit of uv space covers
+  inline void RequestTextureLevel(const Texture* texture, float pixelsPerUv, uint64_t frameIndex)
+  {
+    m_streamer.Request(texture, pixelsPerUv, frameIndex);
+  }
+  // Outputs the textures given a new image, materials using them must rebuild their input sets
+  QuartzResult UpdateTextureStreaming(uint64_t frameIndex, std::vector<const Texture*>* outChanged);
+
+  // Loads many assets at once : files are decoded concurrently across the job workers,
+  //   then uploaded back to back on the calling thread
+  // Every request gets a result and a reference like its single Load*() would, fails if any request failed
+  QuartzResult LoadBatch(
+    const std::vector<AssetLoadRequest>& requests,
+    std::vector<AssetLoadResult>* outResults,
+    AssetBatchStats* outStats = nullptr);
+
+  inline uint32_t MeshCount() const { return m_meshes.Count(); }
+  inline uint32_t TextureCount() const { return m_textures.Count(); }
+
+  static std::string NormalizePath(const char* path);
+
+private:
+  std::string m_sourceDirectory;
+  std::string m_cookedDirectory;
+  bool m_requireCooked = false;
+
+  // Returns false if there is no cooked version and sources may not be imported
+  bool ResolveCookedPath(const std::string& normalizedPath, const char* cookedExtension, std::string* outPath) const;
+  // Cooked textures are only decoded up to the streamer's initial extent
+  uint32_t TextureStreamExtent(const std::string& loadPath) const;
+
+  TextureStreamer m_streamer;
+
+  AssetPool<Mesh>    m_meshes;
+  AssetPool<Texture> m_textures;
+
+  struct MeshContentEntry
+  {
+    MeshHandle handle;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+  };
+
+  std::unordered_map<uint64_t, MeshHandle>       m_meshLookup; // By path and import settings
+  std::unordered_map<uint64_t, MeshContentEntry> m_meshContentLookup; // By the contents of in-memory meshes
+  std::unordered_map<uint64_t, TextureHandle>    m_textureLookup;
+};
+
+} // namespace Quartz
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/assets/asset_handle.h"
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+namespace Quartz
+{
+
+// Slot map : Assets are stored densely, handles index into a sparse slot array
+// Erasing swaps the last asset into the freed dense position
+// Every asset lives in its own allocation, only the dense array of pointers moves : a pointer from Get() stays valid
+//   until its asset is erased, however many assets are inserted or erased around it
+template<typename T>
+class AssetPool
+{
+public:
+  AssetHandle<T> Insert(T&& asset, uint64_t key)
+  {
+    uint32_t slotIndex;
+    if (m_freeHead != ~0u)
+    {
+      slotIndex = m_freeHead;
+      m_freeHead = m_slots[slotIndex].nextFree;
+    }
+    else
+    {
+      slotIndex = (uint32_t)m_slots.size();
+      m_slots.push_back({});
+    }
+
+    Slot& slot = m_slots[slotIndex];
+    slot.denseIndex = (uint32_t)m_dense.size();
+    slot.refCount = 1;
+    slot.key = key;
+    slot.nextFree = ~0u;
+
+    m_dense.push_back(std::make_unique<T>(std::move(asset)));
+    m_denseToSlot.push_back(slotIndex);
+
+    return AssetHandle<T>{ slotIndex, slot.generation };
+  }
+
+  T* Get(AssetHandle<T> handle)
+  {
+    if (!IsAlive(handle))
+    {
+      return nullptr;
+    }
+    return m_dense[m_slots[handle.index].denseIndex].get();
+  }
+
+  inline bool IsAlive(AssetHandle<T> handle) const
+  {
+    return handle.index < m_slots.size()
+      && m_slots[handle.index].generation == handle.generation
+      && m_slots[handle.index].refCount > 0;
+  }
+
+  inline void AddReference(AssetHandle<T> handle)
+  {
+    m_slots[handle.index].refCount++;
+  }
+
+  // Returns true when the last reference has been removed
+  inline bool RemoveReference(AssetHandle<T> handle)
+  {
+    return --m_slots[handle.index].refCount == 0;
+  }
+
+  inline uint32_t ReferenceCount(AssetHandle<T> handle) const
+  {
+    return IsAlive(handle) ? m_slots[handle.index].refCount : 0;
+  }
+
+  inline uint64_t Key(AssetHandle<T> handle) const
+  {
+    return m_slots[handle.index].key;
+  }
+
+  // Asset must already be shut down
+  void Erase(AssetHandle<T> handle)
+  {
+    Slot& slot = m_slots[handle.index];
+    uint32_t lastDense = (uint32_t)m_dense.size() - 1;
+
+    if (slot.denseIndex != lastDense)
+    {
+      m_dense[slot.denseIndex] = std::move(m_dense[lastDense]);
+      m_denseToSlot[slot.denseIndex] = m_denseToSlot[lastDense];
+      m_slots[m_denseToSlot[slot.denseIndex]].denseIndex = slot.denseIndex;
+    }
+    m_dense.pop_back();
+    m_denseToSlot.pop_back();
+
+    slot.refCount = 0;
+    slot.generation++;
+    slot.nextFree = m_freeHead;
+    m_freeHead = handle.index;
+  }
+
+  inline uint32_t Count() const { return (uint32_t)m_dense.size(); }
+  inline T& DenseAt(uint32_t denseIndex) { return *m_dense[denseIndex]; }
+  inline AssetHandle<T> HandleAt(uint32_t denseIndex) const
+  {
+    uint32_t slotIndex = m_denseToSlot[denseIndex];
+    return AssetHandle<T>{ slotIndex, m_slots[slotIndex].generation };
+  }
+
+  void Clear()
+  {
+    m_dense.clear();
+    m_denseToSlot.clear();
+    m_slots.clear();
+    m_freeHead = ~0u;
+  }
+
+private:
+  struct Slot
+  {
+    uint32_t denseIndex = 0;
+    uint32_t generation = 0;
+    uint32_t refCount   = 0;
+    uint32_t nextFree   = ~0u;
+    uint64_t key        = 0;
+  };
+
+  std::vector<std::unique_ptr<T>> m_dense;
+  std::vector<uint32_t>           m_denseToSlot;
+  std::vector<Slot>               m_slots;
+  uint32_t                        m_freeHead = ~0u;
+};
+
+} // namespace Quartz
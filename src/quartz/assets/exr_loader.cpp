@@ -0,0 +1,247 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/half.h"
+#include "quartz/core/jobs.h"
+#include "quartz/assets/exr_loader.h"
+
+// The only user of tinyexr, its configuration and implementation live here
+#define TINYEXR_USE_MINIZ 0
+#define TINYEXR_USE_STB_ZLIB 1
+#define TINYEXR_USE_THREAD 1
+#define TINYEXR_IMPLEMENTATION
+#include <tinyexr.h>
+
+#include <string.h>
+
+namespace Quartz
+{
+
+// Copies a rectangle of channel planes into interleaved RGBA, channels of -1 are filled with one
+// narrow : Channels decoded as floats that are converted to halves here
+template <typename T>
+static void InterleaveRect(
+  unsigned char* const* planes,
+  const int32_t channels[4],
+  const bool narrow[4],
+  T one,
+  uint32_t planeWidth,
+  uint32_t width,
+  uint32_t rowBegin,
+  uint32_t rowEnd,
+  T* out,
+  uint32_t outWidth,
+  uint32_t outX,
+  uint32_t outY)
+{
+  for (uint32_t y = rowBegin; y < rowEnd; y++)
+  {
+    T* outRow = out + ((uint64_t)(outY + y) * outWidth + outX) * 4;
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      if (channels[c] < 0)
+      {
+        for (uint32_t x = 0; x < width; x++)
+        {
+          outRow[x * 4 + c] = one;
+        }
+        continue;
+      }
+
+      if (narrow[c])
+      {
+        const float* plane = (const float*)planes[channels[c]] + (uint64_t)y * planeWidth;
+        uint16_t halves[256];
+        for (uint32_t x = 0; x < width; x += 256)
+        {
+          const uint32_t count = PeriMin(width - x, 256u);
+          FloatsToHalves(plane + x, halves, count);
+          for (uint32_t i = 0; i < count; i++)
+          {
+            outRow[(x + i) * 4 + c] = (T)halves[i];
+          }
+        }
+        continue;
+      }
+
+      const T* plane = (const T*)planes[channels[c]] + (uint64_t)y * planeWidth;
+      for (uint32_t x = 0; x < width; x++)
+      {
+        outRow[x * 4 + c] = plane[x];
+      }
+    }
+  }
+}
+
+template <typename T>
+static void InterleaveImage(
+  const EXRHeader& header,
+  const EXRImage& image,
+  const int32_t channels[4],
+  const bool narrow[4],
+  T one,
+  T* out)
+{
+  const uint32_t width = (uint32_t)image.width;
+
+  if (header.tiled)
+  {
+    const uint32_t tileWidth = (uint32_t)header.tile_size_x;
+    const uint32_t tileHeight = (uint32_t)header.tile_size_y;
+
+    ParallelForRange((uint32_t)image.num_tiles, 1, [&](uint32_t begin, uint32_t end)
+    {
+      for (uint32_t i = begin; i < end; i++)
+      {
+        const EXRTile& tile = image.tiles[i];
+        InterleaveRect<T>(
+          tile.images,
+          channels,
+          narrow,
+          one,
+          tileWidth,
+          (uint32_t)tile.width,
+          0,
+          (uint32_t)tile.height,
+          out,
+          width,
+          (uint32_t)tile.offset_x * tileWidth,
+          (uint32_t)tile.offset_y * tileHeight);
+      }
+    });
+    return;
+  }
+
+  const uint32_t rowsPerBatch = PeriMax(16384 / width, 1u);
+  ParallelForRange((uint32_t)image.height, rowsPerBatch, [&](uint32_t begin, uint32_t end)
+  {
+    InterleaveRect<T>(image.images, channels, narrow, one, width, width, begin, end, out, width, 0, 0);
+  });
+}
+
+QuartzResult LoadExr(const char* path, TextureFormat format, Vec2U* outExtents, void** outPixels)
+{
+  if (format != Texture_Format_RGBA32 && format != Texture_Format_RGBA16F)
+  {
+    QTZ_ERROR("EXR images decode to RGBA32 or RGBA16F, not format {}", (uint32_t)format);
+    return Quartz_Failure;
+  }
+
+  EXRVersion version;
+  if (ParseEXRVersionFromFile(&version, path) != TINYEXR_SUCCESS)
+  {
+    QTZ_ERROR("Failed to read EXR image \"{}\"", path);
+    return Quartz_Failure_Vendor;
+  }
+
+  if (version.multipart || version.non_image)
+  {
+    QTZ_ERROR("EXR image \"{}\" is multipart or deep, which are not supported", path);
+    return Quartz_Failure;
+  }
+
+  const char* err = nullptr;
+  EXRHeader header;
+  InitEXRHeader(&header);
+  if (ParseEXRHeaderFromFile(&header, &version, path, &err) != TINYEXR_SUCCESS)
+  {
+    QTZ_ERROR("Failed to read EXR header \"{}\" : {}", path, err ? err : "Unknown error");
+    FreeEXRErrorMessage(err);
+    return Quartz_Failure_Vendor;
+  }
+
+  // Channels ==============================
+
+  int32_t channels[4] = { -1, -1, -1, -1 };
+  if (header.num_channels == 1)
+  {
+    // Alpha included, as tinyexr's LoadEXR() does
+    channels[0] = channels[1] = channels[2] = channels[3] = 0;
+  }
+  else
+  {
+    const char* names[4] = { "R", "G", "B", "A" };
+    for (int32_t i = 0; i < header.num_channels; i++)
+    {
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        channels[c] = (strcmp(header.channels[i].name, names[c]) == 0) ? i : channels[c];
+      }
+    }
+  }
+
+  if (channels[0] < 0 || channels[1] < 0 || channels[2] < 0)
+  {
+    QTZ_ERROR("EXR image \"{}\" has no R, G and B channels", path);
+    FreeEXRHeader(&header);
+    return Quartz_Failure;
+  }
+
+  // Half channels decode as halves for RGBA16F, tinyexr can only widen so float channels are narrowed while interleaving
+  bool narrow[4] = {};
+  for (uint32_t c = 0; c < 4; c++)
+  {
+    if (channels[c] < 0)
+    {
+      continue;
+    }
+
+    if (header.pixel_types[channels[c]] == TINYEXR_PIXELTYPE_UINT)
+    {
+      QTZ_ERROR("EXR image \"{}\" has integer color channels, which are not supported", path);
+      FreeEXRHeader(&header);
+      return Quartz_Failure;
+    }
+    if (format == Texture_Format_RGBA16F && header.pixel_types[channels[c]] == TINYEXR_PIXELTYPE_HALF)
+    {
+      header.requested_pixel_types[channels[c]] = TINYEXR_PIXELTYPE_HALF;
+    }
+    else
+    {
+      header.requested_pixel_types[channels[c]] = TINYEXR_PIXELTYPE_FLOAT;
+      narrow[c] = format == Texture_Format_RGBA16F;
+    }
+  }
+
+  // Decode ==============================
+
+  EXRImage image;
+  InitEXRImage(&image);
+  if (LoadEXRImageFromFile(&image, &header, path, &err) != TINYEXR_SUCCESS)
+  {
+    QTZ_ERROR("Failed to decode EXR image \"{}\" : {}", path, err ? err : "Unknown error");
+    FreeEXRErrorMessage(err);
+    FreeEXRHeader(&header);
+    return Quartz_Failure_Vendor;
+  }
+
+  const Vec2U extents = { (uint32_t)image.width, (uint32_t)image.height };
+  const uint64_t valueCount = (uint64_t)extents.width * extents.height * 4;
+
+  void* pixels = malloc(valueCount * (format == Texture_Format_RGBA16F ? sizeof(uint16_t) : sizeof(float)));
+  if (pixels == nullptr)
+  {
+    QTZ_ERROR("Failed to allocate {}x{} pixels for EXR image \"{}\"", extents.width, extents.height, path);
+    FreeEXRImage(&image);
+    FreeEXRHeader(&header);
+    return Quartz_Failure;
+  }
+
+  if (format == Texture_Format_RGBA16F)
+  {
+    InterleaveImage<uint16_t>(header, image, channels, narrow, 0x3c00, (uint16_t*)pixels);
+  }
+  else
+  {
+    InterleaveImage<float>(header, image, channels, narrow, 1.0f, (float*)pixels);
+  }
+
+  FreeEXRImage(&image);
+  FreeEXRHeader(&header);
+
+  *outExtents = extents;
+  *outPixels = pixels;
+  return Quartz_Success;
+}
+
+} // namespace Quartz
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/texture_format.h"
+
+namespace Quartz
+{
+
+// Decodes a single part OpenEXR image straight into RGBA32 or RGBA16F pixels
+// Compressed blocks are decompressed in parallel, then channels are interleaved across the job workers
+// Half channels are never widened to floats when decoding to RGBA16F
+//
+// Reads the R, G, B and A channels, a missing alpha is 1. Single channel images fill all four, like tinyexr's LoadEXR()
+// outPixels is allocated with malloc
+QuartzResult LoadExr(const char* path, TextureFormat format, Vec2U* outExtents, void** outPixels);
+
+} // namespace Quartz
@@ -0,0 +1,721 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/jobs.h"
+#include "quartz/assets/gltf_loader.h"
+#include "quartz/assets/asset_manager.h"
+#include "quartz/assets/json.h"
+#include "quartz/assets/mesh_tangents.h"
+#include "quartz/platform/filesystem/filesystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+
+namespace Quartz
+{
+
+// Glb container
+// ============================================================
+// [header : magic, version, length][chunk : length, type, data]... the JSON chunk first, then an optional BIN chunk
+
+#define GLB_MAGIC 0x46546c67 // "glTF"
+#define GLB_VERSION 2
+#define GLB_CHUNK_JSON 0x4e4f534a // "JSON"
+#define GLB_CHUNK_BIN 0x004e4942 // "BIN\0"
+
+// glTF accessor component types
+#define GLTF_BYTE 5120
+#define GLTF_UNSIGNED_BYTE 5121
+#define GLTF_SHORT 5122
+#define GLTF_UNSIGNED_SHORT 5123
+#define GLTF_UNSIGNED_INT 5125
+#define GLTF_FLOAT 5126
+
+#define GLTF_MODE_TRIANGLES 4
+
+struct GlbFile
+{
+  MappedFile file;
+  JsonValue document;
+  const uint8_t* bin = nullptr;
+  uint64_t binSize = 0;
+};
+
+static QuartzResult OpenGlb(const char* path, GlbFile* glb)
+{
+  QTZ_ATTEMPT(PlatformMapFile(path, &glb->file));
+  const uint8_t* bytes = (const uint8_t*)glb->file.data;
+  const uint64_t size = glb->file.size;
+
+  uint32_t header[3];
+  if (size < sizeof(header))
+  {
+    QTZ_ERROR("\"{}\" is too small to be a glb file", path);
+    return Quartz_Failure;
+  }
+  memcpy(header, bytes, sizeof(header));
+  if (header[0] != GLB_MAGIC || header[1] != GLB_VERSION || header[2] > size)
+  {
+    QTZ_ERROR("\"{}\" is not a glTF 2.0 binary file", path);
+    return Quartz_Failure;
+  }
+
+  // Chunks ==============================
+
+  uint64_t offset = sizeof(header);
+  bool foundJson = false;
+  while (offset + 8 <= header[2])
+  {
+    uint32_t chunk[2];
+    memcpy(chunk, bytes + offset, sizeof(chunk));
+    offset += sizeof(chunk);
+    if (offset + chunk[0] > header[2])
+    {
+      QTZ_ERROR("\"{}\" has a truncated chunk", path);
+      return Quartz_Failure;
+    }
+
+    if (!foundJson)
+    {
+      if (chunk[1] != GLB_CHUNK_JSON)
+      {
+        QTZ_ERROR("\"{}\" does not start with a JSON chunk", path);
+        return Quartz_Failure;
+      }
+      QTZ_ATTEMPT(ParseJson((const char*)bytes + offset, chunk[0], &glb->document));
+      foundJson = true;
+    }
+    else if (chunk[1] == GLB_CHUNK_BIN && !glb->bin)
+    {
+      glb->bin = bytes + offset;
+      glb->binSize = chunk[0];
+    }
+
+    // Unknown chunks are skipped, chunks are padded to 4 bytes
+    offset += (chunk[0] + 3) & ~3ull;
+  }
+
+  if (!foundJson)
+  {
+    QTZ_ERROR("\"{}\" has no JSON chunk", path);
+    return Quartz_Failure;
+  }
+
+  return Quartz_Success;
+}
+
+// Accessors
+// ============================================================
+
+struct GltfAccessor
+{
+  const uint8_t* data; // First element
+  uint32_t count;
+  uint32_t stride;
+  uint32_t componentType;
+  uint32_t componentCount;
+  bool normalized;
+};
+
+static uint32_t ComponentSize(uint32_t componentType)
+{
+  switch (componentType)
+  {
+  case GLTF_BYTE: case GLTF_UNSIGNED_BYTE: return 1;
+  case GLTF_SHORT: case GLTF_UNSIGNED_SHORT: return 2;
+  case GLTF_UNSIGNED_INT: case GLTF_FLOAT: return 4;
+  default: return 0;
+  }
+}
+
+static uint32_t ComponentCount(const char* type)
+{
+  if (strcmp(type, "SCALAR") == 0) return 1;
+  if (strcmp(type, "VEC2") == 0) return 2;
+  if (strcmp(type, "VEC3") == 0) return 3;
+  if (strcmp(type, "VEC4") == 0) return 4;
+  return 0;
+}
+
+// Resolves an accessor to a strided view of the BIN chunk, checking every element lies inside its buffer view
+static bool ResolveAccessor(const GlbFile& glb, uint32_t index, GltfAccessor* out)
+{
+  const JsonValue* accessors = glb.document.Find("accessors");
+  const JsonValue* views = glb.document.Find("bufferViews");
+  const JsonValue* buffers = glb.document.Find("buffers");
+  if (!accessors || index >= accessors->Size() || !views || !buffers)
+  {
+    return false;
+  }
+
+  const JsonValue& accessor = (*accessors)[index];
+  uint32_t viewIndex = accessor.Uint("bufferView", ~0u);
+  if (viewIndex >= views->Size() || accessor.Find("sparse"))
+  {
+    // Views without a buffer are all zeros and sparse accessors patch them, neither appear in exported meshes
+    QTZ_ERROR("glTF accessor {} is sparse or has no buffer view, which is not supported", index);
+    return false;
+  }
+
+  const JsonValue& view = (*views)[viewIndex];
+  uint32_t bufferIndex = view.Uint("buffer", ~0u);
+  if (bufferIndex >= buffers->Size() || (*buffers)[bufferIndex].Find("uri"))
+  {
+    QTZ_ERROR("glTF buffer view {} references an external buffer, only the glb's BIN chunk is supported", viewIndex);
+    return false;
+  }
+
+  out->count = accessor.Uint("count", 0);
+  out->componentType = accessor.Uint("componentType", 0);
+  out->componentCount = ComponentCount(accessor.String("type", ""));
+  out->normalized = accessor.Bool("normalized", false);
+
+  uint32_t elementSize = ComponentSize(out->componentType) * out->componentCount;
+  uint64_t viewOffset = (uint64_t)view.Number("byteOffset", 0.0);
+  uint64_t viewLength = (uint64_t)view.Number("byteLength", 0.0);
+  uint64_t accessorOffset = (uint64_t)accessor.Number("byteOffset", 0.0);
+  out->stride = view.Uint("byteStride", elementSize);
+
+  if (elementSize == 0 || out->stride < elementSize || viewOffset + viewLength > glb.binSize
+    || (out->count && accessorOffset + (uint64_t)(out->count - 1) * out->stride + elementSize > viewLength))
+  {
+    QTZ_ERROR("glTF accessor {} is malformed or outside of its buffer", index);
+    return false;
+  }
+
+  out->data = glb.bin + viewOffset + accessorOffset;
+  return true;
+}
+
+// Reads one element as floats, applying normalization as the glTF spec defines it
+static void ReadFloats(const GltfAccessor& accessor, uint32_t element, float* out, uint32_t count)
+{
+  const uint8_t* data = accessor.data + (uint64_t)element * accessor.stride;
+  count = std::min(count, accessor.componentCount);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    switch (accessor.componentType)
+    {
+    case GLTF_FLOAT: memcpy(&out[i], data + i * 4, 4); break;
+    case GLTF_UNSIGNED_BYTE:
+    {
+      float value = (float)data[i];
+      out[i] = accessor.normalized ? value / 255.0f : value;
+    } break;
+    case GLTF_BYTE:
+    {
+      float value = (float)(int8_t)data[i];
+      out[i] = accessor.normalized ? std::max(value / 127.0f, -1.0f) : value;
+    } break;
+    case GLTF_UNSIGNED_SHORT:
+    {
+      uint16_t raw;
+      memcpy(&raw, data + i * 2, 2);
+      out[i] = accessor.normalized ? (float)raw / 65535.0f : (float)raw;
+    } break;
+    case GLTF_SHORT:
+    {
+      int16_t raw;
+      memcpy(&raw, data + i * 2, 2);
+      out[i] = accessor.normalized ? std::max((float)raw / 32767.0f, -1.0f) : (float)raw;
+    } break;
+    default: out[i] = 0.0f; break;
+    }
+  }
+}
+
+// Primitives
+// ============================================================
+
+// Indices and vertices point either into the mapped file or into the decoded copies
+struct GltfPrimitive
+{
+  bool valid = false;
+  const Vertex* vertices = nullptr;
+  uint64_t vertexCount = 0;
+  const uint32_t* indices = nullptr;
+  uint64_t indexCount = 0;
+
+  std::vector<Vertex> decodedVertices;
+  std::vector<uint32_t> decodedIndices;
+};
+
+#define GLTF_DECODE_BATCH_SIZE 16384
+
+static bool FindAttribute(const GlbFile& glb, const JsonValue& attributes, const char* name, GltfAccessor* out)
+{
+  const JsonValue* index = attributes.Find(name);
+  return index && index->type == Json_Number && ResolveAccessor(glb, (uint32_t)index->number, out);
+}
+
+static bool IsFloatAccessor(const GltfAccessor& accessor, uint32_t componentCount)
+{
+  return accessor.componentType == GLTF_FLOAT && accessor.componentCount == componentCount;
+}
+
+// Exporters that interleave POSITION, TEXCOORD_0, NORMAL and TANGENT exactly as Vertex lays them out
+//   need no decode, the mapped pages are uploaded as they are. TANGENT's w lands in bitangentSign
+static bool MatchesVertexLayout(const GltfAccessor& position, const GltfAccessor& uv, const GltfAccessor& normal, const GltfAccessor& tangent)
+{
+  static_assert(offsetof(Vertex, bitangentSign) == offsetof(Vertex, tangent) + 3 * sizeof(float), "TANGENT is read as one vec4");
+
+  const uint8_t* base = position.data;
+  return ((uintptr_t)base % alignof(Vertex)) == 0
+    && position.stride == sizeof(Vertex)
+    && IsFloatAccessor(uv, 2) && uv.stride == sizeof(Vertex) && uv.data == base + offsetof(Vertex, uv)
+    && IsFloatAccessor(normal, 3) && normal.stride == sizeof(Vertex) && normal.data == base + offsetof(Vertex, normal)
+    && IsFloatAccessor(tangent, 4) && tangent.stride == sizeof(Vertex) && tangent.data == base + offsetof(Vertex, tangent);
+}
+
+static bool DecodePrimitive(const GlbFile& glb, const JsonValue& primitive, GltfImportInfo importInfo, GltfPrimitive* out)
+{
+  if (primitive.Uint("mode", GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES)
+  {
+    QTZ_WARNING("Skipping glTF primitive that is not a triangle list");
+    return false;
+  }
+
+  const JsonValue* attributes = primitive.Find("attributes");
+  GltfAccessor position, uv, normal, tangent;
+  if (!attributes || !FindAttribute(glb, *attributes, "POSITION", &position) || !IsFloatAccessor(position, 3))
+  {
+    QTZ_ERROR("glTF primitive has no float3 POSITION attribute");
+    return false;
+  }
+  const uint32_t vertexCount = position.count;
+
+  // Missing or mismatched attributes are treated alike
+  bool hasUv = FindAttribute(glb, *attributes, "TEXCOORD_0", &uv) && uv.count == vertexCount;
+  bool hasNormal = FindAttribute(glb, *attributes, "NORMAL", &normal) && IsFloatAccessor(normal, 3) && normal.count == vertexCount;
+  // VEC4, w is the bitangent sign
+  bool hasTangent = FindAttribute(glb, *attributes, "TANGENT", &tangent) && IsFloatAccessor(tangent, 4) && tangent.count == vertexCount;
+
+  // Indices ==============================
+
+  const JsonValue* indicesIndex = primitive.Find("indices");
+  if (indicesIndex && indicesIndex->type == Json_Number)
+  {
+    GltfAccessor indices;
+    if (!ResolveAccessor(glb, (uint32_t)indicesIndex->number, &indices) || indices.componentCount != 1)
+    {
+      return false;
+    }
+
+    out->indexCount = indices.count;
+    if (indices.componentType == GLTF_UNSIGNED_INT && indices.stride == 4 && ((uintptr_t)indices.data % 4) == 0)
+    {
+      out->indices = (const uint32_t*)indices.data;
+    }
+    else
+    {
+      out->decodedIndices.resize(indices.count);
+      for (uint32_t i = 0; i < indices.count; i++)
+      {
+        const uint8_t* element = indices.data + (uint64_t)i * indices.stride;
+        switch (indices.componentType)
+        {
+        case GLTF_UNSIGNED_BYTE: out->decodedIndices[i] = *element; break;
+        case GLTF_UNSIGNED_SHORT: { uint16_t value; memcpy(&value, element, 2); out->decodedIndices[i] = value; } break;
+        case GLTF_UNSIGNED_INT: memcpy(&out->decodedIndices[i], element, 4); break;
+        default: QTZ_ERROR("glTF indices have an invalid component type"); return false;
+        }
+      }
+      out->indices = out->decodedIndices.data();
+    }
+  }
+  else
+  {
+    // Non-indexed, every three vertices form a triangle
+    out->decodedIndices.resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+      out->decodedIndices[i] = i;
+    }
+    out->indices = out->decodedIndices.data();
+    out->indexCount = vertexCount;
+  }
+
+  out->indexCount -= out->indexCount % 3;
+  for (uint64_t i = 0; i < out->indexCount; i++)
+  {
+    if (out->indices[i] >= vertexCount)
+    {
+      QTZ_ERROR("glTF primitive has an index out of range");
+      return false;
+    }
+  }
+
+  // Vertices ==============================
+
+  out->vertexCount = vertexCount;
+
+  if (hasUv && hasNormal && hasTangent && MatchesVertexLayout(position, uv, normal, tangent))
+  {
+    out->vertices = (const Vertex*)position.data;
+    out->valid = true;
+    return true;
+  }
+
+  // Gathered straight from the mapped pages in batches across the workers
+  out->decodedVertices.resize(vertexCount);
+  Vertex* vertices = out->decodedVertices.data();
+  ParallelForRange(vertexCount, GLTF_DECODE_BATCH_SIZE, [&](uint32_t begin, uint32_t end)
+  {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      Vertex& v = vertices[i];
+      v = {};
+      ReadFloats(position, i, &v.position.x, 3);
+      if (hasUv)
+      {
+        ReadFloats(uv, i, &v.uv.x, 2);
+      }
+      if (hasNormal)
+      {
+        ReadFloats(normal, i, &v.normal.x, 3);
+      }
+      if (hasTangent)
+      {
+        float tangentSign[4];
+        ReadFloats(tangent, i, tangentSign, 4);
+        v.tangent = Vec3{ tangentSign[0], tangentSign[1], tangentSign[2] };
+        v.bitangentSign = tangentSign[3] < 0.0f ? -1.0f : 1.0f;
+      }
+    }
+  });
+
+  if (!hasNormal)
+  {
+    GenerateMissingNormals(&out->decodedVertices, out->indices, out->indexCount);
+  }
+
+  if (!hasTangent && importInfo.generateMissingTangents)
+  {
+    // Vertices on uv seams can be split, which rewrites their indices
+    if (out->indices != out->decodedIndices.data() || out->decodedIndices.size() != out->indexCount)
+    {
+      out->decodedIndices.assign(out->indices, out->indices + out->indexCount);
+    }
+    GenerateTangents(&out->decodedVertices, &out->decodedIndices);
+    out->indices = out->decodedIndices.data();
+    out->vertexCount = out->decodedVertices.size();
+  }
+
+  out->vertices = out->decodedVertices.data();
+  out->valid = true;
+  return true;
+}
+
+// Transforms
+// ============================================================
+// glTF : right handed, +Y up, quaternions as [x, y, z, w], matrices column-major
+
+static Quaternion QuaternionMultiply(const Quaternion& a, const Quaternion& b)
+{
+  Quaternion q;
+  q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+  q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+  q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+  q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+  return q;
+}
+
+static Vec3 QuaternionRotate(const Quaternion& q, const Vec3& v)
+{
+  // v + 2w(u x v) + 2u x (u x v)
+  Vec3 u = Vec3{ q.x, q.y, q.z };
+  Vec3 uv = Vec3{ u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x };
+  Vec3 uuv = Vec3{ u.y * uv.z - u.z * uv.y, u.z * uv.x - u.x * uv.z, u.x * uv.y - u.y * uv.x };
+  return v + uv * (2.0f * q.w) + uuv * 2.0f;
+}
+
+static Vec3 Scale(const Vec3& a, const Vec3& b)
+{
+  return Vec3{ a.x * b.x, a.y * b.y, a.z * b.z };
+}
+
+// Splits an affine matrix into translation, rotation and scale, shear is lost
+static Transform DecomposeMatrix(const float* m)
+{
+  Transform t = TransformIdentity;
+  t.position = Vec3{ m[12], m[13], m[14] };
+
+  Vec3 columns[3] = {
+    Vec3{ m[0], m[1], m[2] },
+    Vec3{ m[4], m[5], m[6] },
+    Vec3{ m[8], m[9], m[10] }
+  };
+  t.scale = Vec3{ sqrtf(Dot(columns[0], columns[0])), sqrtf(Dot(columns[1], columns[1])), sqrtf(Dot(columns[2], columns[2])) };
+
+  // Mirrored bases keep their rotation by flipping one scale axis
+  Vec3 cross = Vec3{
+    columns[0].y * columns[1].z - columns[0].z * columns[1].y,
+    columns[0].z * columns[1].x - columns[0].x * columns[1].z,
+    columns[0].x * columns[1].y - columns[0].y * columns[1].x };
+  if (Dot(cross, columns[2]) < 0.0f)
+  {
+    t.scale.x = -t.scale.x;
+  }
+
+  float r[3][3]; // r[column][row]
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    float s = (c == 0) ? t.scale.x : (c == 1) ? t.scale.y : t.scale.z;
+    float inverse = s != 0.0f ? 1.0f / s : 0.0f;
+    r[c][0] = (&columns[c].x)[0] * inverse;
+    r[c][1] = (&columns[c].x)[1] * inverse;
+    r[c][2] = (&columns[c].x)[2] * inverse;
+  }
+
+  // Shepperd's method, branching on the largest diagonal term for stability
+  Quaternion q;
+  float trace = r[0][0] + r[1][1] + r[2][2];
+  if (trace > 0.0f)
+  {
+    float s = sqrtf(trace + 1.0f) * 2.0f;
+    q.w = 0.25f * s;
+    q.x = (r[1][2] - r[2][1]) / s;
+    q.y = (r[2][0] - r[0][2]) / s;
+    q.z = (r[0][1] - r[1][0]) / s;
+  }
+  else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+  {
+    float s = sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+    q.w = (r[1][2] - r[2][1]) / s;
+    q.x = 0.25f * s;
+    q.y = (r[1][0] + r[0][1]) / s;
+    q.z = (r[2][0] + r[0][2]) / s;
+  }
+  else if (r[1][1] > r[2][2])
+  {
+    float s = sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+    q.w = (r[2][0] - r[0][2]) / s;
+    q.x = (r[1][0] + r[0][1]) / s;
+    q.y = 0.25f * s;
+    q.z = (r[2][1] + r[1][2]) / s;
+  }
+  else
+  {
+    float s = sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+    q.w = (r[0][1] - r[1][0]) / s;
+    q.x = (r[2][0] + r[0][2]) / s;
+    q.y = (r[2][1] + r[1][2]) / s;
+    q.z = 0.25f * s;
+  }
+  t.rotation = q;
+
+  return t;
+}
+
+static Transform NodeLocalTransform(const JsonValue& node)
+{
+  float matrix[16];
+  if (node.Numbers("matrix", matrix, 16))
+  {
+    return DecomposeMatrix(matrix);
+  }
+
+  Transform t = TransformIdentity;
+  float values[4];
+  if (node.Numbers("translation", values, 3))
+  {
+    t.position = Vec3{ values[0], values[1], values[2] };
+  }
+  if (node.Numbers("rotation", values, 4))
+  {
+    t.rotation.x = values[0];
+    t.rotation.y = values[1];
+    t.rotation.z = values[2];
+    t.rotation.w = values[3];
+  }
+  if (node.Numbers("scale", values, 3))
+  {
+    t.scale = Vec3{ values[0], values[1], values[2] };
+  }
+  return t;
+}
+
+// Quartz transforms have no parent, so hierarchies are flattened into world transforms
+// Exact unless a non-uniformly scaled parent has rotated children, which would need shear
+static Transform ComposeTransforms(const Transform& parent, const Transform& local)
+{
+  Transform t = TransformIdentity;
+  t.position = parent.position + QuaternionRotate(parent.rotation, Scale(parent.scale, local.position));
+  t.rotation = QuaternionMultiply(parent.rotation, local.rotation);
+  t.scale = Scale(parent.scale, local.scale);
+  return t;
+}
+
+// Scene
+// ============================================================
+
+void ImportedScene::Release(AssetManager* assets)
+{
+  entities.clear();
+  for (MeshHandle handle : meshes)
+  {
+    if (!handle.IsNull())
+    {
+      assets->Release(handle);
+    }
+  }
+  meshes.clear();
+}
+
+QuartzResult ImportGltfScene(const char* path, AssetManager* assets, GltfImportInfo importInfo, ImportedScene* outScene)
+{
+  auto startTime = std::chrono::steady_clock::now();
+
+  GlbFile glb;
+  QTZ_ATTEMPT(OpenGlb(path, &glb), PlatformUnmapFile(&glb.file));
+  const JsonValue& document = glb.document;
+
+  // Decode every primitive ==============================
+
+  const JsonValue* meshes = document.Find("meshes");
+  const uint32_t meshCount = meshes ? (uint32_t)meshes->Size() : 0;
+
+  std::vector<uint32_t> meshFirstPrimitive(meshCount + 1, 0);
+  std::vector<const JsonValue*> primitiveJson;
+  for (uint32_t m = 0; m < meshCount; m++)
+  {
+    meshFirstPrimitive[m] = (uint32_t)primitiveJson.size();
+    const JsonValue* primitives = (*meshes)[m].Find("primitives");
+    for (uint64_t p = 0; primitives && p < primitives->Size(); p++)
+    {
+      primitiveJson.push_back(&(*primitives)[p]);
+    }
+  }
+  meshFirstPrimitive[meshCount] = (uint32_t)primitiveJson.size();
+
+  std::vector<GltfPrimitive> primitives(primitiveJson.size());
+  ParallelFor((uint32_t)primitives.size(), [&](uint32_t index)
+  {
+    if (!DecodePrimitive(glb, *primitiveJson[index], importInfo, &primitives[index]))
+    {
+      primitives[index] = GltfPrimitive{};
+    }
+  });
+
+  // Upload ==============================
+
+  ImportedScene& scene = *outScene;
+  scene.meshes.resize(primitives.size());
+  for (uint32_t i = 0; i < primitives.size(); i++)
+  {
+    GltfPrimitive& primitive = primitives[i];
+    if (primitive.valid && primitive.indexCount)
+    {
+      scene.meshes[i] = assets->LoadMesh(primitive.vertices, primitive.vertexCount, primitive.indices, primitive.indexCount, importInfo.residency);
+    }
+    // Decoded copies are only needed until upload
+    primitive = GltfPrimitive{};
+  }
+
+  // Entities ==============================
+
+  const JsonValue* nodes = document.Find("nodes");
+  const uint32_t nodeCount = nodes ? (uint32_t)nodes->Size() : 0;
+
+  std::vector<uint32_t> roots;
+  const JsonValue* scenes = document.Find("scenes");
+  uint32_t sceneIndex = document.Uint("scene", 0);
+  if (scenes && sceneIndex < scenes->Size())
+  {
+    const JsonValue* sceneNodes = (*scenes)[sceneIndex].Find("nodes");
+    for (uint64_t i = 0; sceneNodes && i < sceneNodes->Size(); i++)
+    {
+      roots.push_back((uint32_t)(*sceneNodes)[i].number);
+    }
+  }
+  else
+  {
+    // Without scenes, every node nobody claims as a child is a root
+    std::vector<uint8_t> isChild(nodeCount, 0);
+    for (uint32_t n = 0; n < nodeCount; n++)
+    {
+      const JsonValue* children = (*nodes)[n].Find("children");
+      for (uint64_t c = 0; children && c < children->Size(); c++)
+      {
+        uint32_t child = (uint32_t)(*children)[c].number;
+        if (child < nodeCount)
+        {
+          isChild[child] = 1;
+        }
+      }
+    }
+    for (uint32_t n = 0; n < nodeCount; n++)
+    {
+      if (!isChild[n])
+      {
+        roots.push_back(n);
+      }
+    }
+  }
+
+  struct PendingNode
+  {
+    uint32_t node;
+    Transform parent;
+  };
+  std::vector<PendingNode> stack;
+  for (uint32_t root : roots)
+  {
+    stack.push_back({ root, TransformIdentity });
+  }
+
+  // Guards against malformed files whose nodes form cycles
+  std::vector<uint8_t> visited(nodeCount, 0);
+  while (!stack.empty())
+  {
+    PendingNode pending = stack.back();
+    stack.pop_back();
+    if (pending.node >= nodeCount || visited[pending.node])
+    {
+      continue;
+    }
+    visited[pending.node] = 1;
+
+    const JsonValue& node = (*nodes)[pending.node];
+    Transform world = ComposeTransforms(pending.parent, NodeLocalTransform(node));
+
+    uint32_t mesh = node.Uint("mesh", ~0u);
+    if (mesh < meshCount)
+    {
+      // Renderables draw one mesh, so each primitive gets its own entity
+      for (uint32_t p = meshFirstPrimitive[mesh]; p < meshFirstPrimitive[mesh + 1]; p++)
+      {
+        if (scene.meshes[p].IsNull())
+        {
+          continue;
+        }
+
+        std::unique_ptr<Entity> entity = std::make_unique<Entity>();
+        *entity->Get<Transform>() = world;
+
+        Renderable renderable = {};
+        renderable.mesh = scene.meshes[p];
+        renderable.material = importInfo.material;
+        renderable.transformMatrix = world.Matrix();
+        *entity->Add<Renderable>() = renderable;
+
+        scene.entities.push_back(std::move(entity));
+      }
+    }
+
+    const JsonValue* children = node.Find("children");
+    for (uint64_t c = 0; children && c < children->Size(); c++)
+    {
+      stack.push_back({ (uint32_t)(*children)[c].number, world });
+    }
+  }
+
+  PlatformUnmapFile(&glb.file);
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  QTZ_DEBUG("Imported \"{}\" : {} primitives, {} entities in {:.3f}s", path, primitives.size(), scene.entities.size(), seconds);
+  return Quartz_Success;
+}
+
+} // namespace Quartz
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/core/ecs.h"
+#include "quartz/assets/asset_handle.h"
+#include "quartz/assets/mesh_import.h"
+
+#include <memory>
+#include <vector>
+
+namespace Quartz
+{
+
+class AssetManager;
+class Material;
+
+struct GltfImportInfo
+{
+  // Given to every renderable, glTF materials do not map onto Quartz's shader-defined materials
+  Material* material = nullptr;
+  bool generateMissingTangents = true;
+  MeshResidency residency = Mesh_Residency_Gpu;
+};
+
+// Everything a scene import created
+// Entities are destroyed with the scene, Release() returns the scene's references to its meshes
+struct ImportedScene
+{
+  std::vector<std::unique_ptr<Entity>> entities;
+  std::vector<MeshHandle> meshes; // One per mesh primitive
+
+  void Release(AssetManager* assets);
+};
+
+// Imports a binary glTF 2.0 (.glb) scene in one pass
+// The file is mapped and every primitive is decoded across the job workers straight from the mapped pages
+//   uint32 index accessors are read in place, VEC4 tangents keep their w as Vertex::bitangentSign
+// Each node with a mesh becomes one entity per primitive, with a Transform flattened from the node hierarchy
+//   and a Renderable. Cameras, lights, skins, animations and morph targets are ignored
+QuartzResult ImportGltfScene(const char* path, AssetManager* assets, GltfImportInfo importInfo, ImportedScene* outScene);
+
+} // namespace Quartz
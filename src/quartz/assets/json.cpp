@@ -0,0 +1,445 @@
+
+#include "quartz/defines.h"
+#include "quartz/assets/json.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace Quartz
+{
+
+// Value access
+// ============================================================
+
+const JsonValue* JsonValue::Find(const char* key) const
+{
+  if (type != Json_Object)
+  {
+    return nullptr;
+  }
+
+  for (const auto& member : members)
+  {
+    if (member.first == key)
+    {
+      return &member.second;
+    }
+  }
+  return nullptr;
+}
+
+double JsonValue::Number(const char* key, double defaultValue) const
+{
+  const JsonValue* value = Find(key);
+  return (value && value->type == Json_Number) ? value->number : defaultValue;
+}
+
+uint32_t JsonValue::Uint(const char* key, uint32_t defaultValue) const
+{
+  const JsonValue* value = Find(key);
+  return (value && value->type == Json_Number && value->number >= 0.0) ? (uint32_t)value->number : defaultValue;
+}
+
+bool JsonValue::Bool(const char* key, bool defaultValue) const
+{
+  const JsonValue* value = Find(key);
+  return (value && value->type == Json_Bool) ? value->boolean : defaultValue;
+}
+
+const char* JsonValue::String(const char* key, const char* defaultValue) const
+{
+  const JsonValue* value = Find(key);
+  return (value && value->type == Json_String) ? value->string.c_str() : defaultValue;
+}
+
+bool JsonValue::Numbers(const char* key, float* outValues, uint32_t count) const
+{
+  const JsonValue* value = Find(key);
+  if (!value || value->type != Json_Array || value->elements.size() < count)
+  {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (value->elements[i].type != Json_Number)
+    {
+      return false;
+    }
+    outValues[i] = (float)value->elements[i].number;
+  }
+  return true;
+}
+
+// Parsing
+// ============================================================
+
+#define JSON_MAX_DEPTH 256
+
+struct JsonParser
+{
+  const char* cursor;
+  const char* end;
+  uint32_t depth;
+};
+
+static void SkipWhitespace(JsonParser* parser)
+{
+  while (parser->cursor < parser->end)
+  {
+    char c = *parser->cursor;
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+    {
+      return;
+    }
+    parser->cursor++;
+  }
+}
+
+static bool ConsumeLiteral(JsonParser* parser, const char* literal)
+{
+  size_t length = strlen(literal);
+  if ((size_t)(parser->end - parser->cursor) < length || memcmp(parser->cursor, literal, length) != 0)
+  {
+    return false;
+  }
+  parser->cursor += length;
+  return true;
+}
+
+static bool ParseHex4(JsonParser* parser, uint32_t* outCode)
+{
+  if (parser->end - parser->cursor < 4)
+  {
+    return false;
+  }
+
+  uint32_t code = 0;
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    char c = *parser->cursor++;
+    code <<= 4;
+    if (c >= '0' && c <= '9') code |= (uint32_t)(c - '0');
+    else if (c >= 'a' && c <= 'f') code |= (uint32_t)(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F') code |= (uint32_t)(c - 'A' + 10);
+    else return false;
+  }
+  *outCode = code;
+  return true;
+}
+
+static void AppendUtf8(std::string* out, uint32_t code)
+{
+  if (code < 0x80)
+  {
+    out->push_back((char)code);
+  }
+  else if (code < 0x800)
+  {
+    out->push_back((char)(0xc0 | (code >> 6)));
+    out->push_back((char)(0x80 | (code & 0x3f)));
+  }
+  else if (code < 0x10000)
+  {
+    out->push_back((char)(0xe0 | (code >> 12)));
+    out->push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+    out->push_back((char)(0x80 | (code & 0x3f)));
+  }
+  else
+  {
+    out->push_back((char)(0xf0 | (code >> 18)));
+    out->push_back((char)(0x80 | ((code >> 12) & 0x3f)));
+    out->push_back((char)(0x80 | ((code >> 6) & 0x3f)));
+    out->push_back((char)(0x80 | (code & 0x3f)));
+  }
+}
+
+static bool ParseString(JsonParser* parser, std::string* out)
+{
+  // Opening quote already checked by the caller
+  parser->cursor++;
+
+  while (parser->cursor < parser->end)
+  {
+    // Copy plain runs at once, most strings contain no escapes
+    const char* runStart = parser->cursor;
+    while (parser->cursor < parser->end && *parser->cursor != '"' && *parser->cursor != '\\' && (uint8_t)*parser->cursor >= 0x20)
+    {
+      parser->cursor++;
+    }
+    out->append(runStart, parser->cursor);
+
+    if (parser->cursor == parser->end || (uint8_t)*parser->cursor < 0x20)
+    {
+      return false;
+    }
+
+    if (*parser->cursor == '"')
+    {
+      parser->cursor++;
+      return true;
+    }
+
+    // Escape ==============================
+
+    parser->cursor++;
+    if (parser->cursor == parser->end)
+    {
+      return false;
+    }
+
+    char escape = *parser->cursor++;
+    switch (escape)
+    {
+    case '"': out->push_back('"'); break;
+    case '\\': out->push_back('\\'); break;
+    case '/': out->push_back('/'); break;
+    case 'b': out->push_back('\b'); break;
+    case 'f': out->push_back('\f'); break;
+    case 'n': out->push_back('\n'); break;
+    case 'r': out->push_back('\r'); break;
+    case 't': out->push_back('\t'); break;
+    case 'u':
+    {
+      uint32_t code;
+      if (!ParseHex4(parser, &code))
+      {
+        return false;
+      }
+
+      // Surrogate pair
+      if (code >= 0xd800 && code < 0xdc00)
+      {
+        uint32_t low;
+        if (!ConsumeLiteral(parser, "\\u") || !ParseHex4(parser, &low) || low < 0xdc00 || low >= 0xe000)
+        {
+          return false;
+        }
+        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+      }
+      else if (code >= 0xdc00 && code < 0xe000)
+      {
+        return false;
+      }
+
+      AppendUtf8(out, code);
+    } break;
+    default: return false;
+    }
+  }
+
+  return false;
+}
+
+static bool ParseNumber(JsonParser* parser, double* out)
+{
+  // Validate the grammar first, strtod alone would also accept hex, infinities and leading '+'
+  const char* c = parser->cursor;
+  const char* end = parser->end;
+
+  if (c < end && *c == '-') c++;
+  if (c == end) return false;
+  if (*c == '0')
+  {
+    c++;
+  }
+  else if (*c >= '1' && *c <= '9')
+  {
+    while (c < end && *c >= '0' && *c <= '9') c++;
+  }
+  else
+  {
+    return false;
+  }
+
+  if (c < end && *c == '.')
+  {
+    c++;
+    if (c == end || *c < '0' || *c > '9') return false;
+    while (c < end && *c >= '0' && *c <= '9') c++;
+  }
+
+  if (c < end && (*c == 'e' || *c == 'E'))
+  {
+    c++;
+    if (c < end && (*c == '+' || *c == '-')) c++;
+    if (c == end || *c < '0' || *c > '9') return false;
+    while (c < end && *c >= '0' && *c <= '9') c++;
+  }
+
+  // The text is not null-terminated, copy short numbers to the stack
+  char buffer[64];
+  size_t length = (size_t)(c - parser->cursor);
+  if (length >= sizeof(buffer))
+  {
+    std::string copy(parser->cursor, length);
+    *out = strtod(copy.c_str(), nullptr);
+  }
+  else
+  {
+    memcpy(buffer, parser->cursor, length);
+    buffer[length] = '\0';
+    *out = strtod(buffer, nullptr);
+  }
+
+  parser->cursor = c;
+  return true;
+}
+
+static bool ParseValue(JsonParser* parser, JsonValue* out)
+{
+  SkipWhitespace(parser);
+  if (parser->cursor == parser->end)
+  {
+    return false;
+  }
+
+  switch (*parser->cursor)
+  {
+  case 'n': out->type = Json_Null; return ConsumeLiteral(parser, "null");
+  case 't': out->type = Json_Bool; out->boolean = true; return ConsumeLiteral(parser, "true");
+  case 'f': out->type = Json_Bool; out->boolean = false; return ConsumeLiteral(parser, "false");
+  case '"': out->type = Json_String; return ParseString(parser, &out->string);
+  case '[':
+  {
+    if (++parser->depth > JSON_MAX_DEPTH)
+    {
+      return false;
+    }
+
+    out->type = Json_Array;
+    parser->cursor++;
+    SkipWhitespace(parser);
+    if (parser->cursor < parser->end && *parser->cursor == ']')
+    {
+      parser->cursor++;
+      parser->depth--;
+      return true;
+    }
+
+    while (true)
+    {
+      out->elements.emplace_back();
+      if (!ParseValue(parser, &out->elements.back()))
+      {
+        return false;
+      }
+
+      SkipWhitespace(parser);
+      if (parser->cursor == parser->end)
+      {
+        return false;
+      }
+
+      char c = *parser->cursor++;
+      if (c == ']')
+      {
+        break;
+      }
+      if (c != ',')
+      {
+        return false;
+      }
+    }
+
+    parser->depth--;
+    return true;
+  }
+  case '{':
+  {
+    if (++parser->depth > JSON_MAX_DEPTH)
+    {
+      return false;
+    }
+
+    out->type = Json_Object;
+    parser->cursor++;
+    SkipWhitespace(parser);
+    if (parser->cursor < parser->end && *parser->cursor == '}')
+    {
+      parser->cursor++;
+      parser->depth--;
+      return true;
+    }
+
+    while (true)
+    {
+      SkipWhitespace(parser);
+      if (parser->cursor == parser->end || *parser->cursor != '"')
+      {
+        return false;
+      }
+
+      out->members.emplace_back();
+      if (!ParseString(parser, &out->members.back().first))
+      {
+        return false;
+      }
+
+      SkipWhitespace(parser);
+      if (parser->cursor == parser->end || *parser->cursor++ != ':')
+      {
+        return false;
+      }
+
+      if (!ParseValue(parser, &out->members.back().second))
+      {
+        return false;
+      }
+
+      SkipWhitespace(parser);
+      if (parser->cursor == parser->end)
+      {
+        return false;
+      }
+
+      char c = *parser->cursor++;
+      if (c == '}')
+      {
+        break;
+      }
+      if (c != ',')
+      {
+        return false;
+      }
+    }
+
+    parser->depth--;
+    return true;
+  }
+  default:
+  {
+    out->type = Json_Number;
+    return ParseNumber(parser, &out->number);
+  }
+  }
+}
+
+QuartzResult ParseJson(const char* text, uint64_t length, JsonValue* outValue)
+{
+  JsonParser parser = { text, text + length, 0 };
+  *outValue = JsonValue{};
+
+  // Tolerate a UTF-8 byte order mark
+  if (length >= 3 && memcmp(text, "\xef\xbb\xbf", 3) == 0)
+  {
+    parser.cursor += 3;
+  }
+
+  if (!ParseValue(&parser, outValue))
+  {
+    QTZ_ERROR("Malformed json at byte {}", (uint64_t)(parser.cursor - text));
+    return Quartz_Failure;
+  }
+
+  SkipWhitespace(&parser);
+  if (parser.cursor != parser.end)
+  {
+    QTZ_ERROR("Unexpected content after json value at byte {}", (uint64_t)(parser.cursor - text));
+    return Quartz_Failure;
+  }
+
+  return Quartz_Success;
+}
+
+} // namespace Quartz
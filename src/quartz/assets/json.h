@@ -0,0 +1,53 @@
+#pragma once
+
+#include "quartz/defines.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Quartz
+{
+
+// Json
+// ============================================================
+// Minimal read-only document model, enough for asset metadata such as glTF's JSON chunk
+
+enum JsonType
+{
+  Json_Null,
+  Json_Bool,
+  Json_Number,
+  Json_String,
+  Json_Array,
+  Json_Object
+};
+
+struct JsonValue
+{
+  JsonType type = Json_Null;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<JsonValue> elements; // Array elements
+  std::vector<std::pair<std::string, JsonValue>> members; // Object members in file order
+
+  // Returns nullptr if this is not an object or has no such member
+  const JsonValue* Find(const char* key) const;
+
+  inline uint64_t Size() const { return type == Json_Array ? elements.size() : 0; }
+  inline const JsonValue& operator[](uint64_t index) const { return elements[index]; }
+
+  // Typed member reads, defaultValue is returned when the member is missing or of another type
+  double Number(const char* key, double defaultValue) const;
+  uint32_t Uint(const char* key, uint32_t defaultValue) const;
+  bool Bool(const char* key, bool defaultValue) const;
+  const char* String(const char* key, const char* defaultValue) const;
+  // Reads up to count numbers from an array member, returns false if it is missing or not all numbers
+  bool Numbers(const char* key, float* outValues, uint32_t count) const;
+};
+
+// Parses UTF-8 text (RFC 8259). Fails on malformed input, trailing content or nesting beyond 256 levels
+QuartzResult ParseJson(const char* text, uint64_t length, JsonValue* outValue);
+
+} // namespace Quartz
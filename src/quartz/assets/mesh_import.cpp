@@ -0,0 +1,136 @@
+
+#include "quartz/defines.h"
+#include "quartz/assets/mesh_import.h"
+#include "quartz/assets/obj_loader.h"
+#include "quartz/assets/mesh_tangents.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace Quartz
+{
+
+QuartzResult ImportMesh(
+  const char* path,
+  MeshImportInfo importInfo,
+  std::vector<Vertex>* outVertices,
+  std::vector<uint32_t>* outIndices,
+  std::vector<MeshLod>* outLods,
+  std::vector<Meshlet>* outMeshlets)
+{
+  std::vector<Vertex> triangleVertices;
+  QTZ_ATTEMPT(LoadObj(path, &triangleVertices));
+
+  // Assemble mesh =====
+  std::vector<Vertex>& verticies = *outVertices;
+  std::vector<uint32_t>& indices = *outIndices;
+  QTZ_ATTEMPT(WeldVertices(triangleVertices, importInfo.weld, &verticies, &indices));
+  triangleVertices = std::vector<Vertex>();
+
+  if (importInfo.optimize)
+  {
+    MeshOptimizeStats optimizeStats;
+    OptimizeMesh(&verticies, &indices, importInfo.optimization, &optimizeStats);
+    QTZ_DEBUG(
+      "Optimized mesh \"{}\"\n    ACMR : {:.3f} -> {:.3f}\n    ATVR : {:.3f} -> {:.3f}",
+      path,
+      optimizeStats.before.acmr, optimizeStats.after.acmr,
+      optimizeStats.before.atvr, optimizeStats.after.atvr);
+  }
+
+  // Every level shares the vertices, normals and tangents only come from the full detail surface
+  // Welding has already joined the corners of faces written without normals, so generated normals are smooth across them
+  GenerateMissingNormals(&verticies, indices.data(), indices.size());
+  GenerateTangents(&verticies, &indices);
+
+  // Reorders the full detail level, so it runs before the other levels are appended
+  if (outMeshlets)
+  {
+    outMeshlets->clear();
+    if (importInfo.buildMeshlets && indices.size() / 3 >= importInfo.meshletMinTriangleCount)
+    {
+      BuildMeshlets(verticies, &indices, outMeshlets);
+      QTZ_DEBUG("Built {} meshlets for \"{}\"", outMeshlets->size(), path);
+    }
+  }
+
+  // Without outLods the caller expects a single level
+  std::vector<MeshLod> lods = { { 0, (uint32_t)indices.size(), 0.0f } };
+  if (importInfo.generateLods && outLods)
+  {
+    std::vector<uint32_t> lodIndices;
+    GenerateLodChain(verticies, indices, importInfo.lod, &lodIndices, &lods);
+    indices.swap(lodIndices);
+    QTZ_DEBUG("Generated {} LODs for \"{}\", coarsest has {} triangles", lods.size(), path, lods.back().indexCount / 3);
+  }
+
+  if (outLods)
+  {
+    *outLods = std::move(lods);
+  }
+
+  return Quartz_Success;
+}
+
+MeshBounds ComputeMeshBounds(const Vertex* vertices, uint64_t vertexCount)
+{
+  MeshBounds bounds = {};
+  if (vertexCount == 0)
+  {
+    return bounds;
+  }
+
+  bounds.min = vertices[0].position;
+  bounds.max = vertices[0].position;
+  for (uint64_t i = 1; i < vertexCount; i++)
+  {
+    const Vec3& p = vertices[i].position;
+    bounds.min = Vec3{ std::min(bounds.min.x, p.x), std::min(bounds.min.y, p.y), std::min(bounds.min.z, p.z) };
+    bounds.max = Vec3{ std::max(bounds.max.x, p.x), std::max(bounds.max.y, p.y), std::max(bounds.max.z, p.z) };
+  }
+
+  bounds.sphereCenter = (bounds.min + bounds.max) * 0.5f;
+  float radiusSquared = 0.0f;
+  for (uint64_t i = 0; i < vertexCount; i++)
+  {
+    Vec3 offset = vertices[i].position - bounds.sphereCenter;
+    radiusSquared = std::max(radiusSquared, Dot(offset, offset));
+  }
+  bounds.sphereRadius = sqrtf(radiusSquared);
+
+  return bounds;
+}
+
+float ComputeUvDensity(const Vertex* vertices, const uint32_t* indices, uint64_t indexCount)
+{
+  double surfaceArea = 0.0;
+  double uvArea = 0.0;
+  for (uint64_t i = 0; i + 2 < indexCount; i += 3)
+  {
+    const Vertex& a = vertices[indices[i]];
+    const Vertex& b = vertices[indices[i + 1]];
+    const Vertex& c = vertices[indices[i + 2]];
+
+    Vec3 edgeA = b.position - a.position;
+    Vec3 edgeB = c.position - a.position;
+    Vec3 normal = Vec3{
+      edgeA.y * edgeB.z - edgeA.z * edgeB.y,
+      edgeA.z * edgeB.x - edgeA.x * edgeB.z,
+      edgeA.x * edgeB.y - edgeA.y * edgeB.x };
+    surfaceArea += 0.5 * sqrt((double)Dot(normal, normal));
+
+    double uvAx = b.uv.x - a.uv.x;
+    double uvAy = b.uv.y - a.uv.y;
+    double uvBx = c.uv.x - a.uv.x;
+    double uvBy = c.uv.y - a.uv.y;
+    uvArea += 0.5 * fabs(uvAx * uvBy - uvAy * uvBx);
+  }
+
+  if (uvArea <= 0.0)
+  {
+    return 0.0f;
+  }
+  return (float)sqrt(surfaceArea / uvArea);
+}
+
+} // namespace Quartz
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+#include "quartz/assets/mesh_weld.h"
+#include "quartz/assets/mesh_optimize.h"
+#include "quartz/assets/mesh_simplify.h"
+#include "quartz/assets/mesh_meshlets.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Where a mesh's geometry lives once it has been uploaded
+enum MeshResidency
+{
+  Mesh_Residency_Gpu,       // CPU copies are released after upload
+  Mesh_Residency_CpuAndGpu, // CPU copies are retained for Dump(), picking, physics, etc.
+};
+
+// Processing applied to meshes loaded from source files
+struct MeshImportInfo
+{
+  MeshWeldInfo weld = {};
+  bool optimize = true; // Reorder for the vertex cache, overdraw and vertex fetch
+  MeshOptimizeInfo optimization = {};
+  bool generateLods = false; // Simplification is slow, meshes are usually given LODs when cooked
+  MeshLodInfo lod = {};
+  bool buildMeshlets = false; // Split the full detail level into meshlets for cluster culling
+  uint32_t meshletMinTriangleCount = 4096; // Smaller meshes are cheaper to draw whole
+  MeshResidency residency = Mesh_Residency_Gpu;
+};
+
+// Everything ImportMesh() produces, in the form Mesh::Init() consumes it
+struct MeshImportData
+{
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<MeshLod> lods;
+  std::vector<Meshlet> meshlets;
+};
+
+// Loads, welds, optimizes, generates LODs, missing normals and tangents for a source mesh
+// Independent of the renderer so it can run in offline tools
+// outIndices holds every LOD's indices back to back, outLods always describes at least the full detail level
+// outMeshlets is left empty unless meshlets were built
+QuartzResult ImportMesh(
+  const char* path,
+  MeshImportInfo importInfo,
+  std::vector<Vertex>* outVertices,
+  std::vector<uint32_t>* outIndices,
+  std::vector<MeshLod>* outLods = nullptr,
+  std::vector<Meshlet>* outMeshlets = nullptr);
+
+// Axis aligned box and a bounding sphere centered on it
+MeshBounds ComputeMeshBounds(const Vertex* vertices, uint64_t vertexCount);
+
+// Object space units per unit of uv space, averaged over the surface : sqrt(surface area / uv area)
+// 0 if the triangles cover no uv area. Texture streaming uses it to turn screen size into texel density
+float ComputeUvDensity(const Vertex* vertices, const uint32_t* indices, uint64_t indexCount);
+
+} // namespace Quartz
@@ -0,0 +1,222 @@
+
+#include "quartz/defines.h"
+#include "quartz/assets/mesh_meshlets.h"
+#include "quartz/assets/mesh_optimize.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+namespace Quartz
+{
+
+// Bounds
+// ============================================================
+
+static void ComputeMeshletBounds(
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& indices,
+  const std::vector<uint32_t>& meshletVertices,
+  const std::vector<uint32_t>& meshletTriangles,
+  Meshlet* meshlet)
+{
+  // Sphere around the vertex centroid ==============================
+
+  Vec3 center = { 0.0f, 0.0f, 0.0f };
+  for (uint32_t v : meshletVertices)
+  {
+    center = center + vertices[v].position;
+  }
+  center = center * (1.0f / (float)meshletVertices.size());
+
+  float radiusSquared = 0.0f;
+  for (uint32_t v : meshletVertices)
+  {
+    Vec3 offset = vertices[v].position - center;
+    radiusSquared = std::max(radiusSquared, Dot(offset, offset));
+  }
+  meshlet->center = center;
+  meshlet->radius = sqrtf(radiusSquared);
+
+  // Normal cone ==============================
+
+  std::vector<Vec3> normals;
+  normals.reserve(meshletTriangles.size());
+  Vec3 axis = { 0.0f, 0.0f, 0.0f };
+  for (uint32_t triangle : meshletTriangles)
+  {
+    const Vec3& p0 = vertices[indices[triangle * 3 + 0]].position;
+    Vec3 e1 = vertices[indices[triangle * 3 + 1]].position - p0;
+    Vec3 e2 = vertices[indices[triangle * 3 + 2]].position - p0;
+    Vec3 n = Vec3{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+    float length = sqrtf(Dot(n, n));
+    if (length > 0.0f)
+    {
+      n = n * (1.0f / length);
+      normals.push_back(n);
+      axis = axis + n;
+    }
+  }
+
+  float axisLength = sqrtf(Dot(axis, axis));
+  meshlet->coneAxis = axisLength > 0.0f ? axis * (1.0f / axisLength) : Vec3{ 0.0f, 0.0f, 1.0f };
+
+  float minimumDot = axisLength > 0.0f ? 1.0f : -1.0f;
+  for (const Vec3& n : normals)
+  {
+    minimumDot = std::min(minimumDot, Dot(n, meshlet->coneAxis));
+  }
+
+  // Every triangle faces away once the view direction is within 90 - acos(minimumDot) degrees of the axis
+  meshlet->coneCutoff = minimumDot <= 0.0f ? 1.0f : sqrtf(1.0f - minimumDot * minimumDot);
+}
+
+// Meshlets
+// ============================================================
+
+void BuildMeshlets(const std::vector<Vertex>& vertices, std::vector<uint32_t>* indices, std::vector<Meshlet>* outMeshlets)
+{
+  const std::vector<uint32_t>& input = *indices;
+  const uint32_t vertexCount = (uint32_t)vertices.size();
+  const uint32_t triangleCount = (uint32_t)(input.size() / 3);
+  outMeshlets->clear();
+
+  TriangleAdjacency adjacency;
+  adjacency.Init(input, vertexCount);
+
+  // Stamped with the meshlet that last used them, so nothing needs clearing between meshlets
+  std::vector<uint32_t> vertexMeshlet(vertexCount, ~0u);
+  std::vector<uint32_t> candidateMeshlet(triangleCount, ~0u);
+  std::vector<uint8_t> emitted(triangleCount, 0);
+
+  std::vector<uint32_t> output;
+  output.reserve(input.size());
+
+  std::vector<uint32_t> meshletVertices;
+  std::vector<uint32_t> meshletTriangles;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> localVertex(vertexCount); // Index into meshletVertices, valid while vertexMeshlet matches
+  std::vector<uint32_t> localIndices;
+  std::vector<uint32_t> clusterStarts;
+  uint32_t seed = 0;
+
+  while (true)
+  {
+    // Seeds follow the input order, which the vertex cache optimization already made spatially coherent
+    while (seed < triangleCount && emitted[seed])
+    {
+      seed++;
+    }
+    if (seed == triangleCount)
+    {
+      break;
+    }
+
+    const uint32_t meshletIndex = (uint32_t)outMeshlets->size();
+    meshletVertices.clear();
+    meshletTriangles.clear();
+    candidates.clear();
+    Vec3 positionSum = { 0.0f, 0.0f, 0.0f };
+
+    uint32_t triangle = seed;
+    while (triangle != ~0u)
+    {
+      // Add ==============================
+
+      emitted[triangle] = 1;
+      meshletTriangles.push_back(triangle);
+      for (uint32_t corner = 0; corner < 3; corner++)
+      {
+        uint32_t v = input[triangle * 3 + corner];
+        if (vertexMeshlet[v] != meshletIndex)
+        {
+          vertexMeshlet[v] = meshletIndex;
+          localVertex[v] = (uint32_t)meshletVertices.size();
+          meshletVertices.push_back(v);
+          positionSum = positionSum + vertices[v].position;
+
+          // Everything touching a new vertex may join next
+          for (uint32_t a = adjacency.offsets[v]; a < adjacency.offsets[v + 1]; a++)
+          {
+            uint32_t neighbor = adjacency.triangles[a];
+            if (!emitted[neighbor] && candidateMeshlet[neighbor] != meshletIndex)
+            {
+              candidateMeshlet[neighbor] = meshletIndex;
+              candidates.push_back(neighbor);
+            }
+          }
+        }
+      }
+
+      if (meshletTriangles.size() == QTZ_MESHLET_MAX_TRIANGLES)
+      {
+        break;
+      }
+
+      // Choose the next triangle ==============================
+
+      Vec3 centroid = positionSum * (1.0f / (float)meshletVertices.size());
+      triangle = ~0u;
+      uint32_t bestNewVertices = 4;
+      float bestDistance = FLT_MAX;
+
+      uint32_t write = 0;
+      for (uint32_t candidate : candidates)
+      {
+        if (emitted[candidate])
+        {
+          continue;
+        }
+        candidates[write++] = candidate;
+
+        const uint32_t* corners = &input[candidate * 3];
+        uint32_t newVertices =
+          (vertexMeshlet[corners[0]] != meshletIndex) +
+          (vertexMeshlet[corners[1]] != meshletIndex) +
+          (vertexMeshlet[corners[2]] != meshletIndex);
+        if (newVertices > bestNewVertices || meshletVertices.size() + newVertices > QTZ_MESHLET_MAX_VERTICES)
+        {
+          continue;
+        }
+
+        Vec3 offset = (vertices[corners[0]].position + vertices[corners[1]].position + vertices[corners[2]].position) * (1.0f / 3.0f) - centroid;
+        float distance = Dot(offset, offset);
+        if (newVertices < bestNewVertices || distance < bestDistance)
+        {
+          triangle = candidate;
+          bestNewVertices = newVertices;
+          bestDistance = distance;
+        }
+      }
+      candidates.resize(write);
+    }
+
+    // Emit ==============================
+
+    Meshlet meshlet = {};
+    meshlet.indexOffset = (uint32_t)output.size();
+    meshlet.indexCount = (uint32_t)meshletTriangles.size() * 3;
+    ComputeMeshletBounds(vertices, input, meshletVertices, meshletTriangles, &meshlet);
+    outMeshlets->push_back(meshlet);
+
+    // Growth order follows the candidates, not the cache : triangles are reordered for it within the meshlet
+    localIndices.clear();
+    for (uint32_t t : meshletTriangles)
+    {
+      for (uint32_t corner = 0; corner < 3; corner++)
+      {
+        localIndices.push_back(localVertex[input[t * 3 + corner]]);
+      }
+    }
+    OptimizeVertexCache(&localIndices, (uint32_t)meshletVertices.size(), 16, &clusterStarts);
+
+    for (uint32_t local : localIndices)
+    {
+      output.push_back(meshletVertices[local]);
+    }
+  }
+
+  indices->swap(output);
+}
+
+} // namespace Quartz
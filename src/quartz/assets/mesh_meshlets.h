@@ -0,0 +1,18 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Splits the triangles into meshlets of at most QTZ_MESHLET_MAX_VERTICES vertices and QTZ_MESHLET_MAX_TRIANGLES triangles
+// Meshlets grow greedily across shared vertices, preferring triangles that add the fewest new vertices
+//   and then those closest to the meshlet, and close once nothing connected fits
+// Reorders the indices so every meshlet's triangles are contiguous, Meshlet::indexOffset refers to the output
+// Meshlet order replaces OptimizeOverdraw()'s cluster order, each meshlet's triangles are vertex cache optimized again
+void BuildMeshlets(const std::vector<Vertex>& vertices, std::vector<uint32_t>* indices, std::vector<Meshlet>* outMeshlets);
+
+} // namespace Quartz
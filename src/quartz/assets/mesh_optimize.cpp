@@ -0,0 +1,371 @@
+
+#include "quartz/defines.h"
+#include "quartz/assets/mesh_optimize.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace Quartz
+{
+
+// Analysis
+// ============================================================
+
+// FIFO cache simulated with per-vertex timestamps : a vertex is cached if it was inserted within the last cacheSize misses
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+  VertexCacheStats stats = {};
+  if (indices.size() < 3)
+  {
+    return stats;
+  }
+
+  std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+  std::vector<bool> referenced(vertexCount, false);
+  uint32_t time = cacheSize + 1;
+  uint64_t misses = 0;
+  uint64_t uniqueCount = 0;
+
+  for (uint32_t index : indices)
+  {
+    if (time - cacheTimestamps[index] > cacheSize)
+    {
+      cacheTimestamps[index] = time++;
+      misses++;
+    }
+
+    if (!referenced[index])
+    {
+      referenced[index] = true;
+      uniqueCount++;
+    }
+  }
+
+  stats.acmr = (float)misses / (float)(indices.size() / 3);
+  stats.atvr = (float)misses / (float)uniqueCount;
+  return stats;
+}
+
+// Vertex cache
+// ============================================================
+
+void OptimizeVertexCache(std::vector<uint32_t>* indices, uint32_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* outClusterStarts)
+{
+  const std::vector<uint32_t>& in = *indices;
+  const uint32_t triangleCount = (uint32_t)(in.size() / 3);
+
+  outClusterStarts->clear();
+  if (triangleCount == 0)
+  {
+    return;
+  }
+
+  TriangleAdjacency adjacency;
+  adjacency.Init(in, vertexCount);
+
+  std::vector<uint32_t> liveTriangles(vertexCount);
+  for (uint32_t i = 0; i < vertexCount; i++)
+  {
+    liveTriangles[i] = adjacency.offsets[i + 1] - adjacency.offsets[i];
+  }
+
+  std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEnds;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> out;
+  out.reserve(in.size());
+
+  uint32_t time = cacheSize + 1;
+  uint32_t cursor = 0;
+  int64_t fanning = 0;
+
+  // Start from the first referenced vertex
+  while (cursor < vertexCount && liveTriangles[cursor] == 0)
+  {
+    cursor++;
+  }
+  fanning = cursor;
+  outClusterStarts->push_back(0);
+
+  while (fanning >= 0)
+  {
+    candidates.clear();
+
+    for (uint32_t a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++)
+    {
+      uint32_t triangle = adjacency.triangles[a];
+      if (emitted[triangle])
+      {
+        continue;
+      }
+
+      for (uint32_t corner = 0; corner < 3; corner++)
+      {
+        uint32_t v = in[triangle * 3 + corner];
+        out.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        liveTriangles[v]--;
+
+        if (time - cacheTimestamps[v] > cacheSize)
+        {
+          cacheTimestamps[v] = time++;
+        }
+      }
+      emitted[triangle] = true;
+    }
+
+    // Pick the candidate that stays in cache longest while still having triangles left
+    int64_t next = -1;
+    int64_t bestPriority = -1;
+    for (uint32_t v : candidates)
+    {
+      if (liveTriangles[v] == 0)
+      {
+        continue;
+      }
+
+      int64_t priority = 0;
+      if ((int64_t)time - cacheTimestamps[v] + 2 * (int64_t)liveTriangles[v] <= (int64_t)cacheSize)
+      {
+        priority = (int64_t)time - cacheTimestamps[v];
+      }
+
+      if (priority > bestPriority)
+      {
+        bestPriority = priority;
+        next = v;
+      }
+    }
+
+    if (next == -1)
+    {
+      // Dead end : Fall back to recently used vertices, then to the next vertex in input order
+      while (!deadEnds.empty() && next == -1)
+      {
+        uint32_t d = deadEnds.back();
+        deadEnds.pop_back();
+        if (liveTriangles[d] > 0)
+        {
+          next = d;
+        }
+      }
+
+      while (next == -1 && cursor < vertexCount)
+      {
+        if (liveTriangles[cursor] > 0)
+        {
+          next = cursor;
+        }
+        cursor++;
+      }
+
+      if (next != -1)
+      {
+        outClusterStarts->push_back((uint32_t)(out.size() / 3));
+      }
+    }
+
+    fanning = next;
+  }
+
+  *indices = std::move(out);
+}
+
+// Overdraw
+// ============================================================
+
+void OptimizeOverdraw(
+  std::vector<uint32_t>* indices,
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& clusterStarts,
+  uint32_t cacheSize,
+  float threshold)
+{
+  const std::vector<uint32_t>& in = *indices;
+  const uint32_t triangleCount = (uint32_t)(in.size() / 3);
+  if (triangleCount == 0 || clusterStarts.empty())
+  {
+    return;
+  }
+
+  // Soft boundaries ==============================
+
+  std::vector<uint32_t> cacheTimestamps(vertices.size(), 0);
+  uint32_t time = cacheSize + 1;
+
+  auto SimulateTriangle = [&](uint32_t triangle) -> uint32_t
+  {
+    uint32_t misses = 0;
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+      uint32_t v = in[triangle * 3 + corner];
+      if (time - cacheTimestamps[v] > cacheSize)
+      {
+        cacheTimestamps[v] = time++;
+        misses++;
+      }
+    }
+    return misses;
+  };
+
+  auto ResetCache = [&]()
+  {
+    // Advancing time past every timestamp empties the cache without touching the array
+    time += cacheSize + 1;
+  };
+
+  std::vector<uint32_t> clusters;
+  for (uint32_t c = 0; c < clusterStarts.size(); c++)
+  {
+    uint32_t start = clusterStarts[c];
+    uint32_t end = (c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : triangleCount;
+
+    ResetCache();
+    uint32_t hardMisses = 0;
+    for (uint32_t t = start; t < end; t++)
+    {
+      hardMisses += SimulateTriangle(t);
+    }
+    float hardAcmr = (float)hardMisses / (float)(end - start);
+
+    ResetCache();
+    clusters.push_back(start);
+    uint32_t softStart = start;
+    uint32_t softMisses = 0;
+    for (uint32_t t = start; t < end; t++)
+    {
+      softMisses += SimulateTriangle(t);
+
+      // Splitting here keeps this cluster's cache efficiency within the threshold
+      if (t + 1 < end && (float)softMisses / (float)(t + 1 - softStart) <= threshold * hardAcmr)
+      {
+        clusters.push_back(t + 1);
+        softStart = t + 1;
+        softMisses = 0;
+        ResetCache();
+      }
+    }
+  }
+
+  // Sort ==============================
+
+  Vec3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+  float meshArea = 0.0f;
+
+  struct ClusterInfo
+  {
+    uint32_t start;
+    uint32_t end;
+    float sortKey;
+  };
+  std::vector<ClusterInfo> clusterInfos(clusters.size());
+  std::vector<Vec3> clusterCentroids(clusters.size());
+  std::vector<Vec3> clusterNormals(clusters.size());
+  std::vector<float> clusterAreas(clusters.size());
+
+  for (uint32_t c = 0; c < clusters.size(); c++)
+  {
+    clusterInfos[c].start = clusters[c];
+    clusterInfos[c].end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+    Vec3 centroid = { 0.0f, 0.0f, 0.0f };
+    Vec3 normal = { 0.0f, 0.0f, 0.0f };
+    float area = 0.0f;
+
+    for (uint32_t t = clusterInfos[c].start; t < clusterInfos[c].end; t++)
+    {
+      const Vec3& p0 = vertices[in[t * 3 + 0]].position;
+      const Vec3& p1 = vertices[in[t * 3 + 1]].position;
+      const Vec3& p2 = vertices[in[t * 3 + 2]].position;
+
+      Vec3 e1 = p1 - p0;
+      Vec3 e2 = p2 - p0;
+      Vec3 n = Vec3{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+      float triangleArea = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+
+      centroid = centroid + (p0 + p1 + p2) * (triangleArea / 3.0f);
+      normal = normal + n; // Area weighted
+      area += triangleArea;
+    }
+
+    clusterCentroids[c] = centroid;
+    clusterNormals[c] = normal;
+    clusterAreas[c] = area;
+
+    meshCentroid = meshCentroid + centroid;
+    meshArea += area;
+  }
+
+  if (meshArea > 0.0f)
+  {
+    meshCentroid = meshCentroid * (1.0f / meshArea);
+  }
+
+  for (uint32_t c = 0; c < clusters.size(); c++)
+  {
+    Vec3 centroid = clusterCentroids[c];
+    if (clusterAreas[c] > 0.0f)
+    {
+      centroid = centroid * (1.0f / clusterAreas[c]);
+    }
+
+    // Clusters facing away from the mesh center are likely to occlude the rest
+    Vec3 toCluster = centroid - meshCentroid;
+    clusterInfos[c].sortKey = Dot(toCluster, clusterNormals[c]);
+  }
+
+  std::stable_sort(clusterInfos.begin(), clusterInfos.end(), [](const ClusterInfo& a, const ClusterInfo& b)
+  {
+    return a.sortKey > b.sortKey;
+  });
+
+  std::vector<uint32_t> out;
+  out.reserve(in.size());
+  for (const ClusterInfo& cluster : clusterInfos)
+  {
+    out.insert(out.end(), in.begin() + cluster.start * 3, in.begin() + cluster.end * 3);
+  }
+
+  *indices = std::move(out);
+}
+
+// Vertex fetch
+// ============================================================
+
+void OptimizeVertexFetch(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+{
+  std::vector<uint32_t> remap(vertices->size(), ~0u);
+  std::vector<Vertex> out;
+  out.reserve(vertices->size());
+
+  for (uint32_t& index : *indices)
+  {
+    if (remap[index] == ~0u)
+    {
+      remap[index] = (uint32_t)out.size();
+      out.push_back((*vertices)[index]);
+    }
+    index = remap[index];
+  }
+
+  *vertices = std::move(out);
+}
+
+// Mesh
+// ============================================================
+
+void OptimizeMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, MeshOptimizeInfo info, MeshOptimizeStats* outStats)
+{
+  outStats->before = AnalyzeVertexCache(*indices, (uint32_t)vertices->size(), info.cacheSize);
+
+  std::vector<uint32_t> clusterStarts;
+  OptimizeVertexCache(indices, (uint32_t)vertices->size(), info.cacheSize, &clusterStarts);
+  OptimizeOverdraw(indices, *vertices, clusterStarts, info.cacheSize, info.overdrawThreshold);
+  OptimizeVertexFetch(vertices, indices);
+
+  outStats->after = AnalyzeVertexCache(*indices, (uint32_t)vertices->size(), info.cacheSize);
+}
+
+} // namespace Quartz
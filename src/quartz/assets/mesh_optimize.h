@@ -0,0 +1,79 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Post-transform cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats
+{
+  float acmr; // Average cache miss ratio : Vertex shader invocations per triangle (0.5 - 3.0)
+  float atvr; // Average transform to vertex ratio : Vertex shader invocations per referenced vertex (1.0 ideal)
+};
+
+struct MeshOptimizeStats
+{
+  VertexCacheStats before;
+  VertexCacheStats after;
+};
+
+struct MeshOptimizeInfo
+{
+  uint32_t cacheSize = 16;
+  // Clusters may be split until their ACMR reaches threshold * the surrounding ACMR
+  // Higher values allow more overdraw-driven reordering at the cost of vertex cache efficiency
+  float overdrawThreshold = 1.05f;
+};
+
+// Vertex -> triangle adjacency in compressed rows
+struct TriangleAdjacency
+{
+  std::vector<uint32_t> offsets; // vertexCount + 1
+  std::vector<uint32_t> triangles;
+
+  void Init(const std::vector<uint32_t>& indices, uint32_t vertexCount)
+  {
+    offsets.assign(vertexCount + 1, 0);
+    for (uint32_t index : indices)
+    {
+      offsets[index + 1]++;
+    }
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+      offsets[i + 1] += offsets[i];
+    }
+
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    triangles.resize(indices.size());
+    for (uint32_t i = 0; i < indices.size(); i++)
+    {
+      triangles[fill[indices[i]]++] = i / 3;
+    }
+  }
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+// Tipsify (Sander, Nehab, Barczak 2007) : Reorders triangles for the post-transform cache
+// Outputs the first triangle of every cluster separated by a dead-end jump
+void OptimizeVertexCache(std::vector<uint32_t>* indices, uint32_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* outClusterStarts);
+
+// Splits the clusters further where cache efficiency allows, then sorts them so outward-facing clusters draw first
+void OptimizeOverdraw(
+  std::vector<uint32_t>* indices,
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& clusterStarts,
+  uint32_t cacheSize,
+  float threshold);
+
+// Reorders vertices by first use in the index buffer and drops unreferenced vertices
+void OptimizeVertexFetch(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+
+// Runs all of the above in order
+void OptimizeMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, MeshOptimizeInfo info, MeshOptimizeStats* outStats);
+
+} // namespace Quartz
@@ -0,0 +1,715 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/jobs.h"
+#include "quartz/assets/mesh_simplify.h"
+#include "quartz/assets/mesh_optimize.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+namespace Quartz
+{
+
+// Quadrics
+// ============================================================
+
+#define SIMPLIFY_ATTRIBUTE_COUNT 5 // uv.x, uv.y, normal.x, normal.y, normal.z
+
+// Sum of area-weighted squared distances to planes, plus squared differences from linear attribute fields
+// Attribute terms share the positional matrix, only their s-dependent parts are stored separately
+struct Quadric
+{
+  float a00, a11, a22, a01, a02, a12;
+  float b0, b1, b2;
+  float c;
+  float w;
+  float g[SIMPLIFY_ATTRIBUTE_COUNT][3];
+  float d[SIMPLIFY_ATTRIBUTE_COUNT];
+};
+
+static inline void QuadricAdd(Quadric* q, const Quadric& other)
+{
+  float* dst = (float*)q;
+  const float* src = (const float*)&other;
+  for (uint32_t i = 0; i < sizeof(Quadric) / sizeof(float); i++)
+  {
+    dst[i] += src[i];
+  }
+}
+
+// Adds weight * (dot(n, p) + distance)^2
+static inline void QuadricAddPlane(Quadric* q, const Vec3& n, float distance, float weight)
+{
+  q->a00 += weight * n.x * n.x;
+  q->a11 += weight * n.y * n.y;
+  q->a22 += weight * n.z * n.z;
+  q->a01 += weight * n.x * n.y;
+  q->a02 += weight * n.x * n.z;
+  q->a12 += weight * n.y * n.z;
+  q->b0 += weight * n.x * distance;
+  q->b1 += weight * n.y * distance;
+  q->b2 += weight * n.z * distance;
+  q->c += weight * distance * distance;
+}
+
+static inline float QuadricError(const Quadric& q, const Vec3& p, const float* attributes)
+{
+  float rx = q.a00 * p.x + q.a01 * p.y + q.a02 * p.z + q.b0;
+  float ry = q.a01 * p.x + q.a11 * p.y + q.a12 * p.z + q.b1;
+  float rz = q.a02 * p.x + q.a12 * p.y + q.a22 * p.z + q.b2;
+  float error = rx * p.x + ry * p.y + rz * p.z + q.b0 * p.x + q.b1 * p.y + q.b2 * p.z + q.c;
+
+  for (uint32_t k = 0; k < SIMPLIFY_ATTRIBUTE_COUNT; k++)
+  {
+    float s = attributes[k];
+    error += s * s * q.w - 2.0f * s * (q.g[k][0] * p.x + q.g[k][1] * p.y + q.g[k][2] * p.z + q.d[k]);
+  }
+
+  // Normalized to an area-weighted mean so errors are comparable between regions
+  return q.w > 0.0f ? std::max(error, 0.0f) / q.w : 0.0f;
+}
+
+// State
+// ============================================================
+
+enum SimplifyVertexKind
+{
+  Simplify_Vertex_Manifold, // Interior, can collapse to any neighbor
+  Simplify_Vertex_Border,   // On an open edge, collapses along it
+  Simplify_Vertex_Seam,     // One of two vertices sharing a position, collapses along the seam with its sibling
+  Simplify_Vertex_Locked,
+};
+
+struct SimplifyState
+{
+  uint32_t vertexCount;
+  std::vector<Vec3> positions; // Normalized into the unit cube
+  std::vector<float> attributes; // SIMPLIFY_ATTRIBUTE_COUNT per vertex, pre-weighted
+  std::vector<uint32_t> positionGroup; // Lowest vertex index sharing this position
+  std::vector<uint32_t> wedgeNext; // Ring of vertices sharing this position
+  std::vector<Quadric> quadrics;
+  float scale; // Normalized units per object space unit
+};
+
+static void InitPositions(const std::vector<Vertex>& vertices, MeshSimplifyInfo info, SimplifyState* state)
+{
+  const uint32_t vertexCount = (uint32_t)vertices.size();
+  state->vertexCount = vertexCount;
+
+  Vec3 minimum = vertices[0].position;
+  Vec3 maximum = vertices[0].position;
+  for (const Vertex& v : vertices)
+  {
+    minimum = Vec3{ std::min(minimum.x, v.position.x), std::min(minimum.y, v.position.y), std::min(minimum.z, v.position.z) };
+    maximum = Vec3{ std::max(maximum.x, v.position.x), std::max(maximum.y, v.position.y), std::max(maximum.z, v.position.z) };
+  }
+  float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+  state->scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+  state->positions.resize(vertexCount);
+  state->attributes.resize(vertexCount * SIMPLIFY_ATTRIBUTE_COUNT);
+  for (uint32_t i = 0; i < vertexCount; i++)
+  {
+    state->positions[i] = (vertices[i].position - minimum) * state->scale;
+
+    float* attributes = &state->attributes[i * SIMPLIFY_ATTRIBUTE_COUNT];
+    attributes[0] = vertices[i].uv.x * info.uvWeight;
+    attributes[1] = vertices[i].uv.y * info.uvWeight;
+    attributes[2] = vertices[i].normal.x * info.normalWeight;
+    attributes[3] = vertices[i].normal.y * info.normalWeight;
+    attributes[4] = vertices[i].normal.z * info.normalWeight;
+  }
+
+  // Group vertices with bitwise equal positions
+  std::vector<uint32_t> order(vertexCount);
+  for (uint32_t i = 0; i < vertexCount; i++)
+  {
+    order[i] = i;
+  }
+  auto PositionLess = [&](uint32_t a, uint32_t b)
+  {
+    int compare = memcmp(&vertices[a].position, &vertices[b].position, sizeof(Vec3));
+    return compare < 0 || (compare == 0 && a < b);
+  };
+  std::sort(order.begin(), order.end(), PositionLess);
+
+  state->positionGroup.resize(vertexCount);
+  state->wedgeNext.resize(vertexCount);
+  for (uint32_t start = 0; start < vertexCount;)
+  {
+    uint32_t end = start + 1;
+    while (end < vertexCount && memcmp(&vertices[order[start]].position, &vertices[order[end]].position, sizeof(Vec3)) == 0)
+    {
+      end++;
+    }
+
+    for (uint32_t i = start; i < end; i++)
+    {
+      state->positionGroup[order[i]] = order[start];
+      state->wedgeNext[order[i]] = order[(i + 1 < end) ? i + 1 : start];
+    }
+    start = end;
+  }
+}
+
+static void InitQuadrics(const std::vector<uint32_t>& indices, SimplifyState* state)
+{
+  state->quadrics.assign(state->vertexCount, Quadric{});
+
+  for (uint32_t i = 0; i + 2 < indices.size(); i += 3)
+  {
+    const uint32_t corners[3] = { indices[i], indices[i + 1], indices[i + 2] };
+    const Vec3& p0 = state->positions[corners[0]];
+    const Vec3 e1 = state->positions[corners[1]] - p0;
+    const Vec3 e2 = state->positions[corners[2]] - p0;
+
+    Vec3 n = Vec3{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+    float doubleArea = sqrtf(Dot(n, n));
+    if (doubleArea <= 0.0f)
+    {
+      continue;
+    }
+    n = n * (1.0f / doubleArea);
+    float area = doubleArea * 0.5f;
+
+    Quadric q = {};
+    QuadricAddPlane(&q, n, -Dot(n, p0), area);
+    q.w = area;
+
+    // Attribute gradients : Solve dot(g, e1) = s1 - s0, dot(g, e2) = s2 - s0 within the triangle's plane
+    float a00 = Dot(e1, e1);
+    float a01 = Dot(e1, e2);
+    float a11 = Dot(e2, e2);
+    float determinant = a00 * a11 - a01 * a01;
+    if (determinant > 0.0f)
+    {
+      float inverseDeterminant = 1.0f / determinant;
+      for (uint32_t k = 0; k < SIMPLIFY_ATTRIBUTE_COUNT; k++)
+      {
+        float s0 = state->attributes[corners[0] * SIMPLIFY_ATTRIBUTE_COUNT + k];
+        float ds1 = state->attributes[corners[1] * SIMPLIFY_ATTRIBUTE_COUNT + k] - s0;
+        float ds2 = state->attributes[corners[2] * SIMPLIFY_ATTRIBUTE_COUNT + k] - s0;
+
+        float u = (ds1 * a11 - ds2 * a01) * inverseDeterminant;
+        float v = (ds2 * a00 - ds1 * a01) * inverseDeterminant;
+        Vec3 g = e1 * u + e2 * v;
+        float d = s0 - Dot(g, p0);
+
+        // (dot(g, p) + d - s)^2 : The p and constant terms join the positional quadric
+        QuadricAddPlane(&q, g, d, area);
+        q.g[k][0] = area * g.x;
+        q.g[k][1] = area * g.y;
+        q.g[k][2] = area * g.z;
+        q.d[k] = area * d;
+      }
+    }
+
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+      QuadricAdd(&state->quadrics[corners[corner]], q);
+    }
+  }
+}
+
+// Topology
+// ============================================================
+// Edges are looked up through the vertex -> triangle adjacency instead of global edge sets, so a pass only re-buckets
+//   the remaining triangles and reclassifies vertices, nothing is sorted
+
+#define SIMPLIFY_BATCH_SIZE 4096
+
+struct SimplifyTopology
+{
+  const uint32_t* indices;
+  std::vector<uint8_t> kinds;
+
+  TriangleAdjacency adjacency;
+};
+
+// Whether any triangle holds the half-edge a -> b
+static bool HasVertexEdge(const SimplifyTopology& topology, uint32_t a, uint32_t b)
+{
+  const TriangleAdjacency& adjacency = topology.adjacency;
+  for (uint32_t t = adjacency.offsets[a]; t < adjacency.offsets[a + 1]; t++)
+  {
+    const uint32_t* triangle = &topology.indices[adjacency.triangles[t] * 3];
+    if ((triangle[0] == a && triangle[1] == b) || (triangle[1] == a && triangle[2] == b) || (triangle[2] == a && triangle[0] == b))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether any triangle holds a half-edge from a's position to b's
+static bool HasPositionEdge(const SimplifyState& state, const SimplifyTopology& topology, uint32_t a, uint32_t b)
+{
+  const uint32_t* group = state.positionGroup.data();
+  const TriangleAdjacency& adjacency = topology.adjacency;
+  const uint32_t groupB = group[b];
+
+  uint32_t wedge = a;
+  do
+  {
+    for (uint32_t t = adjacency.offsets[wedge]; t < adjacency.offsets[wedge + 1]; t++)
+    {
+      const uint32_t* triangle = &topology.indices[adjacency.triangles[t] * 3];
+      for (uint32_t corner = 0; corner < 3; corner++)
+      {
+        if (triangle[corner] == wedge && group[triangle[(corner + 1) % 3]] == groupB)
+        {
+          return true;
+        }
+      }
+    }
+    wedge = state.wedgeNext[wedge];
+  } while (wedge != a);
+
+  return false;
+}
+
+struct SimplifyOpenEdges
+{
+  uint32_t position; // Edges touching the vertex with no reverse between positions
+  uint32_t out;      // Outgoing edges with no reverse between vertices
+  uint32_t in;       // Incoming edges with no reverse between vertices
+};
+
+static SimplifyOpenEdges CountOpenEdges(const SimplifyState& state, const SimplifyTopology& topology, uint32_t v)
+{
+  SimplifyOpenEdges open = {};
+  const TriangleAdjacency& adjacency = topology.adjacency;
+  for (uint32_t t = adjacency.offsets[v]; t < adjacency.offsets[v + 1]; t++)
+  {
+    const uint32_t* triangle = &topology.indices[adjacency.triangles[t] * 3];
+    const uint32_t corner = (triangle[0] == v) ? 0 : (triangle[1] == v) ? 1 : 2;
+    const uint32_t next = triangle[(corner + 1) % 3];
+    const uint32_t previous = triangle[(corner + 2) % 3];
+
+    open.position += !HasPositionEdge(state, topology, next, v);
+    open.position += !HasPositionEdge(state, topology, v, previous);
+    open.out += !HasVertexEdge(topology, next, v);
+    open.in += !HasVertexEdge(topology, v, previous);
+  }
+  return open;
+}
+
+static void BuildTopology(const std::vector<uint32_t>& indices, const SimplifyState& state, SimplifyTopology* topology)
+{
+  const uint32_t vertexCount = state.vertexCount;
+
+  topology->indices = indices.data();
+  topology->adjacency.Init(indices, vertexCount);
+
+  // Open edge counts ==============================
+
+  std::vector<SimplifyOpenEdges> open(vertexCount);
+  ParallelForRange(vertexCount, SIMPLIFY_BATCH_SIZE, [&](uint32_t begin, uint32_t end)
+  {
+    for (uint32_t v = begin; v < end; v++)
+    {
+      open[v] = CountOpenEdges(state, *topology, v);
+    }
+  });
+
+  // Kinds ==============================
+
+  topology->kinds.assign(vertexCount, Simplify_Vertex_Locked);
+  ParallelForRange(vertexCount, SIMPLIFY_BATCH_SIZE, [&](uint32_t begin, uint32_t end)
+  {
+    for (uint32_t v = begin; v < end; v++)
+    {
+      const TriangleAdjacency& adjacency = topology->adjacency;
+      if (adjacency.offsets[v] == adjacency.offsets[v + 1])
+      {
+        continue; // No longer referenced
+      }
+
+      uint32_t sibling = state.wedgeNext[v];
+      if (sibling == v)
+      {
+        if (open[v].position == 0)
+        {
+          topology->kinds[v] = Simplify_Vertex_Manifold;
+        }
+        else if (open[v].out == 1 && open[v].in == 1)
+        {
+          topology->kinds[v] = Simplify_Vertex_Border;
+        }
+      }
+      else if (state.wedgeNext[sibling] == v)
+      {
+        // Exactly two wedges, closed in position space and each open exactly once on either side of the seam
+        if (open[v].position == 0 && open[sibling].position == 0
+          && open[v].out == 1 && open[v].in == 1 && open[sibling].out == 1 && open[sibling].in == 1)
+        {
+          topology->kinds[v] = Simplify_Vertex_Seam;
+        }
+      }
+    }
+  });
+}
+
+// Collapses
+// ============================================================
+
+struct Collapse
+{
+  uint32_t from;
+  uint32_t to;
+  uint32_t siblingFrom; // ~0u unless collapsing a seam
+  uint32_t siblingTo;
+  float error;
+};
+
+static inline bool AreAdjacent(const SimplifyTopology& topology, uint32_t a, uint32_t b)
+{
+  return HasVertexEdge(topology, a, b) || HasVertexEdge(topology, b, a);
+}
+
+// Fills the seam sibling collapse if the edge from -> to is allowed
+static bool ValidateCollapse(const SimplifyState& state, const SimplifyTopology& topology, Collapse* collapse)
+{
+  const uint32_t from = collapse->from;
+  const uint32_t to = collapse->to;
+  const uint32_t* group = state.positionGroup.data();
+  collapse->siblingFrom = ~0u;
+  collapse->siblingTo = ~0u;
+
+  if (group[from] == group[to])
+  {
+    return false;
+  }
+
+  switch (topology.kinds[from])
+  {
+  case Simplify_Vertex_Manifold:
+  {
+    return true;
+  }
+  case Simplify_Vertex_Border:
+  {
+    // Must slide along the open edge
+    return !HasPositionEdge(state, topology, to, from) || !HasPositionEdge(state, topology, from, to);
+  }
+  case Simplify_Vertex_Seam:
+  {
+    // Must slide along the seam, which is open between vertices but closed between positions
+    bool seamEdge = !HasVertexEdge(topology, to, from) || !HasVertexEdge(topology, from, to);
+    if (!seamEdge || topology.kinds[to] == Simplify_Vertex_Manifold || topology.kinds[to] == Simplify_Vertex_Border)
+    {
+      return false;
+    }
+
+    // The other side of the seam must collapse onto the matching wedge of the target
+    uint32_t siblingFrom = state.wedgeNext[from];
+    for (uint32_t siblingTo = state.wedgeNext[to]; siblingTo != to; siblingTo = state.wedgeNext[siblingTo])
+    {
+      if (AreAdjacent(topology, siblingFrom, siblingTo))
+      {
+        collapse->siblingFrom = siblingFrom;
+        collapse->siblingTo = siblingTo;
+        return true;
+      }
+    }
+    return false;
+  }
+  default: return false;
+  }
+}
+
+static float CollapseError(const SimplifyState& state, const Collapse& collapse)
+{
+  float error = QuadricError(
+    state.quadrics[collapse.from],
+    state.positions[collapse.to],
+    &state.attributes[collapse.to * SIMPLIFY_ATTRIBUTE_COUNT]);
+
+  if (collapse.siblingFrom != ~0u)
+  {
+    error = std::max(error, QuadricError(
+      state.quadrics[collapse.siblingFrom],
+      state.positions[collapse.siblingTo],
+      &state.attributes[collapse.siblingTo * SIMPLIFY_ATTRIBUTE_COUNT]));
+  }
+  return error;
+}
+
+// Rejects collapses that would turn any remaining triangle around the moving vertex over
+static bool FlipsTriangles(
+  const std::vector<uint32_t>& indices,
+  const SimplifyState& state,
+  const SimplifyTopology& topology,
+  uint32_t from,
+  uint32_t to)
+{
+  const Vec3& target = state.positions[to];
+  const TriangleAdjacency& adjacency = topology.adjacency;
+  for (uint32_t a = adjacency.offsets[from]; a < adjacency.offsets[from + 1]; a++)
+  {
+    const uint32_t* triangle = &indices[adjacency.triangles[a] * 3];
+    if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+    {
+      continue; // Removed by the collapse
+    }
+
+    Vec3 before[3];
+    Vec3 after[3];
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+      before[corner] = state.positions[triangle[corner]];
+      after[corner] = (triangle[corner] == from) ? target : before[corner];
+    }
+
+    Vec3 e1 = before[1] - before[0];
+    Vec3 e2 = before[2] - before[0];
+    Vec3 n0 = Vec3{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+    e1 = after[1] - after[0];
+    e2 = after[2] - after[0];
+    Vec3 n1 = Vec3{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+
+    if (Dot(n0, n1) <= 0.0f)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Simplify
+// ============================================================
+
+static float SimplifyPasses(
+  std::vector<uint32_t>* indices,
+  uint32_t targetIndexCount,
+  float maxError,
+  SimplifyState* state)
+{
+  const float maxErrorSquared = maxError * maxError;
+  float resultError = 0.0f;
+
+  SimplifyTopology topology;
+  std::vector<std::vector<Collapse>> batchCollapses;
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> remap(state->vertexCount);
+  std::vector<uint8_t> touched(state->vertexCount);
+
+  while (indices->size() > targetIndexCount)
+  {
+    BuildTopology(*indices, *state, &topology);
+
+    // Candidates ==============================
+
+    // Gathered per batch of triangles and joined in order, so the result does not depend on scheduling
+    const uint32_t triangleCount = (uint32_t)(indices->size() / 3);
+    batchCollapses.resize((triangleCount + SIMPLIFY_BATCH_SIZE - 1) / SIMPLIFY_BATCH_SIZE);
+    ParallelForRange((uint32_t)batchCollapses.size(), 1, [&](uint32_t begin, uint32_t end)
+    {
+      for (uint32_t batch = begin; batch < end; batch++)
+      {
+        std::vector<Collapse>& batchOut = batchCollapses[batch];
+        batchOut.clear();
+
+        const uint32_t lastTriangle = std::min(triangleCount, (batch + 1) * SIMPLIFY_BATCH_SIZE);
+        for (uint32_t triangle = batch * SIMPLIFY_BATCH_SIZE; triangle < lastTriangle; triangle++)
+        {
+          for (uint32_t corner = 0; corner < 3; corner++)
+          {
+            uint32_t a = (*indices)[triangle * 3 + corner];
+            uint32_t b = (*indices)[triangle * 3 + (corner + 1) % 3];
+
+            Collapse collapse = { a, b };
+            if (ValidateCollapse(*state, topology, &collapse))
+            {
+              collapse.error = CollapseError(*state, collapse);
+              batchOut.push_back(collapse);
+            }
+
+            collapse = { b, a };
+            if (ValidateCollapse(*state, topology, &collapse))
+            {
+              collapse.error = CollapseError(*state, collapse);
+              batchOut.push_back(collapse);
+            }
+          }
+        }
+      }
+    });
+
+    collapses.clear();
+    for (const std::vector<Collapse>& batchOut : batchCollapses)
+    {
+      collapses.insert(collapses.end(), batchOut.begin(), batchOut.end());
+    }
+
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+    {
+      return a.error < b.error;
+    });
+
+    // Apply ==============================
+    // Each vertex takes part in at most one collapse per pass so quadrics and flip checks stay valid
+
+    for (uint32_t i = 0; i < state->vertexCount; i++)
+    {
+      remap[i] = i;
+    }
+    memset(touched.data(), 0, touched.size());
+
+    // Most collapses remove two triangles, stop once the target would be reached
+    const uint64_t goal = (indices->size() - targetIndexCount) / 6 + 1;
+    uint64_t collapseCount = 0;
+
+    for (const Collapse& collapse : collapses)
+    {
+      if (collapseCount >= goal || collapse.error > maxErrorSquared)
+      {
+        break;
+      }
+
+      if (touched[collapse.from] || touched[collapse.to])
+      {
+        continue;
+      }
+
+      bool seam = collapse.siblingFrom != ~0u;
+      if (seam && (touched[collapse.siblingFrom] || touched[collapse.siblingTo]))
+      {
+        continue;
+      }
+
+      if (FlipsTriangles(*indices, *state, topology, collapse.from, collapse.to)
+        || (seam && FlipsTriangles(*indices, *state, topology, collapse.siblingFrom, collapse.siblingTo)))
+      {
+        continue;
+      }
+
+      remap[collapse.from] = collapse.to;
+      QuadricAdd(&state->quadrics[collapse.to], state->quadrics[collapse.from]);
+      touched[collapse.from] = 1;
+      touched[collapse.to] = 1;
+
+      if (seam)
+      {
+        remap[collapse.siblingFrom] = collapse.siblingTo;
+        QuadricAdd(&state->quadrics[collapse.siblingTo], state->quadrics[collapse.siblingFrom]);
+        touched[collapse.siblingFrom] = 1;
+        touched[collapse.siblingTo] = 1;
+      }
+
+      // Everything else sharing these positions is pinned for the rest of the pass
+      for (uint32_t w = state->wedgeNext[collapse.from]; w != collapse.from; w = state->wedgeNext[w])
+      {
+        touched[w] = 1;
+      }
+      for (uint32_t w = state->wedgeNext[collapse.to]; w != collapse.to; w = state->wedgeNext[w])
+      {
+        touched[w] = 1;
+      }
+
+      resultError = std::max(resultError, collapse.error);
+      collapseCount++;
+    }
+
+    if (collapseCount == 0)
+    {
+      break;
+    }
+
+    // Rebuild ==============================
+
+    uint32_t write = 0;
+    for (uint32_t i = 0; i < indices->size(); i += 3)
+    {
+      uint32_t a = remap[(*indices)[i + 0]];
+      uint32_t b = remap[(*indices)[i + 1]];
+      uint32_t c = remap[(*indices)[i + 2]];
+      if (a == b || b == c || c == a)
+      {
+        continue;
+      }
+      (*indices)[write++] = a;
+      (*indices)[write++] = b;
+      (*indices)[write++] = c;
+    }
+    indices->resize(write);
+  }
+
+  return sqrtf(resultError);
+}
+
+float SimplifyMesh(
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& indices,
+  uint32_t targetIndexCount,
+  MeshSimplifyInfo info,
+  std::vector<uint32_t>* outIndices)
+{
+  *outIndices = indices;
+  if (vertices.empty() || indices.size() <= targetIndexCount)
+  {
+    return 0.0f;
+  }
+
+  SimplifyState state;
+  InitPositions(vertices, info, &state);
+  InitQuadrics(indices, &state);
+
+  float error = SimplifyPasses(outIndices, targetIndexCount, info.maxError, &state);
+  return error / state.scale;
+}
+
+// Lod chain
+// ============================================================
+
+void GenerateLodChain(
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& indices,
+  MeshLodInfo info,
+  std::vector<uint32_t>* outIndices,
+  std::vector<MeshLod>* outLods)
+{
+  *outIndices = indices;
+  outLods->clear();
+  outLods->push_back({ 0, (uint32_t)indices.size(), 0.0f });
+
+  if (vertices.empty())
+  {
+    return;
+  }
+
+  // One state for the whole chain : position groups are found once and quadrics keep every plane they absorbed,
+  //   so each level continues collapsing where the last one stopped and is measured against the original surface
+  SimplifyState state;
+  InitPositions(vertices, info.simplify, &state);
+  InitQuadrics(indices, &state);
+
+  std::vector<uint32_t> level = indices;
+  std::vector<uint32_t> clusterStarts;
+  float error = 0.0f;
+
+  while (outLods->size() < info.maxLodCount)
+  {
+    const uint64_t previousSize = level.size();
+    uint32_t target = (uint32_t)(previousSize * info.reductionRatio) / 3 * 3;
+    error = std::max(error, SimplifyPasses(&level, target, info.simplify.maxError, &state) / state.scale);
+
+    // Levels that barely shrink are not worth their memory
+    if (level.size() == 0 || level.size() > previousSize * 0.9f)
+    {
+      break;
+    }
+
+    OptimizeVertexCache(&level, (uint32_t)vertices.size(), 16, &clusterStarts);
+
+    MeshLod lod;
+    lod.indexOffset = (uint32_t)outIndices->size();
+    lod.indexCount = (uint32_t)level.size();
+    lod.error = error;
+    outLods->push_back(lod);
+    outIndices->insert(outIndices->end(), level.begin(), level.end());
+  }
+}
+
+} // namespace Quartz
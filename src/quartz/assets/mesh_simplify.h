@@ -0,0 +1,54 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+struct MeshSimplifyInfo
+{
+  // Attribute error is measured in attribute units, scaled by these relative to position error
+  float uvWeight = 1.0f;
+  float normalWeight = 0.5f;
+  // Collapses are rejected once their error exceeds this fraction of the mesh's largest extent
+  float maxError = 0.05f;
+};
+
+// Quadric error metric edge collapse (Garland & Heckbert 1997)
+// with attribute quadrics for uvs and normals (Hoppe 1999)
+//
+// Collapses only move vertices onto existing vertices, so every output indexes the original vertex buffer
+// Open borders may only collapse along themselves, uv seams and normal creases (vertices sharing a position)
+//   only collapse along the seam with both sides moving together, anything more complex stays locked
+//
+// Returns the largest collapse error as an object space distance
+float SimplifyMesh(
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& indices,
+  uint32_t targetIndexCount,
+  MeshSimplifyInfo info,
+  std::vector<uint32_t>* outIndices);
+
+struct MeshLodInfo
+{
+  uint32_t maxLodCount = 5; // Including the full detail level
+  float reductionRatio = 0.5f; // Target index count of each level relative to the last
+  MeshSimplifyInfo simplify = {};
+};
+
+// Builds a chain of LODs sharing the vertex buffer, each simplified from the previous level
+// Level 0 is the input, all levels are appended to outIndices and described by outLods
+// Stops early once a level can no longer reach its target within maxError
+// Collapse state carries from level to level, so MeshLod::error is the largest collapse error against the input surface
+// Every pass classifies vertices and scores collapses across the job workers, applying the collapses stays serial
+void GenerateLodChain(
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& indices,
+  MeshLodInfo info,
+  std::vector<uint32_t>* outIndices,
+  std::vector<MeshLod>* outLods);
+
+} // namespace Quartz
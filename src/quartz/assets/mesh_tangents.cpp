@@ -0,0 +1,711 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/hash.h"
+#include "quartz/assets/mesh_tangents.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+namespace Quartz
+{
+
+// A port of the reference MikkTSpace implementation (mikktspace.c, Morten S. Mikkelsen, zlib license)
+// Each step below follows the function of the same purpose there, in the same order and with the same float
+//   operations, so meshes get the tangents bakers using MikkTSpace expect. Only triangles are supported,
+//   the reference's quad handling is left out
+
+// Helpers
+// ============================================================
+
+#define MIKK_MARK_DEGENERATE   1
+#define MIKK_GROUP_WITH_ANY    4
+#define MIKK_ORIENT_PRESERVING 8
+
+static inline bool NotZero(float x)
+{
+  return fabsf(x) > FLT_MIN;
+}
+
+static inline bool NotZero(const Vec3& v)
+{
+  return NotZero(v.x) || NotZero(v.y) || NotZero(v.z);
+}
+
+static inline Vec3 Scale(float s, const Vec3& v)
+{
+  return Vec3{ s * v.x, s * v.y, s * v.z };
+}
+
+static inline float DotMikk(const Vec3& a, const Vec3& b)
+{
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline float LengthMikk(const Vec3& v)
+{
+  return sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+static inline Vec3 NormalizeMikk(const Vec3& v)
+{
+  return Scale(1.0f / LengthMikk(v), v);
+}
+
+// v projected onto the plane of unit normal n, normalized unless it vanished
+static inline Vec3 ProjectMikk(const Vec3& n, const Vec3& v)
+{
+  Vec3 projected = v - Scale(DotMikk(n, v), n);
+  return NotZero(projected) ? NormalizeMikk(projected) : projected;
+}
+
+struct MikkTriangle
+{
+  int32_t neighbors[3]; // Across the edge leaving each corner, -1 on open edges
+  int32_t groups[3];    // Of each corner, -1 until assigned
+  Vec3 os;              // Unit first order derivatives, flipped for mirrored uvs
+  Vec3 ot;
+  uint32_t original;    // Index of the triangle in the input
+  uint32_t flags;
+};
+
+struct MikkGroup
+{
+  uint32_t faceOffset;  // Into MikkState::groupFaces
+  uint32_t faceCount;
+  uint32_t vertex;      // Welded vertex every corner of the group shares
+  bool orientPreserving;
+};
+
+struct MikkSpace
+{
+  Vec3 os = Vec3{ 1.0f, 0.0f, 0.0f };
+  bool orientPreserving = false;
+};
+
+struct MikkState
+{
+  const std::vector<Vertex>* vertices;
+  std::vector<uint32_t> corners; // Welded vertex of each corner, triangles reordered with degenerate ones last
+  std::vector<MikkTriangle> triangles;
+  uint32_t goodCount;
+  std::vector<MikkGroup> groups;
+  std::vector<uint32_t> groupFaces;
+  std::vector<MikkSpace> spaces; // By input corner
+};
+
+// Welding
+// ============================================================
+
+// Adding zero turns -0 into 0, the reference compares with ==
+static inline void WeldKey(const Vertex& v, float* outKey)
+{
+  outKey[0] = v.position.x + 0.0f; outKey[1] = v.position.y + 0.0f; outKey[2] = v.position.z + 0.0f;
+  outKey[3] = v.normal.x + 0.0f;   outKey[4] = v.normal.y + 0.0f;   outKey[5] = v.normal.z + 0.0f;
+  outKey[6] = v.uv.x + 0.0f;       outKey[7] = v.uv.y + 0.0f;
+}
+
+// Corners with identical position, normal and uv are one vertex to MikkTSpace, even when they are not to the mesh
+// Each vertex maps to the first vertex equal to it, through an open addressed table (GenerateSharedVerticesIndexList)
+static void WeldCorners(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint64_t cornerCount, std::vector<uint32_t>* outCorners)
+{
+  uint64_t capacity = 16;
+  while (capacity < vertices.size() * 2)
+  {
+    capacity *= 2;
+  }
+  std::vector<uint32_t> table(capacity, ~0u);
+  std::vector<uint32_t> welded(vertices.size(), ~0u);
+
+  outCorners->resize(cornerCount);
+  for (uint64_t i = 0; i < cornerCount; i++)
+  {
+    const uint32_t index = indices[i];
+    if (welded[index] == ~0u)
+    {
+      float key[8];
+      WeldKey(vertices[index], key);
+      uint64_t slot = HashBytes(key, sizeof(key)) & (capacity - 1);
+      while (true)
+      {
+        if (table[slot] == ~0u)
+        {
+          table[slot] = index;
+          welded[index] = index;
+          break;
+        }
+
+        float other[8];
+        WeldKey(vertices[table[slot]], other);
+        if (key[0] == other[0] && key[1] == other[1] && key[2] == other[2] && key[3] == other[3]
+          && key[4] == other[4] && key[5] == other[5] && key[6] == other[6] && key[7] == other[7])
+        {
+          welded[index] = table[slot];
+          break;
+        }
+        slot = (slot + 1) & (capacity - 1);
+      }
+    }
+    (*outCorners)[i] = welded[index];
+  }
+}
+
+// Triangles
+// ============================================================
+
+// Good triangles keep their order, degenerate ones move behind them (DegenPrologue)
+static void PartitionDegenerates(MikkState* state, const std::vector<uint32_t>& welded)
+{
+  const std::vector<Vertex>& vertices = *state->vertices;
+  const uint32_t triangleCount = (uint32_t)(welded.size() / 3);
+
+  std::vector<uint8_t> isDegenerate(triangleCount);
+  uint32_t goodCount = 0;
+  for (uint32_t t = 0; t < triangleCount; t++)
+  {
+    const Vec3& p0 = vertices[welded[t * 3 + 0]].position;
+    const Vec3& p1 = vertices[welded[t * 3 + 1]].position;
+    const Vec3& p2 = vertices[welded[t * 3 + 2]].position;
+    isDegenerate[t] = p0 == p1 || p0 == p2 || p1 == p2;
+    goodCount += !isDegenerate[t];
+  }
+
+  state->goodCount = goodCount;
+  state->triangles.resize(triangleCount);
+  state->corners.resize(welded.size());
+  uint32_t nextGood = 0;
+  uint32_t nextDegenerate = goodCount;
+  for (uint32_t t = 0; t < triangleCount; t++)
+  {
+    const uint32_t destination = isDegenerate[t] ? nextDegenerate++ : nextGood++;
+    MikkTriangle& triangle = state->triangles[destination];
+    triangle.original = t;
+    triangle.flags = isDegenerate[t] ? MIKK_MARK_DEGENERATE : 0;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+      state->corners[destination * 3 + i] = welded[t * 3 + i];
+    }
+  }
+}
+
+// First order derivatives of position over uv, and whether the uvs are mirrored (InitTriInfo)
+static void InitTriangles(MikkState* state)
+{
+  const std::vector<Vertex>& vertices = *state->vertices;
+  for (uint32_t f = 0; f < state->goodCount; f++)
+  {
+    MikkTriangle& triangle = state->triangles[f];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+      triangle.neighbors[i] = -1;
+      triangle.groups[i] = -1;
+    }
+    triangle.os = Vec3{ 0.0f, 0.0f, 0.0f };
+    triangle.ot = Vec3{ 0.0f, 0.0f, 0.0f };
+    // Assumed bad
+    triangle.flags |= MIKK_GROUP_WITH_ANY;
+
+    const Vertex& v1 = vertices[state->corners[f * 3 + 0]];
+    const Vertex& v2 = vertices[state->corners[f * 3 + 1]];
+    const Vertex& v3 = vertices[state->corners[f * 3 + 2]];
+    const float t21x = v2.uv.x - v1.uv.x;
+    const float t21y = v2.uv.y - v1.uv.y;
+    const float t31x = v3.uv.x - v1.uv.x;
+    const float t31y = v3.uv.y - v1.uv.y;
+    const Vec3 d1 = v2.position - v1.position;
+    const Vec3 d2 = v3.position - v1.position;
+
+    const float signedAreaStx2 = t21x * t31y - t21y * t31x;
+    const Vec3 os = Scale(t31y, d1) - Scale(t21y, d2);
+    const Vec3 ot = Scale(-t31x, d1) + Scale(t21x, d2);
+
+    triangle.flags |= signedAreaStx2 > 0 ? MIKK_ORIENT_PRESERVING : 0;
+    if (NotZero(signedAreaStx2))
+    {
+      const float absArea = fabsf(signedAreaStx2);
+      const float lengthOs = LengthMikk(os);
+      const float lengthOt = LengthMikk(ot);
+      const float sign = (triangle.flags & MIKK_ORIENT_PRESERVING) == 0 ? -1.0f : 1.0f;
+      if (NotZero(lengthOs))
+      {
+        triangle.os = Scale(sign / lengthOs, os);
+      }
+      if (NotZero(lengthOt))
+      {
+        triangle.ot = Scale(sign / lengthOt, ot);
+      }
+
+      // The magnitudes only decide whether the triangle is good, the basic tangent space does not output them
+      const float magS = lengthOs / absArea;
+      const float magT = lengthOt / absArea;
+      if (NotZero(magS) && NotZero(magT))
+      {
+        triangle.flags &= ~MIKK_GROUP_WITH_ANY;
+      }
+    }
+  }
+}
+
+// The corner the edge (i0, i1) leaves from and its two vertices in the triangle's winding (GetEdge)
+static void GetEdge(const uint32_t* corners, uint32_t i0, uint32_t i1, uint32_t* outFrom, uint32_t* outTo, uint32_t* outEdge)
+{
+  if (corners[0] == i0 || corners[0] == i1)
+  {
+    if (corners[1] == i0 || corners[1] == i1)
+    {
+      *outEdge = 0; *outFrom = corners[0]; *outTo = corners[1];
+    }
+    else
+    {
+      *outEdge = 2; *outFrom = corners[2]; *outTo = corners[0];
+    }
+  }
+  else
+  {
+    *outEdge = 1; *outFrom = corners[1]; *outTo = corners[2];
+  }
+}
+
+// Pairs every edge with the first unpaired edge running the other way over the same vertices (BuildNeighborsFast)
+static void BuildNeighbors(MikkState* state)
+{
+  struct Edge
+  {
+    uint32_t i0;
+    uint32_t i1;
+    uint32_t f;
+  };
+
+  // Sorted by (i0, i1, f) as the reference sorts them : bucketed by i0 with triangles in order,
+  //   then each bucket, a vertex's few edges, sorted by i1 keeping that order
+  const uint32_t edgeCount = state->goodCount * 3;
+  const uint32_t vertexCount = (uint32_t)state->vertices->size();
+  std::vector<uint32_t> bucketOffsets(vertexCount + 1, 0);
+  for (uint32_t c = 0; c < edgeCount; c++)
+  {
+    const uint32_t a = state->corners[c];
+    const uint32_t b = state->corners[(c % 3 < 2) ? c + 1 : c - 2];
+    bucketOffsets[std::min(a, b) + 1]++;
+  }
+  for (uint32_t v = 0; v < vertexCount; v++)
+  {
+    bucketOffsets[v + 1] += bucketOffsets[v];
+  }
+
+  std::vector<Edge> edges(edgeCount);
+  std::vector<uint32_t> bucketFill(bucketOffsets.begin(), bucketOffsets.end() - 1);
+  for (uint32_t c = 0; c < edgeCount; c++)
+  {
+    const uint32_t a = state->corners[c];
+    const uint32_t b = state->corners[(c % 3 < 2) ? c + 1 : c - 2];
+    const uint32_t i0 = std::min(a, b);
+    edges[bucketFill[i0]++] = { i0, std::max(a, b), c / 3 };
+  }
+  bucketFill = std::vector<uint32_t>();
+
+  for (uint32_t v = 0; v < vertexCount; v++)
+  {
+    for (uint32_t i = bucketOffsets[v] + 1; i < bucketOffsets[v + 1]; i++)
+    {
+      const Edge edge = edges[i];
+      uint32_t j = i;
+      for (; j > bucketOffsets[v] && edges[j - 1].i1 > edge.i1; j--)
+      {
+        edges[j] = edges[j - 1];
+      }
+      edges[j] = edge;
+    }
+  }
+
+  for (uint32_t i = 0; i < edgeCount; i++)
+  {
+    const Edge& edgeA = edges[i];
+    uint32_t fromA, toA, edgeNumberA;
+    GetEdge(&state->corners[edgeA.f * 3], edgeA.i0, edgeA.i1, &fromA, &toA, &edgeNumberA);
+    if (state->triangles[edgeA.f].neighbors[edgeNumberA] != -1)
+    {
+      continue;
+    }
+
+    for (uint32_t j = i + 1; j < edgeCount && edges[j].i0 == edgeA.i0 && edges[j].i1 == edgeA.i1; j++)
+    {
+      const Edge& edgeB = edges[j];
+      uint32_t fromB, toB, edgeNumberB;
+      // Flipped, a matching edge runs the other way
+      GetEdge(&state->corners[edgeB.f * 3], edgeB.i0, edgeB.i1, &toB, &fromB, &edgeNumberB);
+      if (fromA == fromB && toA == toB && state->triangles[edgeB.f].neighbors[edgeNumberB] == -1)
+      {
+        state->triangles[edgeA.f].neighbors[edgeNumberA] = (int32_t)edgeB.f;
+        state->triangles[edgeB.f].neighbors[edgeNumberB] = (int32_t)edgeA.f;
+        break;
+      }
+    }
+  }
+}
+
+// Groups
+// ============================================================
+
+// Spreads a group across the triangles around its vertex that share its uv orientation (AssignRecur)
+static bool AssignRecursive(MikkState* state, uint32_t triangleIndex, uint32_t groupIndex)
+{
+  MikkTriangle& triangle = state->triangles[triangleIndex];
+  MikkGroup& group = state->groups[groupIndex];
+  const uint32_t* corners = &state->corners[triangleIndex * 3];
+  const uint32_t i = corners[0] == group.vertex ? 0 : (corners[1] == group.vertex ? 1 : 2);
+
+  if (triangle.groups[i] == (int32_t)groupIndex)
+  {
+    return true;
+  }
+  if (triangle.groups[i] != -1)
+  {
+    return false;
+  }
+
+  // The first group to reach a triangle without usable derivatives decides its orientation
+  if ((triangle.flags & MIKK_GROUP_WITH_ANY) && triangle.groups[0] == -1 && triangle.groups[1] == -1 && triangle.groups[2] == -1)
+  {
+    triangle.flags &= ~MIKK_ORIENT_PRESERVING;
+    triangle.flags |= group.orientPreserving ? MIKK_ORIENT_PRESERVING : 0;
+  }
+
+  if (((triangle.flags & MIKK_ORIENT_PRESERVING) != 0) != group.orientPreserving)
+  {
+    return false;
+  }
+
+  state->groupFaces.push_back(triangleIndex);
+  group.faceCount++;
+  triangle.groups[i] = (int32_t)groupIndex;
+
+  const int32_t left = triangle.neighbors[i];
+  const int32_t right = triangle.neighbors[i > 0 ? i - 1 : 2];
+  if (left >= 0)
+  {
+    AssignRecursive(state, (uint32_t)left, groupIndex);
+  }
+  if (right >= 0)
+  {
+    AssignRecursive(state, (uint32_t)right, groupIndex);
+  }
+  return true;
+}
+
+// One group per vertex and uv orientation over connected triangles (Build4RuleGroups)
+static void BuildGroups(MikkState* state)
+{
+  for (uint32_t f = 0; f < state->goodCount; f++)
+  {
+    for (uint32_t i = 0; i < 3; i++)
+    {
+      MikkTriangle& triangle = state->triangles[f];
+      if ((triangle.flags & MIKK_GROUP_WITH_ANY) || triangle.groups[i] != -1)
+      {
+        continue;
+      }
+
+      const uint32_t groupIndex = (uint32_t)state->groups.size();
+      MikkGroup group;
+      group.faceOffset = (uint32_t)state->groupFaces.size();
+      group.faceCount = 1;
+      group.vertex = state->corners[f * 3 + i];
+      group.orientPreserving = (triangle.flags & MIKK_ORIENT_PRESERVING) != 0;
+      state->groups.push_back(group);
+      state->groupFaces.push_back(f);
+      triangle.groups[i] = (int32_t)groupIndex;
+
+      const int32_t left = triangle.neighbors[i];
+      const int32_t right = triangle.neighbors[i > 0 ? i - 1 : 2];
+      if (left >= 0)
+      {
+        AssignRecursive(state, (uint32_t)left, groupIndex);
+      }
+      if (right >= 0)
+      {
+        AssignRecursive(state, (uint32_t)right, groupIndex);
+      }
+    }
+  }
+}
+
+// Tangent spaces
+// ============================================================
+
+// Angle weighted average of the members' derivatives, projected onto the vertex's plane (EvalTspace)
+static Vec3 EvaluateSpace(const MikkState& state, const uint32_t* members, uint32_t memberCount, uint32_t vertex)
+{
+  const std::vector<Vertex>& vertices = *state.vertices;
+  Vec3 os = Vec3{ 0.0f, 0.0f, 0.0f };
+  for (uint32_t m = 0; m < memberCount; m++)
+  {
+    const uint32_t f = members[m];
+    const MikkTriangle& triangle = state.triangles[f];
+    // Only valid triangles get to add their contribution
+    if (triangle.flags & MIKK_GROUP_WITH_ANY)
+    {
+      continue;
+    }
+
+    const uint32_t* corners = &state.corners[f * 3];
+    const uint32_t i = corners[0] == vertex ? 0 : (corners[1] == vertex ? 1 : 2);
+    const Vec3& n = vertices[corners[i]].normal;
+    const Vec3 faceOs = ProjectMikk(n, triangle.os);
+
+    const Vec3& p0 = vertices[corners[i > 0 ? i - 1 : 2]].position;
+    const Vec3& p1 = vertices[corners[i]].position;
+    const Vec3& p2 = vertices[corners[i < 2 ? i + 1 : 0]].position;
+    const Vec3 v1 = ProjectMikk(n, p0 - p1);
+    const Vec3 v2 = ProjectMikk(n, p2 - p1);
+
+    // Weighted by the angle between the corner's edges
+    const float cosine = std::clamp(DotMikk(v1, v2), -1.0f, 1.0f);
+    const float angle = (float)acos(cosine);
+    os = os + Scale(angle, faceOs);
+  }
+
+  return NotZero(os) ? NormalizeMikk(os) : os;
+}
+
+// Splits each group into subgroups of similar derivatives and evaluates a space per subgroup (GenerateTSpaces)
+// fThresCos is the reference's default, an angular threshold of 180 degrees
+static void GenerateSpaces(MikkState* state)
+{
+  const float thresholdCos = cosf(180.0f * 3.14159265358979323846f / 180.0f);
+  const std::vector<Vertex>& vertices = *state->vertices;
+
+  std::vector<uint32_t> members;
+  std::vector<uint32_t> subgroupMembers; // Every subgroup's members back to back
+  std::vector<uint32_t> subgroupOffsets;
+  std::vector<Vec3> subgroupSpaces;
+  // Every face's derivatives projected onto the group's vertex once, the reference projects them per pair
+  std::vector<Vec3> projectedOs;
+  std::vector<Vec3> projectedOt;
+
+  for (uint32_t g = 0; g < state->groups.size(); g++)
+  {
+    const MikkGroup& group = state->groups[g];
+    const uint32_t* faces = &state->groupFaces[group.faceOffset];
+    const Vec3& n = vertices[group.vertex].normal;
+    subgroupMembers.clear();
+    subgroupOffsets.assign(1, 0);
+    subgroupSpaces.clear();
+
+    projectedOs.resize(group.faceCount);
+    projectedOt.resize(group.faceCount);
+    for (uint32_t i = 0; i < group.faceCount; i++)
+    {
+      projectedOs[i] = ProjectMikk(n, state->triangles[faces[i]].os);
+      projectedOt[i] = ProjectMikk(n, state->triangles[faces[i]].ot);
+    }
+
+    for (uint32_t i = 0; i < group.faceCount; i++)
+    {
+      const uint32_t f = faces[i];
+      const MikkTriangle& triangle = state->triangles[f];
+
+      members.clear();
+      for (uint32_t j = 0; j < group.faceCount; j++)
+      {
+        const uint32_t t = faces[j];
+        const bool any = ((triangle.flags | state->triangles[t].flags) & MIKK_GROUP_WITH_ANY) != 0;
+        const bool sameFace = f == t;
+        if (any
+          || sameFace
+          || (DotMikk(projectedOs[i], projectedOs[j]) > thresholdCos && DotMikk(projectedOt[i], projectedOt[j]) > thresholdCos))
+        {
+          members.push_back(t);
+        }
+      }
+      std::sort(members.begin(), members.end());
+
+      uint32_t subgroup = 0;
+      for (; subgroup < subgroupSpaces.size(); subgroup++)
+      {
+        const uint32_t offset = subgroupOffsets[subgroup];
+        if (subgroupOffsets[subgroup + 1] - offset == members.size()
+          && std::equal(members.begin(), members.end(), subgroupMembers.begin() + offset))
+        {
+          break;
+        }
+      }
+      if (subgroup == subgroupSpaces.size())
+      {
+        subgroupMembers.insert(subgroupMembers.end(), members.begin(), members.end());
+        subgroupOffsets.push_back((uint32_t)subgroupMembers.size());
+        subgroupSpaces.push_back(EvaluateSpace(*state, members.data(), (uint32_t)members.size(), group.vertex));
+      }
+
+      const uint32_t corner = triangle.groups[0] == (int32_t)g ? 0 : (triangle.groups[1] == (int32_t)g ? 1 : 2);
+      MikkSpace& space = state->spaces[triangle.original * 3 + corner];
+      space.os = subgroupSpaces[subgroup];
+      space.orientPreserving = group.orientPreserving;
+    }
+  }
+}
+
+// Degenerate triangles copy the space of the first good corner on the same welded vertex (DegenEpilogue)
+static void CopyDegenerateSpaces(MikkState* state)
+{
+  if (state->goodCount == state->triangles.size())
+  {
+    return;
+  }
+
+  // Only the vertices degenerate triangles use are looked up
+  const uint32_t unused = ~0u;
+  const uint32_t wanted = ~0u - 1;
+  std::vector<uint32_t> firstGoodCorner(state->vertices->size(), unused);
+  for (uint32_t c = state->goodCount * 3; c < state->corners.size(); c++)
+  {
+    firstGoodCorner[state->corners[c]] = wanted;
+  }
+  for (uint32_t c = 0; c < state->goodCount * 3; c++)
+  {
+    if (firstGoodCorner[state->corners[c]] == wanted)
+    {
+      firstGoodCorner[state->corners[c]] = c;
+    }
+  }
+
+  for (uint32_t t = state->goodCount; t < state->triangles.size(); t++)
+  {
+    for (uint32_t i = 0; i < 3; i++)
+    {
+      const uint32_t source = firstGoodCorner[state->corners[t * 3 + i]];
+      if (source < wanted)
+      {
+        const uint32_t sourceCorner = state->triangles[source / 3].original * 3 + source % 3;
+        state->spaces[state->triangles[t].original * 3 + i] = state->spaces[sourceCorner];
+      }
+    }
+  }
+}
+
+// Output
+// ============================================================
+
+// MikkTSpace outputs a space per corner, vertices whose corners disagree are duplicated
+static void WriteSpaces(const MikkState& state, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+{
+  const uint32_t originalCount = (uint32_t)vertices->size();
+  std::vector<uint8_t> written(originalCount, 0);
+  std::vector<uint32_t> nextCopy(originalCount, ~0u);
+
+  for (uint64_t c = 0; c < state.spaces.size(); c++)
+  {
+    const MikkSpace& space = state.spaces[c];
+    const float sign = space.orientPreserving ? 1.0f : -1.0f;
+    uint32_t index = (*indices)[c];
+
+    if (!written[index])
+    {
+      written[index] = 1;
+      (*vertices)[index].tangent = space.os;
+      (*vertices)[index].bitangentSign = sign;
+      continue;
+    }
+
+    // Walks the vertex's copies for one with this space
+    while (true)
+    {
+      const Vertex& v = (*vertices)[index];
+      if (v.tangent == space.os && v.bitangentSign == sign)
+      {
+        break;
+      }
+
+      if (nextCopy[index] == ~0u)
+      {
+        Vertex copy = v;
+        copy.tangent = space.os;
+        copy.bitangentSign = sign;
+        nextCopy[index] = (uint32_t)vertices->size();
+        nextCopy.push_back(~0u);
+        vertices->push_back(copy);
+      }
+      index = nextCopy[index];
+    }
+    (*indices)[c] = index;
+  }
+}
+
+// Tangents
+// ============================================================
+
+void GenerateTangents(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+{
+  const uint32_t triangleCount = (uint32_t)(indices->size() / 3);
+  if (triangleCount == 0)
+  {
+    return;
+  }
+
+  MikkState state;
+  state.vertices = vertices;
+  state.spaces.resize((uint64_t)triangleCount * 3);
+
+  std::vector<uint32_t> welded;
+  WeldCorners(*vertices, *indices, (uint64_t)triangleCount * 3, &welded);
+  PartitionDegenerates(&state, welded);
+  welded = std::vector<uint32_t>();
+
+  InitTriangles(&state);
+  BuildNeighbors(&state);
+  BuildGroups(&state);
+  GenerateSpaces(&state);
+  CopyDegenerateSpaces(&state);
+
+  WriteSpaces(state, vertices, indices);
+}
+
+// Normals
+// ============================================================
+
+void GenerateMissingNormals(std::vector<Vertex>* vertices, const uint32_t* indices, uint64_t indexCount)
+{
+  std::vector<Vertex>& verts = *vertices;
+  std::vector<uint8_t> missing(verts.size());
+  bool anyMissing = false;
+  for (uint64_t i = 0; i < verts.size(); i++)
+  {
+    missing[i] = Dot(verts[i].normal, verts[i].normal) == 0.0f;
+    anyMissing = anyMissing || missing[i];
+  }
+
+  if (!anyMissing)
+  {
+    return;
+  }
+
+  // The unnormalized cross product is twice the triangle's area
+  for (uint64_t i = 0; i + 2 < indexCount; i += 3)
+  {
+    Vertex& v0 = verts[indices[i + 0]];
+    Vertex& v1 = verts[indices[i + 1]];
+    Vertex& v2 = verts[indices[i + 2]];
+    Vec3 e1 = v1.position - v0.position;
+    Vec3 e2 = v2.position - v0.position;
+    Vec3 n = Vec3{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+      const uint32_t index = indices[i + corner];
+      if (missing[index])
+      {
+        verts[index].normal = verts[index].normal + n;
+      }
+    }
+  }
+
+  for (uint64_t i = 0; i < verts.size(); i++)
+  {
+    if (missing[i])
+    {
+      Vertex& v = verts[i];
+      float length = sqrtf(Dot(v.normal, v.normal));
+      v.normal = length > 0.0f ? v.normal * (1.0f / length) : Vec3{ 0.0f, 1.0f, 0.0f };
+    }
+  }
+}
+
+} // namespace Quartz
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Area weighted face normals for every vertex whose normal is zero, as importers leave vertices exported without one
+// Vertices only touched by degenerate triangles get +Y
+void GenerateMissingNormals(std::vector<Vertex>* vertices, const uint32_t* indices, uint64_t indexCount);
+
+// Generates MikkTSpace tangents and bitangent signs, matching the reference implementation at its default
+//   180 degree angular threshold, so normal maps baked against MikkTSpace shade without seams
+// MikkTSpace gives every triangle corner its own space : vertices whose corners disagree, such as along uv mirror seams,
+//   are duplicated and indices is rewritten to use the copies
+// Runs on the calling thread, importers already process separate meshes on separate job workers
+// Normals must already be normalized
+void GenerateTangents(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+
+} // namespace Quartz
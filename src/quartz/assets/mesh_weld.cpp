@@ -0,0 +1,270 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/hash.h"
+#include "quartz/assets/mesh_weld.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace Quartz
+{
+
+// Table
+// ============================================================
+
+// Open-addressing table with linear probing
+// Each entry packs the upper 32 hash bits (to reject most mismatches without touching the vertex)
+//   with (outputIndex + 1) so that zero marks an empty entry
+struct WeldTable
+{
+  std::vector<uint64_t> entries;
+  uint64_t mask;
+
+  void Init(uint64_t elementCount)
+  {
+    uint64_t capacity = 16;
+    while (capacity < elementCount * 2)
+    {
+      capacity <<= 1;
+    }
+    entries.assign(capacity, 0);
+    mask = capacity - 1;
+  }
+
+  static inline uint64_t Pack(uint64_t hash, uint32_t index) { return (hash & 0xffffffff00000000ull) | (uint64_t)(index + 1); }
+  static inline uint32_t Index(uint64_t entry) { return (uint32_t)(entry & 0xffffffffull) - 1; }
+  static inline bool TagMatches(uint64_t entry, uint64_t hash) { return (entry >> 32) == (hash >> 32); }
+};
+
+static inline uint64_t HashVertexBytes(const Vertex& vertex)
+{
+  return HashBytes(&vertex, sizeof(Vertex));
+}
+
+static inline uint64_t HashPositionBytes(const Vec3& position)
+{
+  return HashBytes(&position, sizeof(Vec3));
+}
+
+static inline uint64_t HashCell(int64_t x, int64_t y, int64_t z)
+{
+  return HashCombine(HashCombine(HashMix64((uint64_t)x), (uint64_t)y), (uint64_t)z);
+}
+
+// Exact
+// ============================================================
+
+static void WeldExact(const std::vector<Vertex>& vertices, std::vector<Vertex>* outVertices, std::vector<uint32_t>* outIndices)
+{
+  WeldTable table;
+  table.Init(vertices.size());
+
+  for (uint64_t i = 0; i < vertices.size(); i++)
+  {
+    const Vertex& vertex = vertices[i];
+    uint64_t hash = HashVertexBytes(vertex);
+    uint64_t slot = hash & table.mask;
+
+    while (true)
+    {
+      uint64_t entry = table.entries[slot];
+      if (entry == 0)
+      {
+        uint32_t index = (uint32_t)outVertices->size();
+        outVertices->push_back(vertex);
+        table.entries[slot] = WeldTable::Pack(hash, index);
+        (*outIndices)[i] = index;
+        break;
+      }
+
+      if (WeldTable::TagMatches(entry, hash)
+        && memcmp(&(*outVertices)[WeldTable::Index(entry)], &vertex, sizeof(Vertex)) == 0)
+      {
+        (*outIndices)[i] = WeldTable::Index(entry);
+        break;
+      }
+
+      slot = (slot + 1) & table.mask;
+    }
+  }
+}
+
+// Position
+// ============================================================
+
+static void WeldPositionExact(const std::vector<Vertex>& vertices, std::vector<Vertex>* outVertices, std::vector<uint32_t>* outIndices)
+{
+  WeldTable table;
+  table.Init(vertices.size());
+
+  for (uint64_t i = 0; i < vertices.size(); i++)
+  {
+    const Vertex& vertex = vertices[i];
+    uint64_t hash = HashPositionBytes(vertex.position);
+    uint64_t slot = hash & table.mask;
+
+    while (true)
+    {
+      uint64_t entry = table.entries[slot];
+      if (entry == 0)
+      {
+        uint32_t index = (uint32_t)outVertices->size();
+        outVertices->push_back(vertex);
+        table.entries[slot] = WeldTable::Pack(hash, index);
+        (*outIndices)[i] = index;
+        break;
+      }
+
+      if (WeldTable::TagMatches(entry, hash)
+        && memcmp(&(*outVertices)[WeldTable::Index(entry)].position, &vertex.position, sizeof(Vec3)) == 0)
+      {
+        (*outIndices)[i] = WeldTable::Index(entry);
+        break;
+      }
+
+      slot = (slot + 1) & table.mask;
+    }
+  }
+}
+
+// Positions are bucketed into cubic cells of size epsilon
+// Two vertices in the same cell are always within epsilon, so each cell holds one representative
+// A vertex can only weld with representatives of its own or its 26 neighboring cells
+static void WeldPositionEpsilon(const std::vector<Vertex>& vertices, float epsilon, std::vector<Vertex>* outVertices, std::vector<uint32_t>* outIndices)
+{
+  WeldTable table;
+  table.Init(vertices.size());
+
+  const float inverseEpsilon = 1.0f / epsilon;
+  auto CellOf = [inverseEpsilon](float value) { return (int64_t)floorf(value * inverseEpsilon); };
+
+  auto FindCell = [&](int64_t x, int64_t y, int64_t z, uint64_t* outSlot) -> uint64_t
+  {
+    uint64_t hash = HashCell(x, y, z);
+    uint64_t slot = hash & table.mask;
+    while (true)
+    {
+      uint64_t entry = table.entries[slot];
+      if (entry == 0)
+      {
+        *outSlot = slot;
+        return 0;
+      }
+
+      if (WeldTable::TagMatches(entry, hash))
+      {
+        const Vec3& p = (*outVertices)[WeldTable::Index(entry)].position;
+        if (CellOf(p.x) == x && CellOf(p.y) == y && CellOf(p.z) == z)
+        {
+          *outSlot = slot;
+          return entry;
+        }
+      }
+
+      slot = (slot + 1) & table.mask;
+    }
+  };
+
+  for (uint64_t i = 0; i < vertices.size(); i++)
+  {
+    const Vertex& vertex = vertices[i];
+    int64_t cx = CellOf(vertex.position.x);
+    int64_t cy = CellOf(vertex.position.y);
+    int64_t cz = CellOf(vertex.position.z);
+
+    uint64_t ownSlot;
+    uint64_t entry = FindCell(cx, cy, cz, &ownSlot);
+    if (entry != 0)
+    {
+      (*outIndices)[i] = WeldTable::Index(entry);
+      continue;
+    }
+
+    bool welded = false;
+    for (int64_t dz = -1; dz <= 1 && !welded; dz++)
+    {
+      for (int64_t dy = -1; dy <= 1 && !welded; dy++)
+      {
+        for (int64_t dx = -1; dx <= 1 && !welded; dx++)
+        {
+          if (dx == 0 && dy == 0 && dz == 0)
+          {
+            continue;
+          }
+
+          uint64_t neighborSlot;
+          uint64_t neighbor = FindCell(cx + dx, cy + dy, cz + dz, &neighborSlot);
+          if (neighbor == 0)
+          {
+            continue;
+          }
+
+          const Vec3& p = (*outVertices)[WeldTable::Index(neighbor)].position;
+          if (fabsf(p.x - vertex.position.x) <= epsilon
+            && fabsf(p.y - vertex.position.y) <= epsilon
+            && fabsf(p.z - vertex.position.z) <= epsilon)
+          {
+            (*outIndices)[i] = WeldTable::Index(neighbor);
+            welded = true;
+          }
+        }
+      }
+    }
+
+    if (!welded)
+    {
+      uint32_t index = (uint32_t)outVertices->size();
+      outVertices->push_back(vertex);
+      table.entries[ownSlot] = WeldTable::Pack(HashCell(cx, cy, cz), index);
+      (*outIndices)[i] = index;
+    }
+  }
+}
+
+// Weld
+// ============================================================
+
+QuartzResult WeldVertices(
+  const std::vector<Vertex>& vertices,
+  MeshWeldInfo info,
+  std::vector<Vertex>* outVertices,
+  std::vector<uint32_t>* outIndices)
+{
+  if (vertices.size() >= 0xffffffffull)
+  {
+    QTZ_ERROR("Can not weld more than 2^32 - 1 vertices ({})", vertices.size());
+    return Quartz_Failure;
+  }
+
+  outVertices->clear();
+  outIndices->resize(vertices.size());
+
+  switch (info.mode)
+  {
+  case Mesh_Weld_Exact:
+  {
+    WeldExact(vertices, outVertices, outIndices);
+  } break;
+  case Mesh_Weld_Position:
+  {
+    if (info.positionEpsilon > 0.0f)
+    {
+      WeldPositionEpsilon(vertices, info.positionEpsilon, outVertices, outIndices);
+    }
+    else
+    {
+      WeldPositionExact(vertices, outVertices, outIndices);
+    }
+  } break;
+  default:
+  {
+    QTZ_ERROR("Invalid mesh weld mode ({})", (uint32_t)info.mode);
+    return Quartz_Failure;
+  }
+  }
+
+  outVertices->shrink_to_fit();
+  return Quartz_Success;
+}
+
+} // namespace Quartz
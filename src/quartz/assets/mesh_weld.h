@@ -0,0 +1,32 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+enum MeshWeldMode
+{
+  Mesh_Weld_Exact,    // Vertices merge only if all of their bytes match
+  Mesh_Weld_Position, // Vertices merge if their positions are within positionEpsilon on every axis
+};
+
+struct MeshWeldInfo
+{
+  MeshWeldMode mode = Mesh_Weld_Exact;
+  float positionEpsilon = 0.0f;
+};
+
+// Merges duplicate vertices, outputs one index per input vertex
+// Welded vertices keep the attributes of the first vertex in their group
+// Exact welding performs a single hash table probe sequence per vertex
+QuartzResult WeldVertices(
+  const std::vector<Vertex>& vertices,
+  MeshWeldInfo info,
+  std::vector<Vertex>* outVertices,
+  std::vector<uint32_t>* outIndices);
+
+} // namespace Quartz
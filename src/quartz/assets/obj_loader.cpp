@@ -0,0 +1,509 @@
+
+#include "quartz/defines.h"
+#include "quartz/assets/obj_loader.h"
+#include "quartz/core/jobs.h"
+#include "quartz/platform/filesystem/filesystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+
+namespace Quartz
+{
+
+// Types
+// ============================================================
+
+// Zero-based attribute indices, g_objAbsent when the face omits the attribute
+struct ObjCorner
+{
+  int32_t position;
+  int32_t uv;
+  int32_t normal;
+};
+
+static const int32_t g_objAbsent = INT32_MIN;
+
+struct ObjChunk
+{
+  const char* begin;
+  const char* end;
+
+  std::vector<Vec3> positions;
+  std::vector<Vec2> uvs;
+  std::vector<Vec3> normals;
+  std::vector<ObjCorner> corners; // Triangulated
+
+  // Negative OBJ indices are relative to the attribute count at their line
+  // They are stored relative to this chunk's first attribute and offset after all chunks are counted
+  // Holds (cornerIndex * 3 + attribute) for each relative index
+  std::vector<uint64_t> relativeIndices;
+
+  uint64_t positionOffset;
+  uint64_t uvOffset;
+  uint64_t normalOffset;
+  uint64_t cornerOffset;
+
+  uint64_t lineCount;
+  uint64_t failedLine; // One-based within the chunk, 0 if no error
+};
+
+// Number parsing
+// ============================================================
+
+static const double g_objPowersOfTen[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool ObjIsSpace(char c)
+{
+  return c == ' ' || c == '\t';
+}
+
+static inline bool ObjIsDigit(char c)
+{
+  return (unsigned)(c - '0') < 10;
+}
+
+static inline const char* ObjSkipSpace(const char* c, const char* end)
+{
+  while (c < end && ObjIsSpace(*c))
+  {
+    c++;
+  }
+  return c;
+}
+
+// Decimal mantissa is accumulated as an integer and scaled once
+// Exact for up to 19 significant digits and exponents within 10^+-22, which covers all real OBJ data
+static const char* ObjParseFloat(const char* c, const char* end, float* outValue)
+{
+  c = ObjSkipSpace(c, end);
+
+  bool negative = false;
+  if (c < end && (*c == '-' || *c == '+'))
+  {
+    negative = *c == '-';
+    c++;
+  }
+
+  uint64_t mantissa = 0;
+  int32_t exponent = 0;
+  uint32_t significantDigits = 0;
+  const char* digitStart = c;
+
+  for (; c < end && ObjIsDigit(*c); c++)
+  {
+    if (significantDigits < 19)
+    {
+      mantissa = mantissa * 10 + (*c - '0');
+      significantDigits += (mantissa != 0);
+    }
+    else
+    {
+      exponent++;
+    }
+  }
+
+  if (c < end && *c == '.')
+  {
+    c++;
+    for (; c < end && ObjIsDigit(*c); c++)
+    {
+      if (significantDigits < 19)
+      {
+        mantissa = mantissa * 10 + (*c - '0');
+        significantDigits += (mantissa != 0);
+        exponent--;
+      }
+    }
+  }
+
+  if (c == digitStart)
+  {
+    *outValue = 0.0f;
+    return nullptr;
+  }
+
+  if (c < end && (*c == 'e' || *c == 'E'))
+  {
+    c++;
+    bool negativeExponent = false;
+    if (c < end && (*c == '-' || *c == '+'))
+    {
+      negativeExponent = *c == '-';
+      c++;
+    }
+
+    int32_t explicitExponent = 0;
+    for (; c < end && ObjIsDigit(*c); c++)
+    {
+      if (explicitExponent < 10000)
+      {
+        explicitExponent = explicitExponent * 10 + (*c - '0');
+      }
+    }
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  double value = (double)mantissa;
+  if (exponent < 0 && exponent >= -22)
+  {
+    value /= g_objPowersOfTen[-exponent];
+  }
+  else if (exponent > 0 && exponent <= 22)
+  {
+    value *= g_objPowersOfTen[exponent];
+  }
+  else if (exponent != 0)
+  {
+    value *= pow(10.0, (double)exponent);
+  }
+
+  *outValue = (float)(negative ? -value : value);
+  return c;
+}
+
+static const char* ObjParseInt(const char* c, const char* end, int64_t* outValue)
+{
+  bool negative = false;
+  if (c < end && (*c == '-' || *c == '+'))
+  {
+    negative = *c == '-';
+    c++;
+  }
+
+  if (c >= end || !ObjIsDigit(*c))
+  {
+    return nullptr;
+  }
+
+  int64_t value = 0;
+  for (; c < end && ObjIsDigit(*c); c++)
+  {
+    value = value * 10 + (*c - '0');
+  }
+
+  *outValue = negative ? -value : value;
+  return c;
+}
+
+// Chunk parsing
+// ============================================================
+
+// Converts a one-based (or negative relative) OBJ index into a zero-based index
+// Relative indices are left relative to the chunk's first attribute of that type
+static inline int32_t ObjResolveIndex(int64_t objIndex, uint64_t chunkLocalCount, bool* outIsRelative)
+{
+  if (objIndex > 0)
+  {
+    *outIsRelative = false;
+    return (int32_t)(objIndex - 1);
+  }
+
+  *outIsRelative = true;
+  return (int32_t)((int64_t)chunkLocalCount + objIndex);
+}
+
+static const char* ObjParseCorner(const char* c, const char* end, ObjChunk* chunk, ObjCorner* outCorner, bool outRelative[3])
+{
+  int64_t value;
+  outRelative[0] = outRelative[1] = outRelative[2] = false;
+  outCorner->uv = g_objAbsent;
+  outCorner->normal = g_objAbsent;
+
+  c = ObjParseInt(c, end, &value);
+  if (c == nullptr || value == 0)
+  {
+    return nullptr;
+  }
+  outCorner->position = ObjResolveIndex(value, chunk->positions.size(), &outRelative[0]);
+
+  if (c < end && *c == '/')
+  {
+    c++;
+    if (c < end && *c != '/')
+    {
+      c = ObjParseInt(c, end, &value);
+      if (c == nullptr || value == 0)
+      {
+        return nullptr;
+      }
+      outCorner->uv = ObjResolveIndex(value, chunk->uvs.size(), &outRelative[1]);
+    }
+
+    if (c < end && *c == '/')
+    {
+      c++;
+      c = ObjParseInt(c, end, &value);
+      if (c == nullptr || value == 0)
+      {
+        return nullptr;
+      }
+      outCorner->normal = ObjResolveIndex(value, chunk->normals.size(), &outRelative[2]);
+    }
+  }
+
+  return c;
+}
+
+static void ObjPushCorner(ObjChunk* chunk, const ObjCorner& corner, const bool relative[3])
+{
+  uint64_t cornerIndex = chunk->corners.size();
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    if (relative[i])
+    {
+      chunk->relativeIndices.push_back(cornerIndex * 3 + i);
+    }
+  }
+  chunk->corners.push_back(corner);
+}
+
+static void ObjParseChunk(ObjChunk* chunk)
+{
+  const char* c = chunk->begin;
+  const char* end = chunk->end;
+  uint64_t lineNumber = 1;
+
+  while (c < end)
+  {
+    const char* lineEnd = (const char*)memchr(c, '\n', end - c);
+    if (lineEnd == nullptr)
+    {
+      lineEnd = end;
+    }
+
+    c = ObjSkipSpace(c, lineEnd);
+    bool valid = true;
+
+    if (lineEnd - c >= 2 && c[0] == 'v' && ObjIsSpace(c[1]))
+    {
+      Vec3 p;
+      valid = (c = ObjParseFloat(c + 2, lineEnd, &p.x)) && (c = ObjParseFloat(c, lineEnd, &p.y)) && (c = ObjParseFloat(c, lineEnd, &p.z));
+      chunk->positions.push_back(p);
+    }
+    else if (lineEnd - c >= 3 && c[0] == 'v' && c[1] == 't' && ObjIsSpace(c[2]))
+    {
+      Vec2 uv;
+      valid = (c = ObjParseFloat(c + 3, lineEnd, &uv.x)) && (c = ObjParseFloat(c, lineEnd, &uv.y));
+      chunk->uvs.push_back(uv);
+    }
+    else if (lineEnd - c >= 3 && c[0] == 'v' && c[1] == 'n' && ObjIsSpace(c[2]))
+    {
+      Vec3 n;
+      valid = (c = ObjParseFloat(c + 3, lineEnd, &n.x)) && (c = ObjParseFloat(c, lineEnd, &n.y)) && (c = ObjParseFloat(c, lineEnd, &n.z));
+      chunk->normals.push_back(n);
+    }
+    else if (lineEnd - c >= 2 && c[0] == 'f' && ObjIsSpace(c[1]))
+    {
+      ObjCorner first, previous, current;
+      bool firstRelative[3], previousRelative[3], currentRelative[3];
+      uint32_t cornerCount = 0;
+
+      c = ObjSkipSpace(c + 2, lineEnd);
+      while (valid && c < lineEnd && !ObjIsSpace(*c) && *c != '\r' && *c != '#')
+      {
+        c = ObjParseCorner(c, lineEnd, chunk, &current, currentRelative);
+        if (c == nullptr)
+        {
+          valid = false;
+          break;
+        }
+
+        if (cornerCount == 0)
+        {
+          first = current;
+          memcpy(firstRelative, currentRelative, sizeof(firstRelative));
+        }
+        else if (cornerCount >= 2)
+        {
+          // Fan triangulation
+          ObjPushCorner(chunk, first, firstRelative);
+          ObjPushCorner(chunk, previous, previousRelative);
+          ObjPushCorner(chunk, current, currentRelative);
+        }
+
+        previous = current;
+        memcpy(previousRelative, currentRelative, sizeof(previousRelative));
+        cornerCount++;
+        c = ObjSkipSpace(c, lineEnd);
+      }
+
+      valid = valid && cornerCount >= 3;
+    }
+    // Other statements (groups, materials, smoothing, comments, ...) are ignored
+
+    if (!valid && chunk->failedLine == 0)
+    {
+      chunk->failedLine = lineNumber;
+    }
+
+    c = (lineEnd < end) ? lineEnd + 1 : end;
+    lineNumber++;
+  }
+
+  chunk->lineCount = lineNumber - 1;
+}
+
+// Loader
+// ============================================================
+
+QuartzResult LoadObj(const char* path, std::vector<Vertex>* outTriangleVertices)
+{
+  MappedFile file;
+  QTZ_ATTEMPT(PlatformMapFile(path, &file));
+
+  const char* fileBegin = (const char*)file.data;
+  const char* fileEnd = fileBegin + file.size;
+
+  // Split at line boundaries ==============================
+
+  const uint64_t minChunkSize = 1 << 20;
+  uint64_t chunkCount = std::clamp<uint64_t>(file.size / minChunkSize, 1, (uint64_t)JobWorkerCount() * 8);
+
+  std::vector<ObjChunk> chunks(chunkCount);
+  const char* chunkBegin = fileBegin;
+  for (uint64_t i = 0; i < chunkCount; i++)
+  {
+    const char* chunkEnd = fileEnd;
+    if (i + 1 < chunkCount)
+    {
+      chunkEnd = std::max(chunkBegin, fileBegin + (file.size * (i + 1)) / chunkCount);
+      const char* newline = (const char*)memchr(chunkEnd, '\n', fileEnd - chunkEnd);
+      chunkEnd = (newline == nullptr) ? fileEnd : newline + 1;
+    }
+
+    chunks[i] = {};
+    chunks[i].begin = chunkBegin;
+    chunks[i].end = chunkEnd;
+    chunkBegin = chunkEnd;
+  }
+
+  // Parse ==============================
+
+  ParallelFor((uint32_t)chunkCount, [&](uint32_t i)
+  {
+    ObjParseChunk(&chunks[i]);
+  });
+
+  // Offsets ==============================
+
+  uint64_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0, lineCount = 0;
+  bool failed = false;
+  for (ObjChunk& chunk : chunks)
+  {
+    chunk.positionOffset = positionCount;
+    chunk.uvOffset = uvCount;
+    chunk.normalOffset = normalCount;
+    chunk.cornerOffset = cornerCount;
+
+    positionCount += chunk.positions.size();
+    uvCount += chunk.uvs.size();
+    normalCount += chunk.normals.size();
+    cornerCount += chunk.corners.size();
+
+    if (chunk.failedLine != 0 && !failed)
+    {
+      QTZ_ERROR("Failed to parse OBJ \"{}\" : Malformed statement on line {}", path, lineCount + chunk.failedLine);
+      failed = true;
+    }
+    lineCount += chunk.lineCount;
+  }
+
+  if (failed || cornerCount == 0)
+  {
+    if (!failed)
+    {
+      QTZ_ERROR("Failed to parse OBJ \"{}\" : File contains no faces", path);
+    }
+    PlatformUnmapFile(&file);
+    return Quartz_Failure;
+  }
+
+  // Concatenate attributes ==============================
+
+  std::vector<Vec3> positions(positionCount);
+  std::vector<Vec2> uvs(uvCount);
+  std::vector<Vec3> normals(normalCount);
+
+  ParallelFor((uint32_t)chunkCount, [&](uint32_t i)
+  {
+    ObjChunk& chunk = chunks[i];
+    memcpy(positions.data() + chunk.positionOffset, chunk.positions.data(), chunk.positions.size() * sizeof(Vec3));
+    memcpy(uvs.data() + chunk.uvOffset, chunk.uvs.data(), chunk.uvs.size() * sizeof(Vec2));
+    memcpy(normals.data() + chunk.normalOffset, chunk.normals.data(), chunk.normals.size() * sizeof(Vec3));
+    chunk.positions = std::vector<Vec3>();
+    chunk.uvs = std::vector<Vec2>();
+    chunk.normals = std::vector<Vec3>();
+  });
+
+  PlatformUnmapFile(&file);
+
+  // Assemble vertices ==============================
+
+  outTriangleVertices->resize(cornerCount);
+  Vertex* outVertices = outTriangleVertices->data();
+  std::atomic<bool> outOfRange = false;
+
+  ParallelFor((uint32_t)chunkCount, [&](uint32_t i)
+  {
+    ObjChunk& chunk = chunks[i];
+
+    const uint64_t offsets[3] = { chunk.positionOffset, chunk.uvOffset, chunk.normalOffset };
+    for (uint64_t relative : chunk.relativeIndices)
+    {
+      int32_t* index = &chunk.corners[relative / 3].position + (relative % 3);
+      *index += (int32_t)offsets[relative % 3];
+    }
+
+    Vertex* v = outVertices + chunk.cornerOffset;
+    for (const ObjCorner& corner : chunk.corners)
+    {
+      if ((uint64_t)corner.position >= positionCount
+        || (corner.uv != g_objAbsent && (uint64_t)corner.uv >= uvCount)
+        || (corner.normal != g_objAbsent && (uint64_t)corner.normal >= normalCount))
+      {
+        outOfRange = true;
+        *v = {};
+        v++;
+        continue;
+      }
+
+      v->position = positions[corner.position];
+      if (corner.uv != g_objAbsent)
+      {
+        v->uv = Vec2{ uvs[corner.uv].x, 1.0f - uvs[corner.uv].y };
+      }
+      else
+      {
+        v->uv = Vec2{ 0.0f, 0.0f };
+      }
+      if (corner.normal != g_objAbsent)
+      {
+        v->normal = normals[corner.normal];
+      }
+      else
+      {
+        v->normal = Vec3{ 0.0f, 0.0f, 0.0f };
+      }
+      v->tangent = Vec3{ 0.0f, 0.0f, 0.0f };
+      v++;
+    }
+
+    chunk.corners = std::vector<ObjCorner>();
+    chunk.relativeIndices = std::vector<uint64_t>();
+  });
+
+  if (outOfRange)
+  {
+    QTZ_ERROR("Failed to parse OBJ \"{}\" : Face references an attribute that does not exist", path);
+    outTriangleVertices->clear();
+    return Quartz_Failure;
+  }
+
+  return Quartz_Success;
+}
+
+} // namespace Quartz
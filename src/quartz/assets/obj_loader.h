@@ -0,0 +1,16 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Parses a Wavefront OBJ file across all job workers
+// Polygons are fan-triangulated, every three consecutive output vertices form one triangle
+// Vertices are not welded and have no tangents, missing uvs/normals are zeroed (ImportMesh() generates the normals)
+QuartzResult LoadObj(const char* path, std::vector<Vertex>* outTriangleVertices);
+
+} // namespace Quartz
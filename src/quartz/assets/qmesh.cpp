@@ -0,0 +1,369 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/hash.h"
+#include "quartz/assets/qmesh.h"
+#include "quartz/assets/mesh_import.h"
+#include "quartz/rendering/vertex_compression.h"
+
+#include <filesystem>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <unordered_set>
+
+namespace Quartz
+{
+
+static uint64_t QMeshChecksum(const QMeshHeader& header, const uint8_t* fileData, uint64_t fileSize)
+{
+  QMeshHeader seedHeader = header;
+  seedHeader.checksum = 0;
+  uint64_t seed = HashBytes(&seedHeader, sizeof(seedHeader));
+  return HashBytes(fileData + sizeof(QMeshHeader), fileSize - sizeof(QMeshHeader), seed);
+}
+
+static inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Write
+// ============================================================
+
+QuartzResult WriteQMesh(const char* path, const QMeshWriteInfo& info)
+{
+  const std::vector<Vertex>& vertices = *info.vertices;
+  const std::vector<uint32_t>& indices = *info.indices;
+
+  if (info.extraSections.size() + 2 > QMESH_MAX_SECTIONS)
+  {
+    QTZ_ERROR("Cooked meshes can hold at most {} sections ({} requested)", QMESH_MAX_SECTIONS, info.extraSections.size() + 2);
+    return Quartz_Failure;
+  }
+
+  const MeshBounds bounds = ComputeMeshBounds(vertices.data(), vertices.size());
+  QuartzVertexFormat vertexFormat = info.vertexFormat;
+  if (vertexFormat == Quartz_Vertex_Format_Compact && !CompactPositionsFit(bounds))
+  {
+    QTZ_WARNING("\"{}\" is too large or too far from its origin for half float positions, cooking full vertices", path);
+    vertexFormat = Quartz_Vertex_Format_Full;
+  }
+
+  std::vector<CompactVertex> compactVertices;
+  QMeshSectionData vertexSection = { QMesh_Section_Vertices, sizeof(Vertex), vertices.size(), vertices.data() };
+  if (vertexFormat == Quartz_Vertex_Format_Compact)
+  {
+    compactVertices.resize(vertices.size());
+    for (uint64_t i = 0; i < vertices.size(); i++)
+    {
+      compactVertices[i] = CompressVertex(vertices[i]);
+    }
+    vertexSection = { QMesh_Section_Vertices, sizeof(CompactVertex), compactVertices.size(), compactVertices.data() };
+  }
+
+  std::vector<uint16_t> narrowIndices;
+  QMeshSectionData indexSection = { QMesh_Section_Indices, sizeof(uint32_t), indices.size(), indices.data() };
+  if (vertices.size() <= QTZ_MESH_MAX_16BIT_VERTICES)
+  {
+    narrowIndices.assign(indices.begin(), indices.end());
+    indexSection = { QMesh_Section_Indices, sizeof(uint16_t), narrowIndices.size(), narrowIndices.data() };
+  }
+
+  std::vector<QMeshSectionData> sections;
+  sections.push_back(vertexSection);
+  sections.push_back(indexSection);
+  sections.insert(sections.end(), info.extraSections.begin(), info.extraSections.end());
+
+  // Header ==============================
+
+  QMeshHeader header = {};
+  header.magic = QMESH_MAGIC;
+  header.version = QMESH_VERSION;
+  header.endianness = QMESH_ENDIANNESS;
+  header.vertexFormat = (uint32_t)vertexFormat;
+
+  header.boundsMin[0] = bounds.min.x; header.boundsMin[1] = bounds.min.y; header.boundsMin[2] = bounds.min.z;
+  header.boundsMax[0] = bounds.max.x; header.boundsMax[1] = bounds.max.y; header.boundsMax[2] = bounds.max.z;
+  header.sphereCenter[0] = bounds.sphereCenter.x; header.sphereCenter[1] = bounds.sphereCenter.y; header.sphereCenter[2] = bounds.sphereCenter.z;
+  header.sphereRadius = bounds.sphereRadius;
+
+  // The full detail level leads the index section, the LOD section says where it ends
+  uint64_t fullDetailIndexCount = indices.size();
+  for (const QMeshSectionData& section : info.extraSections)
+  {
+    if (section.type == QMesh_Section_Lods && section.count > 0)
+    {
+      fullDetailIndexCount = ((const MeshLod*)section.data)[0].indexCount;
+    }
+  }
+  header.uvDensity = ComputeUvDensity(vertices.data(), indices.data(), fullDetailIndexCount);
+
+  uint64_t offset = AlignUp(sizeof(QMeshHeader), QMESH_SECTION_ALIGNMENT);
+  header.sectionCount = (uint32_t)sections.size();
+  for (uint32_t i = 0; i < sections.size(); i++)
+  {
+    QMeshSection& section = header.sections[i];
+    section.type = (uint32_t)sections[i].type;
+    section.stride = sections[i].stride;
+    section.count = sections[i].count;
+    section.offset = offset;
+    section.size = (uint64_t)sections[i].stride * sections[i].count;
+    offset = AlignUp(offset + section.size, QMESH_SECTION_ALIGNMENT);
+  }
+  header.fileSize = offset;
+
+  // Assemble ==============================
+
+  std::vector<uint8_t> fileData(header.fileSize, 0);
+  for (uint32_t i = 0; i < sections.size(); i++)
+  {
+    if (header.sections[i].size > 0)
+    {
+      memcpy(fileData.data() + header.sections[i].offset, sections[i].data, header.sections[i].size);
+    }
+  }
+
+  header.checksum = QMeshChecksum(header, fileData.data(), fileData.size());
+  memcpy(fileData.data(), &header, sizeof(header));
+
+  const std::string partialPath = std::string(path) + ".partial";
+  FILE* outFile;
+  int err = fopen_s(&outFile, partialPath.c_str(), "wb");
+  if (err)
+  {
+    QTZ_ERROR("Failed to open \"{}\" for writing", partialPath);
+    return Quartz_Failure;
+  }
+
+  uint64_t written = fwrite(fileData.data(), 1, fileData.size(), outFile);
+  const bool closed = fclose(outFile) == 0;
+
+  std::error_code error;
+  if (written != fileData.size() || !closed)
+  {
+    QTZ_ERROR("Failed to write cooked mesh \"{}\" ({} of {} bytes)", path, written, fileData.size());
+    std::filesystem::remove(partialPath, error);
+    return Quartz_Failure;
+  }
+
+  std::filesystem::rename(partialPath, path, error);
+  if (error)
+  {
+    QTZ_ERROR("Failed to move \"{}\" into place : {}", partialPath, error.message());
+    std::filesystem::remove(partialPath, error);
+    return Quartz_Failure;
+  }
+
+  return Quartz_Success;
+}
+
+// Read
+// ============================================================
+
+const void* QMeshFile::Section(QMeshSectionType type, uint64_t* outCount, uint32_t* outStride) const
+{
+  for (uint32_t i = 0; i < header->sectionCount; i++)
+  {
+    const QMeshSection& section = header->sections[i];
+    if (section.type == (uint32_t)type)
+    {
+      if (outCount)
+      {
+        *outCount = section.count;
+      }
+      if (outStride)
+      {
+        *outStride = section.stride;
+      }
+      return (const uint8_t*)file.data + section.offset;
+    }
+  }
+
+  if (outCount)
+  {
+    *outCount = 0;
+  }
+  return nullptr;
+}
+
+// Files whose checksum has passed this run, by path and checksum so a re-cooked file is verified again
+static std::mutex g_verifiedMutex;
+static std::unordered_set<uint64_t> g_verifiedFiles;
+
+static QuartzResult ValidateQMesh(const char* path, const MappedFile& file, bool verifyChecksum)
+{
+  if (file.size < sizeof(QMeshHeader))
+  {
+    QTZ_ERROR("\"{}\" is too small to be a cooked mesh ({} bytes)", path, file.size);
+    return Quartz_Failure;
+  }
+
+  const QMeshHeader* header = (const QMeshHeader*)file.data;
+  if (header->magic != QMESH_MAGIC)
+  {
+    QTZ_ERROR("\"{}\" is not a cooked mesh", path);
+    return Quartz_Failure;
+  }
+
+  if (header->endianness != QMESH_ENDIANNESS)
+  {
+    QTZ_ERROR("Cooked mesh \"{}\" was written with a different endianness", path);
+    return Quartz_Failure;
+  }
+
+  if (header->version != QMESH_VERSION)
+  {
+    QTZ_ERROR("Cooked mesh \"{}\" has version {}, expected {}. Re-cook the source asset", path, header->version, QMESH_VERSION);
+    return Quartz_Failure;
+  }
+
+  if (header->fileSize != file.size || header->sectionCount > QMESH_MAX_SECTIONS)
+  {
+    QTZ_ERROR("Cooked mesh \"{}\" is truncated or corrupt", path);
+    return Quartz_Failure;
+  }
+
+  for (uint32_t i = 0; i < header->sectionCount; i++)
+  {
+    const QMeshSection& section = header->sections[i];
+    if (section.offset % QMESH_SECTION_ALIGNMENT != 0
+      || section.offset > file.size
+      || section.size > file.size - section.offset
+      || section.size != (uint64_t)section.stride * section.count)
+    {
+      QTZ_ERROR("Cooked mesh \"{}\" has an invalid section ({})", path, i);
+      return Quartz_Failure;
+    }
+  }
+
+  const uint64_t verifiedKey = HashCombine(HashString(path), header->checksum);
+  {
+    std::lock_guard<std::mutex> lock(g_verifiedMutex);
+    verifyChecksum = verifyChecksum || g_verifiedFiles.count(verifiedKey) == 0;
+  }
+
+  if (verifyChecksum)
+  {
+    if (QMeshChecksum(*header, (const uint8_t*)file.data, file.size) != header->checksum)
+    {
+      QTZ_ERROR("Cooked mesh \"{}\" failed its checksum", path);
+      return Quartz_Failure;
+    }
+
+    std::lock_guard<std::mutex> lock(g_verifiedMutex);
+    g_verifiedFiles.insert(verifiedKey);
+  }
+
+  return Quartz_Success;
+}
+
+static uint32_t MaxIndex(const void* indices, uint32_t stride, uint64_t count)
+{
+  uint32_t maxIndex = 0;
+  if (stride == sizeof(uint16_t))
+  {
+    for (uint64_t i = 0; i < count; i++)
+    {
+      maxIndex = PeriMax(maxIndex, (uint32_t)((const uint16_t*)indices)[i]);
+    }
+  }
+  else
+  {
+    for (uint64_t i = 0; i < count; i++)
+    {
+      maxIndex = PeriMax(maxIndex, ((const uint32_t*)indices)[i]);
+    }
+  }
+  return maxIndex;
+}
+
+QuartzResult OpenQMesh(const char* path, QMeshFile* outFile, bool verifyChecksum)
+{
+  QTZ_ATTEMPT(PlatformMapFile(path, &outFile->file));
+  QTZ_ATTEMPT(ValidateQMesh(path, outFile->file, verifyChecksum), PlatformUnmapFile(&outFile->file));
+
+  outFile->header = (const QMeshHeader*)outFile->file.data;
+
+  if (outFile->header->vertexFormat > Quartz_Vertex_Format_Compact)
+  {
+    QTZ_ERROR("Cooked mesh \"{}\" has an unknown vertex format ({})", path, outFile->header->vertexFormat);
+    CloseQMesh(outFile);
+    return Quartz_Failure;
+  }
+
+  const QuartzVertexFormat vertexFormat = (QuartzVertexFormat)outFile->header->vertexFormat;
+  uint64_t vertexCount = 0;
+  uint32_t vertexStride = 0;
+  uint32_t indexStride = 0;
+  if (outFile->Section(QMesh_Section_Vertices, &vertexCount, &vertexStride) == nullptr
+    || outFile->Section(QMesh_Section_Indices, nullptr, &indexStride) == nullptr
+    || vertexStride != ((vertexFormat == Quartz_Vertex_Format_Compact) ? sizeof(CompactVertex) : sizeof(Vertex))
+    || (indexStride != sizeof(uint32_t) && (indexStride != sizeof(uint16_t) || vertexCount > QTZ_MESH_MAX_16BIT_VERTICES)))
+  {
+    QTZ_ERROR("Cooked mesh \"{}\" is missing vertices or indices", path);
+    CloseQMesh(outFile);
+    return Quartz_Failure;
+  }
+
+  // Checked even when the checksum is not : an index past the vertices reads outside the gpu's vertex buffers
+  uint64_t indexCount;
+  const void* indices = outFile->Section(QMesh_Section_Indices, &indexCount);
+  if (indexCount > 0 && MaxIndex(indices, indexStride, indexCount) >= vertexCount)
+  {
+    QTZ_ERROR("Cooked mesh \"{}\" has indices past its {} vertices", path, vertexCount);
+    CloseQMesh(outFile);
+    return Quartz_Failure;
+  }
+
+  // Lod ranges are used to draw straight from the index section
+  uint64_t lodCount;
+  uint32_t lodStride = 0;
+  const MeshLod* lods = (const MeshLod*)outFile->Section(QMesh_Section_Lods, &lodCount, &lodStride);
+  if (lods)
+  {
+    // The full detail level leads the index section, meshlets and Dump() index from its start
+    bool lodsValid = lodStride == sizeof(MeshLod) && lodCount > 0 && lods[0].indexOffset == 0;
+    for (uint64_t i = 0; lodsValid && i < lodCount; i++)
+    {
+      lodsValid = (uint64_t)lods[i].indexOffset + lods[i].indexCount <= indexCount;
+    }
+
+    if (!lodsValid)
+    {
+      QTZ_ERROR("Cooked mesh \"{}\" has invalid LODs", path);
+      CloseQMesh(outFile);
+      return Quartz_Failure;
+    }
+  }
+
+  // Meshlets index into the full detail level
+  uint64_t fullDetailIndexCount = lods ? lods[0].indexCount : indexCount;
+  uint64_t meshletCount;
+  uint32_t meshletStride = 0;
+  const Meshlet* meshlets = (const Meshlet*)outFile->Section(QMesh_Section_Meshlets, &meshletCount, &meshletStride);
+  if (meshlets)
+  {
+    bool meshletsValid = meshletStride == sizeof(Meshlet);
+    for (uint64_t i = 0; meshletsValid && i < meshletCount; i++)
+    {
+      meshletsValid = (uint64_t)meshlets[i].indexOffset + meshlets[i].indexCount <= fullDetailIndexCount;
+    }
+
+    if (!meshletsValid)
+    {
+      QTZ_ERROR("Cooked mesh \"{}\" has invalid meshlets", path);
+      CloseQMesh(outFile);
+      return Quartz_Failure;
+    }
+  }
+
+  return Quartz_Success;
+}
+
+void CloseQMesh(QMeshFile* file)
+{
+  PlatformUnmapFile(&file->file);
+  file->header = nullptr;
+}
+
+} // namespace Quartz
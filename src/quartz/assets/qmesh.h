@@ -0,0 +1,107 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+#include "quartz/platform/filesystem/filesystem.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Cooked mesh (.qmesh)
+// ============================================================
+// [QMeshHeader][section 0]...[section n], every section starts on a QMESH_SECTION_ALIGNMENT boundary
+// All values are little-endian, files are loaded by mapping them and uploading straight from the mapped pages
+
+// Cooked meshes are named after their source : "model.obj" cooks to "model.obj.qmesh"
+#define QMESH_EXTENSION ".qmesh"
+#define QMESH_MAGIC 0x48534d51 // "QMSH"
+#define QMESH_VERSION 1
+#define QMESH_ENDIANNESS 0x01020304
+#define QMESH_SECTION_ALIGNMENT 64
+#define QMESH_MAX_SECTIONS 8
+
+#ifdef QTZ_CONFIG_DEBUG
+#define QMESH_VERIFY_DEFAULT true
+#else
+#define QMESH_VERIFY_DEFAULT false
+#endif // QTZ_CONFIG_DEBUG
+
+enum QMeshSectionType
+{
+  QMesh_Section_Vertices,         // Vertex or CompactVertex, as the header's vertexFormat says
+  QMesh_Section_Indices,          // uint16_t if there are at most QTZ_MESH_MAX_16BIT_VERTICES vertices, uint32_t otherwise. Every LOD back to back
+  QMesh_Section_Lods,             // MeshLod, ranges of the index section. Missing for single level meshes
+  QMesh_Section_Meshlets,         // Meshlet, ranges of the full detail level. Missing for meshes drawn whole
+  QMesh_Section_Count
+};
+
+struct QMeshSection
+{
+  uint32_t type;
+  uint32_t stride; // Bytes per element
+  uint64_t count;
+  uint64_t offset; // From the start of the file
+  uint64_t size;
+};
+
+struct QMeshHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t endianness;
+  uint32_t vertexFormat; // QuartzVertexFormat of the vertex section
+  uint64_t fileSize;
+  // Hash of every byte after the header, seeded with the header itself (checksum zeroed)
+  uint64_t checksum;
+
+  float boundsMin[3];
+  float boundsMax[3];
+  float sphereCenter[3];
+  float sphereRadius;
+
+  uint32_t sectionCount;
+  float uvDensity; // Of the full detail level, see ComputeUvDensity()
+  QMeshSection sections[QMESH_MAX_SECTIONS];
+};
+static_assert(sizeof(QMeshHeader) == 336, "QMeshHeader layout is part of the file format");
+
+struct QMeshSectionData
+{
+  QMeshSectionType type;
+  uint32_t stride;
+  uint64_t count;
+  const void* data;
+};
+
+struct QMeshWriteInfo
+{
+  const std::vector<Vertex>* vertices;
+  const std::vector<uint32_t>* indices; // Narrowed to 16-bit when they fit
+  // Vertices are stored pre-converted so they can be uploaded without a copy
+  QuartzVertexFormat vertexFormat = Quartz_Vertex_Format_Full;
+  // LODs, meshlets, etc.
+  std::vector<QMeshSectionData> extraSections;
+};
+
+// Written to "<path>.partial" and moved into place, a failed or interrupted write never leaves a truncated file at path
+QuartzResult WriteQMesh(const char* path, const QMeshWriteInfo& info);
+
+// An open, validated cooked mesh, section pointers stay valid until CloseQMesh
+struct QMeshFile
+{
+  MappedFile file;
+  const QMeshHeader* header = nullptr;
+
+  // Returns nullptr if the file has no section of this type
+  const void* Section(QMeshSectionType type, uint64_t* outCount = nullptr, uint32_t* outStride = nullptr) const;
+};
+
+// Checksum verification reads every page of the file. Outside of debug builds it is skipped by default
+//   once a file has been verified, so only the first open of each file per run pays for it
+// The vertex format, every index and the LOD ranges are always validated
+QuartzResult OpenQMesh(const char* path, QMeshFile* outFile, bool verifyChecksum = QMESH_VERIFY_DEFAULT);
+void CloseQMesh(QMeshFile* file);
+
+} // namespace Quartz
@@ -0,0 +1,348 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/hash.h"
+#include "quartz/core/jobs.h"
+#include "quartz/core/lz4.h"
+#include "quartz/assets/qtex.h"
+
+#include <atomic>
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace Quartz
+{
+
+// Supercompressed levels must save at least 1 / this of their size, otherwise the direct upload is worth more
+static const uint64_t g_minimumSavingFraction = 16;
+
+static uint64_t QTexChecksum(const QTexHeader& header, const uint8_t* fileData, uint64_t fileSize)
+{
+  QTexHeader seedHeader = header;
+  seedHeader.checksum = 0;
+  uint64_t seed = HashBytes(&seedHeader, sizeof(seedHeader));
+  return HashBytes(fileData + sizeof(QTexHeader), fileSize - sizeof(QTexHeader), seed);
+}
+
+static inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static inline uint64_t LevelAlignment(uint64_t storedSize)
+{
+  return (storedSize >= QTEX_LEVEL_ALIGNMENT) ? QTEX_LEVEL_ALIGNMENT : QTEX_TAIL_ALIGNMENT;
+}
+
+static inline uint32_t ChunkCount(uint64_t size)
+{
+  return (uint32_t)((size + QTEX_CHUNK_SIZE - 1) / QTEX_CHUNK_SIZE);
+}
+
+// Write
+// ============================================================
+
+// Chunk size table followed by the chunks, returns false if it would not save enough to be worth decompressing
+static bool CompressLevel(const uint8_t* pixels, uint64_t size, std::vector<uint8_t>* out)
+{
+  const uint32_t chunkCount = ChunkCount(size);
+  std::vector<std::vector<uint8_t>> chunks(chunkCount);
+
+  ParallelFor(chunkCount, [&](uint32_t index)
+  {
+    const uint64_t begin = (uint64_t)index * QTEX_CHUNK_SIZE;
+    const uint64_t chunkSize = PeriMin(size - begin, (uint64_t)QTEX_CHUNK_SIZE);
+    std::vector<uint8_t>& chunk = chunks[index];
+
+    chunk.resize(Lz4CompressBound(chunkSize));
+    uint64_t compressedSize = Lz4Compress(pixels + begin, chunkSize, chunk.data(), chunk.size());
+    if (compressedSize == 0 || compressedSize >= chunkSize)
+    {
+      chunk.assign(pixels + begin, pixels + begin + chunkSize);
+    }
+    else
+    {
+      chunk.resize(compressedSize);
+    }
+  });
+
+  uint64_t storedSize = (uint64_t)chunkCount * sizeof(uint32_t);
+  for (const std::vector<uint8_t>& chunk : chunks)
+  {
+    storedSize += chunk.size();
+  }
+
+  if (storedSize > size - size / g_minimumSavingFraction)
+  {
+    return false;
+  }
+
+  out->resize(storedSize);
+  uint32_t* chunkSizes = (uint32_t*)out->data();
+  uint8_t* chunkData = out->data() + (uint64_t)chunkCount * sizeof(uint32_t);
+  for (uint32_t i = 0; i < chunkCount; i++)
+  {
+    chunkSizes[i] = (uint32_t)chunks[i].size();
+    memcpy(chunkData, chunks[i].data(), chunks[i].size());
+    chunkData += chunks[i].size();
+  }
+  return true;
+}
+
+QuartzResult WriteQTex(const char* path, const QTexWriteInfo& info)
+{
+  if (info.levelCount == 0 || info.levelCount > QTEX_MAX_LEVELS || info.levelCount > FullMipCount(info.extents))
+  {
+    QTZ_ERROR("Cooked textures hold 1 to {} mip levels, {} requested for \"{}\"", QTEX_MAX_LEVELS, info.levelCount, path);
+    return Quartz_Failure;
+  }
+
+  QTexHeader header = {};
+  header.magic = QTEX_MAGIC;
+  header.version = QTEX_VERSION;
+  header.endianness = QTEX_ENDIANNESS;
+  header.format = (uint32_t)info.format;
+  header.usage = info.usage;
+  header.filtering = info.filtering;
+  header.sampleMode = info.sampleMode;
+  header.levelCount = info.levelCount;
+
+  // Levels ==============================
+
+  std::vector<std::vector<uint8_t>> compressedLevels(info.levelCount);
+  const uint8_t* levelPixels = (const uint8_t*)info.pixels;
+  uint64_t offset = AlignUp(sizeof(QTexHeader), QTEX_LEVEL_ALIGNMENT);
+
+  for (uint32_t i = 0; i < info.levelCount; i++)
+  {
+    const Vec2U levelExtents = MipExtents(info.extents, i);
+    QTexLevel& level = header.levels[i];
+    level.width = levelExtents.width;
+    level.height = levelExtents.height;
+    level.size = TextureLevelSize(info.format, levelExtents);
+    level.storedSize = level.size;
+    level.compression = QTex_Compression_None;
+
+    if (info.compression == QTex_Compression_Lz4 && CompressLevel(levelPixels, level.size, &compressedLevels[i]))
+    {
+      level.storedSize = compressedLevels[i].size();
+      level.compression = QTex_Compression_Lz4;
+    }
+
+    level.offset = AlignUp(offset, LevelAlignment(level.storedSize));
+    offset = level.offset + level.storedSize;
+    levelPixels += level.size;
+  }
+  header.fileSize = AlignUp(offset, QTEX_TAIL_ALIGNMENT);
+
+  // Assemble ==============================
+
+  std::vector<uint8_t> fileData(header.fileSize, 0);
+  levelPixels = (const uint8_t*)info.pixels;
+  for (uint32_t i = 0; i < info.levelCount; i++)
+  {
+    const QTexLevel& level = header.levels[i];
+    const uint8_t* stored = (level.compression == QTex_Compression_None) ? levelPixels : compressedLevels[i].data();
+    memcpy(fileData.data() + level.offset, stored, level.storedSize);
+    levelPixels += level.size;
+  }
+
+  header.checksum = QTexChecksum(header, fileData.data(), fileData.size());
+  memcpy(fileData.data(), &header, sizeof(header));
+
+  const std::string partialPath = std::string(path) + ".partial";
+  FILE* outFile;
+  int err = fopen_s(&outFile, partialPath.c_str(), "wb");
+  if (err)
+  {
+    QTZ_ERROR("Failed to open \"{}\" for writing", partialPath);
+    return Quartz_Failure;
+  }
+
+  uint64_t written = fwrite(fileData.data(), 1, fileData.size(), outFile);
+  const bool closed = fclose(outFile) == 0;
+
+  std::error_code error;
+  if (written != fileData.size() || !closed)
+  {
+    QTZ_ERROR("Failed to write cooked texture \"{}\" ({} of {} bytes)", path, written, fileData.size());
+    std::filesystem::remove(partialPath, error);
+    return Quartz_Failure;
+  }
+
+  std::filesystem::rename(partialPath, path, error);
+  if (error)
+  {
+    QTZ_ERROR("Failed to move \"{}\" into place : {}", partialPath, error.message());
+    std::filesystem::remove(partialPath, error);
+    return Quartz_Failure;
+  }
+
+  return Quartz_Success;
+}
+
+// Read
+// ============================================================
+
+static QuartzResult ValidateQTex(const char* path, const MappedFile& file, bool verifyChecksum)
+{
+  if (file.size < sizeof(QTexHeader))
+  {
+    QTZ_ERROR("\"{}\" is too small to be a cooked texture ({} bytes)", path, file.size);
+    return Quartz_Failure;
+  }
+
+  const QTexHeader* header = (const QTexHeader*)file.data;
+  if (header->magic != QTEX_MAGIC)
+  {
+    QTZ_ERROR("\"{}\" is not a cooked texture", path);
+    return Quartz_Failure;
+  }
+
+  if (header->endianness != QTEX_ENDIANNESS)
+  {
+    QTZ_ERROR("Cooked texture \"{}\" was written with a different endianness", path);
+    return Quartz_Failure;
+  }
+
+  if (header->version != QTEX_VERSION)
+  {
+    QTZ_ERROR("Cooked texture \"{}\" has version {}, expected {}. Re-cook the source asset", path, header->version, QTEX_VERSION);
+    return Quartz_Failure;
+  }
+
+  const TextureFormat format = (TextureFormat)header->format;
+  const Vec2U extents = { header->levels[0].width, header->levels[0].height };
+  if (header->fileSize != file.size
+    || header->levelCount == 0
+    || header->levelCount > QTEX_MAX_LEVELS
+    || TextureFormatElementSize(format) == 0
+    || extents.width == 0
+    || extents.height == 0
+    || header->levelCount > FullMipCount(extents))
+  {
+    QTZ_ERROR("Cooked texture \"{}\" is truncated or corrupt", path);
+    return Quartz_Failure;
+  }
+
+  for (uint32_t i = 0; i < header->levelCount; i++)
+  {
+    const QTexLevel& level = header->levels[i];
+    const Vec2U levelExtents = MipExtents(extents, i);
+
+    bool storageValid = false;
+    switch (level.compression)
+    {
+    case QTex_Compression_None: storageValid = level.storedSize == level.size; break;
+    case QTex_Compression_Lz4: storageValid = level.storedSize >= (uint64_t)ChunkCount(level.size) * sizeof(uint32_t); break;
+    default: break;
+    }
+
+    if (!storageValid
+      || level.offset % LevelAlignment(level.storedSize) != 0
+      || level.offset > file.size
+      || level.storedSize > file.size - level.offset
+      || level.width != levelExtents.width
+      || level.height != levelExtents.height
+      || level.size != TextureLevelSize(format, levelExtents))
+    {
+      QTZ_ERROR("Cooked texture \"{}\" has an invalid mip level ({})", path, i);
+      return Quartz_Failure;
+    }
+  }
+
+  if (verifyChecksum && QTexChecksum(*header, (const uint8_t*)file.data, file.size) != header->checksum)
+  {
+    QTZ_ERROR("Cooked texture \"{}\" failed its checksum", path);
+    return Quartz_Failure;
+  }
+
+  return Quartz_Success;
+}
+
+QuartzResult OpenQTex(const char* path, QTexFile* outFile, bool verifyChecksum)
+{
+  QTZ_ATTEMPT(PlatformMapFile(path, &outFile->file));
+  QTZ_ATTEMPT(ValidateQTex(path, outFile->file, verifyChecksum), PlatformUnmapFile(&outFile->file));
+
+  outFile->header = (const QTexHeader*)outFile->file.data;
+  return Quartz_Success;
+}
+
+void CloseQTex(QTexFile* file)
+{
+  PlatformUnmapFile(&file->file);
+  file->header = nullptr;
+}
+
+QuartzResult DecompressQTexLevel(const QTexFile& file, uint32_t level, void* out, bool parallel)
+{
+  const QTexLevel& info = file.header->levels[level];
+  if (info.compression == QTex_Compression_None)
+  {
+    memcpy(out, file.Level(level), info.size);
+    return Quartz_Success;
+  }
+
+  // Chunk offsets from the size table, the table itself was bounds checked when the file was opened
+  const uint32_t chunkCount = ChunkCount(info.size);
+  const uint64_t tableSize = (uint64_t)chunkCount * sizeof(uint32_t);
+  const uint8_t* stored = (const uint8_t*)file.Level(level);
+  std::vector<uint32_t> chunkSizes(chunkCount);
+  memcpy(chunkSizes.data(), stored, tableSize);
+
+  std::vector<uint64_t> chunkOffsets(chunkCount);
+  uint64_t offset = tableSize;
+  for (uint32_t i = 0; i < chunkCount; i++)
+  {
+    chunkOffsets[i] = offset;
+    offset += chunkSizes[i];
+  }
+
+  if (offset != info.storedSize)
+  {
+    QTZ_ERROR("Cooked texture mip level {} has an invalid chunk table", level);
+    return Quartz_Failure;
+  }
+
+  std::atomic<bool> failed = false;
+  auto DecompressChunk = [&](uint32_t index)
+  {
+    const uint64_t begin = (uint64_t)index * QTEX_CHUNK_SIZE;
+    const uint64_t chunkSize = PeriMin(info.size - begin, (uint64_t)QTEX_CHUNK_SIZE);
+    uint8_t* chunkOut = (uint8_t*)out + begin;
+
+    if (chunkSizes[index] == chunkSize)
+    {
+      memcpy(chunkOut, stored + chunkOffsets[index], chunkSize);
+    }
+    else if (Lz4Decompress(stored + chunkOffsets[index], chunkSizes[index], chunkOut, chunkSize) != Quartz_Success)
+    {
+      failed = true;
+    }
+  };
+
+  if (parallel)
+  {
+    ParallelFor(chunkCount, DecompressChunk);
+  }
+  else
+  {
+    for (uint32_t i = 0; i < chunkCount; i++)
+    {
+      DecompressChunk(i);
+    }
+  }
+
+  if (failed)
+  {
+    QTZ_ERROR("Cooked texture mip level {} failed to decompress", level);
+    return Quartz_Failure;
+  }
+
+  return Quartz_Success;
+}
+
+} // namespace Quartz
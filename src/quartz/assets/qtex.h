@@ -0,0 +1,110 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/texture_format.h"
+#include "quartz/platform/filesystem/filesystem.h"
+
+namespace Quartz
+{
+
+// Cooked texture (.qtex)
+// ============================================================
+// [QTexHeader][level 0]...[level n], every level starts on a QTEX_LEVEL_ALIGNMENT boundary
+//   except the mip tail : levels under a page are packed on QTEX_TAIL_ALIGNMENT boundaries
+// All values are little-endian. Levels hold gpu-ready texels (see TextureLevelSize), largest first
+//
+// Uncompressed levels are page-aligned so they upload straight from the mapped file
+// Supercompressed levels are split into QTEX_CHUNK_SIZE chunks compressed on their own :
+//   [uint32_t stored size of each chunk][chunk 0]...[chunk n]
+//   so they decompress in parallel, or a chunk at a time. A chunk as large as its source is stored as is
+
+// Cooked textures are named after their source : "albedo.png" cooks to "albedo.png.qtex"
+#define QTEX_EXTENSION ".qtex"
+#define QTEX_MAGIC 0x58455451 // "QTEX"
+#define QTEX_VERSION 1
+#define QTEX_ENDIANNESS 0x01020304
+#define QTEX_LEVEL_ALIGNMENT 4096
+#define QTEX_TAIL_ALIGNMENT 64
+#define QTEX_MAX_LEVELS 16
+#define QTEX_CHUNK_SIZE (256 * 1024)
+
+#ifdef QTZ_CONFIG_DEBUG
+#define QTEX_VERIFY_DEFAULT true
+#else
+#define QTEX_VERIFY_DEFAULT false
+#endif // QTZ_CONFIG_DEBUG
+
+enum QTexCompression
+{
+  QTex_Compression_None,
+  QTex_Compression_Lz4, // LZ4 blocks (see quartz/core/lz4.h)
+};
+
+struct QTexLevel
+{
+  uint32_t width;
+  uint32_t height;
+  uint64_t offset;     // From the start of the file
+  uint64_t storedSize; // Bytes in the file
+  uint64_t size;       // Bytes once decompressed
+  uint32_t compression; // QTexCompression
+  uint32_t padding;
+};
+
+struct QTexHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t endianness;
+  uint32_t format;     // TextureFormat
+  // Sampling, as the texture enums in quartz/rendering/texture.h
+  uint32_t usage;
+  uint32_t filtering;
+  uint32_t sampleMode;
+  uint32_t levelCount;
+  uint64_t fileSize;
+  // Hash of every byte after the header, seeded with the header itself (checksum zeroed)
+  uint64_t checksum;
+
+  QTexLevel levels[QTEX_MAX_LEVELS];
+};
+static_assert(sizeof(QTexHeader) == 688, "QTexHeader layout is part of the file format");
+
+struct QTexWriteInfo
+{
+  TextureFormat format;
+  uint32_t usage;
+  uint32_t filtering;
+  uint32_t sampleMode;
+  Vec2U extents;
+  uint32_t levelCount;
+  const void* pixels; // Every level back to back, largest first
+  // Levels that barely shrink are stored uncompressed anyway, keeping their direct upload
+  QTexCompression compression = QTex_Compression_None;
+};
+
+// Goes through "<path>.partial" like WriteQMesh, readers and the cooker never see a half written texture
+QuartzResult WriteQTex(const char* path, const QTexWriteInfo& info);
+
+// An open, validated cooked texture, level pointers stay valid until CloseQTex
+struct QTexFile
+{
+  MappedFile file;
+  const QTexHeader* header = nullptr;
+
+  // The level's bytes as stored, only texels if the level is uncompressed
+  inline const void* Level(uint32_t level) const
+  {
+    return (const uint8_t*)file.data + header->levels[level].offset;
+  }
+};
+
+// Checksum verification reads every page of the file, it is skipped by default outside of debug builds
+QuartzResult OpenQTex(const char* path, QTexFile* outFile, bool verifyChecksum = QTEX_VERIFY_DEFAULT);
+void CloseQTex(QTexFile* file);
+
+// Decompresses a supercompressed level into out (the level's size in bytes), chunks are spread across the job workers
+// Background threads that should not compete with the frame's jobs decompress serially instead
+QuartzResult DecompressQTexLevel(const QTexFile& file, uint32_t level, void* out, bool parallel = true);
+
+} // namespace Quartz
@@ -0,0 +1,1116 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/half.h"
+#include "quartz/core/jobs.h"
+#include "quartz/assets/texture_compress.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define QTZ_BC_SSE2
+#endif
+
+namespace Quartz
+{
+
+// Pixels are held channel-major so the per-block loops run over 16 contiguous floats
+typedef float BlockPixels[4][16];
+
+// Weights of the interpolated values shared by BC6H and BC7
+static const uint32_t g_bcWeights2[4] = { 0, 21, 43, 64 };
+static const uint32_t g_bcWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Blocks are written least significant bit first
+struct BlockBitWriter
+{
+  uint8_t* out;
+  uint32_t bit;
+
+  void Write(uint32_t value, uint32_t count)
+  {
+    for (uint32_t i = 0; i < count; i++, bit++)
+    {
+      out[bit >> 3] |= (uint8_t)(((value >> i) & 1) << (bit & 7));
+    }
+  }
+};
+
+static inline float Clamp(float value, float min, float max)
+{
+  return value < min ? min : (value > max ? max : value);
+}
+
+#ifdef QTZ_BC_SSE2
+// A block channel is four registers of four pixels
+static inline float HorizontalSum(__m128 v)
+{
+  __m128 pair = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  return _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+static inline float HorizontalMin(__m128 v)
+{
+  __m128 pair = _mm_min_ps(v, _mm_movehl_ps(v, v));
+  return _mm_cvtss_f32(_mm_min_ss(pair, _mm_shuffle_ps(pair, pair, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+static inline float HorizontalMax(__m128 v)
+{
+  __m128 pair = _mm_max_ps(v, _mm_movehl_ps(v, v));
+  return _mm_cvtss_f32(_mm_max_ss(pair, _mm_shuffle_ps(pair, pair, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+#endif // QTZ_BC_SSE2
+
+// Fitting
+// ============================================================
+
+// Endpoints at the extremes of the block's projection onto its principal axis
+template <uint32_t C>
+static void FitEndpoints(const BlockPixels& block, float outE0[C], float outE1[C])
+{
+  float mean[C] = {};
+  float covariance[C][C] = {};
+#ifdef QTZ_BC_SSE2
+  __m128 centered[C][4];
+  for (uint32_t c = 0; c < C; c++)
+  {
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t g = 0; g < 4; g++)
+    {
+      centered[c][g] = _mm_loadu_ps(block[c] + g * 4);
+      sum = _mm_add_ps(sum, centered[c][g]);
+    }
+    mean[c] = HorizontalSum(sum) / 16.0f;
+
+    const __m128 meanV = _mm_set1_ps(mean[c]);
+    for (uint32_t g = 0; g < 4; g++)
+    {
+      centered[c][g] = _mm_sub_ps(centered[c][g], meanV);
+    }
+  }
+
+  for (uint32_t a = 0; a < C; a++)
+  {
+    for (uint32_t b = a; b < C; b++)
+    {
+      __m128 sum = _mm_setzero_ps();
+      for (uint32_t g = 0; g < 4; g++)
+      {
+        sum = _mm_add_ps(sum, _mm_mul_ps(centered[a][g], centered[b][g]));
+      }
+      covariance[a][b] = HorizontalSum(sum);
+      covariance[b][a] = covariance[a][b];
+    }
+  }
+#else
+  for (uint32_t c = 0; c < C; c++)
+  {
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      mean[c] += block[c][i];
+    }
+    mean[c] /= 16.0f;
+  }
+
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    float d[C];
+    for (uint32_t c = 0; c < C; c++)
+    {
+      d[c] = block[c][i] - mean[c];
+    }
+    for (uint32_t a = 0; a < C; a++)
+    {
+      for (uint32_t b = 0; b < C; b++)
+      {
+        covariance[a][b] += d[a] * d[b];
+      }
+    }
+  }
+#endif // QTZ_BC_SSE2
+
+  // Power iteration, starting from the row of the most varied channel
+  uint32_t startRow = 0;
+  for (uint32_t c = 1; c < C; c++)
+  {
+    startRow = (covariance[c][c] > covariance[startRow][startRow]) ? c : startRow;
+  }
+
+  float axis[C];
+  for (uint32_t c = 0; c < C; c++)
+  {
+    axis[c] = covariance[startRow][c];
+  }
+
+  for (uint32_t iteration = 0; iteration < 8; iteration++)
+  {
+    float next[C] = {};
+    float largest = 0.0f;
+    for (uint32_t a = 0; a < C; a++)
+    {
+      for (uint32_t b = 0; b < C; b++)
+      {
+        next[a] += covariance[a][b] * axis[b];
+      }
+      largest = fmaxf(largest, fabsf(next[a]));
+    }
+
+    if (largest < 1e-12f)
+    {
+      break;
+    }
+    for (uint32_t c = 0; c < C; c++)
+    {
+      axis[c] = next[c] / largest;
+    }
+  }
+
+  float length = 0.0f;
+  for (uint32_t c = 0; c < C; c++)
+  {
+    length += axis[c] * axis[c];
+  }
+
+  if (length < 1e-12f)
+  {
+    // Flat block
+    for (uint32_t c = 0; c < C; c++)
+    {
+      outE0[c] = mean[c];
+      outE1[c] = mean[c];
+    }
+    return;
+  }
+
+  length = sqrtf(length);
+  for (uint32_t c = 0; c < C; c++)
+  {
+    axis[c] /= length;
+  }
+
+#ifdef QTZ_BC_SSE2
+  __m128 minV = _mm_set1_ps(FLT_MAX);
+  __m128 maxV = _mm_set1_ps(-FLT_MAX);
+  for (uint32_t g = 0; g < 4; g++)
+  {
+    __m128 t = _mm_setzero_ps();
+    for (uint32_t c = 0; c < C; c++)
+    {
+      t = _mm_add_ps(t, _mm_mul_ps(centered[c][g], _mm_set1_ps(axis[c])));
+    }
+    minV = _mm_min_ps(minV, t);
+    maxV = _mm_max_ps(maxV, t);
+  }
+  const float minT = HorizontalMin(minV);
+  const float maxT = HorizontalMax(maxV);
+#else
+  float minT = FLT_MAX;
+  float maxT = -FLT_MAX;
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    float t = 0.0f;
+    for (uint32_t c = 0; c < C; c++)
+    {
+      t += (block[c][i] - mean[c]) * axis[c];
+    }
+    minT = fminf(minT, t);
+    maxT = fmaxf(maxT, t);
+  }
+#endif // QTZ_BC_SSE2
+
+  for (uint32_t c = 0; c < C; c++)
+  {
+    outE0[c] = mean[c] + axis[c] * minT;
+    outE1[c] = mean[c] + axis[c] * maxT;
+  }
+}
+
+// Solves for the endpoints that best reproduce the block given each pixel's interpolation weight
+// Returns false if the weights can not determine both endpoints (every pixel on one weight)
+template <uint32_t C>
+static bool RefineEndpoints(const BlockPixels& block, const float weights[16], float outE0[C], float outE1[C])
+{
+  float alpha2 = 0.0f, beta2 = 0.0f, alphaBeta = 0.0f;
+  float alphaX[C] = {};
+  float betaX[C] = {};
+#ifdef QTZ_BC_SSE2
+  const __m128 one = _mm_set1_ps(1.0f);
+  __m128 alpha2V = _mm_setzero_ps(), beta2V = _mm_setzero_ps(), alphaBetaV = _mm_setzero_ps();
+  __m128 alphaXV[C], betaXV[C];
+  for (uint32_t c = 0; c < C; c++)
+  {
+    alphaXV[c] = _mm_setzero_ps();
+    betaXV[c] = _mm_setzero_ps();
+  }
+  for (uint32_t g = 0; g < 4; g++)
+  {
+    __m128 beta = _mm_loadu_ps(weights + g * 4);
+    __m128 alpha = _mm_sub_ps(one, beta);
+    alpha2V = _mm_add_ps(alpha2V, _mm_mul_ps(alpha, alpha));
+    beta2V = _mm_add_ps(beta2V, _mm_mul_ps(beta, beta));
+    alphaBetaV = _mm_add_ps(alphaBetaV, _mm_mul_ps(alpha, beta));
+    for (uint32_t c = 0; c < C; c++)
+    {
+      __m128 x = _mm_loadu_ps(block[c] + g * 4);
+      alphaXV[c] = _mm_add_ps(alphaXV[c], _mm_mul_ps(alpha, x));
+      betaXV[c] = _mm_add_ps(betaXV[c], _mm_mul_ps(beta, x));
+    }
+  }
+  alpha2 = HorizontalSum(alpha2V);
+  beta2 = HorizontalSum(beta2V);
+  alphaBeta = HorizontalSum(alphaBetaV);
+  for (uint32_t c = 0; c < C; c++)
+  {
+    alphaX[c] = HorizontalSum(alphaXV[c]);
+    betaX[c] = HorizontalSum(betaXV[c]);
+  }
+#else
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    float beta = weights[i];
+    float alpha = 1.0f - beta;
+    alpha2 += alpha * alpha;
+    beta2 += beta * beta;
+    alphaBeta += alpha * beta;
+    for (uint32_t c = 0; c < C; c++)
+    {
+      alphaX[c] += alpha * block[c][i];
+      betaX[c] += beta * block[c][i];
+    }
+  }
+#endif // QTZ_BC_SSE2
+
+  float determinant = alpha2 * beta2 - alphaBeta * alphaBeta;
+  if (fabsf(determinant) < 1e-6f)
+  {
+    return false;
+  }
+
+  float inverse = 1.0f / determinant;
+  for (uint32_t c = 0; c < C; c++)
+  {
+    outE0[c] = (alphaX[c] * beta2 - betaX[c] * alphaBeta) * inverse;
+    outE1[c] = (betaX[c] * alpha2 - alphaX[c] * alphaBeta) * inverse;
+  }
+  return true;
+}
+
+// Nearest palette entry of each pixel by exhaustive search, returns the block's squared error
+template <uint32_t C>
+static float NearestIndices(const BlockPixels& block, const float palette[][4], uint32_t paletteSize, uint32_t outIndices[16])
+{
+#ifdef QTZ_BC_SSE2
+  // Four pixels at a time, a pixel takes an entry only if it is strictly closer, as the scalar search does
+  __m128 totalErrorV = _mm_setzero_ps();
+  for (uint32_t g = 0; g < 4; g++)
+  {
+    __m128 x[C];
+    for (uint32_t c = 0; c < C; c++)
+    {
+      x[c] = _mm_loadu_ps(block[c] + g * 4);
+    }
+
+    __m128 bestError = _mm_set1_ps(FLT_MAX);
+    __m128i bestIndex = _mm_setzero_si128();
+    for (uint32_t p = 0; p < paletteSize; p++)
+    {
+      __m128 error = _mm_setzero_ps();
+      for (uint32_t c = 0; c < C; c++)
+      {
+        __m128 d = _mm_sub_ps(x[c], _mm_set1_ps(palette[p][c]));
+        error = _mm_add_ps(error, _mm_mul_ps(d, d));
+      }
+      __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+      bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((int32_t)p)), _mm_andnot_si128(closer, bestIndex));
+      bestError = _mm_min_ps(error, bestError);
+    }
+
+    _mm_storeu_si128((__m128i*)(outIndices + g * 4), bestIndex);
+    totalErrorV = _mm_add_ps(totalErrorV, bestError);
+  }
+  return HorizontalSum(totalErrorV);
+#else
+  float totalError = 0.0f;
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    float bestError = FLT_MAX;
+    for (uint32_t p = 0; p < paletteSize; p++)
+    {
+      float error = 0.0f;
+      for (uint32_t c = 0; c < C; c++)
+      {
+        float d = block[c][i] - palette[p][c];
+        error += d * d;
+      }
+      if (error < bestError)
+      {
+        bestError = error;
+        outIndices[i] = p;
+      }
+    }
+    totalError += bestError;
+  }
+  return totalError;
+#endif // QTZ_BC_SSE2
+}
+
+// The 16 entry palettes of BC6H and BC7 are evenly spread along their segment
+//   each pixel's projection onto it picks a guess, only it and its neighbors are compared
+template <uint32_t C>
+static float NearestIndices16(const BlockPixels& block, const float palette[16][4], uint32_t outIndices[16])
+{
+  float direction[C];
+  float length2 = 0.0f;
+  for (uint32_t c = 0; c < C; c++)
+  {
+    direction[c] = palette[15][c] - palette[0][c];
+    length2 += direction[c] * direction[c];
+  }
+
+  if (length2 < 1e-12f)
+  {
+    return NearestIndices<C>(block, palette, 1, outIndices);
+  }
+
+#ifdef QTZ_BC_SSE2
+  // Candidates are visited in ascending order like the scalar search, so both pick the same entries
+  const __m128 scale = _mm_set1_ps(15.0f / length2);
+  __m128 totalErrorV = _mm_setzero_ps();
+  for (uint32_t g = 0; g < 4; g++)
+  {
+    __m128 x[C];
+    __m128 t = _mm_setzero_ps();
+    for (uint32_t c = 0; c < C; c++)
+    {
+      x[c] = _mm_loadu_ps(block[c] + g * 4);
+      t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(x[c], _mm_set1_ps(palette[0][c])), _mm_set1_ps(direction[c])));
+    }
+    t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(t, scale), _mm_setzero_ps()), _mm_set1_ps(15.0f));
+    const __m128i guess = _mm_cvttps_epi32(_mm_add_ps(t, _mm_set1_ps(0.5f)));
+
+    __m128 bestError = _mm_set1_ps(FLT_MAX);
+    __m128i bestIndex = _mm_setzero_si128();
+    for (int32_t offset = -1; offset <= 1; offset++)
+    {
+      // Lanes hold 0-15 (or -1), so the 16-bit clamp is exact
+      __m128i candidate = _mm_add_epi32(guess, _mm_set1_epi32(offset));
+      candidate = _mm_min_epi16(_mm_max_epi16(candidate, _mm_setzero_si128()), _mm_set1_epi32(15));
+      alignas(16) uint32_t lanes[4];
+      _mm_store_si128((__m128i*)lanes, candidate);
+
+      __m128 error = _mm_setzero_ps();
+      for (uint32_t c = 0; c < C; c++)
+      {
+        __m128 entry = _mm_setr_ps(palette[lanes[0]][c], palette[lanes[1]][c], palette[lanes[2]][c], palette[lanes[3]][c]);
+        __m128 d = _mm_sub_ps(x[c], entry);
+        error = _mm_add_ps(error, _mm_mul_ps(d, d));
+      }
+      __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+      bestIndex = _mm_or_si128(_mm_and_si128(closer, candidate), _mm_andnot_si128(closer, bestIndex));
+      bestError = _mm_min_ps(error, bestError);
+    }
+
+    _mm_storeu_si128((__m128i*)(outIndices + g * 4), bestIndex);
+    totalErrorV = _mm_add_ps(totalErrorV, bestError);
+  }
+  return HorizontalSum(totalErrorV);
+#else
+  float totalError = 0.0f;
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    float t = 0.0f;
+    for (uint32_t c = 0; c < C; c++)
+    {
+      t += (block[c][i] - palette[0][c]) * direction[c];
+    }
+    int32_t guess = (int32_t)(Clamp(t / length2, 0.0f, 1.0f) * 15.0f + 0.5f);
+
+    float bestError = FLT_MAX;
+    for (int32_t p = PeriMax(guess - 1, 0); p <= PeriMin(guess + 1, 15); p++)
+    {
+      float error = 0.0f;
+      for (uint32_t c = 0; c < C; c++)
+      {
+        float d = block[c][i] - palette[p][c];
+        error += d * d;
+      }
+      if (error < bestError)
+      {
+        bestError = error;
+        outIndices[i] = (uint32_t)p;
+      }
+    }
+    totalError += bestError;
+  }
+  return totalError;
+#endif // QTZ_BC_SSE2
+}
+
+// BC1
+// ============================================================
+
+static uint16_t To565(const float color[3])
+{
+  uint32_t r = (uint32_t)(Clamp(color[0], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+  uint32_t g = (uint32_t)(Clamp(color[1], 0.0f, 255.0f) * (63.0f / 255.0f) + 0.5f);
+  uint32_t b = (uint32_t)(Clamp(color[2], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void From565(uint16_t value, float outColor[4])
+{
+  uint32_t r = (value >> 11) & 31;
+  uint32_t g = (value >> 5) & 63;
+  uint32_t b = value & 31;
+  outColor[0] = (float)((r << 3) | (r >> 2));
+  outColor[1] = (float)((g << 2) | (g >> 4));
+  outColor[2] = (float)((b << 3) | (b >> 2));
+  outColor[3] = 0.0f;
+}
+
+// Index order of the four color mode : color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1
+static const float g_bc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+static float Bc1Indices(const BlockPixels& block, uint16_t color0, uint16_t color1, uint32_t outIndices[16])
+{
+  float palette[4][4];
+  From565(color0, palette[0]);
+  From565(color1, palette[1]);
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+    palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+  }
+  return NearestIndices<3>(block, palette, 4, outIndices);
+}
+
+static void EncodeBc1(const BlockPixels& block, uint8_t* out)
+{
+  float e0[3], e1[3];
+  FitEndpoints<3>(block, e0, e1);
+
+  uint16_t color0 = To565(e0);
+  uint16_t color1 = To565(e1);
+  uint32_t indices[16];
+  float error = Bc1Indices(block, color0, color1, indices);
+
+  float weights[16];
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    weights[i] = g_bc1Weights[indices[i]];
+  }
+  if (RefineEndpoints<3>(block, weights, e0, e1))
+  {
+    uint16_t refined0 = To565(e0);
+    uint16_t refined1 = To565(e1);
+    uint32_t refinedIndices[16];
+    float refinedError = Bc1Indices(block, refined0, refined1, refinedIndices);
+    if (refinedError < error)
+    {
+      color0 = refined0;
+      color1 = refined1;
+      memcpy(indices, refinedIndices, sizeof(indices));
+    }
+  }
+
+  // The four color mode requires color0 > color1
+  if (color0 < color1)
+  {
+    uint16_t swap = color0;
+    color0 = color1;
+    color1 = swap;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      indices[i] ^= 1;
+    }
+  }
+  else if (color0 == color1)
+  {
+    memset(indices, 0, sizeof(indices));
+  }
+
+  BlockBitWriter bits = { out, 0 };
+  bits.Write(color0, 16);
+  bits.Write(color1, 16);
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    bits.Write(indices[i], 2);
+  }
+}
+
+// BC4
+// ============================================================
+
+// Index order of the eight value mode : value0, value1, then six steps from value0 to value1
+static float Bc4Weight(uint32_t index)
+{
+  return (index == 0) ? 0.0f : ((index == 1) ? 1.0f : (float)(index - 1) / 7.0f);
+}
+
+static float Bc4Indices(const BlockPixels& block, uint32_t channel, uint32_t value0, uint32_t value1, uint32_t outIndices[16])
+{
+  float palette[8][4];
+  for (uint32_t p = 0; p < 8; p++)
+  {
+    float weight = Bc4Weight(p);
+    palette[p][0] = (1.0f - weight) * (float)value0 + weight * (float)value1;
+  }
+
+  BlockPixels single;
+  memcpy(single[0], block[channel], sizeof(single[0]));
+  return NearestIndices<1>(single, palette, 8, outIndices);
+}
+
+static void EncodeBc4(const BlockPixels& block, uint32_t channel, uint8_t* out)
+{
+  float minValue = FLT_MAX;
+  float maxValue = -FLT_MAX;
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    minValue = fminf(minValue, block[channel][i]);
+    maxValue = fmaxf(maxValue, block[channel][i]);
+  }
+
+  uint32_t value0 = (uint32_t)(Clamp(maxValue, 0.0f, 255.0f) + 0.5f);
+  uint32_t value1 = (uint32_t)(Clamp(minValue, 0.0f, 255.0f) + 0.5f);
+  uint32_t indices[16];
+  float error = Bc4Indices(block, channel, value0, value1, indices);
+
+  BlockPixels single;
+  memcpy(single[0], block[channel], sizeof(single[0]));
+  float weights[16];
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    weights[i] = Bc4Weight(indices[i]);
+  }
+  float e0, e1;
+  if (RefineEndpoints<1>(single, weights, &e0, &e1))
+  {
+    uint32_t refined0 = (uint32_t)(Clamp(e0, 0.0f, 255.0f) + 0.5f);
+    uint32_t refined1 = (uint32_t)(Clamp(e1, 0.0f, 255.0f) + 0.5f);
+    uint32_t refinedIndices[16];
+    float refinedError = Bc4Indices(block, channel, refined0, refined1, refinedIndices);
+    if (refinedError < error)
+    {
+      value0 = refined0;
+      value1 = refined1;
+      memcpy(indices, refinedIndices, sizeof(indices));
+    }
+  }
+
+  // The eight value mode requires value0 > value1
+  if (value0 < value1)
+  {
+    uint32_t swap = value0;
+    value0 = value1;
+    value1 = swap;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      indices[i] = (indices[i] < 2) ? (indices[i] ^ 1) : (9 - indices[i]);
+    }
+  }
+  else if (value0 == value1)
+  {
+    memset(indices, 0, sizeof(indices));
+  }
+
+  BlockBitWriter bits = { out, 0 };
+  bits.Write(value0, 8);
+  bits.Write(value1, 8);
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    bits.Write(indices[i], 3);
+  }
+}
+
+// BC7
+// ============================================================
+
+struct Bc7Mode6Block
+{
+  uint32_t endpoints[2][4]; // 7 bits
+  uint32_t pBits[2];
+  uint32_t indices[16];
+  float error;
+};
+
+// Picks the p-bit (shared low bit of every channel) that best reproduces the endpoint
+static void QuantizeBc7Endpoint(const float endpoint[4], uint32_t outValues[4], uint32_t* outPBit)
+{
+  float bestError = FLT_MAX;
+  for (uint32_t pBit = 0; pBit < 2; pBit++)
+  {
+    uint32_t values[4];
+    float error = 0.0f;
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      float target = Clamp(endpoint[c], 0.0f, 255.0f);
+      values[c] = (uint32_t)Clamp(floorf((target - (float)pBit) * 0.5f + 0.5f), 0.0f, 127.0f);
+      float d = (float)((values[c] << 1) | pBit) - target;
+      error += d * d;
+    }
+
+    if (error < bestError)
+    {
+      bestError = error;
+      memcpy(outValues, values, sizeof(values));
+      *outPBit = pBit;
+    }
+  }
+}
+
+static void EvaluateBc7Mode6(const BlockPixels& block, const float e0[4], const float e1[4], Bc7Mode6Block* outBlock)
+{
+  QuantizeBc7Endpoint(e0, outBlock->endpoints[0], &outBlock->pBits[0]);
+  QuantizeBc7Endpoint(e1, outBlock->endpoints[1], &outBlock->pBits[1]);
+
+  float palette[16][4];
+  for (uint32_t c = 0; c < 4; c++)
+  {
+    uint32_t a = (outBlock->endpoints[0][c] << 1) | outBlock->pBits[0];
+    uint32_t b = (outBlock->endpoints[1][c] << 1) | outBlock->pBits[1];
+    for (uint32_t p = 0; p < 16; p++)
+    {
+      palette[p][c] = (float)(((64 - g_bcWeights4[p]) * a + g_bcWeights4[p] * b + 32) >> 6);
+    }
+  }
+
+  outBlock->error = NearestIndices16<4>(block, palette, outBlock->indices);
+}
+
+// Mode 5 : color and alpha are fit separately, used when alpha does not follow the color
+struct Bc7Mode5Block
+{
+  uint32_t colorEndpoints[2][3]; // 7 bits
+  uint32_t alphaEndpoints[2];    // 8 bits
+  uint32_t colorIndices[16];
+  uint32_t alphaIndices[16];
+  float error;
+};
+
+static float Bc7Mode5Color(const BlockPixels& block, const float e0[3], const float e1[3], Bc7Mode5Block* outBlock)
+{
+  float palette[4][4];
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    outBlock->colorEndpoints[0][c] = (uint32_t)(Clamp(e0[c], 0.0f, 255.0f) * (127.0f / 255.0f) + 0.5f);
+    outBlock->colorEndpoints[1][c] = (uint32_t)(Clamp(e1[c], 0.0f, 255.0f) * (127.0f / 255.0f) + 0.5f);
+    uint32_t a = (outBlock->colorEndpoints[0][c] << 1) | (outBlock->colorEndpoints[0][c] >> 6);
+    uint32_t b = (outBlock->colorEndpoints[1][c] << 1) | (outBlock->colorEndpoints[1][c] >> 6);
+    for (uint32_t p = 0; p < 4; p++)
+    {
+      palette[p][c] = (float)(((64 - g_bcWeights2[p]) * a + g_bcWeights2[p] * b + 32) >> 6);
+    }
+  }
+  return NearestIndices<3>(block, palette, 4, outBlock->colorIndices);
+}
+
+static float Bc7Mode5Alpha(const BlockPixels& block, float e0, float e1, Bc7Mode5Block* outBlock)
+{
+  float palette[4][4];
+  outBlock->alphaEndpoints[0] = (uint32_t)(Clamp(e0, 0.0f, 255.0f) + 0.5f);
+  outBlock->alphaEndpoints[1] = (uint32_t)(Clamp(e1, 0.0f, 255.0f) + 0.5f);
+  for (uint32_t p = 0; p < 4; p++)
+  {
+    palette[p][0] = (float)(((64 - g_bcWeights2[p]) * outBlock->alphaEndpoints[0] + g_bcWeights2[p] * outBlock->alphaEndpoints[1] + 32) >> 6);
+  }
+
+  BlockPixels single;
+  memcpy(single[0], block[3], sizeof(single[0]));
+  return NearestIndices<1>(single, palette, 4, outBlock->alphaIndices);
+}
+
+static void EvaluateBc7Mode5(const BlockPixels& block, Bc7Mode5Block* outBlock)
+{
+  float weights[16];
+
+  float e0[3], e1[3];
+  FitEndpoints<3>(block, e0, e1);
+  float colorError = Bc7Mode5Color(block, e0, e1, outBlock);
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    weights[i] = (float)g_bcWeights2[outBlock->colorIndices[i]] / 64.0f;
+  }
+  if (RefineEndpoints<3>(block, weights, e0, e1))
+  {
+    Bc7Mode5Block refined = *outBlock;
+    float refinedError = Bc7Mode5Color(block, e0, e1, &refined);
+    if (refinedError < colorError)
+    {
+      colorError = refinedError;
+      *outBlock = refined;
+    }
+  }
+
+  float minAlpha = FLT_MAX;
+  float maxAlpha = -FLT_MAX;
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    minAlpha = fminf(minAlpha, block[3][i]);
+    maxAlpha = fmaxf(maxAlpha, block[3][i]);
+  }
+  float alphaError = Bc7Mode5Alpha(block, minAlpha, maxAlpha, outBlock);
+
+  BlockPixels single;
+  memcpy(single[0], block[3], sizeof(single[0]));
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    weights[i] = (float)g_bcWeights2[outBlock->alphaIndices[i]] / 64.0f;
+  }
+  float a0, a1;
+  if (RefineEndpoints<1>(single, weights, &a0, &a1))
+  {
+    Bc7Mode5Block refined = *outBlock;
+    float refinedError = Bc7Mode5Alpha(block, a0, a1, &refined);
+    if (refinedError < alphaError)
+    {
+      alphaError = refinedError;
+      *outBlock = refined;
+    }
+  }
+
+  outBlock->error = colorError + alphaError;
+}
+
+static void WriteBc7Mode5(Bc7Mode5Block* block, uint8_t* out)
+{
+  // The first pixel's indices are stored without their high bits
+  if (block->colorIndices[0] & 2)
+  {
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      uint32_t swap = block->colorEndpoints[0][c];
+      block->colorEndpoints[0][c] = block->colorEndpoints[1][c];
+      block->colorEndpoints[1][c] = swap;
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      block->colorIndices[i] = 3 - block->colorIndices[i];
+    }
+  }
+  if (block->alphaIndices[0] & 2)
+  {
+    uint32_t swap = block->alphaEndpoints[0];
+    block->alphaEndpoints[0] = block->alphaEndpoints[1];
+    block->alphaEndpoints[1] = swap;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      block->alphaIndices[i] = 3 - block->alphaIndices[i];
+    }
+  }
+
+  BlockBitWriter bits = { out, 0 };
+  bits.Write(1 << 5, 6); // Mode 5
+  bits.Write(0, 2);      // No channel rotation
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    bits.Write(block->colorEndpoints[0][c], 7);
+    bits.Write(block->colorEndpoints[1][c], 7);
+  }
+  bits.Write(block->alphaEndpoints[0], 8);
+  bits.Write(block->alphaEndpoints[1], 8);
+  bits.Write(block->colorIndices[0], 1);
+  for (uint32_t i = 1; i < 16; i++)
+  {
+    bits.Write(block->colorIndices[i], 2);
+  }
+  bits.Write(block->alphaIndices[0], 1);
+  for (uint32_t i = 1; i < 16; i++)
+  {
+    bits.Write(block->alphaIndices[i], 2);
+  }
+}
+
+static void EncodeBc7(const BlockPixels& block, uint8_t* out)
+{
+  float e0[4], e1[4];
+  FitEndpoints<4>(block, e0, e1);
+
+  Bc7Mode6Block best;
+  EvaluateBc7Mode6(block, e0, e1, &best);
+
+  float weights[16];
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    weights[i] = (float)g_bcWeights4[best.indices[i]] / 64.0f;
+  }
+  if (RefineEndpoints<4>(block, weights, e0, e1))
+  {
+    Bc7Mode6Block refined;
+    EvaluateBc7Mode6(block, e0, e1, &refined);
+    if (refined.error < best.error)
+    {
+      best = refined;
+    }
+  }
+
+  // Blocks with varying alpha also try fitting it on its own
+  bool alphaVaries = false;
+  for (uint32_t i = 1; i < 16; i++)
+  {
+    alphaVaries = alphaVaries || block[3][i] != block[3][0];
+  }
+  if (alphaVaries)
+  {
+    Bc7Mode5Block separateAlpha;
+    EvaluateBc7Mode5(block, &separateAlpha);
+    if (separateAlpha.error < best.error)
+    {
+      WriteBc7Mode5(&separateAlpha, out);
+      return;
+    }
+  }
+
+  // The first pixel's index is stored without its high bit
+  if (best.indices[0] & 8)
+  {
+    for (uint32_t c = 0; c < 4; c++)
+    {
+      uint32_t swap = best.endpoints[0][c];
+      best.endpoints[0][c] = best.endpoints[1][c];
+      best.endpoints[1][c] = swap;
+    }
+    uint32_t swap = best.pBits[0];
+    best.pBits[0] = best.pBits[1];
+    best.pBits[1] = swap;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      best.indices[i] = 15 - best.indices[i];
+    }
+  }
+
+  BlockBitWriter bits = { out, 0 };
+  bits.Write(1 << 6, 7); // Mode 6
+  for (uint32_t c = 0; c < 4; c++)
+  {
+    bits.Write(best.endpoints[0][c], 7);
+    bits.Write(best.endpoints[1][c], 7);
+  }
+  bits.Write(best.pBits[0], 1);
+  bits.Write(best.pBits[1], 1);
+  bits.Write(best.indices[0], 3);
+  for (uint32_t i = 1; i < 16; i++)
+  {
+    bits.Write(best.indices[i], 4);
+  }
+}
+
+// BC6H
+// ============================================================
+// Blocks are fit in the decoder's unquantized space, half float bits scaled by 64/31
+//   interpolating there is close to interpolating logarithmically
+
+static float ToBc6hSpace(float value)
+{
+  // Also clears NaNs
+  value = (value > 0.0f) ? PeriMin(value, 65504.0f) : 0.0f;
+  return (float)FloatToHalf(value) * (64.0f / 31.0f);
+}
+
+static uint32_t Unquantize10(uint32_t value)
+{
+  if (value == 0)
+  {
+    return 0;
+  }
+  if (value == 1023)
+  {
+    return 0xffff;
+  }
+  return ((value << 16) + 0x8000) >> 10;
+}
+
+static uint32_t Quantize10(float value)
+{
+  value = Clamp(value, 0.0f, 65535.0f);
+  uint32_t guess = (uint32_t)Clamp(floorf((value - 32.0f) / 64.0f + 0.5f), 0.0f, 1023.0f);
+
+  // The ends of the range do not follow the linear mapping
+  uint32_t best = guess;
+  float bestError = fabsf((float)Unquantize10(guess) - value);
+  for (uint32_t candidate = (guess > 0 ? guess - 1 : 0); candidate <= PeriMin(guess + 1, 1023u); candidate++)
+  {
+    float error = fabsf((float)Unquantize10(candidate) - value);
+    if (error < bestError)
+    {
+      bestError = error;
+      best = candidate;
+    }
+  }
+  return best;
+}
+
+struct Bc6hMode11Block
+{
+  uint32_t endpoints[2][3]; // 10 bits
+  uint32_t indices[16];
+  float error;
+};
+
+static void EvaluateBc6hMode11(const BlockPixels& block, const float e0[3], const float e1[3], Bc6hMode11Block* outBlock)
+{
+  float palette[16][4];
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    outBlock->endpoints[0][c] = Quantize10(e0[c]);
+    outBlock->endpoints[1][c] = Quantize10(e1[c]);
+    uint32_t a = Unquantize10(outBlock->endpoints[0][c]);
+    uint32_t b = Unquantize10(outBlock->endpoints[1][c]);
+    for (uint32_t p = 0; p < 16; p++)
+    {
+      palette[p][c] = (float)(((64 - g_bcWeights4[p]) * a + g_bcWeights4[p] * b + 32) >> 6);
+    }
+  }
+
+  outBlock->error = NearestIndices16<3>(block, palette, outBlock->indices);
+}
+
+static void EncodeBc6h(const BlockPixels& block, uint8_t* out)
+{
+  float e0[3], e1[3];
+  FitEndpoints<3>(block, e0, e1);
+
+  Bc6hMode11Block best;
+  EvaluateBc6hMode11(block, e0, e1, &best);
+
+  float weights[16];
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    weights[i] = (float)g_bcWeights4[best.indices[i]] / 64.0f;
+  }
+  if (RefineEndpoints<3>(block, weights, e0, e1))
+  {
+    Bc6hMode11Block refined;
+    EvaluateBc6hMode11(block, e0, e1, &refined);
+    if (refined.error < best.error)
+    {
+      best = refined;
+    }
+  }
+
+  // The first pixel's index is stored without its high bit
+  if (best.indices[0] & 8)
+  {
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      uint32_t swap = best.endpoints[0][c];
+      best.endpoints[0][c] = best.endpoints[1][c];
+      best.endpoints[1][c] = swap;
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+      best.indices[i] = 15 - best.indices[i];
+    }
+  }
+
+  BlockBitWriter bits = { out, 0 };
+  bits.Write(0x03, 5); // Mode 11
+  for (uint32_t e = 0; e < 2; e++)
+  {
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      bits.Write(best.endpoints[e][c], 10);
+    }
+  }
+  bits.Write(best.indices[0], 3);
+  for (uint32_t i = 1; i < 16; i++)
+  {
+    bits.Write(best.indices[i], 4);
+  }
+}
+
+// Compress
+// ============================================================
+
+static void FetchBlock(const void* pixels, Vec2U extents, TextureFormat format, uint32_t blockX, uint32_t blockY, BlockPixels& outBlock)
+{
+  for (uint32_t y = 0; y < 4; y++)
+  {
+    uint32_t pixelY = PeriMin(blockY * 4 + y, extents.height - 1);
+    for (uint32_t x = 0; x < 4; x++)
+    {
+      uint32_t pixelX = PeriMin(blockX * 4 + x, extents.width - 1);
+      uint64_t pixelIndex = (uint64_t)pixelY * extents.width + pixelX;
+
+      if (format == Texture_Format_BC6H)
+      {
+        const float* pixel = (const float*)pixels + pixelIndex * 4;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+          outBlock[c][y * 4 + x] = ToBc6hSpace(pixel[c]);
+        }
+        outBlock[3][y * 4 + x] = 0.0f;
+      }
+      else
+      {
+        const uint8_t* pixel = (const uint8_t*)pixels + pixelIndex * 4;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+          outBlock[c][y * 4 + x] = (float)pixel[c];
+        }
+      }
+    }
+  }
+}
+
+QuartzResult CompressTexture(const void* pixels, Vec2U extents, TextureFormat format, std::vector<uint8_t>* outBlocks)
+{
+  if (!IsBlockCompressed(format))
+  {
+    QTZ_ERROR("Attempting to block compress to an uncompressed format ({})", (uint32_t)format);
+    return Quartz_Failure;
+  }
+
+  if (extents.width == 0 || extents.height == 0)
+  {
+    QTZ_ERROR("Attempting to block compress an empty image");
+    return Quartz_Failure;
+  }
+
+  const uint32_t blocksWide = (extents.width + 3) / 4;
+  const uint32_t blocksHigh = (extents.height + 3) / 4;
+  const uint32_t blockSize = TextureFormatElementSize(format);
+  outBlocks->assign(TextureLevelSize(format, extents), 0);
+  uint8_t* out = outBlocks->data();
+
+  // Roughly 256 blocks per job
+  uint32_t rowsPerBatch = PeriMax(256 / blocksWide, 1u);
+  ParallelForRange(blocksHigh, rowsPerBatch, [&](uint32_t begin, uint32_t end)
+  {
+    BlockPixels block;
+    for (uint32_t blockY = begin; blockY < end; blockY++)
+    {
+      for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+      {
+        uint8_t* blockOut = out + ((uint64_t)blockY * blocksWide + blockX) * blockSize;
+        FetchBlock(pixels, extents, format, blockX, blockY, block);
+
+        switch (format)
+        {
+        case Texture_Format_BC1: EncodeBc1(block, blockOut); break;
+        case Texture_Format_BC3:
+        {
+          EncodeBc4(block, 3, blockOut);
+          EncodeBc1(block, blockOut + 8);
+        } break;
+        case Texture_Format_BC4: EncodeBc4(block, 0, blockOut); break;
+        case Texture_Format_BC5:
+        {
+          EncodeBc4(block, 0, blockOut);
+          EncodeBc4(block, 1, blockOut + 8);
+        } break;
+        case Texture_Format_BC6H: EncodeBc6h(block, blockOut); break;
+        case Texture_Format_BC7: EncodeBc7(block, blockOut); break;
+        default: break;
+        }
+      }
+    }
+  });
+
+  return Quartz_Success;
+}
+
+} // namespace Quartz
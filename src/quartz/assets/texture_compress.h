@@ -0,0 +1,32 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/texture_format.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Block compression
+// ============================================================
+// CPU encoders for the BCn formats, rows of blocks are encoded across the job workers
+// Partial blocks at the right and bottom edges repeat their last row / column of pixels
+//
+// BC1  : Principal axis fit, always the opaque four color mode
+// BC3  : BC1 color with a BC4 alpha block
+// BC4  : Min/max fit, eight value mode
+// BC5  : BC4 red and green
+// BC6H : Mode 11, one region with 10-bit unsigned endpoints
+// BC7  : Mode 6, one subset with 7-bit RGBA endpoints and per-endpoint p-bits
+//        Blocks with varying alpha also try mode 5, which fits alpha separately
+// Every encoder refines its endpoints with one least squares pass over the chosen indices
+// No other BC6H / BC7 modes or partitions are searched, so multi-colored blocks lose more than a full encoder would
+// The endpoint fit, refinement and index search run four pixels at a time with SSE2, scalar otherwise
+
+// pixels :
+//   RGBA8 (4 bytes per pixel) for every format but BC6H
+//   RGBA32 (4 floats per pixel) for BC6H, negative values are clamped to zero
+QuartzResult CompressTexture(const void* pixels, Vec2U extents, TextureFormat format, std::vector<uint8_t>* outBlocks);
+
+} // namespace Quartz
@@ -0,0 +1,378 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/jobs.h"
+#include "quartz/assets/texture_mips.h"
+#include "quartz/rendering/texture_format.h"
+
+#include <atomic>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define QTZ_MIPS_SSE2
+#endif
+
+namespace Quartz
+{
+
+// Roughly this many texels per job in every parallel pass
+static const uint32_t g_texelsPerBatch = 16384;
+// Resampling works on square tiles so the rows a tile's taps read stay in cache between its rows
+static const uint32_t g_tileSize = 64;
+
+static const float g_kaiserRadius = 3.0f; // In destination texels
+static const float g_kaiserAlpha = 4.0f;
+static const float g_pi = 3.14159265358979f;
+
+// Calls fn(x0, x1, y0, y1) for every tile of a width x height texel grid, across the job workers
+template <typename Fn>
+static void ForTiles(uint32_t width, uint32_t height, const Fn& fn)
+{
+  const uint32_t tilesWide = (width + g_tileSize - 1) / g_tileSize;
+  const uint32_t tilesHigh = (height + g_tileSize - 1) / g_tileSize;
+  ParallelFor(tilesWide * tilesHigh, [&](uint32_t tile)
+  {
+    const uint32_t x0 = (tile % tilesWide) * g_tileSize;
+    const uint32_t y0 = (tile / tilesWide) * g_tileSize;
+    fn(x0, PeriMin(x0 + g_tileSize, width), y0, PeriMin(y0 + g_tileSize, height));
+  });
+}
+
+// Filters
+// ============================================================
+
+// Filter weights for resampling one axis, a fixed number of taps for every destination texel
+struct FilterTaps
+{
+  uint32_t width;
+  std::vector<uint32_t> indices; // Source texel of each tap, edge handling already applied
+  std::vector<float> weights;    // Normalized per destination texel
+};
+
+// Modified Bessel function of the first kind, order zero
+static float BesselI0(float x)
+{
+  const float halfX = x * 0.5f;
+  float sum = 1.0f;
+  float term = 1.0f;
+  for (uint32_t k = 1; k < 32 && term > sum * 1e-7f; k++)
+  {
+    const float factor = halfX / (float)k;
+    term *= factor * factor;
+    sum += term;
+  }
+  return sum;
+}
+
+// t : Distance from the destination texel's center, in destination texels
+static float KaiserWeight(float t)
+{
+  if (fabsf(t) >= g_kaiserRadius)
+  {
+    return 0.0f;
+  }
+
+  const float sinc = (t == 0.0f) ? 1.0f : sinf(g_pi * t) / (g_pi * t);
+  const float r = t / g_kaiserRadius;
+  return sinc * BesselI0(g_kaiserAlpha * sqrtf(1.0f - r * r)) / BesselI0(g_kaiserAlpha);
+}
+
+static void BuildTaps(uint32_t sourceSize, uint32_t destSize, const MipGenerateInfo& info, FilterTaps* out)
+{
+  const float scale = (float)sourceSize / (float)destSize;
+  const float radius = ((info.filter == Mip_Filter_Box) ? 0.5f : g_kaiserRadius) * scale; // In source texels
+
+  out->width = (uint32_t)ceilf(2.0f * radius) + 1;
+  out->indices.assign((uint64_t)destSize * out->width, 0);
+  out->weights.assign((uint64_t)destSize * out->width, 0.0f);
+
+  for (uint32_t d = 0; d < destSize; d++)
+  {
+    const float center = ((float)d + 0.5f) * scale;
+    const int32_t first = (int32_t)floorf(center - radius);
+    uint32_t* indices = &out->indices[(uint64_t)d * out->width];
+    float* weights = &out->weights[(uint64_t)d * out->width];
+
+    float total = 0.0f;
+    for (uint32_t t = 0; t < out->width; t++)
+    {
+      const int32_t s = first + (int32_t)t;
+
+      if (info.filter == Mip_Filter_Box)
+      {
+        // Overlap of the source texel with the destination texel's footprint
+        const float overlap = fminf((float)s + 1.0f, center + radius) - fmaxf((float)s, center - radius);
+        weights[t] = fmaxf(overlap, 0.0f);
+      }
+      else
+      {
+        weights[t] = KaiserWeight(((float)s + 0.5f - center) / scale);
+      }
+      total += weights[t];
+
+      if (info.wrap)
+      {
+        indices[t] = (uint32_t)(((s % (int32_t)sourceSize) + (int32_t)sourceSize) % (int32_t)sourceSize);
+      }
+      else
+      {
+        indices[t] = (uint32_t)PeriClamp(s, 0, (int32_t)sourceSize - 1);
+      }
+    }
+
+    if (total != 0.0f)
+    {
+      for (uint32_t t = 0; t < out->width; t++)
+      {
+        weights[t] /= total;
+      }
+    }
+  }
+}
+
+// Levels
+// ============================================================
+
+// scratch : dest width * source height texels, holds the horizontal pass
+// Texels are RGBA, with SSE2 each tap is one multiply-add of a whole texel
+static void ResampleLevel(
+  const float* source,
+  Vec2U sourceExtents,
+  const FilterTaps& horizontal,
+  const FilterTaps& vertical,
+  float* scratch,
+  MipLevel* dest)
+{
+  const uint64_t sourceRowFloats = (uint64_t)sourceExtents.width * 4;
+  const uint64_t destRowFloats = (uint64_t)dest->extents.width * 4;
+
+  ForTiles(dest->extents.width, sourceExtents.height, [&](uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1)
+  {
+    for (uint32_t y = y0; y < y1; y++)
+    {
+      const float* sourceRow = source + y * sourceRowFloats;
+      float* outRow = scratch + y * destRowFloats;
+
+      for (uint32_t x = x0; x < x1; x++)
+      {
+        const uint32_t* indices = &horizontal.indices[(uint64_t)x * horizontal.width];
+        const float* weights = &horizontal.weights[(uint64_t)x * horizontal.width];
+
+#ifdef QTZ_MIPS_SSE2
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t t = 0; t < horizontal.width; t++)
+        {
+          const __m128 texel = _mm_loadu_ps(sourceRow + (uint64_t)indices[t] * 4);
+          sum = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(weights[t])));
+        }
+        _mm_storeu_ps(outRow + x * 4, sum);
+#else
+        float sum[4] = {};
+        for (uint32_t t = 0; t < horizontal.width; t++)
+        {
+          const float* texel = sourceRow + (uint64_t)indices[t] * 4;
+          for (uint32_t c = 0; c < 4; c++)
+          {
+            sum[c] += texel[c] * weights[t];
+          }
+        }
+        for (uint32_t c = 0; c < 4; c++)
+        {
+          outRow[x * 4 + c] = sum[c];
+        }
+#endif // QTZ_MIPS_SSE2
+      }
+    }
+  });
+
+  // Whole tile rows are weighted and accumulated, the inner loop runs over contiguous floats
+  ForTiles(dest->extents.width, dest->extents.height, [&](uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1)
+  {
+    const uint64_t first = (uint64_t)x0 * 4;
+    const uint64_t last = (uint64_t)x1 * 4;
+    for (uint32_t y = y0; y < y1; y++)
+    {
+      const uint32_t* indices = &vertical.indices[(uint64_t)y * vertical.width];
+      const float* weights = &vertical.weights[(uint64_t)y * vertical.width];
+      float* outRow = dest->pixels.data() + y * destRowFloats;
+
+      for (uint64_t i = first; i < last; i++)
+      {
+        outRow[i] = 0.0f;
+      }
+      for (uint32_t t = 0; t < vertical.width; t++)
+      {
+        if (weights[t] == 0.0f)
+        {
+          continue;
+        }
+
+        const float* row = scratch + indices[t] * destRowFloats;
+#ifdef QTZ_MIPS_SSE2
+        // Rows hold whole texels, always a multiple of four floats
+        const __m128 weight = _mm_set1_ps(weights[t]);
+        for (uint64_t i = first; i < last; i += 4)
+        {
+          _mm_storeu_ps(outRow + i, _mm_add_ps(_mm_loadu_ps(outRow + i), _mm_mul_ps(_mm_loadu_ps(row + i), weight)));
+        }
+#else
+        const float weight = weights[t];
+        for (uint64_t i = first; i < last; i++)
+        {
+          outRow[i] += row[i] * weight;
+        }
+#endif // QTZ_MIPS_SSE2
+      }
+    }
+  });
+}
+
+// Removes negative lobe ringing and restores unit normals
+static void FinishLevel(MipLevel* level, const MipGenerateInfo& info)
+{
+  const uint64_t texelCount = (uint64_t)level->extents.width * level->extents.height;
+  float* pixels = level->pixels.data();
+
+  ParallelForRange((uint32_t)texelCount, g_texelsPerBatch, [&](uint32_t begin, uint32_t end)
+  {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      float* texel = pixels + (uint64_t)i * 4;
+      for (uint32_t c = 0; c < 3; c++)
+      {
+        texel[c] = fmaxf(texel[c], 0.0f);
+      }
+      texel[3] = PeriClamp(texel[3], 0.0f, 1.0f);
+
+      if (info.normalMap)
+      {
+        float n[3];
+        float lengthSquared = 0.0f;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+          n[c] = texel[c] * 2.0f - 1.0f;
+          lengthSquared += n[c] * n[c];
+        }
+
+        if (lengthSquared < 1e-12f)
+        {
+          n[0] = 0.0f;
+          n[1] = 0.0f;
+          n[2] = 1.0f;
+          lengthSquared = 1.0f;
+        }
+
+        const float inverseLength = 1.0f / sqrtf(lengthSquared);
+        for (uint32_t c = 0; c < 3; c++)
+        {
+          texel[c] = n[c] * inverseLength * 0.5f + 0.5f;
+        }
+      }
+    }
+  });
+}
+
+// Alpha coverage ==============================
+
+// Counted across the job workers for large levels
+static float AlphaCoverage(const float* pixels, uint64_t texelCount, float reference, float scale)
+{
+  std::atomic<uint64_t> covered = 0;
+  ParallelForRange((uint32_t)texelCount, g_texelsPerBatch, [&](uint32_t begin, uint32_t end)
+  {
+    uint64_t batchCovered = 0;
+    for (uint32_t i = begin; i < end; i++)
+    {
+      batchCovered += (pixels[(uint64_t)i * 4 + 3] * scale >= reference) ? 1 : 0;
+    }
+    covered += batchCovered;
+  });
+  return (float)covered / (float)texelCount;
+}
+
+static void ScaleAlphaToCoverage(MipLevel* level, float reference, float targetCoverage)
+{
+  const uint64_t texelCount = (uint64_t)level->extents.width * level->extents.height;
+  float* pixels = level->pixels.data();
+
+  // Coverage only grows with the scale, bisect for the one that matches
+  float low = 0.0f;
+  float high = 4.0f;
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    const float middle = (low + high) * 0.5f;
+    if (AlphaCoverage(pixels, texelCount, reference, middle) < targetCoverage)
+    {
+      low = middle;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  const float scale = (low + high) * 0.5f;
+  ParallelForRange((uint32_t)texelCount, g_texelsPerBatch, [&](uint32_t begin, uint32_t end)
+  {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      pixels[(uint64_t)i * 4 + 3] = fminf(pixels[(uint64_t)i * 4 + 3] * scale, 1.0f);
+    }
+  });
+}
+
+QuartzResult GenerateMips(const float* pixels, Vec2U extents, const MipGenerateInfo& info, std::vector<MipLevel>* outLevels)
+{
+  if (extents.width == 0 || extents.height == 0)
+  {
+    QTZ_ERROR("Attempting to generate mips for an empty image");
+    return Quartz_Failure;
+  }
+
+  const uint32_t fullCount = FullMipCount(extents);
+  const uint32_t levelCount = (info.levelCount == 0) ? fullCount : PeriMin(info.levelCount, fullCount);
+
+  outLevels->clear();
+  outLevels->resize(levelCount - 1);
+
+  const bool keepCoverage = info.alphaCoverageReference > 0.0f;
+  float coverage = 0.0f;
+  if (keepCoverage)
+  {
+    coverage = AlphaCoverage(pixels, (uint64_t)extents.width * extents.height, info.alphaCoverageReference, 1.0f);
+  }
+
+  FilterTaps horizontal, vertical;
+  std::vector<float> scratch;
+  const float* source = pixels;
+  Vec2U sourceExtents = extents;
+
+  for (uint32_t i = 1; i < levelCount; i++)
+  {
+    MipLevel& level = (*outLevels)[i - 1];
+    level.extents = MipExtents(extents, i);
+    level.pixels.resize((uint64_t)level.extents.width * level.extents.height * 4);
+    scratch.resize((uint64_t)level.extents.width * sourceExtents.height * 4);
+
+    BuildTaps(sourceExtents.width, level.extents.width, info, &horizontal);
+    BuildTaps(sourceExtents.height, level.extents.height, info, &vertical);
+    ResampleLevel(source, sourceExtents, horizontal, vertical, scratch.data(), &level);
+    FinishLevel(&level, info);
+
+    source = level.pixels.data();
+    sourceExtents = level.extents;
+  }
+
+  // Every level is filtered from the unscaled one above it, so the scales do not compound and levels are scaled in parallel
+  if (keepCoverage)
+  {
+    ParallelFor(levelCount - 1, [&](uint32_t i)
+    {
+      ScaleAlphaToCoverage(&(*outLevels)[i], info.alphaCoverageReference, coverage);
+    });
+  }
+
+  return Quartz_Success;
+}
+
+} // namespace Quartz
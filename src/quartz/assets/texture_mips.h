@@ -0,0 +1,48 @@
+#pragma once
+
+#include "quartz/defines.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Mip generation
+// ============================================================
+// Offline mip chains for the cooker, each level is filtered from the one above it
+// Levels are separable two-pass resamples, 64x64 texel tiles of each pass are spread across the job workers
+//   and every tap is a four channel SSE2 multiply-add when the build targets it
+//
+// Pixels are linear RGBA floats throughout, sRGB images are decoded before filtering and encoded after
+// (see Pixel_Convert_Srgb in quartz/core/pixel_convert.h) so averaging happens in linear space
+
+enum MipFilter
+{
+  Mip_Filter_Box,    // Area average, cheapest and softest
+  Mip_Filter_Kaiser, // Kaiser windowed sinc, a radius of three destination texels (six wide). Sharper, may ring slightly
+};
+
+struct MipGenerateInfo
+{
+  MipFilter filter = Mip_Filter_Kaiser;
+  uint32_t levelCount = 0; // Including the source level, 0 for the full chain down to 1x1
+  bool wrap = true;        // Taps past an edge sample the opposite edge (tiling textures), clamped otherwise
+  bool normalMap = false;  // RGB hold n * 0.5 + 0.5, renormalized after filtering every level
+
+  // Above zero, alpha of every level is scaled so the fraction of texels at or above this value
+  // matches the source level. Keeps alpha-tested foliage and fences from thinning out in the distance
+  // Levels are filtered from unscaled alpha and scaled in parallel once the chain is built
+  float alphaCoverageReference = 0.0f;
+};
+
+struct MipLevel
+{
+  Vec2U extents;
+  std::vector<float> pixels; // RGBA
+};
+
+// pixels : The source level, RGBA floats. Not copied into outLevels
+// outLevels : Levels 1 and smaller, largest first
+QuartzResult GenerateMips(const float* pixels, Vec2U extents, const MipGenerateInfo& info, std::vector<MipLevel>* outLevels);
+
+} // namespace Quartz
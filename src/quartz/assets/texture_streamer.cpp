@@ -0,0 +1,377 @@
+
+#include "quartz/defines.h"
+#include "quartz/assets/texture_streamer.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace Quartz
+{
+
+// Lifetime
+// ============================================================
+
+QuartzResult TextureStreamer::Init(const TextureStreamingSettings& settings)
+{
+  if (m_running)
+  {
+    QTZ_WARNING("Texture streaming is already enabled");
+    return Quartz_Success;
+  }
+
+  m_settings = settings;
+  m_running = true;
+  m_thread = std::thread(&TextureStreamer::ThreadMain, this);
+
+  QTZ_DEBUG(
+    "Texture streaming enabled : {} MB budget, {} MB uploaded per frame, initial extent {}",
+    m_settings.vramBudget >> 20, m_settings.uploadBudget >> 20, m_settings.initialExtent);
+  return Quartz_Success;
+}
+
+void TextureStreamer::Shutdown()
+{
+  if (!m_running)
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+    m_reads.clear();
+  }
+  m_wake.notify_all();
+  m_thread.join();
+
+  for (Entry& entry : m_entries)
+  {
+    if (entry.alive)
+    {
+      CloseQTex(&entry.file);
+    }
+  }
+  m_entries.clear();
+  m_freeEntries.clear();
+  m_results.clear();
+  m_residentBytes = 0;
+}
+
+// Textures
+// ============================================================
+
+void TextureStreamer::Register(TextureHandle handle, Texture* texture, const char* cookedPath)
+{
+  if (!m_running || texture->m_residentLevel == 0)
+  {
+    return;
+  }
+
+  Entry entry;
+  if (OpenQTex(cookedPath, &entry.file, false) != Quartz_Success)
+  {
+    QTZ_WARNING("Texture \"{}\" can not be streamed, keeping its small levels", cookedPath);
+    return;
+  }
+
+  if (entry.file.header->levelCount != texture->mipLevels)
+  {
+    QTZ_WARNING("Texture \"{}\" changed on disk since it was loaded, keeping its small levels", cookedPath);
+    CloseQTex(&entry.file);
+    return;
+  }
+
+  entry.handle = handle;
+  entry.alive = true;
+  entry.baseLevel = texture->m_residentLevel;
+  entry.residentLevel = entry.baseLevel;
+  entry.targetLevel = entry.baseLevel;
+  entry.wantedLevel = entry.baseLevel;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint32_t index;
+  if (!m_freeEntries.empty())
+  {
+    index = m_freeEntries.back();
+    m_freeEntries.pop_back();
+    entry.generation = m_entries[index].generation;
+    m_entries[index] = entry;
+  }
+  else
+  {
+    index = (uint32_t)m_entries.size();
+    m_entries.push_back(entry);
+  }
+  texture->m_streamingId = index;
+}
+
+void TextureStreamer::Unregister(Texture* texture)
+{
+  const uint32_t index = texture->m_streamingId;
+  texture->m_streamingId = ~0u;
+  if (index >= m_entries.size() || !m_entries[index].alive)
+  {
+    return;
+  }
+
+  Entry& entry = m_entries[index];
+  m_residentBytes -= StreamedBytes(entry, entry.targetLevel);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_readDone.wait(lock, [&] { return m_readingEntry != index; });
+  CloseQTex(&entry.file);
+  entry.alive = false;
+  entry.generation++;
+  m_freeEntries.push_back(index);
+}
+
+void TextureStreamer::Request(const Texture* texture, float pixelsPerUv, uint64_t frameIndex)
+{
+  if (texture->m_streamingId >= m_entries.size())
+  {
+    return;
+  }
+
+  Entry& entry = m_entries[texture->m_streamingId];
+
+  // The level with about one texel per pixel, meshes without uvs sample a single spot and keep the small levels
+  uint32_t level = entry.baseLevel;
+  if (pixelsPerUv > 0.0f)
+  {
+    const QTexLevel& largest = entry.file.header->levels[0];
+    float texelsPerPixel = (float)PeriMax(largest.width, largest.height) / pixelsPerUv;
+    float idealLevel = floorf(log2f(texelsPerPixel) + m_settings.mipBias);
+    level = (uint32_t)PeriClamp(idealLevel, 0.0f, (float)entry.baseLevel);
+  }
+
+  if (entry.lastUsedFrame != frameIndex)
+  {
+    entry.lastUsedFrame = frameIndex;
+    entry.wantedLevel = level;
+  }
+  else
+  {
+    entry.wantedLevel = PeriMin(entry.wantedLevel, level);
+  }
+}
+
+uint64_t TextureStreamer::StreamedBytes(const Entry& entry, uint32_t level) const
+{
+  uint64_t bytes = 0;
+  for (uint32_t i = level; i < entry.baseLevel; i++)
+  {
+    bytes += entry.file.header->levels[i].size;
+  }
+  return bytes;
+}
+
+// Update
+// ============================================================
+
+void TextureStreamer::QueueRead(uint32_t entryIndex, uint32_t level)
+{
+  Entry& entry = m_entries[entryIndex];
+  m_residentBytes = m_residentBytes - StreamedBytes(entry, entry.targetLevel) + StreamedBytes(entry, level);
+  entry.targetLevel = level;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_reads.push_back({ entryIndex, entry.generation, level });
+  }
+  m_wake.notify_one();
+}
+
+QuartzResult TextureStreamer::Update(AssetPool<Texture>* textures, uint64_t frameIndex, std::vector<const Texture*>* outChanged)
+{
+  if (!m_running)
+  {
+    return Quartz_Success;
+  }
+
+  // Upload ==============================
+  // Reads that do not fit this frame's budget wait for the next one
+
+  std::vector<ReadResult> results;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    results.swap(m_results);
+  }
+
+  std::vector<ReadResult> deferred;
+  uint64_t uploadedBytes = 0;
+  for (ReadResult& result : results)
+  {
+    Entry& entry = m_entries[result.read.entry];
+    if (!entry.alive || entry.generation != result.read.generation)
+    {
+      continue;
+    }
+
+    if (uploadedBytes > 0 && uploadedBytes + result.pixels.size() > m_settings.uploadBudget)
+    {
+      deferred.push_back(std::move(result));
+      continue;
+    }
+
+    const void* levelPixels[QTEX_MAX_LEVELS];
+    const uint8_t* levelData = result.pixels.data();
+    for (uint32_t i = result.read.level; i < entry.file.header->levelCount; i++)
+    {
+      levelPixels[i - result.read.level] = levelData;
+      levelData += entry.file.header->levels[i].size;
+    }
+
+    Texture* texture = textures->Get(entry.handle);
+    if (texture == nullptr
+      || result.result != Quartz_Success
+      || texture->SetResidentLevel(result.read.level, levelPixels) != Quartz_Success)
+    {
+      // Left at its current level, the texture is requested again next frame
+      QTZ_WARNING("Failed to stream level {} of a texture", result.read.level);
+      m_residentBytes = m_residentBytes - StreamedBytes(entry, entry.targetLevel) + StreamedBytes(entry, entry.residentLevel);
+      entry.targetLevel = entry.residentLevel;
+      continue;
+    }
+
+    entry.residentLevel = result.read.level;
+    uploadedBytes += result.pixels.size();
+    outChanged->push_back(texture);
+  }
+
+  if (!deferred.empty())
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_results.insert(m_results.begin(), std::make_move_iterator(deferred.begin()), std::make_move_iterator(deferred.end()));
+  }
+
+  // Requests ==============================
+  // Textures drawn this frame that need larger levels, most blurred first
+  // Textures not drawn for the longest are evicted to make room, then those drawn with levels larger than they need
+
+  std::vector<uint32_t> loads;
+  std::vector<uint32_t> evictable;
+  for (uint32_t i = 0; i < m_entries.size(); i++)
+  {
+    const Entry& entry = m_entries[i];
+    if (!entry.alive || entry.targetLevel != entry.residentLevel)
+    {
+      continue;
+    }
+
+    const bool usedThisFrame = entry.lastUsedFrame == frameIndex;
+    if (usedThisFrame && entry.wantedLevel < entry.residentLevel)
+    {
+      loads.push_back(i);
+    }
+    else if (entry.residentLevel < entry.baseLevel && (!usedThisFrame || entry.wantedLevel > entry.residentLevel))
+    {
+      evictable.push_back(i);
+    }
+  }
+
+  std::sort(loads.begin(), loads.end(), [&](uint32_t a, uint32_t b)
+  {
+    return m_entries[a].residentLevel - m_entries[a].wantedLevel > m_entries[b].residentLevel - m_entries[b].wantedLevel;
+  });
+  std::sort(evictable.begin(), evictable.end(), [&](uint32_t a, uint32_t b)
+  {
+    return m_entries[a].lastUsedFrame < m_entries[b].lastUsedFrame;
+  });
+
+  uint32_t evictCursor = 0;
+  for (uint32_t index : loads)
+  {
+    const Entry& entry = m_entries[index];
+    auto Overflows = [&](uint32_t level)
+    {
+      return m_residentBytes + StreamedBytes(entry, level) - StreamedBytes(entry, entry.residentLevel) > m_settings.vramBudget;
+    };
+
+    while (Overflows(entry.wantedLevel) && evictCursor < evictable.size())
+    {
+      const Entry& victim = m_entries[evictable[evictCursor]];
+      QueueRead(evictable[evictCursor], (victim.lastUsedFrame == frameIndex) ? victim.wantedLevel : victim.baseLevel);
+      evictCursor++;
+    }
+
+    // Settles for the largest level that fits
+    uint32_t level = entry.wantedLevel;
+    while (level < entry.residentLevel && Overflows(level))
+    {
+      level++;
+    }
+
+    if (level < entry.residentLevel)
+    {
+      QueueRead(index, level);
+    }
+  }
+
+  return Quartz_Success;
+}
+
+// Background reads
+// ============================================================
+
+void TextureStreamer::ThreadMain()
+{
+  while (true)
+  {
+    Read read;
+    QTexFile file;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&] { return !m_running || !m_reads.empty(); });
+      if (!m_running)
+      {
+        return;
+      }
+
+      read = m_reads.front();
+      m_reads.pop_front();
+      const Entry& entry = m_entries[read.entry];
+      if (!entry.alive || entry.generation != read.generation)
+      {
+        continue;
+      }
+      file = entry.file;
+      m_readingEntry = read.entry;
+    }
+
+    ReadResult result = ReadLevels(read, file);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_readingEntry = ~0u;
+      m_results.push_back(std::move(result));
+    }
+    m_readDone.notify_all();
+  }
+}
+
+// Every level from the requested one down : the texture's new image is filled whole
+// Uncompressed levels are copied out of the mapping here, so their page faults stay off the main thread
+TextureStreamer::ReadResult TextureStreamer::ReadLevels(const Read& read, const QTexFile& file)
+{
+  ReadResult result;
+  result.read = read;
+  result.result = Quartz_Success;
+
+  uint64_t size = 0;
+  for (uint32_t i = read.level; i < file.header->levelCount; i++)
+  {
+    size += file.header->levels[i].size;
+  }
+  result.pixels.resize(size);
+
+  uint8_t* levelOut = result.pixels.data();
+  for (uint32_t i = read.level; i < file.header->levelCount && result.result == Quartz_Success; i++)
+  {
+    result.result = DecompressQTexLevel(file, i, levelOut, false);
+    levelOut += file.header->levels[i].size;
+  }
+
+  return result;
+}
+
+} // namespace Quartz
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/assets/asset_handle.h"
+#include "quartz/assets/asset_pool.h"
+#include "quartz/assets/qtex.h"
+#include "quartz/rendering/texture.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Quartz
+{
+
+// Texture streaming
+// ============================================================
+// Cooked textures are created with only their small levels, up to initialExtent, which are never evicted
+// Every frame the renderer requests the level each visible texture needs from its on-screen texel density
+// A background thread reads the larger levels, the main thread uploads them within uploadBudget a frame
+// Once the streamed levels exceed vramBudget, textures unused for the longest are evicted back to their small levels
+//
+// Opal has no sparse residency : a residency change creates a new image holding every level from the new
+//   largest one down, and the material descriptor sets that held the old image must be rebuilt
+
+struct TextureStreamingSettings
+{
+  uint64_t vramBudget = 512ull * 1024 * 1024; // Bytes of streamed levels resident at once, small levels are not counted
+  uint64_t uploadBudget = 16ull * 1024 * 1024; // Bytes uploaded a frame, at least one texture is always uploaded
+  uint32_t initialExtent = 128; // Largest level loaded with the texture
+  float mipBias = 0.0f; // Added to every requested level, positive values trade sharpness for memory
+};
+
+class TextureStreamer
+{
+public:
+  QuartzResult Init(const TextureStreamingSettings& settings);
+  // Streamed textures keep the levels they have
+  void Shutdown();
+
+  inline bool IsEnabled() const { return m_running; }
+  inline const TextureStreamingSettings& Settings() const { return m_settings; }
+  inline uint64_t ResidentBytes() const { return m_residentBytes; }
+
+  // Called once a texture created with TextureDecodeData::streamExtent is in its pool
+  // Opens its own mapping of the cooked file, textures whose levels all fit the initial extent are not streamed
+  void Register(TextureHandle handle, Texture* texture, const char* cookedPath);
+  // Before the texture is shut down, waits for the background thread if it is reading the texture's file
+  void Unregister(Texture* texture);
+
+  // Records that texture is drawn this frame where one unit of uv space covers pixelsPerUv pixels
+  void Request(const Texture* texture, float pixelsPerUv, uint64_t frameIndex);
+
+  // Uploads finished reads, evicts and queues new reads. Once per frame, after the frame's requests
+  // Textures given a new image are appended to outChanged, materials using them must rebuild their input sets
+  // The images replaced are retired to the renderer rather than waiting for the gpu to idle
+  QuartzResult Update(AssetPool<Texture>* textures, uint64_t frameIndex, std::vector<const Texture*>* outChanged);
+
+private:
+  struct Entry
+  {
+    TextureHandle handle;
+    QTexFile file;
+    uint32_t generation = 0; // Changes when the entry is reused, reads for an older texture are dropped
+    bool alive = false;
+
+    uint32_t baseLevel = 0;        // Loaded with the texture, never evicted
+    uint32_t residentLevel = 0;
+    uint32_t targetLevel = 0;      // Resident level once the pending read lands
+    uint32_t wantedLevel = 0;      // Finest level requested this frame
+    uint64_t lastUsedFrame = 0;
+  };
+
+  struct Read
+  {
+    uint32_t entry;
+    uint32_t generation;
+    uint32_t level;
+  };
+
+  struct ReadResult
+  {
+    Read read;
+    QuartzResult result;
+    std::vector<uint8_t> pixels; // Levels [level, levelCount) back to back
+  };
+
+  TextureStreamingSettings m_settings;
+  std::vector<Entry> m_entries;
+  std::vector<uint32_t> m_freeEntries;
+  uint64_t m_residentBytes = 0; // Streamed levels of every target level, counted as soon as the read is queued
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_readDone;
+  bool m_running = false;
+  uint32_t m_readingEntry = ~0u;
+  std::deque<Read> m_reads;
+  std::vector<ReadResult> m_results;
+
+  void ThreadMain();
+  ReadResult ReadLevels(const Read& read, const QTexFile& file);
+  // Bytes of the levels above baseLevel, down to and including level
+  uint64_t StreamedBytes(const Entry& entry, uint32_t level) const;
+  void QueueRead(uint32_t entryIndex, uint32_t level);
+};
+
+} // namespace Quartz
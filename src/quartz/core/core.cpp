@@ -18,6 +18,9 @@ V-- Declared in quartz.h --V
   double Time();      // Total real time
   uint32_t WindowWidth();
   uint32_t WindowHeight();
+  AssetManager& Assets();
+  void SetLodBias(float bias);
+  float LodBias();
 ^-- Declared in quartz.h --^
 */
 // Events
@@ -52,6 +55,21 @@ uint32_t WindowHeight()
   return g_coreState.mainWindow.Height();
 }
 
+AssetManager& Assets()
+{
+  return g_coreState.assets;
+}
+
+void SetLodBias(float bias)
+{
+  g_coreState.lod.bias = bias;
+}
+
+float LodBias()
+{
+  return g_coreState.lod.bias;
+}
+
 // Events
 // ============================================================
 
@@ -4,6 +4,7 @@
 
 #include "quartz/core/application.h"
 #include "quartz/core/ecs.h"
+#include "quartz/assets/asset_manager.h"
 #include "quartz/platform/window/window.h"
 #include "quartz/rendering/renderer.h"
 #include "quartz/layers/layer_stack.h"
@@ -31,6 +32,13 @@ struct TimeKeepers
   } clocks;
 };
 
+struct LodSettings
+{
+  float pixelError;
+  float hysteresis;
+  float bias;
+};
+
 struct ComponentIds
 {
   ComponentId transform;
@@ -45,7 +53,9 @@ struct CoreState
 {
   Window mainWindow;
   Renderer renderer;
+  AssetManager assets;
   TimeKeepers time;
+  LodSettings lod;
   LayerStack layerStack;
   Diamond::EcsWorld ecsWorld;
   ComponentIds ecsIds;
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// MSVC never defines __F16C__, its /arch:AVX2 implies F16C. QUARTZ_AVX2 adds -mf16c for other compilers
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define QTZ_HALF_F16C
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define QTZ_HALF_SSE2
+#endif
+
+namespace Quartz
+{
+
+// IEEE 754 binary16 conversion
+// ============================================================
+
+// Rounds to nearest even, overflows to infinity and keeps NaNs
+inline uint16_t FloatToHalf(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t magnitude = bits & 0x7fffffff;
+
+  if (magnitude >= 0x7f800000)
+  {
+    // Inf / NaN
+    return (uint16_t)(sign | 0x7c00 | ((magnitude > 0x7f800000) ? 0x0200 : 0));
+  }
+
+  if (magnitude >= 0x477ff000)
+  {
+    // Rounds above the largest half (65504)
+    return (uint16_t)(sign | 0x7c00);
+  }
+
+  if (magnitude < 0x38800000)
+  {
+    // Subnormal half (or zero) : Align the implicit bit, then round to nearest even
+    if (magnitude < 0x33000000)
+    {
+      return (uint16_t)sign;
+    }
+
+    uint32_t exponent = magnitude >> 23;
+    uint32_t mantissa = (magnitude & 0x007fffff) | 0x00800000;
+    uint32_t shift = 126 - exponent; // 14 + (112 - exponent) + 1
+    uint32_t halfMantissa = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+    {
+      halfMantissa++;
+    }
+    return (uint16_t)(sign | halfMantissa);
+  }
+
+  // Normal : Rebias the exponent, round the dropped 13 mantissa bits to nearest even
+  uint32_t half = ((magnitude - 0x38000000) >> 13);
+  uint32_t dropped = magnitude & 0x1fff;
+  if (dropped > 0x1000 || (dropped == 0x1000 && (half & 1)))
+  {
+    half++;
+  }
+  return (uint16_t)(sign | half);
+}
+
+inline float HalfToFloat(uint16_t half)
+{
+  uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1f;
+  uint32_t mantissa = half & 0x3ff;
+  uint32_t bits;
+
+  if (exponent == 0x1f)
+  {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else if (exponent != 0)
+  {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  else if (mantissa != 0)
+  {
+    // Subnormal : Normalize into a float
+    exponent = 113;
+    while ((mantissa & 0x400) == 0)
+    {
+      mantissa <<= 1;
+      exponent--;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  }
+  else
+  {
+    bits = sign;
+  }
+
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+#ifdef QTZ_HALF_SSE2
+// Four conversions per register without F16C, after Fabian Giesen's float_to_half_rtne / half_to_float
+// Both give exactly the scalar results, halves are held in the low 16 bits of each 32-bit lane
+
+inline __m128i FloatsToHalvesSse2(__m128 value)
+{
+  const __m128 sign = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32((int32_t)0x80000000)));
+  const __m128 magnitude = _mm_xor_ps(value, sign);
+  const __m128i bits = _mm_castps_si128(magnitude);
+
+  // Inf / NaN, and everything that rounds past 65504
+  const __m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32(0x47800000), bits);
+  const __m128i nanBit = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(magnitude, magnitude)), _mm_set1_epi32(0x0200));
+  const __m128i special = _mm_or_si128(nanBit, _mm_set1_epi32(0x7c00));
+
+  // Subnormal : Adding 0.5 aligns the mantissa so the float add rounds to nearest even
+  const __m128i isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32(0x38800000), bits);
+  const __m128i subnormalMagic = _mm_set1_epi32(0x3f000000);
+  const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(magnitude, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+  // Normal : Rebias, then round the dropped 13 bits up past halfway, or at halfway when the kept bits are odd
+  const __m128i odd = _mm_srai_epi32(_mm_slli_epi32(bits, 18), 31);
+  const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, _mm_set1_epi32(0x0fff - 0x38000000)), odd), 13);
+
+  __m128i half = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+  half = _mm_or_si128(_mm_and_si128(isRegular, half), _mm_andnot_si128(isRegular, special));
+  // The sign is smeared through the upper 16 bits so a signed pack keeps it
+  return _mm_or_si128(half, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+inline __m128 HalvesToFloatsSse2(__m128i halves)
+{
+  const __m128i magnitude = _mm_and_si128(halves, _mm_set1_epi32(0x7fff));
+  const __m128i sign = _mm_slli_epi32(_mm_xor_si128(halves, magnitude), 16);
+
+  // Scaling by 2^112 rebiases the exponent, subnormal halves come out normalized
+  const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(magnitude, 13)), _mm_castsi128_ps(_mm_set1_epi32(0x77800000)));
+  const __m128i isSpecial = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7bff));
+  const __m128 specialExponent = _mm_and_ps(_mm_castsi128_ps(isSpecial), _mm_castsi128_ps(_mm_set1_epi32(0x7f800000)));
+  return _mm_or_ps(_mm_or_ps(scaled, specialExponent), _mm_castsi128_ps(sign));
+}
+#endif // QTZ_HALF_SSE2
+
+// Converts count floats, eight at a time with F16C when the build targets it (QUARTZ_AVX2), four at a time with SSE2
+// Rounding matches FloatToHalf. out may alias in, halves are written behind the floats still to be read
+inline void FloatsToHalves(const float* in, uint16_t* out, uint64_t count)
+{
+  uint64_t i = 0;
+#ifdef QTZ_HALF_F16C
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128((__m128i*)(out + i), halves);
+  }
+#endif // QTZ_HALF_F16C
+#ifdef QTZ_HALF_SSE2
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i halves = FloatsToHalvesSse2(_mm_loadu_ps(in + i));
+    _mm_storel_epi64((__m128i*)(out + i), _mm_packs_epi32(halves, halves));
+  }
+#endif // QTZ_HALF_SSE2
+  for (; i < count; i++)
+  {
+    out[i] = FloatToHalf(in[i]);
+  }
+}
+
+// Converts count halves, eight at a time with F16C when the build targets it, four at a time with SSE2
+inline void HalvesToFloats(const uint16_t* in, float* out, uint64_t count)
+{
+  uint64_t i = 0;
+#ifdef QTZ_HALF_F16C
+  for (; i + 8 <= count; i += 8)
+  {
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(in + i))));
+  }
+#endif // QTZ_HALF_F16C
+#ifdef QTZ_HALF_SSE2
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i halves = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(in + i)), _mm_setzero_si128());
+    _mm_storeu_ps(out + i, HalvesToFloatsSse2(halves));
+  }
+#endif // QTZ_HALF_SSE2
+  for (; i < count; i++)
+  {
+    out[i] = HalfToFloat(in[i]);
+  }
+}
+
+} // namespace Quartz
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace Quartz
+{
+
+// Hashing
+// ============================================================
+
+// Finalizer from splitmix64, mixes every input bit into every output bit
+inline uint64_t HashMix64(uint64_t value)
+{
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ull;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebull;
+  value ^= value >> 31;
+  return value;
+}
+
+inline uint64_t HashCombine(uint64_t seed, uint64_t value)
+{
+  return HashMix64(seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)));
+}
+
+// MurmurHash64A, used for content and path hashing
+inline uint64_t HashBytes(const void* data, uint64_t size, uint64_t seed = 0)
+{
+  const uint64_t m = 0xc6a4a7935bd1e995ull;
+  const int r = 47;
+
+  uint64_t h = seed ^ (size * m);
+
+  const uint8_t* bytes = (const uint8_t*)data;
+  const uint8_t* end = bytes + (size & ~7ull);
+
+  for (; bytes != end; bytes += 8)
+  {
+    uint64_t k;
+    memcpy(&k, bytes, sizeof(k));
+
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h ^= k;
+    h *= m;
+  }
+
+  switch (size & 7)
+  {
+  case 7: h ^= uint64_t(bytes[6]) << 48; [[fallthrough]];
+  case 6: h ^= uint64_t(bytes[5]) << 40; [[fallthrough]];
+  case 5: h ^= uint64_t(bytes[4]) << 32; [[fallthrough]];
+  case 4: h ^= uint64_t(bytes[3]) << 24; [[fallthrough]];
+  case 3: h ^= uint64_t(bytes[2]) << 16; [[fallthrough]];
+  case 2: h ^= uint64_t(bytes[1]) << 8;  [[fallthrough]];
+  case 1: h ^= uint64_t(bytes[0]);
+          h *= m;
+  };
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+
+  return h;
+}
+
+inline uint64_t HashString(const char* string, uint64_t seed = 0)
+{
+  return HashBytes(string, strlen(string), seed);
+}
+
+} // namespace Quartz
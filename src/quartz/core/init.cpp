@@ -12,7 +12,6 @@ namespace Quartz
 // ============================================================
 
 CoreState g_coreState;
-uint32_t g_quartzAttemptDepth;
 
 // Quartz entrypoint
 // ============================================================
@@ -30,7 +29,7 @@ void Run(QuartzInitInfo initInfo)
 // Platform
 QuartzResult InitWindow(QuartzInitInfo initInfo);
 // Rendering
-QuartzResult InitRenderer();
+QuartzResult InitRenderer(QuartzInitInfo initInfo);
 // Engine
 QuartzResult InitEcs();
 void InitClocks();
@@ -44,8 +43,25 @@ QuartzResult CoreInit(QuartzInitInfo initInfo)
   Logger::Init();
 
   QTZ_ATTEMPT(InitWindow(initInfo));
-  QTZ_ATTEMPT(InitRenderer());
-  // init resource pools
+  QTZ_ATTEMPT(InitRenderer(initInfo));
+
+  if (initInfo.assets.cookedDirectory != nullptr)
+  {
+    g_coreState.assets.SetCookedDirectory(
+      initInfo.assets.sourceDirectory != nullptr ? initInfo.assets.sourceDirectory : ".",
+      initInfo.assets.cookedDirectory,
+      initInfo.assets.requireCooked);
+  }
+
+  TextureSkybox::SetCacheDirectory(initInfo.assets.iblCacheDirectory);
+
+  if (initInfo.assets.streamTextures)
+  {
+    TextureStreamingSettings streaming;
+    streaming.vramBudget = (uint64_t)initInfo.assets.streamingBudgetMB << 20;
+    streaming.uploadBudget = (uint64_t)initInfo.assets.streamingUploadMB << 20;
+    QTZ_ATTEMPT(g_coreState.assets.EnableTextureStreaming(streaming));
+  }
 
   QTZ_ATTEMPT(InitEcs());
   QTZ_ATTEMPT(InitLayers());
@@ -81,9 +97,14 @@ QuartzResult InitWindow(QuartzInitInfo initInfo)
 // Rendering
 // ============================================================
 
-QuartzResult InitRenderer()
+QuartzResult InitRenderer(QuartzInitInfo initInfo)
 {
-  QTZ_ATTEMPT(g_coreState.renderer.Init(&g_coreState.mainWindow));
+  QTZ_ATTEMPT(g_coreState.renderer.Init(&g_coreState.mainWindow, initInfo.rendering.vertexFormat));
+
+  g_coreState.lod.pixelError = initInfo.rendering.lodPixelError;
+  g_coreState.lod.hysteresis = initInfo.rendering.lodHysteresis;
+  g_coreState.lod.bias = initInfo.rendering.lodBias;
+
   return Quartz_Success;
 }
 
@@ -0,0 +1,234 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/jobs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Quartz
+{
+
+// Types
+// ============================================================
+
+struct JobBatch
+{
+  const std::function<void(uint32_t)>* fn;
+  std::atomic<uint32_t> nextIndex;
+  std::atomic<uint32_t> remaining;
+  std::atomic<uint32_t> users; // Threads other than the owner holding a pointer to this batch
+  uint32_t count;
+};
+
+struct JobState
+{
+  std::vector<std::thread> workers;
+  std::deque<JobBatch*> batches;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool running = false;
+
+  // Workers must be joined before the condition variable is destroyed at exit
+  ~JobState() { JobsShutdown(); }
+};
+
+// Variables
+// ============================================================
+
+static JobState g_jobState;
+static std::once_flag g_jobInitFlag;
+
+// Declarations
+// ============================================================
+
+static void JobsInit();
+static void JobWorkerMain();
+static bool RunBatchIndex(JobBatch* batch);
+
+// Jobs
+// ============================================================
+
+uint32_t JobWorkerCount()
+{
+  std::call_once(g_jobInitFlag, JobsInit);
+  return (uint32_t)g_jobState.workers.size() + 1;
+}
+
+void ParallelFor(uint32_t count, const std::function<void(uint32_t index)>& fn)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  std::call_once(g_jobInitFlag, JobsInit);
+
+  if (count == 1 || g_jobState.workers.empty())
+  {
+    for (uint32_t i = 0; i < count; i++)
+    {
+      fn(i);
+    }
+    return;
+  }
+
+  JobBatch batch;
+  batch.fn = &fn;
+  batch.nextIndex = 0;
+  batch.remaining = count;
+  batch.users = 0;
+  batch.count = count;
+
+  {
+    std::lock_guard<std::mutex> lock(g_jobState.mutex);
+    g_jobState.batches.push_back(&batch);
+  }
+  g_jobState.wake.notify_all();
+
+  // Help with this batch first, then with any others queued (nested calls) until ours finishes
+  while (RunBatchIndex(&batch)) {}
+
+  while (batch.remaining.load(std::memory_order_acquire) > 0)
+  {
+    JobBatch* other = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(g_jobState.mutex);
+      if (!g_jobState.batches.empty())
+      {
+        other = g_jobState.batches.front();
+        other->users++;
+      }
+    }
+
+    bool ranJob = false;
+    if (other != nullptr)
+    {
+      ranJob = RunBatchIndex(other);
+      other->users--;
+    }
+
+    if (!ranJob)
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  // The batch lives on this stack frame, wait until no other thread can reach it
+  {
+    std::lock_guard<std::mutex> lock(g_jobState.mutex);
+    auto iterator = std::find(g_jobState.batches.begin(), g_jobState.batches.end(), &batch);
+    if (iterator != g_jobState.batches.end())
+    {
+      g_jobState.batches.erase(iterator);
+    }
+  }
+
+  while (batch.users.load(std::memory_order_acquire) > 0)
+  {
+    std::this_thread::yield();
+  }
+}
+
+void ParallelForRange(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& fn)
+{
+  if (batchSize == 0)
+  {
+    batchSize = 1;
+  }
+
+  uint32_t rangeCount = (count + batchSize - 1) / batchSize;
+  ParallelFor(rangeCount, [&](uint32_t rangeIndex)
+  {
+    uint32_t begin = rangeIndex * batchSize;
+    uint32_t end = std::min(begin + batchSize, count);
+    fn(begin, end);
+  });
+}
+
+void JobsShutdown()
+{
+  {
+    std::lock_guard<std::mutex> lock(g_jobState.mutex);
+    if (!g_jobState.running)
+    {
+      return;
+    }
+    g_jobState.running = false;
+  }
+  g_jobState.wake.notify_all();
+
+  for (std::thread& worker : g_jobState.workers)
+  {
+    worker.join();
+  }
+  g_jobState.workers.clear();
+}
+
+// Workers
+// ============================================================
+
+static void JobsInit()
+{
+  uint32_t threadCount = std::thread::hardware_concurrency();
+  if (threadCount == 0)
+  {
+    threadCount = 1;
+  }
+
+  g_jobState.running = true;
+  g_jobState.workers.reserve(threadCount - 1);
+  for (uint32_t i = 0; i < threadCount - 1; i++)
+  {
+    g_jobState.workers.emplace_back(JobWorkerMain);
+  }
+}
+
+static void JobWorkerMain()
+{
+  while (true)
+  {
+    JobBatch* batch = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(g_jobState.mutex);
+      g_jobState.wake.wait(lock, [] { return !g_jobState.running || !g_jobState.batches.empty(); });
+
+      if (!g_jobState.running)
+      {
+        return;
+      }
+      batch = g_jobState.batches.front();
+      batch->users++;
+    }
+
+    while (RunBatchIndex(batch)) {}
+    batch->users--;
+  }
+}
+
+// Claims and runs one index of the batch
+// Returns false once every index has been claimed (and removes the batch from the queue)
+static bool RunBatchIndex(JobBatch* batch)
+{
+  uint32_t index = batch->nextIndex.fetch_add(1, std::memory_order_relaxed);
+  if (index >= batch->count)
+  {
+    std::lock_guard<std::mutex> lock(g_jobState.mutex);
+    auto iterator = std::find(g_jobState.batches.begin(), g_jobState.batches.end(), batch);
+    if (iterator != g_jobState.batches.end())
+    {
+      g_jobState.batches.erase(iterator);
+    }
+    return false;
+  }
+
+  (*batch->fn)(index);
+  batch->remaining.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+} // namespace Quartz
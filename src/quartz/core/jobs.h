@@ -0,0 +1,26 @@
+#pragma once
+
+#include "quartz/defines.h"
+
+#include <functional>
+
+namespace Quartz
+{
+
+// Jobs
+// ============================================================
+
+// Worker threads are started on first use
+// The calling thread also executes jobs while it waits, so nested ParallelFor calls are safe
+
+uint32_t JobWorkerCount(); // Includes the calling thread
+
+// Calls fn(index) for every index in [0, count), returns once all have completed
+void ParallelFor(uint32_t count, const std::function<void(uint32_t index)>& fn);
+
+// Calls fn(begin, end) on contiguous ranges of at most batchSize indices
+void ParallelForRange(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& fn);
+
+void JobsShutdown();
+
+} // namespace Quartz
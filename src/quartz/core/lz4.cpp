@@ -0,0 +1,263 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/lz4.h"
+
+#include <string.h>
+
+namespace Quartz
+{
+
+// Block format : a series of sequences, each one run of literals followed by one match
+//   token      : high 4 bits literal length, low 4 bits match length - 4. 15 means more length bytes follow
+//   [length]   : 255 bytes add 255 each, the first byte below 255 ends the length
+//   literals
+//   offset     : 2 bytes little-endian, distance back to the match. Missing in the last sequence
+//   [length]   : match length continuation
+// The last sequence is literals only, and the format requires matches stay clear of the block's tail
+
+static const uint32_t g_hashLog = 12; // Hash table entries, 16KB of positions sits on the stack
+static const uint64_t g_minMatch = 4;
+static const uint64_t g_lastLiterals = 5;   // Every block ends with at least this many literals
+static const uint64_t g_matchFindLimit = 12; // No match starts within this many bytes of the end
+static const uint64_t g_maxOffset = 65535;
+static const uint64_t g_maxInputSize = 0x7e000000;
+
+static inline uint32_t Read32(const uint8_t* bytes)
+{
+  uint32_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+static inline uint32_t HashSequence(uint32_t sequence)
+{
+  return (sequence * 2654435761u) >> (32 - g_hashLog);
+}
+
+// Bytes needed to store a length's continuation, the first 15 live in the token
+static inline uint64_t LengthBytes(uint64_t length)
+{
+  return (length >= 15) ? (length - 15) / 255 + 1 : 0;
+}
+
+static inline uint8_t* WriteLength(uint8_t* out, uint64_t length)
+{
+  for (; length >= 255; length -= 255)
+  {
+    *out++ = 255;
+  }
+  *out++ = (uint8_t)length;
+  return out;
+}
+
+// Compression
+// ============================================================
+
+uint64_t Lz4Compress(const void* in, uint64_t size, void* out, uint64_t capacity)
+{
+  if (size > g_maxInputSize)
+  {
+    return 0;
+  }
+
+  const uint8_t* source = (const uint8_t*)in;
+  const uint8_t* end = source + size;
+  const uint8_t* ip = source;
+  const uint8_t* anchor = source; // Start of the pending literals
+  uint8_t* op = (uint8_t*)out;
+  uint8_t* outEnd = op + capacity;
+
+  if (size > g_matchFindLimit)
+  {
+    const uint8_t* matchFindEnd = end - g_matchFindLimit;
+    const uint8_t* matchEnd = end - g_lastLiterals;
+
+    // Last position each hashed sequence was seen at
+    uint32_t table[1 << g_hashLog];
+    memset(table, 0, sizeof(table));
+
+    // Incompressible runs are skipped faster the longer they go without a match
+    uint32_t misses = 0;
+    while (ip < matchFindEnd)
+    {
+      const uint32_t sequence = Read32(ip);
+      const uint32_t hash = HashSequence(sequence);
+      const uint8_t* ref = source + table[hash];
+      table[hash] = (uint32_t)(ip - source);
+
+      if (ref >= ip || (uint64_t)(ip - ref) > g_maxOffset || Read32(ref) != sequence)
+      {
+        ip += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+
+      // Grow the match backwards into the literals, then forwards
+      while (ip > anchor && ref > source && ip[-1] == ref[-1])
+      {
+        ip--;
+        ref--;
+      }
+
+      const uint8_t* matchIp = ip + g_minMatch;
+      const uint8_t* matchRef = ref + g_minMatch;
+      while (matchIp < matchEnd && *matchIp == *matchRef)
+      {
+        matchIp++;
+        matchRef++;
+      }
+
+      const uint64_t literalLength = (uint64_t)(ip - anchor);
+      const uint64_t matchLength = (uint64_t)(matchIp - ip) - g_minMatch;
+      const uint64_t sequenceSize = 1 + LengthBytes(literalLength) + literalLength + 2 + LengthBytes(matchLength);
+      if (sequenceSize > (uint64_t)(outEnd - op))
+      {
+        return 0;
+      }
+
+      uint8_t* token = op++;
+      *token = (uint8_t)(PeriMin(literalLength, (uint64_t)15) << 4);
+      if (literalLength >= 15)
+      {
+        op = WriteLength(op, literalLength - 15);
+      }
+      memcpy(op, anchor, literalLength);
+      op += literalLength;
+
+      const uint64_t offset = (uint64_t)(ip - ref);
+      op[0] = (uint8_t)offset;
+      op[1] = (uint8_t)(offset >> 8);
+      op += 2;
+
+      *token |= (uint8_t)PeriMin(matchLength, (uint64_t)15);
+      if (matchLength >= 15)
+      {
+        op = WriteLength(op, matchLength - 15);
+      }
+
+      ip = matchIp;
+      anchor = ip;
+
+      // Long matches would otherwise leave the table pointing far behind
+      if (ip < matchFindEnd)
+      {
+        table[HashSequence(Read32(ip - 2))] = (uint32_t)(ip - 2 - source);
+      }
+    }
+  }
+
+  // Last literals ==============================
+
+  const uint64_t literalLength = (uint64_t)(end - anchor);
+  if (1 + LengthBytes(literalLength) + literalLength > (uint64_t)(outEnd - op))
+  {
+    return 0;
+  }
+
+  *op++ = (uint8_t)(PeriMin(literalLength, (uint64_t)15) << 4);
+  if (literalLength >= 15)
+  {
+    op = WriteLength(op, literalLength - 15);
+  }
+  memcpy(op, anchor, literalLength);
+  op += literalLength;
+
+  return (uint64_t)(op - (uint8_t*)out);
+}
+
+// Decompression
+// ============================================================
+
+// Adds a length's continuation bytes, fails if the input runs out first
+static inline bool ReadLength(const uint8_t** ip, const uint8_t* end, uint64_t* length)
+{
+  uint8_t byte;
+  do
+  {
+    if (*ip >= end)
+    {
+      return false;
+    }
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+QuartzResult Lz4Decompress(const void* in, uint64_t size, void* out, uint64_t outSize)
+{
+  const uint8_t* ip = (const uint8_t*)in;
+  const uint8_t* end = ip + size;
+  uint8_t* const outStart = (uint8_t*)out;
+  uint8_t* op = outStart;
+  uint8_t* const outEnd = outStart + outSize;
+
+  while (true)
+  {
+    if (ip >= end)
+    {
+      return Quartz_Failure;
+    }
+    const uint8_t token = *ip++;
+
+    uint64_t literalLength = token >> 4;
+    if (literalLength == 15 && !ReadLength(&ip, end, &literalLength))
+    {
+      return Quartz_Failure;
+    }
+    if (literalLength > (uint64_t)(end - ip) || literalLength > (uint64_t)(outEnd - op))
+    {
+      return Quartz_Failure;
+    }
+    memcpy(op, ip, literalLength);
+    ip += literalLength;
+    op += literalLength;
+
+    // Only the last sequence has no match
+    if (ip == end)
+    {
+      break;
+    }
+
+    if (end - ip < 2)
+    {
+      return Quartz_Failure;
+    }
+    const uint64_t offset = (uint64_t)ip[0] | ((uint64_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (uint64_t)(op - outStart))
+    {
+      return Quartz_Failure;
+    }
+
+    uint64_t matchLength = token & 15;
+    if (matchLength == 15 && !ReadLength(&ip, end, &matchLength))
+    {
+      return Quartz_Failure;
+    }
+    matchLength += g_minMatch;
+    if (matchLength > (uint64_t)(outEnd - op))
+    {
+      return Quartz_Failure;
+    }
+
+    const uint8_t* match = op - offset;
+    if (offset >= matchLength)
+    {
+      memcpy(op, match, matchLength);
+      op += matchLength;
+    }
+    else
+    {
+      // Overlapping matches repeat the bytes just written, copied forwards one at a time
+      for (uint64_t i = 0; i < matchLength; i++)
+      {
+        *op++ = *match++;
+      }
+    }
+  }
+
+  return (op == outEnd) ? Quartz_Success : Quartz_Failure;
+}
+
+} // namespace Quartz
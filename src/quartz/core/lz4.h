@@ -0,0 +1,26 @@
+#pragma once
+
+#include "quartz/defines.h"
+
+namespace Quartz
+{
+
+// LZ4
+// ============================================================
+// Raw LZ4 blocks (no frame or checksum), readable by any LZ4 block decoder and the other way around
+// The compressor is the fast greedy one, decompression runs near memcpy speed and is what the format is chosen for
+
+// Largest possible compressed size of size bytes, the capacity Lz4Compress always succeeds with
+inline uint64_t Lz4CompressBound(uint64_t size)
+{
+  return size + size / 255 + 16;
+}
+
+// Returns the compressed size, 0 if it would not fit in capacity
+uint64_t Lz4Compress(const void* in, uint64_t size, void* out, uint64_t capacity);
+
+// Fails on malformed input or if the block does not decompress to exactly outSize bytes
+// Never reads or writes outside of the given ranges
+QuartzResult Lz4Decompress(const void* in, uint64_t size, void* out, uint64_t outSize);
+
+} // namespace Quartz
@@ -1,5 +1,10 @@
 
 #include "quartz/core/core.h"
+#include "quartz/rendering/culling.h"
+
+#include <algorithm>
+#include <math.h>
+#include <unordered_set>
 
 #include <imgui.h>
 #include <backends/imgui_impl_vulkan.h>
@@ -14,6 +19,8 @@ namespace Quartz
 // ============================================================
 
 ScenePacket g_packet = {};
+// Visible meshlet ranges of every renderable, per camera
+std::vector<MeshDrawCommand> g_cameraDrawCommands[QTZ_CAMERA_MAX_COUNT];
 
 // Declarations
 // ============================================================
@@ -26,7 +33,9 @@ void UpdateTimes();
 QuartzResult UpdateLayers();
 QuartzResult UpdateClient();
 QuartzResult UpdateTransforms();
+QuartzResult UpdateCameraLods();
 QuartzResult UpdateCameraVisibility();
+QuartzResult UpdateTextureStreaming();
 QuartzResult UpdatePacket();
 
 // Rendering
@@ -46,7 +55,10 @@ QuartzResult CoreMainLoop()
     QTZ_ATTEMPT(UpdateLayers());
     QTZ_ATTEMPT(UpdateClient());
     QTZ_ATTEMPT(UpdateTransforms());
+    // Before visibility, which only culls meshlets of renderables drawing their full detail level
+    QTZ_ATTEMPT(UpdateCameraLods());
     QTZ_ATTEMPT(UpdateCameraVisibility());
+    QTZ_ATTEMPT(UpdateTextureStreaming());
     QTZ_ATTEMPT(UpdatePacket());
     QTZ_ATTEMPT(Render());
   }
@@ -124,11 +136,212 @@ QuartzResult UpdateTransforms()
   return Quartz_Success;
 }
 
+// projectionMatrix.y.y is cot(fov / 2) : Pixels covered by one unit at a distance of one unit
+static float PixelsPerUnit(const Camera* camera)
+{
+  return fabsf(camera->projectionMatrix.y.y) * 0.5f * (float)g_coreState.mainWindow.Height();
+}
+
+// Distance from the camera to the nearest point of a renderable's bounds, never closer than the near plane
+static float BoundsDistance(const Mesh* mesh, const Mat4& transform, const Camera* camera)
+{
+  const MeshBounds& bounds = mesh->Bounds();
+  Vec3 offset = camera->pos - TransformPoint(transform, bounds.sphereCenter);
+  return std::max(sqrtf(Dot(offset, offset)) - bounds.sphereRadius * TransformMaxScale(transform), std::max(camera->nearClip, 0.0001f));
+}
+
+// Chooses the LOD for one renderable as seen by one camera
+// Starts from the previous selection and only moves once a level's projected error
+//   is clear of the allowed error by the hysteresis margin, so objects near a threshold do not flicker
+static uint32_t SelectLod(
+  const Mesh* mesh,
+  const Mat4& transform,
+  const Camera* camera,
+  float pixelsPerUnit,
+  float allowedError,
+  uint32_t previousLod)
+{
+  const std::vector<MeshLod>& lods = mesh->Lods();
+  if (lods.size() <= 1)
+  {
+    return 0;
+  }
+
+  // Pixels covered by one object space unit at the nearest point of the bounds
+  float pixelsPerObjectUnit = pixelsPerUnit * TransformMaxScale(transform) / BoundsDistance(mesh, transform, camera);
+  auto ProjectedError = [&](uint32_t lod)
+  {
+    return lods[lod].error * pixelsPerObjectUnit;
+  };
+
+  const float hysteresis = g_coreState.lod.hysteresis;
+  uint32_t lod = std::min(previousLod, (uint32_t)lods.size() - 1);
+  while (lod > 0 && ProjectedError(lod) > allowedError * (1.0f + hysteresis))
+  {
+    lod--;
+  }
+  while (lod + 1 < lods.size() && ProjectedError(lod + 1) < allowedError * (1.0f - hysteresis))
+  {
+    lod++;
+  }
+  return lod;
+}
+
+QuartzResult UpdateCameraLods()
+{
+  // Iterate through all cameras
+  //   Select the LOD of every renderable from its projected simplification error
+
+  // Each step of bias doubles the error allowed on screen
+  const float allowedError = g_coreState.lod.pixelError * exp2f(g_coreState.lod.bias);
+
+  uint32_t cameraIndex = 0;
+  ObjectIterator cameraIter({g_coreState.ecsIds.camera});
+  while (!cameraIter.AtEnd() && cameraIndex < QTZ_CAMERA_MAX_COUNT)
+  {
+    const Camera* c = cameraIter.Get<Camera>();
+    const float pixelsPerUnit = PixelsPerUnit(c);
+
+    ObjectIterator renderableIter({g_coreState.ecsIds.renderable});
+    while (!renderableIter.AtEnd())
+    {
+      Renderable* r = renderableIter.Get<Renderable>();
+      const Mesh* mesh = g_coreState.assets.Get(r->mesh);
+      if (mesh != nullptr)
+      {
+        RenderableView& view = r->views[cameraIndex];
+        view.lod = (uint8_t)SelectLod(mesh, r->transformMatrix, c, pixelsPerUnit, allowedError, view.lod);
+      }
+      renderableIter.NextElement();
+    }
+
+    cameraIter.NextElement();
+    cameraIndex++;
+  }
+
+  return Quartz_Success;
+}
+
 QuartzResult UpdateCameraVisibility()
 {
   // Iterate through all cameras
-  //   Determine objects visible to camera[i]
-  //   Add objects' information for rendering
+  //   Cull renderables by their bounds
+  //   Cull the meshlets of visible renderables drawing their full detail level, by bounds and normal cone
+
+  uint32_t cameraIndex = 0;
+  ObjectIterator cameraIter({g_coreState.ecsIds.camera});
+  while (!cameraIter.AtEnd() && cameraIndex < QTZ_CAMERA_MAX_COUNT)
+  {
+    const Camera* c = cameraIter.Get<Camera>();
+    Frustum frustum = FrustumFromViewProjection(c->viewProjectionMatrix);
+    std::vector<MeshDrawCommand>& commands = g_cameraDrawCommands[cameraIndex];
+    commands.clear();
+
+    ObjectIterator renderableIter({g_coreState.ecsIds.renderable});
+    while (!renderableIter.AtEnd())
+    {
+      Renderable* r = renderableIter.Get<Renderable>();
+      RenderableView& view = r->views[cameraIndex];
+      view.commandOffset = 0;
+      view.commandCount = 0;
+
+      const Mesh* mesh = g_coreState.assets.Get(r->mesh);
+      view.visible = mesh != nullptr && SphereInFrustum(
+        frustum,
+        TransformPoint(r->transformMatrix, mesh->Bounds().sphereCenter),
+        mesh->Bounds().sphereRadius * TransformMaxScale(r->transformMatrix));
+
+      // Meshlets only cover the full detail level
+      if (view.visible && view.lod == 0 && !mesh->Meshlets().empty())
+      {
+        view.commandOffset = (uint32_t)commands.size();
+        view.commandCount = CullMeshlets(mesh->Meshlets(), r->transformMatrix, frustum, c->pos, &commands);
+        view.visible = view.commandCount > 0;
+      }
+
+      renderableIter.NextElement();
+    }
+
+    cameraIter.NextElement();
+    cameraIndex++;
+  }
+
+  return Quartz_Success;
+}
+
+QuartzResult UpdateTextureStreaming()
+{
+  // Iterate through all cameras
+  //   Request the mip level each visible renderable's textures need from their texel density on screen
+  // Update the inputs of materials whose textures were given new images
+
+  if (!g_coreState.assets.Streamer().IsEnabled())
+  {
+    return Quartz_Success;
+  }
+
+  const uint64_t frameIndex = g_coreState.time.frameIndex;
+  uint32_t cameraIndex = 0;
+  ObjectIterator cameraIter({g_coreState.ecsIds.camera});
+  while (!cameraIter.AtEnd() && cameraIndex < QTZ_CAMERA_MAX_COUNT)
+  {
+    const Camera* c = cameraIter.Get<Camera>();
+    const float pixelsPerUnit = PixelsPerUnit(c);
+
+    ObjectIterator renderableIter({g_coreState.ecsIds.renderable});
+    while (!renderableIter.AtEnd())
+    {
+      Renderable* r = renderableIter.Get<Renderable>();
+      const Mesh* mesh = g_coreState.assets.Get(r->mesh);
+      if (r->views[cameraIndex].visible && r->material != nullptr)
+      {
+        // Pixels covered by one unit of uv space at the nearest point of the bounds
+        const float pixelsPerUv = pixelsPerUnit * TransformMaxScale(r->transformMatrix) * mesh->UvDensity()
+          / BoundsDistance(mesh, r->transformMatrix, c);
+
+        for (const MaterialInput& input : r->material->Inputs())
+        {
+          if (input.type == Input_Texture && input.value.texture != nullptr)
+          {
+            g_coreState.assets.RequestTextureLevel(input.value.texture, pixelsPerUv, frameIndex);
+          }
+        }
+      }
+      renderableIter.NextElement();
+    }
+
+    cameraIter.NextElement();
+    cameraIndex++;
+  }
+
+  std::vector<const Texture*> changed;
+  QTZ_ATTEMPT(g_coreState.assets.UpdateTextureStreaming(frameIndex, &changed));
+  if (changed.empty())
+  {
+    return Quartz_Success;
+  }
+
+  // Materials are found through the renderables using them, each is updated once
+  std::unordered_set<const Texture*> changedSet(changed.begin(), changed.end());
+  std::unordered_set<Material*> updated;
+  ObjectIterator renderableIter({g_coreState.ecsIds.renderable});
+  while (!renderableIter.AtEnd())
+  {
+    Material* material = renderableIter.Get<Renderable>()->material;
+    if (material != nullptr && !updated.count(material))
+    {
+      for (const MaterialInput& input : material->Inputs())
+      {
+        if (input.type == Input_Texture && changedSet.count(input.value.texture))
+        {
+          updated.insert(material);
+          QTZ_ATTEMPT(material->RebuildInputSet());
+          break;
+        }
+      }
+    }
+    renderableIter.NextElement();
+  }
 
   return Quartz_Success;
 }
@@ -190,8 +403,9 @@ QuartzResult RenderScene()
 {
   g_coreState.renderer.StartSceneRender();
 
+  // Matches UpdateCameraLods()'s camera order
+  uint32_t cameraIndex = 0;
   ObjectIterator cameraIter({g_coreState.ecsIds.camera});
-  ObjectIterator renderableIter({g_coreState.ecsIds.renderable});
 
   while (!cameraIter.AtEnd())
   {
@@ -201,13 +415,32 @@ QuartzResult RenderScene()
 
     QTZ_ATTEMPT(g_coreState.renderer.PushSceneData(&g_packet));
 
+    ObjectIterator renderableIter({g_coreState.ecsIds.renderable});
     while (!renderableIter.AtEnd())
     {
       Renderable* r = renderableIter.Get<Renderable>();
-      g_coreState.renderer.Render(r);
+      if (cameraIndex >= QTZ_CAMERA_MAX_COUNT)
+      {
+        // Cameras past the limit have no visibility results
+        g_coreState.renderer.Render(r);
+      }
+      else if (r->views[cameraIndex].visible)
+      {
+        const RenderableView& view = r->views[cameraIndex];
+        if (view.commandCount > 0)
+        {
+          const MeshDrawCommand* commands = &g_cameraDrawCommands[cameraIndex][view.commandOffset];
+          g_coreState.renderer.Render(r, commands, view.commandCount);
+        }
+        else
+        {
+          g_coreState.renderer.Render(r, view.lod);
+        }
+      }
       renderableIter.NextElement();
     }
     cameraIter.NextElement();
+    cameraIndex++;
   }
 
   g_coreState.renderer.EndSceneRender();
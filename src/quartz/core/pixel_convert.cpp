@@ -0,0 +1,384 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/half.h"
+#include "quartz/core/jobs.h"
+#include "quartz/core/pixel_convert.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define QTZ_PIXEL_SSE2
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define QTZ_PIXEL_AVX2
+#endif
+
+namespace Quartz
+{
+
+static const uint32_t g_pixelsPerBatch = 16384;
+// Pixels staged as RGBA floats on the stack between reading the input and packing the output
+static const uint32_t g_blockPixels = 256;
+
+// Calls fn(begin, end) over pixel ranges, across the job workers when there is more than one batch
+template <typename Fn>
+static void ForPixelBatches(uint64_t pixelCount, const Fn& fn)
+{
+  if (pixelCount <= g_pixelsPerBatch)
+  {
+    fn(0, pixelCount);
+    return;
+  }
+
+  const uint32_t batchCount = (uint32_t)((pixelCount + g_pixelsPerBatch - 1) / g_pixelsPerBatch);
+  ParallelForRange(batchCount, 1, [&](uint32_t begin, uint32_t end)
+  {
+    for (uint32_t batch = begin; batch < end; batch++)
+    {
+      const uint64_t first = (uint64_t)batch * g_pixelsPerBatch;
+      fn(first, PeriMin(first + g_pixelsPerBatch, pixelCount));
+    }
+  });
+}
+
+// sRGB
+// ============================================================
+
+float SrgbToLinear(float value)
+{
+  return (value <= 0.04045f) ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSrgb(float value)
+{
+  return (value <= 0.0031308f) ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Encoding is indexed by a float's exponent and top six mantissa bits, 1/64th of an octave per entry
+// The curve is interpolated linearly across each entry, values below 2^-13 encode to zero
+static const uint32_t g_srgbEncodeMinBits = 0x39000000; // 2^-13
+static const uint32_t g_srgbEncodeShift = 17;
+static const uint32_t g_srgbEncodeSize = (0x3f800000 - g_srgbEncodeMinBits) >> g_srgbEncodeShift;
+
+struct SrgbTables
+{
+  float encodeBase[g_srgbEncodeSize];  // In bytes, at the start of the entry's range
+  float encodeDelta[g_srgbEncodeSize]; // Across the entry's range
+  float decode[256];
+};
+
+static const SrgbTables& GetSrgbTables()
+{
+  static const SrgbTables tables = []()
+  {
+    SrgbTables t;
+    for (uint32_t i = 0; i < g_srgbEncodeSize; i++)
+    {
+      uint32_t startBits = g_srgbEncodeMinBits + (i << g_srgbEncodeShift);
+      uint32_t endBits = startBits + (1u << g_srgbEncodeShift);
+      float start, end;
+      memcpy(&start, &startBits, sizeof(start));
+      memcpy(&end, &endBits, sizeof(end));
+
+      t.encodeBase[i] = LinearToSrgb(start) * 255.0f;
+      t.encodeDelta[i] = LinearToSrgb(end) * 255.0f - t.encodeBase[i];
+    }
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      t.decode[i] = SrgbToLinear((float)i / 255.0f);
+    }
+    return t;
+  }();
+  return tables;
+}
+
+static inline uint8_t EncodeSrgb8(const SrgbTables& tables, float value)
+{
+  if (!(value > 0.0f))
+  {
+    return 0; // Negative and NaN
+  }
+  if (value >= 1.0f)
+  {
+    return 255;
+  }
+
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  if (bits < g_srgbEncodeMinBits)
+  {
+    return 0;
+  }
+
+  // Within an octave the mantissa bits are linear in the value
+  const uint32_t index = (bits - g_srgbEncodeMinBits) >> g_srgbEncodeShift;
+  const float t = (float)(bits & ((1u << g_srgbEncodeShift) - 1)) * (1.0f / (float)(1u << g_srgbEncodeShift));
+  return (uint8_t)(tables.encodeBase[index] + tables.encodeDelta[index] * t + 0.5f);
+}
+
+static inline uint8_t EncodeUnorm8(float value)
+{
+  value = (value > 0.0f) ? value : 0.0f; // Also clears NaN
+  value = (value < 1.0f) ? value : 1.0f;
+  return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+// Kernels
+// ============================================================
+
+static void Premultiply(float* pixels, uint64_t count)
+{
+  uint64_t i = 0;
+#ifdef QTZ_PIXEL_AVX2
+  for (; i + 2 <= count; i += 2)
+  {
+    __m256 pair = _mm256_loadu_ps(pixels + i * 4);
+    __m256 alpha = _mm256_permute_ps(pair, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm256_storeu_ps(pixels + i * 4, _mm256_blend_ps(_mm256_mul_ps(pair, alpha), pair, 0x88));
+  }
+#endif // QTZ_PIXEL_AVX2
+#ifdef QTZ_PIXEL_SSE2
+  const __m128 colorMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+  for (; i < count; i++)
+  {
+    __m128 pixel = _mm_loadu_ps(pixels + i * 4);
+    __m128 alpha = _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 scaled = _mm_mul_ps(pixel, alpha);
+    _mm_storeu_ps(pixels + i * 4, _mm_or_ps(_mm_and_ps(colorMask, scaled), _mm_andnot_ps(colorMask, pixel)));
+  }
+#endif // QTZ_PIXEL_SSE2
+  for (; i < count; i++)
+  {
+    for (uint32_t c = 0; c < 3; c++)
+    {
+      pixels[i * 4 + c] *= pixels[i * 4 + 3];
+    }
+  }
+}
+
+// Reads count pixels as RGBA floats into out, premultiplied and sRGB encoded as requested
+static void LoadPixels(const float* in, uint32_t inChannels, uint64_t count, PixelConvertFlags flags, bool encodeSrgb, float* out)
+{
+  if (inChannels == 4)
+  {
+    memcpy(out, in, count * 4 * sizeof(float));
+  }
+  else
+  {
+    for (uint64_t i = 0; i < count; i++)
+    {
+      out[i * 4    ] = in[i * 3    ];
+      out[i * 4 + 1] = in[i * 3 + 1];
+      out[i * 4 + 2] = in[i * 3 + 2];
+      out[i * 4 + 3] = 1.0f;
+    }
+  }
+
+  if (flags & Pixel_Convert_Premultiply)
+  {
+    Premultiply(out, count);
+  }
+
+  if (encodeSrgb)
+  {
+    for (uint64_t i = 0; i < count; i++)
+    {
+      for (uint32_t c = 0; c < 3; c++)
+      {
+        out[i * 4 + c] = LinearToSrgb(out[i * 4 + c]);
+      }
+    }
+  }
+}
+
+// RGBA floats to bytes, clamped to [0, 1]
+static void PackUnorm8(const float* in, uint64_t count, uint8_t* out)
+{
+  const uint64_t floatCount = count * 4;
+  uint64_t i = 0;
+
+#ifdef QTZ_PIXEL_AVX2
+  {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    // Packing interleaves the two 128-bit lanes, this puts the 4-byte groups back in order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    auto toInts = [&](const float* values)
+    {
+      __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(values), zero), one);
+      return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, scale), half));
+    };
+
+    for (; i + 32 <= floatCount; i += 32)
+    {
+      __m256i shortsA = _mm256_packs_epi32(toInts(in + i), toInts(in + i + 8));
+      __m256i shortsB = _mm256_packs_epi32(toInts(in + i + 16), toInts(in + i + 24));
+      __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(shortsA, shortsB), order);
+      _mm256_storeu_si256((__m256i*)(out + i), bytes);
+    }
+  }
+#endif // QTZ_PIXEL_AVX2
+
+#ifdef QTZ_PIXEL_SSE2
+  {
+    // max(v, 0) returns 0 for NaN
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    auto toInts = [&](const float* values)
+    {
+      __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(values), zero), one);
+      return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+    };
+
+    for (; i + 16 <= floatCount; i += 16)
+    {
+      __m128i shortsA = _mm_packs_epi32(toInts(in + i), toInts(in + i + 4));
+      __m128i shortsB = _mm_packs_epi32(toInts(in + i + 8), toInts(in + i + 12));
+      _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(shortsA, shortsB));
+    }
+  }
+#endif // QTZ_PIXEL_SSE2
+
+  for (; i < floatCount; i++)
+  {
+    out[i] = EncodeUnorm8(in[i]);
+  }
+}
+
+static void PackSrgb8(const float* in, uint64_t count, uint8_t* out)
+{
+  const SrgbTables& tables = GetSrgbTables();
+  for (uint64_t i = 0; i < count; i++)
+  {
+    out[i * 4    ] = EncodeSrgb8(tables, in[i * 4    ]);
+    out[i * 4 + 1] = EncodeSrgb8(tables, in[i * 4 + 1]);
+    out[i * 4 + 2] = EncodeSrgb8(tables, in[i * 4 + 2]);
+    out[i * 4 + 3] = EncodeUnorm8(in[i * 4 + 3]);
+  }
+}
+
+static void UnpackUnorm8(const uint8_t* in, uint64_t count, float* out)
+{
+  const uint64_t byteCount = count * 4;
+  const float scale = 1.0f / 255.0f;
+  uint64_t i = 0;
+
+#ifdef QTZ_PIXEL_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale4 = _mm_set1_ps(scale);
+  for (; i + 16 <= byteCount; i += 16)
+  {
+    __m128i bytes = _mm_loadu_si128((const __m128i*)(in + i));
+    __m128i low = _mm_unpacklo_epi8(bytes, zero);
+    __m128i high = _mm_unpackhi_epi8(bytes, zero);
+    _mm_storeu_ps(out + i,      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale4));
+    _mm_storeu_ps(out + i + 4,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale4));
+    _mm_storeu_ps(out + i + 8,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale4));
+    _mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale4));
+  }
+#endif // QTZ_PIXEL_SSE2
+
+  for (; i < byteCount; i++)
+  {
+    out[i] = (float)in[i] * scale;
+  }
+}
+
+// Conversions
+// ============================================================
+
+void ConvertToUnorm8(const float* in, uint32_t inChannels, uint64_t pixelCount, PixelConvertFlags flags, uint8_t* out)
+{
+  const bool direct = inChannels == 4 && (flags & Pixel_Convert_Premultiply) == 0;
+  auto pack = (flags & Pixel_Convert_Srgb) ? PackSrgb8 : PackUnorm8;
+
+  ForPixelBatches(pixelCount, [&](uint64_t begin, uint64_t end)
+  {
+    if (direct)
+    {
+      pack(in + begin * 4, end - begin, out + begin * 4);
+      return;
+    }
+
+    float block[g_blockPixels * 4];
+    for (uint64_t i = begin; i < end; i += g_blockPixels)
+    {
+      const uint64_t count = PeriMin<uint64_t>(g_blockPixels, end - i);
+      LoadPixels(in + i * inChannels, inChannels, count, flags, false, block);
+      pack(block, count, out + i * 4);
+    }
+  });
+}
+
+void ConvertToHalf(const float* in, uint32_t inChannels, uint64_t pixelCount, PixelConvertFlags flags, uint16_t* out)
+{
+  const bool direct = inChannels == 4 && flags == Pixel_Convert_None;
+  const bool encodeSrgb = (flags & Pixel_Convert_Srgb) != 0;
+
+  ForPixelBatches(pixelCount, [&](uint64_t begin, uint64_t end)
+  {
+    if (direct)
+    {
+      FloatsToHalves(in + begin * 4, out + begin * 4, (end - begin) * 4);
+      return;
+    }
+
+    float block[g_blockPixels * 4];
+    for (uint64_t i = begin; i < end; i += g_blockPixels)
+    {
+      const uint64_t count = PeriMin<uint64_t>(g_blockPixels, end - i);
+      LoadPixels(in + i * inChannels, inChannels, count, flags, encodeSrgb, block);
+      FloatsToHalves(block, out + i * 4, count * 4);
+    }
+  });
+}
+
+void ConvertToFloat(const float* in, uint32_t inChannels, uint64_t pixelCount, PixelConvertFlags flags, float* out)
+{
+  const bool encodeSrgb = (flags & Pixel_Convert_Srgb) != 0;
+
+  ForPixelBatches(pixelCount, [&](uint64_t begin, uint64_t end)
+  {
+    LoadPixels(in + begin * inChannels, inChannels, end - begin, flags, encodeSrgb, out + begin * 4);
+  });
+}
+
+void ConvertFromUnorm8(const uint8_t* in, uint64_t pixelCount, PixelConvertFlags flags, float* out)
+{
+  const SrgbTables& tables = GetSrgbTables();
+
+  ForPixelBatches(pixelCount, [&](uint64_t begin, uint64_t end)
+  {
+    if (flags & Pixel_Convert_Srgb)
+    {
+      for (uint64_t i = begin * 4; i < end * 4; i += 4)
+      {
+        out[i    ] = tables.decode[in[i    ]];
+        out[i + 1] = tables.decode[in[i + 1]];
+        out[i + 2] = tables.decode[in[i + 2]];
+        out[i + 3] = (float)in[i + 3] * (1.0f / 255.0f);
+      }
+    }
+    else
+    {
+      UnpackUnorm8(in + begin * 4, end - begin, out + begin * 4);
+    }
+
+    if (flags & Pixel_Convert_Premultiply)
+    {
+      Premultiply(out + begin * 4, end - begin);
+    }
+  });
+}
+
+} // namespace Quartz
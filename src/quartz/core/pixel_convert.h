@@ -0,0 +1,36 @@
+#pragma once
+
+#include "quartz/defines.h"
+
+namespace Quartz
+{
+
+// Pixel conversion
+// ============================================================
+// Converts whole images into the layout a texture uploads, writing straight into the destination
+// Large images are split across the job workers, the kernels use SSE2, or AVX2 / F16C when built with QUARTZ_AVX2
+//
+// Float inputs hold 3 (RGB) or 4 (RGBA) channels per pixel, a missing alpha is filled with 1
+// Outputs are always RGBA and must not overlap their input
+
+enum PixelConvertFlagBits
+{
+  Pixel_Convert_None        = 0,
+  Pixel_Convert_Srgb        = 0x01, // Color is sRGB encoded when stored and decoded when read, alpha stays linear
+  Pixel_Convert_Premultiply = 0x02, // Color is multiplied by alpha, in linear space
+};
+typedef uint32_t PixelConvertFlags;
+
+// RGBA8, clamped to [0, 1] and rounded to nearest
+void ConvertToUnorm8(const float* in, uint32_t inChannels, uint64_t pixelCount, PixelConvertFlags flags, uint8_t* out);
+// RGBA16F
+void ConvertToHalf(const float* in, uint32_t inChannels, uint64_t pixelCount, PixelConvertFlags flags, uint16_t* out);
+// RGBA32
+void ConvertToFloat(const float* in, uint32_t inChannels, uint64_t pixelCount, PixelConvertFlags flags, float* out);
+// RGBA8 in, RGBA32 out
+void ConvertFromUnorm8(const uint8_t* in, uint64_t pixelCount, PixelConvertFlags flags, float* out);
+
+float SrgbToLinear(float value);
+float LinearToSrgb(float value);
+
+} // namespace Quartz
@@ -1,5 +1,6 @@
 
 #include "quartz/core/core.h"
+#include "quartz/core/jobs.h"
 
 namespace Quartz
 {
@@ -17,8 +18,10 @@ void CoreShutdown()
     (*iterator)->OnDetach();
   }
 
+  g_coreState.assets.Shutdown();
   g_coreState.renderer.Shutdown();
   g_coreState.mainWindow.Shutdown();
+  JobsShutdown();
 
   QTZ_DEBUG(
     "Average frame time : {} ms : {} frames",
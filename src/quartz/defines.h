@@ -15,6 +15,12 @@ enum QuartzResult
   Quartz_Failure_Vendor,
 };
 
+enum QuartzVertexFormat
+{
+  Quartz_Vertex_Format_Full,    // Quartz::Vertex : 48 bytes of 32-bit floats
+  Quartz_Vertex_Format_Compact, // Quartz::CompactVertex : 20 bytes of half floats, octahedral normal & tangent
+};
+
 struct QuartzInitInfo
 {
   struct
@@ -23,11 +29,41 @@ struct QuartzInitInfo
     Vec2I position = { 0, 0 };
     const char* title = "Quartz application";
   } window;
+
+  struct
+  {
+    // Layout of every vertex buffer, shaders must decode the compact format's normal and tangent
+    QuartzVertexFormat vertexFormat = Quartz_Vertex_Format_Full;
+
+    // The coarsest LOD whose simplification error projects to at most this many pixels is drawn
+    float lodPixelError = 1.0f;
+    // Fraction of lodPixelError a level's error must move past before the selected LOD changes
+    float lodHysteresis = 0.25f;
+    // Added to every selection, positive values trade quality for speed. See Quartz::SetLodBias()
+    float lodBias = 0.0f;
+  } rendering;
+
+  struct
+  {
+    // Output of quartz-cook for sourceDirectory, assets are loaded from here when cooked
+    const char* sourceDirectory = nullptr;
+    const char* cookedDirectory = nullptr;
+    bool requireCooked = false; // Fail instead of importing sources that have not been cooked
+
+    // Cooked textures start with their small levels, larger ones are streamed in as they are drawn up close
+    bool streamTextures = false;
+    uint32_t streamingBudgetMB = 512; // Larger levels resident at once, the least recently drawn are evicted past it
+    uint32_t streamingUploadMB = 16;  // Uploaded per frame
+
+    // Skybox diffuse, specular and brdf maps are cached here instead of being convolved on every load
+    // nullptr generates them every time. See TextureSkybox::SetCacheDirectory()
+    const char* iblCacheDirectory = nullptr;
+  } assets;
 };
 
 namespace Quartz
 {
-extern uint32_t g_quartzAttemptDepth;
+extern thread_local uint32_t g_quartzAttemptDepth; // Per thread, assets are decoded on job workers
 }
 
 #define QTZ_ATTEMPT(fn, ...)                                                                  \
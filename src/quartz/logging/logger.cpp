@@ -9,6 +9,9 @@ namespace Quartz
 std::shared_ptr<spdlog::logger> Logger::coreLogger;
 std::shared_ptr<spdlog::logger> Logger::appLogger;
 
+// Used by QTZ_ATTEMPT's failure logging, lives here so tools can log without linking the core
+thread_local uint32_t g_quartzAttemptDepth;
+
 void Logger::Init()
 {
   spdlog::set_pattern("%^[%T.%e] %L : %n :-: %v%$");
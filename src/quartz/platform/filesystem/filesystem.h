@@ -8,4 +8,17 @@ namespace Quartz
 
 uint32_t PlatformLoadFile(void** buffer, const char* path);
 
+// Read-only view of a whole file, pages are loaded by the OS on first access
+struct MappedFile
+{
+  const void* data = nullptr;
+  uint64_t size = 0;
+
+  void* platformFile = nullptr;
+  void* platformMapping = nullptr;
+};
+
+QuartzResult PlatformMapFile(const char* path, MappedFile* outFile);
+void PlatformUnmapFile(MappedFile* file);
+
 } // namespace Quartz
\ No newline at end of file
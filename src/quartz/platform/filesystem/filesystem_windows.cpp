@@ -37,4 +37,78 @@ uint32_t PlatformLoadFile(void** buffer, const char* path)
   return inSize;
 }
 
+QuartzResult PlatformMapFile(const char* path, MappedFile* outFile)
+{
+  *outFile = {};
+
+  HANDLE file = CreateFileA(
+    path,
+    GENERIC_READ,
+    FILE_SHARE_READ,
+    NULL,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+    NULL);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    QTZ_ERROR("Failed to open the file '{}' for mapping", path);
+    return Quartz_Failure;
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize))
+  {
+    QTZ_ERROR("Failed to get the size of '{}'", path);
+    CloseHandle(file);
+    return Quartz_Failure;
+  }
+
+  if (fileSize.QuadPart == 0)
+  {
+    // Empty files can not be mapped, but are still valid
+    outFile->platformFile = file;
+    return Quartz_Success;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+  {
+    QTZ_ERROR("Failed to create a mapping for '{}'", path);
+    CloseHandle(file);
+    return Quartz_Failure;
+  }
+
+  const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == NULL)
+  {
+    QTZ_ERROR("Failed to map a view of '{}'", path);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return Quartz_Failure;
+  }
+
+  outFile->data = view;
+  outFile->size = (uint64_t)fileSize.QuadPart;
+  outFile->platformFile = file;
+  outFile->platformMapping = mapping;
+  return Quartz_Success;
+}
+
+void PlatformUnmapFile(MappedFile* file)
+{
+  if (file->data != nullptr)
+  {
+    UnmapViewOfFile(file->data);
+  }
+  if (file->platformMapping != nullptr)
+  {
+    CloseHandle((HANDLE)file->platformMapping);
+  }
+  if (file->platformFile != nullptr)
+  {
+    CloseHandle((HANDLE)file->platformFile);
+  }
+  *file = {};
+}
+
 } // namespace Quartz
@@ -0,0 +1,168 @@
+
+#include "quartz/defines.h"
+#include "quartz/rendering/culling.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace Quartz
+{
+
+// Transforms
+// ============================================================
+
+Vec3 TransformPoint(const Mat4& transform, const Vec3& point)
+{
+  const Mat4& m = transform;
+  return Vec3{
+    m.x.x * point.x + m.y.x * point.y + m.z.x * point.z + m.w.x,
+    m.x.y * point.x + m.y.y * point.y + m.z.y * point.z + m.w.y,
+    m.x.z * point.x + m.y.z * point.y + m.z.z * point.z + m.w.z };
+}
+
+static inline Vec3 TransformDirection(const Mat4& m, const Vec3& direction)
+{
+  return Vec3{
+    m.x.x * direction.x + m.y.x * direction.y + m.z.x * direction.z,
+    m.x.y * direction.x + m.y.y * direction.y + m.z.y * direction.z,
+    m.x.z * direction.x + m.y.z * direction.y + m.z.z * direction.z };
+}
+
+// Rotation and uniform scale only : Directions then transform like normals and keep the angles between them
+static bool TransformIsConformal(const Mat4& transform)
+{
+  const Mat4& m = transform;
+  const Vec3 x = { m.x.x, m.x.y, m.x.z };
+  const Vec3 y = { m.y.x, m.y.y, m.y.z };
+  const Vec3 z = { m.z.x, m.z.y, m.z.z };
+
+  const float xx = Dot(x, x);
+  const float yy = Dot(y, y);
+  const float zz = Dot(z, z);
+  const float tolerance = 1e-3f * std::max(xx, std::max(yy, zz));
+
+  // Mirrored transforms flip the winding the triangles' facing was computed from
+  const Vec3 xCrossY = { x.y * y.z - x.z * y.y, x.z * y.x - x.x * y.z, x.x * y.y - x.y * y.x };
+  return fabsf(xx - yy) <= tolerance && fabsf(xx - zz) <= tolerance
+    && fabsf(Dot(x, y)) <= tolerance && fabsf(Dot(x, z)) <= tolerance && fabsf(Dot(y, z)) <= tolerance
+    && Dot(xCrossY, z) > 0.0f;
+}
+
+float TransformMaxScale(const Mat4& transform)
+{
+  const Mat4& m = transform;
+  float x = m.x.x * m.x.x + m.x.y * m.x.y + m.x.z * m.x.z;
+  float y = m.y.x * m.y.x + m.y.y * m.y.y + m.y.z * m.y.z;
+  float z = m.z.x * m.z.x + m.z.y * m.z.y + m.z.z * m.z.z;
+  return sqrtf(std::max(x, std::max(y, z)));
+}
+
+// Frustum
+// ============================================================
+
+Frustum FrustumFromViewProjection(const Mat4& viewProjection)
+{
+  const Mat4& m = viewProjection;
+  // Rows of the column-major matrix
+  Vec4 row0 = { m.x.x, m.y.x, m.z.x, m.w.x };
+  Vec4 row1 = { m.x.y, m.y.y, m.z.y, m.w.y };
+  Vec4 row2 = { m.x.z, m.y.z, m.z.z, m.w.z };
+  Vec4 row3 = { m.x.w, m.y.w, m.z.w, m.w.w };
+
+  auto Add = [](const Vec4& a, const Vec4& b, float sign)
+  {
+    return Vec4{ a.x + b.x * sign, a.y + b.y * sign, a.z + b.z * sign, a.w + b.w * sign };
+  };
+
+  Frustum frustum;
+  frustum.planes[0] = Add(row3, row0, 1.0f);  // Left
+  frustum.planes[1] = Add(row3, row0, -1.0f); // Right
+  frustum.planes[2] = Add(row3, row1, 1.0f);  // Bottom
+  frustum.planes[3] = Add(row3, row1, -1.0f); // Top
+  frustum.planes[4] = row2;                   // Near, depth starts at 0
+  frustum.planes[5] = Add(row3, row2, -1.0f); // Far
+
+  for (Vec4& plane : frustum.planes)
+  {
+    float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if (length > 0.0f)
+    {
+      float inverseLength = 1.0f / length;
+      plane = Vec4{ plane.x * inverseLength, plane.y * inverseLength, plane.z * inverseLength, plane.w * inverseLength };
+    }
+  }
+
+  return frustum;
+}
+
+bool SphereInFrustum(const Frustum& frustum, const Vec3& center, float radius)
+{
+  for (const Vec4& plane : frustum.planes)
+  {
+    if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Meshlets
+// ============================================================
+
+// Culled indices a draw may span to join the next visible range, one full meshlet
+static const uint32_t g_maxBridgedIndices = QTZ_MESHLET_MAX_TRIANGLES * 3;
+
+uint32_t CullMeshlets(
+  const std::vector<Meshlet>& meshlets,
+  const Mat4& transform,
+  const Frustum& frustum,
+  const Vec3& eye,
+  std::vector<MeshDrawCommand>* outCommands)
+{
+  const float scale = TransformMaxScale(transform);
+  const size_t firstCommand = outCommands->size();
+  // Cones would need the normal matrix and a widened cutoff under any other transform
+  const bool cullCones = TransformIsConformal(transform);
+
+  for (const Meshlet& meshlet : meshlets)
+  {
+    Vec3 center = TransformPoint(transform, meshlet.center);
+    float radius = meshlet.radius * scale;
+    if (!SphereInFrustum(frustum, center, radius))
+    {
+      continue;
+    }
+
+    // Back facing cone : Every triangle faces away from every point of the bounding sphere
+    if (cullCones && meshlet.coneCutoff < 1.0f)
+    {
+      Vec3 axis = TransformDirection(transform, meshlet.coneAxis);
+      float axisLength = sqrtf(Dot(axis, axis));
+      Vec3 view = center - eye;
+      if (axisLength > 0.0f
+        && Dot(view, axis) >= (meshlet.coneCutoff * sqrtf(Dot(view, view)) + radius) * axisLength)
+      {
+        continue;
+      }
+    }
+
+    // Drawing a few culled triangles costs less than another draw
+    if (outCommands->size() > firstCommand)
+    {
+      MeshDrawCommand& previous = outCommands->back();
+      const uint32_t previousEnd = previous.firstIndex + previous.indexCount;
+      if (previousEnd <= meshlet.indexOffset && meshlet.indexOffset - previousEnd <= g_maxBridgedIndices)
+      {
+        previous.indexCount = meshlet.indexOffset + meshlet.indexCount - previous.firstIndex;
+        continue;
+      }
+    }
+
+    outCommands->push_back({ meshlet.indexCount, 1, meshlet.indexOffset, 0, 0 });
+  }
+
+  return (uint32_t)(outCommands->size() - firstCommand);
+}
+
+} // namespace Quartz
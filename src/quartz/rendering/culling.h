@@ -0,0 +1,37 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Planes face inwards : xyz is the normal, w the distance, a point is inside when dot(normal, p) + w >= 0
+struct Frustum
+{
+  Vec4 planes[6];
+};
+
+// Gribb & Hartmann plane extraction, expects Vulkan's 0 to 1 clip space depth
+Frustum FrustumFromViewProjection(const Mat4& viewProjection);
+
+bool SphereInFrustum(const Frustum& frustum, const Vec3& center, float radius);
+
+Vec3 TransformPoint(const Mat4& transform, const Vec3& point);
+// Largest axis scale of the transform, bounds spheres under non-uniform scale
+float TransformMaxScale(const Mat4& transform);
+
+// Appends commands drawing the meshlets that are inside the frustum and not facing away from the eye
+// Visible meshlets separated by at most one culled meshlet's worth of indices are merged into one command
+// Cone culling is skipped for transforms that scale non-uniformly, shear or mirror
+// Returns the number of commands appended
+uint32_t CullMeshlets(
+  const std::vector<Meshlet>& meshlets,
+  const Mat4& transform,
+  const Frustum& frustum,
+  const Vec3& eye,
+  std::vector<MeshDrawCommand>* outCommands);
+
+} // namespace Quartz
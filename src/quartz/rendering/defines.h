@@ -1,6 +1,7 @@
 #pragma once
 
 #include "quartz/defines.h"
+#include "quartz/assets/asset_handle.h"
 
 #include <opal.h>
 
@@ -28,16 +29,78 @@ struct Vertex
   Vec2 uv;
   Vec3 normal;
   Vec3 tangent;
+  float bitangentSign = 1.0f; // Read with the tangent as one vec4 : bitangent = cross(normal, tangent) * sign
 
   bool operator==(const Vertex& other) const
   {
     return (position == other.position)
       &&   (normal   == other.normal)
       &&   (uv       == other.uv)
-      &&   (tangent  == other.tangent);
+      &&   (tangent  == other.tangent)
+      &&   (bitangentSign == other.bitangentSign);
   }
 };
 
+// Half floats throughout (see quartz/rendering/vertex_compression.h)
+struct CompactVertex
+{
+  uint16_t position[4]; // w holds Vertex::bitangentSign
+  uint16_t uv[2];
+  uint16_t normal[2];   // Octahedral
+  uint16_t tangent[2];  // Octahedral
+};
+
+// Meshes (and LODs) with at most this many vertices are drawn with 16-bit indices
+// Primitive restart is never enabled, so 0xffff is an ordinary index
+#define QTZ_MESH_MAX_16BIT_VERTICES 65536
+
+inline uint32_t ReadIndex(const void* indices, uint32_t indexStride, uint64_t i)
+{
+  return (indexStride == sizeof(uint16_t)) ? ((const uint16_t*)indices)[i] : ((const uint32_t*)indices)[i];
+}
+
+struct MeshBounds
+{
+  Vec3 min;
+  Vec3 max;
+  Vec3 sphereCenter;
+  float sphereRadius;
+};
+
+// A range of a mesh's index buffer drawn at one level of detail
+struct MeshLod
+{
+  uint32_t indexOffset;
+  uint32_t indexCount;
+  float error; // Object space distance from the full detail surface
+};
+
+#define QTZ_MESHLET_MAX_VERTICES 64
+#define QTZ_MESHLET_MAX_TRIANGLES 124
+
+// A spatially coherent cluster of the full detail level's triangles, culled as a unit
+struct Meshlet
+{
+  Vec3 center; // Bounding sphere
+  float radius;
+  Vec3 coneAxis; // Average facing of the triangles
+  // Back facing when dot(normalize(center - eye), coneAxis) >= coneCutoff (ignoring the radius)
+  // 1 when the triangles face too many directions to ever be back facing
+  float coneCutoff;
+  uint32_t indexOffset; // Into the full detail level's indices
+  uint32_t indexCount;
+};
+
+// Layout matches VkDrawIndexedIndirectCommand
+struct MeshDrawCommand
+{
+  uint32_t indexCount;
+  uint32_t instanceCount;
+  uint32_t firstIndex;
+  int32_t vertexOffset;
+  uint32_t firstInstance;
+};
+
 struct alignas(16) LightDirectional
 {
   Vec3 color;
@@ -67,11 +130,24 @@ struct alignas(16) LightSpot
 };
 #define QTZ_LIGHT_SPOT_MAX_COUNT 2
 
+#define QTZ_CAMERA_MAX_COUNT 4
+
+// A renderable as seen by one camera, written each frame by the LOD and visibility stages
+struct RenderableView
+{
+  uint8_t lod; // Kept between frames so LOD changes can lag behind the ideal level
+  bool visible;
+  // Visible meshlets in the camera's draw commands, a count of 0 draws the whole LOD
+  uint32_t commandOffset;
+  uint32_t commandCount;
+};
+
 struct Renderable
 {
-  class Mesh* mesh;
+  MeshHandle mesh;
   class Material* material;
   Mat4 transformMatrix;
+  RenderableView views[QTZ_CAMERA_MAX_COUNT] = {}; // In camera iteration order
 };
 
 struct Camera
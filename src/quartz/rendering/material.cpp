@@ -123,13 +123,39 @@ QuartzResult Material::InitInputs(const std::vector<MaterialInput>& inputs)
 {
   std::vector<OpalStageFlags> stages(inputs.size());
   std::vector<OpalShaderInputType> types(inputs.size());
-  std::vector<OpalShaderInputValue> values(inputs.size());
-  
 
   for (uint32_t i = 0; i < inputs.size(); i++)
   {
     stages[i] = Opal_Stage_All;
 
+    switch (inputs[i].type)
+    {
+    case Input_Texture: types[i] = Opal_Shader_Input_Image; break;
+    case Input_Buffer: types[i] = Opal_Shader_Input_Buffer; break;
+    default: return Quartz_Failure;
+    }
+  }
+
+  if (m_isBase)
+  {
+    OpalShaderInputLayoutInitInfo layoutInfo;
+    layoutInfo.count = inputs.size();
+    layoutInfo.pStages = stages.data();
+    layoutInfo.pTypes = types.data();
+
+    QTZ_ATTEMPT_OPAL(OpalShaderInputLayoutInit(&m_inputLayout, layoutInfo));
+  }
+
+  QTZ_ATTEMPT(InitInputSet(inputs));
+  return Quartz_Success;
+}
+
+QuartzResult Material::InitInputSet(const std::vector<MaterialInput>& inputs)
+{
+  std::vector<OpalShaderInputValue> values(inputs.size());
+
+  for (uint32_t i = 0; i < inputs.size(); i++)
+  {
     switch (inputs[i].type)
     {
     case Input_Texture:
@@ -140,7 +166,6 @@ QuartzResult Material::InitInputs(const std::vector<MaterialInput>& inputs)
         return Quartz_Failure;
       }
 
-      types[i] = Opal_Shader_Input_Image;
       values[i].image = &inputs[i].value.texture->m_opalImage;
     } break;
     case Input_Buffer:
@@ -151,23 +176,12 @@ QuartzResult Material::InitInputs(const std::vector<MaterialInput>& inputs)
         return Quartz_Failure;
       }
 
-      types[i] = Opal_Shader_Input_Buffer;
       values[i].buffer = &inputs[i].value.buffer->m_opalBuffer;
     } break;
     default: return Quartz_Failure;
     }
   }
 
-  if (m_isBase)
-  {
-    OpalShaderInputLayoutInitInfo layoutInfo;
-    layoutInfo.count = inputs.size();
-    layoutInfo.pStages = stages.data();
-    layoutInfo.pTypes = types.data();
-
-    QTZ_ATTEMPT_OPAL(OpalShaderInputLayoutInit(&m_inputLayout, layoutInfo));
-  }
-
   OpalShaderInputInitInfo setInfo;
   setInfo.layout = m_inputLayout;
   setInfo.pValues = values.data();
@@ -325,6 +339,21 @@ QuartzResult Material::UpdateInputs()
   return Quartz_Success;
 }
 
+QuartzResult Material::RebuildInputSet()
+{
+  if (!m_isValid)
+  {
+    QTZ_WARNING("Attempting to rebuild the inputs of an invalid material");
+    return Quartz_Failure;
+  }
+
+  // The layout is unchanged, frames in flight keep binding the previous set until it is released
+  OpalShaderInput previousSet = m_inputSet;
+  QTZ_ATTEMPT(InitInputSet(m_inputs), m_inputSet = previousSet);
+  g_coreState.renderer.Retire(previousSet);
+  return Quartz_Success;
+}
+
 QuartzResult Material::UpdateInputs(const std::vector<MaterialInputValue>& inputs)
 {
   if (!m_isValid)
@@ -71,6 +71,7 @@ private:
 
 public:
   inline bool IsValid() const { return m_isValid; }
+  inline const std::vector<MaterialInput>& Inputs() const { return m_inputs; }
 
   Material() : m_isValid(false), m_isBase(true) {}
   Material(const std::vector<std::string>& shaderPaths, const std::vector<MaterialInput>& inputs);
@@ -85,12 +86,16 @@ public:
   QuartzResult Reload();
   QuartzResult UpdateInputs();
   QuartzResult UpdateInputs(const std::vector<MaterialInputValue>& inputs);
+  // Points a new input set at the current values without waiting for the gpu, the previous set is retired to the renderer
+  // For inputs whose gpu objects were replaced, the layout and the values' types must be unchanged
+  QuartzResult RebuildInputSet();
   void SetSingleInput(uint32_t index, MaterialInputValue input);
 
 private:
   QuartzResult Init(ShaderSourceInfo vertInfo, ShaderSourceInfo fragInfo, const std::vector<MaterialInput>& inputs, OpalRenderpass renderpass, QuartzPipelineSettingFlags pipelineSettings = 0);
 
   QuartzResult InitInputs(const std::vector<MaterialInput>& inputs);
+  QuartzResult InitInputSet(const std::vector<MaterialInput>& inputs);
   QuartzResult InitShaderFiles(const std::vector<std::string>& shaderPaths);
   QuartzResult InitMaterial();
 
@@ -2,63 +2,70 @@
 #include "quartz/defines.h"
 #include "quartz/rendering/defines.h"
 #include "quartz/rendering/mesh.h"
+#include "quartz/rendering/renderer.h"
+#include "quartz/core/core.h"
+#include "quartz/rendering/vertex_compression.h"
+#include "quartz/assets/mesh_import.h"
+#include "quartz/assets/qmesh.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#include <unordered_map>
-#include <stdio.h>
+#include <algorithm>
+#include <string.h>
 
-size_t HashInt(int32_t value)
-{
-  value += (0x9e3779b9 * value) >> 3;
-  return value;
-}
-
-// Used to map vertices into an unordered array during mesh building
-namespace std {
-template<> struct hash<Quartz::Vertex>
+namespace Quartz
 {
-  size_t operator()(Quartz::Vertex const& vertex) const
-  {
-    // Keep all bits, don't round
-    Vec3I* iPos = (Vec3I*)&vertex.position;
-    Vec3I* iNor = (Vec3I*)&vertex.normal;
-    Vec3I* iTan = (Vec3I*)&vertex.tangent;
-    Vec2I* iUv = (Vec2I*)&vertex.uv;
 
-    size_t posHash = 0, normHash = 0, tanHash = 0, uvHash = 0;
+static QuartzResult ReadCookedCpuData(const char* path, std::vector<Vertex>* outVertices, std::vector<uint32_t>* outIndices);
+static std::vector<MeshLod> SingleLod(uint64_t indexCount);
 
-    posHash ^= HashInt(iPos->x);
-    posHash ^= HashInt(iPos->y);
-    posHash ^= HashInt(iPos->z);
-
-    normHash ^= HashInt(iNor->x);
-    normHash ^= HashInt(iNor->y);
-    normHash ^= HashInt(iNor->z);
-
-    tanHash ^= HashInt(iTan->x);
-    tanHash ^= HashInt(iTan->y);
-    tanHash ^= HashInt(iTan->z);
-
-    uvHash ^= HashInt(iUv->x);
-    uvHash ^= HashInt(iUv->y);
-
-    return posHash ^ normHash ^ uvHash;
-  }
-};
+Mesh::Mesh(const char* path, MeshImportInfo importInfo) : m_isValid(false)
+{
+  QTZ_ATTEMPT_VOID(Init(path, importInfo));
 }
 
-namespace Quartz
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshResidency residency) : m_isValid(false)
 {
+  QTZ_ATTEMPT_VOID(Init(vertices, indices, residency));
+}
 
-Mesh::Mesh(const char* path) : m_isValid(false)
+Mesh::Mesh(Mesh&& other) noexcept :
+  m_gpuLods(std::move(other.m_gpuLods)),
+  m_isValid(other.m_isValid),
+  m_hasCpuData(other.m_hasCpuData),
+  m_bounds(other.m_bounds),
+  m_uvDensity(other.m_uvDensity),
+  m_lods(std::move(other.m_lods)),
+  m_meshlets(std::move(other.m_meshlets)),
+  m_sourcePath(std::move(other.m_sourcePath)),
+  m_sourceIsCooked(other.m_sourceIsCooked),
+  m_importInfo(other.m_importInfo),
+  m_indices(std::move(other.m_indices)),
+  m_verticies(std::move(other.m_verticies))
 {
-  QTZ_ATTEMPT_VOID(Init(path));
+  other.m_isValid = false;
+  other.m_hasCpuData = false;
 }
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) : m_isValid(false)
+Mesh& Mesh::operator=(Mesh&& other) noexcept
 {
-  QTZ_ATTEMPT_VOID(Init(vertices, indices));
+  if (this != &other)
+  {
+    Shutdown();
+    m_gpuLods = std::move(other.m_gpuLods);
+    m_isValid = other.m_isValid;
+    m_hasCpuData = other.m_hasCpuData;
+    m_bounds = other.m_bounds;
+    m_uvDensity = other.m_uvDensity;
+    m_lods = std::move(other.m_lods);
+    m_meshlets = std::move(other.m_meshlets);
+    m_sourcePath = std::move(other.m_sourcePath);
+    m_sourceIsCooked = other.m_sourceIsCooked;
+    m_importInfo = other.m_importInfo;
+    m_indices = std::move(other.m_indices);
+    m_verticies = std::move(other.m_verticies);
+    other.m_isValid = false;
+    other.m_hasCpuData = false;
+  }
+  return *this;
 }
 
 Mesh::~Mesh()
@@ -69,7 +76,17 @@ Mesh::~Mesh()
   }
 }
 
-QuartzResult Mesh::Init(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+QuartzResult Mesh::Init(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshResidency residency)
+{
+  return Init(vertices.data(), vertices.size(), indices.data(), indices.size(), residency);
+}
+
+QuartzResult Mesh::Init(
+  const Vertex* vertices,
+  uint64_t vertexCount,
+  const uint32_t* indices,
+  uint64_t indexCount,
+  MeshResidency residency)
 {
   if (m_isValid)
   {
@@ -77,163 +94,334 @@ QuartzResult Mesh::Init(const std::vector<Vertex>& vertices, const std::vector<u
     return Quartz_Success;
   }
 
-  OpalMeshInitInfo meshInfo {};
-  meshInfo.vertexCount = vertices.size();
-  meshInfo.pVertices = vertices.data();
-  meshInfo.indexCount = indices.size();
-  meshInfo.pIndices = indices.data();
-
-  QTZ_ATTEMPT_OPAL(OpalMeshInit(&m_opalMesh, meshInfo));
+  m_lods = SingleLod(indexCount);
+  m_meshlets.clear();
+  QTZ_ATTEMPT(Upload(vertices, vertexCount, Quartz_Vertex_Format_Full, indices, sizeof(uint32_t), m_lods));
+  m_bounds = ComputeMeshBounds(vertices, vertexCount);
+  m_uvDensity = ComputeUvDensity(vertices, indices, indexCount);
 
-  m_verticies = std::vector<Vertex>(vertices);
-  m_indices = std::vector<uint32_t>(indices);
+  m_sourcePath.clear();
+  if (residency == Mesh_Residency_CpuAndGpu)
+  {
+    m_verticies.assign(vertices, vertices + vertexCount);
+    m_indices.assign(indices, indices + indexCount);
+    m_hasCpuData = true;
+  }
 
   m_isValid = true;
   return Quartz_Success;
 }
 
-QuartzResult LoadTinyObjMesh(const char* path, tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes)
+// Vertices are only converted if they are not already in the renderer's format
+// Every LOD gets its own gpu mesh holding only the vertices it references,
+//   with 16-bit indices whenever that level has few enough vertices
+QuartzResult Mesh::Upload(
+  const void* vertices,
+  uint64_t vertexCount,
+  QuartzVertexFormat vertexFormat,
+  const void* indices,
+  uint32_t indexStride,
+  const std::vector<MeshLod>& lods)
 {
-  std::string loadWarnings, loadErrors;
-  std::vector<tinyobj::material_t> materials;
+  std::vector<CompactVertex> compactVertices;
+  std::vector<Vertex> fullVertices;
+  if (vertexFormat != Renderer::VertexFormat())
+  {
+    if (vertexFormat == Quartz_Vertex_Format_Full)
+    {
+      const Vertex* in = (const Vertex*)vertices;
+      // The renderer has one vertex layout, meshes that would lose their shape in it are rejected
+      if (!CompactPositionsFit(ComputeMeshBounds(in, vertexCount)))
+      {
+        QTZ_ERROR("Mesh is too large or too far from its origin for the compact vertex format, use the full format");
+        return Quartz_Failure;
+      }
 
-  if (!tinyobj::LoadObj(attrib, shapes, &materials, &loadWarnings, &loadErrors, path))
+      compactVertices.resize(vertexCount);
+      for (uint64_t i = 0; i < vertexCount; i++)
+      {
+        compactVertices[i] = CompressVertex(in[i]);
+      }
+      vertices = compactVertices.data();
+    }
+    else
+    {
+      const CompactVertex* in = (const CompactVertex*)vertices;
+      fullVertices.resize(vertexCount);
+      for (uint64_t i = 0; i < vertexCount; i++)
+      {
+        fullVertices[i] = DecompressVertex(in[i]);
+      }
+      vertices = fullVertices.data();
+    }
+  }
+  const uint64_t stride = (Renderer::VertexFormat() == Quartz_Vertex_Format_Compact) ? sizeof(CompactVertex) : sizeof(Vertex);
+
+  m_gpuLods.reserve(lods.size());
+
+  std::vector<uint32_t> remap;
+  std::vector<uint8_t> lodVertices;
+  std::vector<uint32_t> lodIndices;
+  for (uint32_t level = 0; level < lods.size(); level++)
   {
-    QTZ_ERROR("Failed to load mesh\"{}\"\n\tTinyobj warning : {}\n\tTinyobj error : {}", path, loadWarnings.c_str(), loadErrors.c_str());
-    return Quartz_Failure_Vendor;
+    MeshGpuLod gpuLod = {};
+    if (level == 0)
+    {
+      const void* levelIndices = (const uint8_t*)indices + (uint64_t)lods[level].indexOffset * indexStride;
+      QTZ_ATTEMPT(UploadLod(vertices, vertexCount, levelIndices, indexStride, lods[level].indexCount, &gpuLod), ShutdownGpuLods());
+    }
+    else
+    {
+      // Simplified levels reference a shrinking subset of the vertices
+      remap.assign(vertexCount, ~0u);
+      lodVertices.clear();
+      lodIndices.resize(lods[level].indexCount);
+      uint32_t lodVertexCount = 0;
+      for (uint32_t i = 0; i < lods[level].indexCount; i++)
+      {
+        uint32_t index = ReadIndex(indices, indexStride, lods[level].indexOffset + i);
+        if (index >= vertexCount)
+        {
+          QTZ_ERROR("Mesh LOD {} references vertex {} of {}", level, index, vertexCount);
+          ShutdownGpuLods();
+          return Quartz_Failure;
+        }
+
+        if (remap[index] == ~0u)
+        {
+          remap[index] = lodVertexCount++;
+          const uint8_t* vertex = (const uint8_t*)vertices + index * stride;
+          lodVertices.insert(lodVertices.end(), vertex, vertex + stride);
+        }
+        lodIndices[i] = remap[index];
+      }
+
+      QTZ_ATTEMPT(
+        UploadLod(lodVertices.data(), lodVertexCount, lodIndices.data(), sizeof(uint32_t), lods[level].indexCount, &gpuLod),
+        ShutdownGpuLods());
+    }
+    m_gpuLods.push_back(gpuLod);
   }
 
   return Quartz_Success;
 }
 
-QuartzResult Mesh::Init(const char* path)
+// Vertices must already be in the renderer's vertex format
+QuartzResult Mesh::UploadLod(
+  const void* vertices,
+  uint64_t vertexCount,
+  const void* indices,
+  uint32_t indexStride,
+  uint32_t indexCount,
+  MeshGpuLod* outLod)
 {
-  if (m_isValid)
-  {
-    QTZ_WARNING("Attempting to initialize a valid mesh");
-    return Quartz_Success;
-  }
+  outLod->indexCount = indexCount;
+  outLod->indices16Bit = vertexCount <= QTZ_MESH_MAX_16BIT_VERTICES;
 
-  // TODO : Replace with custom model loader for better control
-  tinyobj::attrib_t attrib;
-  std::vector<tinyobj::shape_t> shapes;
-  QTZ_ATTEMPT(LoadTinyObjMesh(path, &attrib, &shapes));
-
-  // Assemble mesh =====
-  std::unordered_map<Vertex, uint32_t> vertMap = {};
-  Vertex vert{};
-  std::vector<uint32_t> indices;
-  std::vector<Vertex> verticies;
-  for (const auto& shape : shapes)
+  OpalMeshInitInfo meshInfo {};
+  meshInfo.vertexCount = (uint32_t)vertexCount;
+  meshInfo.pVertices = vertices;
+  meshInfo.indexCount = indexCount;
+
+  // Narrowed only when needed, 16-bit sources (such as cooked meshes) upload as they are
+  // Opal sizes index buffers in 32-bit indices, so an odd count is padded with one unused index
+  std::vector<uint16_t> narrowIndices;
+  if (outLod->indices16Bit)
   {
-    for (const auto& indexSet : shape.mesh.indices)
+    if (indexStride == sizeof(uint32_t) || (indexCount & 1))
     {
-      vert.position = Vec3{
-        attrib.vertices[3 * indexSet.vertex_index + 0],
-        attrib.vertices[3 * indexSet.vertex_index + 1],
-        attrib.vertices[3 * indexSet.vertex_index + 2]
-      };
-
-      vert.uv = Vec2{
-        attrib.texcoords[2 * indexSet.texcoord_index + 0],
-        1.0f - attrib.texcoords[2 * indexSet.texcoord_index + 1],
-      };
-
-      vert.normal = Vec3{
-        attrib.normals[3 * indexSet.normal_index + 0],
-        attrib.normals[3 * indexSet.normal_index + 1],
-        attrib.normals[3 * indexSet.normal_index + 2]
-      };
-
-      vert.tangent = Vec3{ 0.0f, 0.0f, 0.0f };
-
-      if (vertMap.count(vert) == 0)
+      narrowIndices.resize(indexCount + (indexCount & 1));
+      for (uint32_t i = 0; i < indexCount; i++)
       {
-        vertMap[vert] = (uint32_t)verticies.size();
-        verticies.push_back(vert);
+        narrowIndices[i] = (uint16_t)ReadIndex(indices, indexStride, i);
       }
-      indices.push_back(vertMap[vert]);
+      indices = narrowIndices.data();
     }
+    meshInfo.indexCount = (indexCount + 1) / 2;
   }
+  meshInfo.pIndices = (const uint32_t*)indices;
 
-  std::vector<uint32_t> vertexTangentCounts(verticies.size());
-  for (uint32_t i = 0; i < indices.size(); i += 3)
-  {
-    Vertex* vert1 = &verticies[indices[i + 0]];
-    Vertex* vert2 = &verticies[indices[i + 1]];
-    Vertex* vert3 = &verticies[indices[i + 2]];
-
-    Vec3 e1 = vert2->position - vert1->position;
-    Vec3 e2 = vert3->position - vert1->position;
-
-    Vec2 uv1 = vert2->uv - vert1->uv;
-    Vec2 uv2 = vert3->uv - vert1->uv;
+  QTZ_ATTEMPT_OPAL(OpalMeshInit(&outLod->opalMesh, meshInfo));
+  return Quartz_Success;
+}
 
-    float r = 1.0f / (uv1.x * uv2.y - uv2.x * uv1.y);
+QuartzResult Mesh::Init(const char* path, MeshImportInfo importInfo)
+{
+  if (m_isValid)
+  {
+    QTZ_WARNING("Attempting to initialize a valid mesh");
+    return Quartz_Success;
+  }
 
-    Vec3 tangent = Vec3{ (uv2.y * e1.x - uv1.y * e2.x) * r, (uv2.y * e1.y - uv1.y * e2.y) * r, (uv2.y * e1.z - uv1.y * e2.z) * r };
+  size_t pathLength = strlen(path);
+  if (pathLength >= 6 && strcmp(path + pathLength - 6, ".qmesh") == 0)
+  {
+    // Cooked meshes were already processed when they were cooked
+    return InitFromCooked(path, importInfo.residency);
+  }
 
-    if (tangent.x != tangent.x || tangent.y != tangent.y || tangent.z != tangent.z)
-    {
-      // Fix divide by zero issues (If all UV's share an axis)
-      tangent = Vec3{0.0f, 0.0f, 0.0f};
-    }
+  MeshImportData data;
+  QTZ_ATTEMPT(ImportMesh(path, importInfo, &data.vertices, &data.indices, &data.lods, &data.meshlets));
+  return Init(path, importInfo, &data);
+}
 
-    vert1->tangent = vert1->tangent + tangent;
-    vert2->tangent = vert2->tangent + tangent;
-    vert3->tangent = vert3->tangent + tangent;
+QuartzResult Mesh::Init(const char* path, MeshImportInfo importInfo, MeshImportData* data)
+{
+  if (m_isValid)
+  {
+    QTZ_WARNING("Attempting to initialize a valid mesh");
+    return Quartz_Success;
   }
 
-  for (uint32_t i = 0; i < verticies.size(); i++)
+  QTZ_ATTEMPT(Upload(
+    data->vertices.data(),
+    data->vertices.size(),
+    Quartz_Vertex_Format_Full,
+    data->indices.data(),
+    sizeof(uint32_t),
+    data->lods));
+  m_bounds = ComputeMeshBounds(data->vertices.data(), data->vertices.size());
+  m_uvDensity = ComputeUvDensity(data->vertices.data(), data->indices.data(), data->lods[0].indexCount);
+  m_lods = std::move(data->lods);
+  m_meshlets = std::move(data->meshlets);
+
+  m_sourcePath = path;
+  m_sourceIsCooked = false;
+  m_importInfo = importInfo;
+  if (importInfo.residency == Mesh_Residency_CpuAndGpu)
   {
-    Vertex* v = &verticies[i];
+    m_verticies = std::move(data->vertices);
+    m_indices = std::move(data->indices);
+    m_hasCpuData = true;
+  }
 
-    if (v->tangent == Vec3{ 0.0f, 0.0f, 0.0f })
-    {
-      // TODO : Find a proper fix for invalid tangents
-      v->tangent = v->normal;
-    }
+  m_isValid = true;
+  return Quartz_Success;
+}
 
-    // Calculate orthogonal tangent
-    v->tangent = (v->tangent - (v->normal * Dot(v->normal, v->tangent))).Normal();
+QuartzResult Mesh::LoadCpuData()
+{
+  if (m_hasCpuData)
+  {
+    return Quartz_Success;
   }
 
-  QTZ_ATTEMPT(Init(verticies, indices));
+  if (m_sourcePath.empty())
+  {
+    QTZ_ERROR("Mesh CPU data can not be restored, the mesh was not loaded from a file");
+    return Quartz_Failure;
+  }
 
-  m_isValid = true;
+  if (m_sourceIsCooked)
+  {
+    QTZ_ATTEMPT(ReadCookedCpuData(m_sourcePath.c_str(), &m_verticies, &m_indices));
+  }
+  else
+  {
+    // Meshlets reorder the indices, so they are rebuilt to match the uploaded mesh
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    QTZ_ATTEMPT(ImportMesh(m_sourcePath.c_str(), m_importInfo, &m_verticies, &m_indices, &lods, &meshlets));
+  }
+  m_hasCpuData = true;
   return Quartz_Success;
 }
 
-QuartzResult Mesh::InitFromDump(const char* path)
+void Mesh::ReleaseCpuData()
 {
-  FILE* inFile;
-  int err = fopen_s(&inFile, path, "rb");
-  if (err)
+  // Swap with empty vectors to actually return the memory
+  std::vector<Vertex>().swap(m_verticies);
+  std::vector<uint32_t>().swap(m_indices);
+  m_hasCpuData = false;
+}
+
+QuartzResult Mesh::InitFromCooked(const char* path, MeshResidency residency)
+{
+  if (m_isValid)
   {
-    QTZ_ERROR("Failed to open a mesh dump file (\"%s\")", path);
-    return Quartz_Failure;
+    QTZ_WARNING("Attempting to initialize a valid mesh");
+    return Quartz_Success;
   }
 
-  std::vector<Vertex> verts;
-  std::vector<uint32_t> indices;
-  uint64_t vertCount;
+  QMeshFile cooked;
+  QTZ_ATTEMPT(OpenQMesh(path, &cooked));
+
+  uint64_t vertexCount;
   uint64_t indexCount;
+  uint64_t lodCount;
+  uint64_t meshletCount;
+  uint32_t indexStride;
+  const void* vertices = cooked.Section(QMesh_Section_Vertices, &vertexCount);
+  const void* indices = cooked.Section(QMesh_Section_Indices, &indexCount, &indexStride);
+  const MeshLod* lods = (const MeshLod*)cooked.Section(QMesh_Section_Lods, &lodCount);
+  const Meshlet* meshlets = (const Meshlet*)cooked.Section(QMesh_Section_Meshlets, &meshletCount);
+  QuartzVertexFormat vertexFormat = (QuartzVertexFormat)cooked.header->vertexFormat;
+
+  m_lods = lods ? std::vector<MeshLod>(lods, lods + lodCount) : SingleLod(indexCount);
+  m_meshlets = meshlets ? std::vector<Meshlet>(meshlets, meshlets + meshletCount) : std::vector<Meshlet>();
+  QTZ_ATTEMPT(Upload(vertices, vertexCount, vertexFormat, indices, indexStride, m_lods), CloseQMesh(&cooked));
+
+  const QMeshHeader* header = cooked.header;
+  m_bounds.min = Vec3{ header->boundsMin[0], header->boundsMin[1], header->boundsMin[2] };
+  m_bounds.max = Vec3{ header->boundsMax[0], header->boundsMax[1], header->boundsMax[2] };
+  m_bounds.sphereCenter = Vec3{ header->sphereCenter[0], header->sphereCenter[1], header->sphereCenter[2] };
+  m_bounds.sphereRadius = header->sphereRadius;
+  m_uvDensity = header->uvDensity;
+
+  CloseQMesh(&cooked);
+
+  m_sourcePath = path;
+  m_sourceIsCooked = true;
+  m_isValid = true;
 
-  fread(&vertCount, sizeof(vertCount), 1, inFile);
-  verts.resize(vertCount);
-  fread(verts.data(), sizeof(Vertex), vertCount, inFile);
+  if (residency == Mesh_Residency_CpuAndGpu && LoadCpuData() != Quartz_Success)
+  {
+    QTZ_WARNING("Failed to retain CPU data for cooked mesh \"{}\"", path);
+  }
 
-  fread(&indexCount, sizeof(indexCount), 1, inFile);
-  indices.resize(indexCount);
-  fread(indices.data(), sizeof(uint32_t), indexCount, inFile);
+  return Quartz_Success;
+}
 
-  fclose(inFile);
+static QuartzResult ReadCookedCpuData(const char* path, std::vector<Vertex>* outVertices, std::vector<uint32_t>* outIndices)
+{
+  QMeshFile cooked;
+  QTZ_ATTEMPT(OpenQMesh(path, &cooked));
 
-  QTZ_ATTEMPT(Init(verts, indices));
+  uint64_t vertexCount;
+  uint64_t indexCount;
+  uint32_t indexStride;
+  const void* vertices = cooked.Section(QMesh_Section_Vertices, &vertexCount);
+  const void* indices = cooked.Section(QMesh_Section_Indices, &indexCount, &indexStride);
 
+  if (cooked.header->vertexFormat == Quartz_Vertex_Format_Compact)
+  {
+    const CompactVertex* compactVertices = (const CompactVertex*)vertices;
+    outVertices->resize(vertexCount);
+    for (uint64_t i = 0; i < vertexCount; i++)
+    {
+      (*outVertices)[i] = DecompressVertex(compactVertices[i]);
+    }
+  }
+  else
+  {
+    outVertices->assign((const Vertex*)vertices, (const Vertex*)vertices + vertexCount);
+  }
+  // CPU copies are always 32-bit
+  outIndices->resize(indexCount);
+  for (uint64_t i = 0; i < indexCount; i++)
+  {
+    (*outIndices)[i] = ReadIndex(indices, indexStride, i);
+  }
+
+  CloseQMesh(&cooked);
   return Quartz_Success;
 }
 
+static std::vector<MeshLod> SingleLod(uint64_t indexCount)
+{
+  return { { 0, (uint32_t)indexCount, 0.0f } };
+}
+
 void Mesh::Shutdown()
 {
   if (!m_isValid)
@@ -242,19 +430,61 @@ void Mesh::Shutdown()
   }
 
   m_isValid = false;
-  OpalMeshShutdown(&m_opalMesh);
+  ShutdownGpuLods();
+  ReleaseCpuData();
+  m_sourcePath.clear();
+}
+
+void Mesh::Retire()
+{
+  if (!m_isValid)
+  {
+    return;
+  }
+
+  m_isValid = false;
+  for (MeshGpuLod& gpuLod : m_gpuLods)
+  {
+    g_coreState.renderer.Retire(gpuLod.opalMesh);
+  }
+  m_gpuLods.clear();
+  ReleaseCpuData();
+  m_sourcePath.clear();
+}
+
+void Mesh::ShutdownGpuLods()
+{
+  for (MeshGpuLod& gpuLod : m_gpuLods)
+  {
+    OpalMeshShutdown(&gpuLod.opalMesh);
+  }
+  m_gpuLods.clear();
 }
 
 void Mesh::Dump(uint64_t* outVertCount, const Vertex** outVertices, uint64_t* outIndexCount, const uint32_t** outIndices) const
 {
+  if (!m_hasCpuData)
+  {
+    QTZ_WARNING("Dumping a mesh without CPU data, use Mesh_Residency_CpuAndGpu or LoadCpuData()");
+  }
+
   *outVertCount = m_verticies.size();
   *outVertices = m_verticies.data();
 
-  *outIndexCount = m_indices.size();
-  *outIndices = m_indices.data();
+  *outIndexCount = m_hasCpuData ? m_lods[0].indexCount : 0;
+  *outIndices = m_indices.data() + (m_hasCpuData ? m_lods[0].indexOffset : 0);
 }
 
-void Mesh::Render() const
+// Opal binds every index buffer as 32-bit, so the buffers are bound and drawn from directly
+static void BindGpuLod(VkCommandBuffer commandBuffer, const MeshGpuLod& gpuLod)
+{
+  VkDeviceSize vertexOffset = 0;
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &gpuLod.opalMesh.vertBuffer.api.vk.buffer, &vertexOffset);
+  VkIndexType indexType = gpuLod.indices16Bit ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  vkCmdBindIndexBuffer(commandBuffer, gpuLod.opalMesh.indexBuffer.api.vk.buffer, 0, indexType);
+}
+
+void Mesh::Render(uint32_t lod) const
 {
   if (!m_isValid)
   {
@@ -262,7 +492,41 @@ void Mesh::Render() const
     return;
   }
 
-  OpalRenderMesh(&m_opalMesh);
+  VkCommandBuffer commandBuffer = OpalGetState()->api.vk.renderState.curCmd;
+  const MeshGpuLod& gpuLod = m_gpuLods[std::min(lod, (uint32_t)m_gpuLods.size() - 1)];
+  BindGpuLod(commandBuffer, gpuLod);
+  vkCmdDrawIndexed(commandBuffer, gpuLod.indexCount, 1, 0, 0, 0);
+}
+
+// Meshlets index the full detail level, so its buffers are bound and drawn from directly
+// The commands are laid out for vkCmdDrawIndexedIndirect once Opal exposes indirect buffers
+void Mesh::Render(const MeshDrawCommand* commands, uint32_t commandCount) const
+{
+  if (!m_isValid)
+  {
+    QTZ_ERROR("Attempting to render invalid mesh");
+    return;
+  }
+
+  if (commandCount == 0)
+  {
+    return;
+  }
+
+  VkCommandBuffer commandBuffer = OpalGetState()->api.vk.renderState.curCmd;
+  BindGpuLod(commandBuffer, m_gpuLods[0]);
+
+  for (uint32_t i = 0; i < commandCount; i++)
+  {
+    const MeshDrawCommand& command = commands[i];
+    vkCmdDrawIndexed(
+      commandBuffer,
+      command.indexCount,
+      command.instanceCount,
+      command.firstIndex,
+      command.vertexOffset,
+      command.firstInstance);
+  }
 }
 
 } // namespace Quartz
@@ -2,14 +2,25 @@
 
 #include "quartz/defines.h"
 #include "quartz/rendering/defines.h"
+#include "quartz/assets/mesh_import.h"
 
 #include <opal.h>
 
+#include <string>
 #include <vector>
 
 namespace Quartz
 {
 
+// The gpu copy of one level of detail
+// Opal's index buffers hold 32-bit indices, 16-bit levels pack two to a word and are bound as 16-bit by Mesh
+struct MeshGpuLod
+{
+  OpalMesh opalMesh;
+  uint32_t indexCount;
+  bool indices16Bit;
+};
+
 class Mesh
 {
 friend class Renderer;
@@ -18,28 +29,80 @@ friend QuartzResult ConvolveHdri();
 
 public:
   Mesh() : m_isValid(false) {}
-  Mesh(const char* path);
-  Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+  Mesh(const char* path, MeshImportInfo importInfo = {});
+  Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshResidency residency = Mesh_Residency_Gpu);
+  // Ownership of the gpu mesh moves with the object
+  Mesh(Mesh&& other) noexcept;
+  Mesh& operator=(Mesh&& other) noexcept;
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
 
   ~Mesh();
 
-  QuartzResult Init(const char* path);
-  QuartzResult Init(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
-  QuartzResult InitFromDump(const char* path);
+  QuartzResult Init(const char* path, MeshImportInfo importInfo = {});
+  QuartzResult Init(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshResidency residency = Mesh_Residency_Gpu);
+  // Uploads straight from memory the caller owns, such as a mapped file
+  QuartzResult Init(
+    const Vertex* vertices,
+    uint64_t vertexCount,
+    const uint32_t* indices,
+    uint64_t indexCount,
+    MeshResidency residency = Mesh_Residency_Gpu);
+  // Init(path) for an already imported source mesh, the import can run on any thread beforehand
+  // Takes the contents of data
+  QuartzResult Init(const char* path, MeshImportInfo importInfo, MeshImportData* data);
+  // Uploads straight from the mapped .qmesh file (see quartz/assets/qmesh.h)
+  QuartzResult InitFromCooked(const char* path, MeshResidency residency = Mesh_Residency_Gpu);
   void Shutdown();
+  // Shutdown() for a mesh frames in flight may still draw, the renderer releases its gpu meshes once they complete
+  void Retire();
 
+  // Re-reads the CPU copies of a mesh loaded from a file without touching the gpu mesh
+  QuartzResult LoadCpuData();
+  void ReleaseCpuData();
+  inline bool HasCpuData() const { return m_hasCpuData; }
+
+  // Requires CPU data, outputs empty arrays otherwise. Only outputs the full detail level's indices
   void Dump(uint64_t* outVertCount, const Vertex** outVertices, uint64_t* outIndexCount, const uint32_t** outIndices) const;
 
   inline bool IsValid() const { return m_isValid; }
+  inline const MeshBounds& Bounds() const { return m_bounds; }
+  // Object space units per unit of uv space on the full detail level, 0 without uvs (see ComputeUvDensity())
+  inline float UvDensity() const { return m_uvDensity; }
+  // Always holds at least the full detail level
+  inline const std::vector<MeshLod>& Lods() const { return m_lods; }
+  // Empty unless the mesh was imported or cooked with meshlets
+  inline const std::vector<Meshlet>& Meshlets() const { return m_meshlets; }
 
 private:
-  OpalMesh m_opalMesh;
+  std::vector<MeshGpuLod> m_gpuLods; // One per LOD
   bool m_isValid;
+  bool m_hasCpuData = false;
+  MeshBounds m_bounds = {};
+  float m_uvDensity = 0.0f;
+  std::vector<MeshLod> m_lods;
+  std::vector<Meshlet> m_meshlets;
+
+  // Source of the mesh, used to restore CPU data on demand
+  std::string m_sourcePath;
+  bool m_sourceIsCooked = false;
+  MeshImportInfo m_importInfo;
 
-  std::vector<uint32_t> m_indices;
+  std::vector<uint32_t> m_indices; // The gpu copies are 16-bit where they fit
   std::vector<Vertex> m_verticies;
 
-  void Render() const;
+  QuartzResult Upload(
+    const void* vertices,
+    uint64_t vertexCount,
+    QuartzVertexFormat vertexFormat,
+    const void* indices,
+    uint32_t indexStride, // 2 or 4 bytes
+    const std::vector<MeshLod>& lods);
+  QuartzResult UploadLod(const void* vertices, uint64_t vertexCount, const void* indices, uint32_t indexStride, uint32_t indexCount, MeshGpuLod* outLod);
+  void ShutdownGpuLods();
+  void Render(uint32_t lod = 0) const;
+  // Draws ranges of the full detail level, such as the visible meshlets
+  void Render(const MeshDrawCommand* commands, uint32_t commandCount) const;
 };
 
 } // namespace Quartz
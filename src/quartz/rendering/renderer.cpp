@@ -4,6 +4,7 @@
 #include "quartz/rendering/renderer.h"
 #include "quartz/platform/platform.h"
 #include "quartz/platform/filesystem/filesystem.h"
+#include "quartz/core/core.h"
 
 #include <imgui.h>
 #include <backends/imgui_impl_win32.h>
@@ -12,6 +13,7 @@
 namespace Quartz
 {
 
+QuartzVertexFormat Renderer::m_vertexFormat = Quartz_Vertex_Format_Full;
 OpalShaderInputLayout Renderer::m_sceneLayout;
 OpalShaderInput Renderer::m_sceneSet;
 
@@ -33,20 +35,41 @@ void OpalMessageCallback(OpalMessageType type, const char* message)
   }
 }
 
-QuartzResult Renderer::Init(Window* window)
+QuartzResult Renderer::Init(Window* window, QuartzVertexFormat vertexFormat)
 {
   m_qWindow = window;
 
+#ifndef QTZ_OPAL_EXTENDED_FORMATS
+  // The compact layout's half float positions need Opal's RGBA16, meshes are expanded to full vertices at upload
+  if (vertexFormat == Quartz_Vertex_Format_Compact)
+  {
+    QTZ_WARNING("The compact vertex format needs an Opal with RGBA16 (QUARTZ_OPAL_EXTENDED_FORMATS), using full vertices");
+    vertexFormat = Quartz_Vertex_Format_Full;
+  }
+#endif // !QTZ_OPAL_EXTENDED_FORMATS
+  m_vertexFormat = vertexFormat;
+
   const WindowPlatformInfo platformInfo = window->PlatformInfo();
 
+  // Attribute locations are the same for both formats so shaders only differ in decoding
   const uint32_t vertexFormatCount = 4;
   OpalFormat vertexFormats[vertexFormatCount] = {
     Opal_Format_RGB32, // Position
     Opal_Format_RG32, // Uv
     Opal_Format_RGB32, // Normal
-    Opal_Format_RGB32, // Tangent
+    Opal_Format_RGBA32, // Tangent, bitangent sign
   };
 
+#ifdef QTZ_OPAL_EXTENDED_FORMATS
+  if (vertexFormat == Quartz_Vertex_Format_Compact)
+  {
+    vertexFormats[0] = Opal_Format_RGBA16; // Position, bitangent sign
+    vertexFormats[1] = Opal_Format_RG16;   // Uv
+    vertexFormats[2] = Opal_Format_RG16;   // Octahedral normal
+    vertexFormats[3] = Opal_Format_RG16;   // Octahedral tangent
+  }
+#endif // QTZ_OPAL_EXTENDED_FORMATS
+
   OpalInitInfo opalInfo;
 #ifdef QTZ_CONFIG_DEBUG
   opalInfo.useDebug = true;
@@ -271,6 +294,7 @@ QuartzResult Renderer::StartFrame()
       return Quartz_Failure;
   }
 
+  ReleaseRetired(false);
   return Quartz_Success;
 }
 
@@ -278,9 +302,75 @@ QuartzResult Renderer::EndFrame()
 {
   QTZ_ATTEMPT_OPAL(OpalRenderToWindowEnd(&m_window));
   imageIndex = (imageIndex + 1) % m_framebuffers.size();
+  m_frameCount++;
   return Quartz_Success;
 }
 
+void Renderer::Retire(OpalImage image)
+{
+  m_retiredImages.push_back({ m_frameCount, image });
+}
+
+void Renderer::Retire(OpalShaderInput inputSet)
+{
+  m_retiredInputSets.push_back({ m_frameCount, inputSet });
+}
+
+void Renderer::Retire(OpalMesh mesh)
+{
+  m_retiredMeshes.push_back({ m_frameCount, mesh });
+}
+
+// Retired while frame n was recorded or before it started, so n is the last frame that can use it
+// Beginning frame n + frames in flight + 1 has waited on n's slot
+void Renderer::ReleaseRetired(bool all)
+{
+  const uint64_t framesInFlight = m_framebuffers.size();
+  auto IsComplete = [&](uint64_t frame) { return all || m_frameCount > frame + framesInFlight; };
+
+  uint32_t kept = 0;
+  for (auto& retired : m_retiredImages)
+  {
+    if (IsComplete(retired.first))
+    {
+      OpalImageShutdown(&retired.second);
+    }
+    else
+    {
+      m_retiredImages[kept++] = retired;
+    }
+  }
+  m_retiredImages.resize(kept);
+
+  kept = 0;
+  for (auto& retired : m_retiredInputSets)
+  {
+    if (IsComplete(retired.first))
+    {
+      OpalShaderInputShutdown(&retired.second);
+    }
+    else
+    {
+      m_retiredInputSets[kept++] = retired;
+    }
+  }
+  m_retiredInputSets.resize(kept);
+
+  kept = 0;
+  for (auto& retired : m_retiredMeshes)
+  {
+    if (IsComplete(retired.first))
+    {
+      OpalMeshShutdown(&retired.second);
+    }
+    else
+    {
+      m_retiredMeshes[kept++] = retired;
+    }
+  }
+  m_retiredMeshes.resize(kept);
+}
+
 void Renderer::StartSceneRender()
 {
   OpalRenderRenderpassBegin(&m_renderpass, &m_framebuffers[imageIndex]);
@@ -301,11 +391,34 @@ void Renderer::EndImguiRender()
   OpalRenderRenderpassEnd(&m_imguiRenderpass);
 }
 
-QuartzResult Renderer::Render(Renderable* renderable)
+QuartzResult Renderer::Render(Renderable* renderable, uint32_t lod)
+{
+  Mesh* mesh = g_coreState.assets.Get(renderable->mesh);
+  if (mesh == nullptr)
+  {
+    QTZ_ERROR("Attempting to render a stale mesh handle");
+    return Quartz_Failure;
+  }
+
+  renderable->material->Bind();
+  OpalRenderSetPushConstant((void*)&renderable->transformMatrix);
+  mesh->Render(lod);
+
+  return Quartz_Success;
+}
+
+QuartzResult Renderer::Render(Renderable* renderable, const MeshDrawCommand* commands, uint32_t commandCount)
 {
+  Mesh* mesh = g_coreState.assets.Get(renderable->mesh);
+  if (mesh == nullptr)
+  {
+    QTZ_ERROR("Attempting to render a stale mesh handle");
+    return Quartz_Failure;
+  }
+
   renderable->material->Bind();
   OpalRenderSetPushConstant((void*)&renderable->transformMatrix);
-  renderable->mesh->Render();
+  mesh->Render(commands, commandCount);
 
   return Quartz_Success;
 }
@@ -316,6 +429,9 @@ void Renderer::Shutdown()
   ImGui_ImplVulkan_Shutdown();
   ImGui_ImplWin32_Shutdown();
 
+  // CoreShutdown() has already waited for the gpu
+  ReleaseRetired(true);
+
   OpalBufferShutdown(&m_sceneBuffer);
   OpalShaderInputLayoutShutdown(&m_sceneLayout);
   OpalShaderInputShutdown(&m_sceneSet);
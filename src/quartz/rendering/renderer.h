@@ -35,7 +35,7 @@ struct alignas(16) ScenePacket
 class Renderer
 {
 public:
-  QuartzResult Init(Window* window);
+  QuartzResult Init(Window* window, QuartzVertexFormat vertexFormat = Quartz_Vertex_Format_Full);
   void Shutdown();
 
   QuartzResult StartFrame();
@@ -45,20 +45,31 @@ public:
   void StartImguiRender();
   void EndImguiRender();
 
-  QuartzResult Render(Renderable* renderable);
+  QuartzResult Render(Renderable* renderable, uint32_t lod = 0);
+  // Draws ranges of the full detail level, such as the visible meshlets
+  QuartzResult Render(Renderable* renderable, const MeshDrawCommand* commands, uint32_t commandCount);
 
   static OpalShaderInputLayout SceneLayout() { return m_sceneLayout; }
   static OpalShaderInput* SceneSet() { return &m_sceneSet; }
+  static QuartzVertexFormat VertexFormat() { return m_vertexFormat; }
 
   QuartzResult PushSceneData(ScenePacket* sceneInfo);
 
   QuartzResult Resize(uint32_t width, uint32_t height);
 
+  // Released once every frame that may still be using them has completed, rather than waiting for the gpu to idle
+  // Opal keeps at most one frame in flight per swapchain image
+  void Retire(OpalImage image);
+  void Retire(OpalShaderInput inputSet);
+  void Retire(OpalMesh mesh);
+
   OpalShaderInputLayout GetSingleImageLayout() const { return m_imguiImageLayout; }
   OpalRenderpass GetRenderpass() const { return m_renderpass; } // TODO : Replace for flexibility
 
 private:
   QuartzResult InitImgui();
+  // Everything retired before the frames in flight, or all of it once the gpu is idle
+  void ReleaseRetired(bool all);
 
 private:
   Window* m_qWindow;
@@ -68,10 +79,17 @@ private:
   Texture m_depthTexture;
 
   uint32_t imageIndex;
+  uint64_t m_frameCount = 0; // Frames ended
+
+  // Each with m_frameCount when it was retired
+  std::vector<std::pair<uint64_t, OpalImage>> m_retiredImages;
+  std::vector<std::pair<uint64_t, OpalShaderInput>> m_retiredInputSets;
+  std::vector<std::pair<uint64_t, OpalMesh>> m_retiredMeshes;
 
   OpalRenderpass m_renderpass;
   std::vector<OpalFramebuffer> m_framebuffers;
 
+  static QuartzVertexFormat m_vertexFormat;
   static OpalShaderInputLayout m_sceneLayout;
   static OpalShaderInput m_sceneSet;
   OpalBuffer m_sceneBuffer;
@@ -0,0 +1,31 @@
+// Diffuse irradiance from a skybox's spherical harmonics (TextureSkybox::GetIrradianceInput() in sh mode)
+// The uniform block matches Quartz::ShIrradiance, rgb in xyz and w unused
+//   #define QUARTZ_SH_IRRADIANCE_SET / QUARTZ_SH_IRRADIANCE_BINDING before including to place the block
+
+#ifndef QUARTZ_SH_IRRADIANCE_GLSL
+#define QUARTZ_SH_IRRADIANCE_GLSL
+
+#ifndef QUARTZ_SH_IRRADIANCE_SET
+#define QUARTZ_SH_IRRADIANCE_SET 0
+#endif
+#ifndef QUARTZ_SH_IRRADIANCE_BINDING
+#define QUARTZ_SH_IRRADIANCE_BINDING 0
+#endif
+
+layout(set = QUARTZ_SH_IRRADIANCE_SET, binding = QUARTZ_SH_IRRADIANCE_BINDING) uniform QuartzShIrradianceBlock
+{
+  vec4 coefficients[9];
+} quartzShIrradiance;
+
+// n is a unit direction in the skybox's space, y up
+vec3 QuartzShIrradiance(vec3 n)
+{
+  vec4 c[9] = quartzShIrradiance.coefficients;
+  vec3 result = c[0].rgb;
+  result += c[1].rgb * n.y + c[2].rgb * n.z + c[3].rgb * n.x;
+  result += c[4].rgb * (n.x * n.y) + c[5].rgb * (n.y * n.z) + c[6].rgb * (3.0 * n.z * n.z - 1.0);
+  result += c[7].rgb * (n.x * n.z) + c[8].rgb * (n.x * n.x - n.y * n.y);
+  return max(result, vec3(0.0));
+}
+
+#endif // QUARTZ_SH_IRRADIANCE_GLSL
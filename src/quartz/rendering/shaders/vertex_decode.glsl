@@ -0,0 +1,26 @@
+// Decoding for Quartz_Vertex_Format_Compact
+// Attribute locations match the full format :
+//   0 : vec4 position (xyz) + bitangent sign (w)
+//   1 : vec2 uv
+//   2 : vec2 octahedral normal
+//   3 : vec2 octahedral tangent
+// The full format's tangent attribute is a vec4 holding the bitangent sign in w
+
+#ifndef QUARTZ_VERTEX_DECODE_GLSL
+#define QUARTZ_VERTEX_DECODE_GLSL
+
+vec3 QuartzOctDecode(vec2 e)
+{
+  vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+vec3 QuartzDecodeBitangent(vec3 normal, vec3 tangent, float bitangentSign)
+{
+  return cross(normal, tangent) * (bitangentSign < 0.0 ? -1.0 : 1.0);
+}
+
+#endif // QUARTZ_VERTEX_DECODE_GLSL
@@ -0,0 +1,188 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/jobs.h"
+#include "quartz/rendering/specular_prefilter.h"
+#include "quartz/rendering/texture_format.h"
+
+#include <math.h>
+#include <vector>
+
+namespace Quartz
+{
+
+static const uint32_t g_rowsPerBatch = 2;
+static const float g_pi = 3.14159265358979f;
+
+// Samples
+// ============================================================
+
+// A reflected direction in a tangent frame, z is along the normal and is also its n.l weight
+struct PrefilterSample
+{
+  float x, y, z;
+};
+
+// Point i of count, the second coordinate is i with its bits reversed (the Van der Corput sequence)
+static void Hammersley(uint32_t i, uint32_t count, float* outU, float* outV)
+{
+  uint32_t bits = i;
+  bits = (bits << 16u) | (bits >> 16u);
+  bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+  bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+  bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+  bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+  *outU = (float)i / (float)count;
+  *outV = (float)bits * 2.3283064365386963e-10f; // 1 / 2^32
+}
+
+// Half vectors only depend on the roughness, so every texel of a level reflects the same set
+// Samples below the horizon carry no weight and are dropped here instead of per texel
+static std::vector<PrefilterSample> GatherSamples(float roughness)
+{
+  const float a = roughness * roughness;
+
+  std::vector<PrefilterSample> samples;
+  for (uint32_t i = 0; i < QTZ_SPECULAR_PREFILTER_SAMPLE_COUNT; i++)
+  {
+    float u, v;
+    Hammersley(i, QTZ_SPECULAR_PREFILTER_SAMPLE_COUNT, &u, &v);
+
+    const float phi = 2.0f * g_pi * u;
+    const float cosTheta = sqrtf((1.0f - v) / (1.0f + (a * a - 1.0f) * v));
+    const float sinTheta = sqrtf(PeriMax(1.0f - cosTheta * cosTheta, 0.0f));
+
+    // l = 2 (v.h) h - v, with v = n = +z
+    const PrefilterSample l = {
+      2.0f * cosTheta * cosf(phi) * sinTheta,
+      2.0f * cosTheta * sinf(phi) * sinTheta,
+      2.0f * cosTheta * cosTheta - 1.0f };
+    if (l.z > 0.0f)
+    {
+      samples.push_back(l);
+    }
+
+    // A mirror reflects every sample along the normal
+    if (roughness == 0.0f)
+    {
+      break;
+    }
+  }
+  return samples;
+}
+
+// A sample's tap in one row, its v and the weights of the two rows it reads are shared by every texel of the row
+struct PrefilterTap
+{
+  float u;
+  uint32_t y0, y1;
+  float fy;
+  float weight;
+};
+
+// Prefiltering
+// ============================================================
+
+QuartzResult PrefilterSpecularGgx(
+  const float* pixels,
+  Vec2U sourceExtents,
+  Vec2U extents,
+  uint32_t levelCount,
+  std::vector<Vec4>* outPixels)
+{
+  if (sourceExtents.width == 0 || sourceExtents.height == 0 || extents.width == 0 || extents.height == 0 || levelCount == 0)
+  {
+    QTZ_ERROR("Specular prefiltering needs a source image and at least one level");
+    return Quartz_Failure;
+  }
+
+  uint64_t pixelCount = 0;
+  for (uint32_t i = 0; i < levelCount; i++)
+  {
+    const Vec2U levelExtents = MipExtents(extents, i);
+    pixelCount += (uint64_t)levelExtents.width * levelExtents.height;
+  }
+  outPixels->resize(pixelCount);
+
+  Vec4* levelPixels = outPixels->data();
+  for (uint32_t i = 0; i < levelCount; i++)
+  {
+    const Vec2U levelExtents = MipExtents(extents, i);
+    const float roughness = (levelCount > 1) ? (float)i / (float)(levelCount - 1) : 0.0f;
+    const std::vector<PrefilterSample> samples = GatherSamples(roughness);
+
+    ParallelForRange(levelExtents.height, g_rowsPerBatch, [&](uint32_t begin, uint32_t end)
+    {
+      std::vector<PrefilterTap> taps(samples.size());
+      for (uint32_t y = begin; y < end; y++)
+      {
+        // Row 0 is the top of the image, looking straight up
+        const float latitude = (0.5f - ((y + 0.5f) / levelExtents.height)) * g_pi;
+        const float cl = cosf(latitude);
+        const float sl = sinf(latitude);
+
+        // Placed at longitude 0 in the shader's frame : tangent = normalize(cross(+z, n)), bitangent = cross(n, tangent)
+        const float n[3] = { cl, sl, 0.0f };
+        const float t[3] = { -sl, cl, 0.0f };
+        const float b[3] = { 0.0f, 0.0f, 1.0f };
+        for (size_t k = 0; k < samples.size(); k++)
+        {
+          const PrefilterSample& s = samples[k];
+          const float lx = t[0] * s.x + b[0] * s.y + n[0] * s.z;
+          const float ly = t[1] * s.x + b[1] * s.y + n[1] * s.z;
+          const float lz = t[2] * s.x + b[2] * s.y + n[2] * s.z;
+
+          const float v = 0.5f - asinf(PeriMin(PeriMax(ly, -1.0f), 1.0f)) / g_pi;
+          const float sourceY = v * sourceExtents.height - 0.5f;
+          const float yFloor = floorf(sourceY);
+
+          PrefilterTap& tap = taps[k];
+          tap.u = atan2f(lz, lx) * (0.5f / g_pi) + 0.5f;
+          tap.y0 = (uint32_t)PeriMin(PeriMax((int32_t)yFloor, 0), (int32_t)sourceExtents.height - 1);
+          tap.y1 = (uint32_t)PeriMin(PeriMax((int32_t)yFloor + 1, 0), (int32_t)sourceExtents.height - 1);
+          tap.fy = sourceY - yFloor;
+          tap.weight = s.z;
+        }
+
+        Vec4* row = levelPixels + (uint64_t)levelExtents.width * y;
+        for (uint32_t x = 0; x < levelExtents.width; x++)
+        {
+          // Turning about the vertical axis only moves u
+          const float longitudeU = ((x + 0.5f) / levelExtents.width) - 0.5f;
+
+          float color[3] = { 0.0f, 0.0f, 0.0f };
+          float totalWeight = 0.0f;
+          for (const PrefilterTap& tap : taps)
+          {
+            float u = tap.u + longitudeU;
+            u = (u < 0.0f) ? u + 1.0f : ((u >= 1.0f) ? u - 1.0f : u);
+
+            // Bilinear like the base image's sampler, clamped to the edges
+            const float sourceX = u * sourceExtents.width - 0.5f;
+            const float xFloor = floorf(sourceX);
+            const float fx = sourceX - xFloor;
+            const uint32_t x0 = (uint32_t)PeriMin(PeriMax((int32_t)xFloor, 0), (int32_t)sourceExtents.width - 1);
+            const uint32_t x1 = (uint32_t)PeriMin((int32_t)xFloor + 1, (int32_t)sourceExtents.width - 1);
+
+            const float* top = pixels + 4 * (uint64_t)tap.y0 * sourceExtents.width;
+            const float* bottom = pixels + 4 * (uint64_t)tap.y1 * sourceExtents.width;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+              const float upper = top[4 * x0 + c] + (top[4 * x1 + c] - top[4 * x0 + c]) * fx;
+              const float lower = bottom[4 * x0 + c] + (bottom[4 * x1 + c] - bottom[4 * x0 + c]) * fx;
+              color[c] += (upper + (lower - upper) * tap.fy) * tap.weight;
+            }
+            totalWeight += tap.weight;
+          }
+
+          row[x] = Vec4{ color[0] / totalWeight, color[1] / totalWeight, color[2] / totalWeight, 1.0f };
+        }
+      }
+    });
+
+    levelPixels += (uint64_t)levelExtents.width * levelExtents.height;
+  }
+
+  return Quartz_Success;
+}
+
+} // namespace Quartz
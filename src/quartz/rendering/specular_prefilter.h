@@ -0,0 +1,32 @@
+#pragma once
+
+#include "quartz/defines.h"
+
+#include <vector>
+
+namespace Quartz
+{
+
+// Specular prefiltering
+// ============================================================
+// The skybox's specular pass on the cpu, so the cooker can precompute it without a gpu
+// GGX importance sampling with the split sum's n = v = r, level i of n is convolved at roughness i / (n - 1)
+// Every texel takes the shader's 4096 Hammersley samples weighted by n.l, with bilinear taps clamped to the source's edges
+// A row places its samples once and turns them about the vertical axis for each texel, which only offsets u
+//   The shader builds a frame per texel instead, the two differ by sampling noise
+//
+// Directions follow the skybox's equirectangular mapping (see quartz/rendering/spherical_harmonics.h)
+
+#define QTZ_SPECULAR_PREFILTER_SAMPLE_COUNT 4096
+
+// pixels : RGBA32 source image
+// extents : Size of the first level, level i is MipExtents(extents, i)
+// outPixels : Every level back to back, largest first. Rows are convolved in parallel across the job workers
+QuartzResult PrefilterSpecularGgx(
+  const float* pixels,
+  Vec2U sourceExtents,
+  Vec2U extents,
+  uint32_t levelCount,
+  std::vector<Vec4>* outPixels);
+
+} // namespace Quartz
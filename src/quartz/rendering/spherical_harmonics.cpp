@@ -0,0 +1,290 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/half.h"
+#include "quartz/core/jobs.h"
+#include "quartz/rendering/spherical_harmonics.h"
+
+#include <math.h>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define QTZ_SH_SSE2
+#endif
+
+namespace Quartz
+{
+
+static const uint32_t g_rowsPerBatch = 16;
+static const double g_pi = 3.14159265358979323846;
+
+// Basis constants of the first three bands
+static const double g_shY0 = 0.282094792; // 1 / (2 sqrt(pi))
+static const double g_shY1 = 0.488602512; // sqrt(3 / (4 pi))
+static const double g_shY2 = 1.092548431; // sqrt(15 / (4 pi))
+static const double g_shY20 = 0.315391565; // sqrt(5 / (16 pi))
+static const double g_shY22 = 0.546274215; // sqrt(15 / (16 pi))
+
+// Cosine lobe convolution per band, divided by pi to match the diffuse map
+static const double g_bandScale[3] = { 1.0, 2.0 / 3.0, 1.0 / 4.0 };
+
+// Projection
+// ============================================================
+// A texel at longitude p and latitude l has direction (cos l cos p, sin l, cos l sin p)
+// Within a row the latitude is constant, so every basis function is a fixed combination of
+//   1, cos p, sin p, cos^2 p, sin p cos p and sin^2 p : the row accumulates those six moments of its radiance
+//   and combines them into the nine coefficients once
+
+enum ShMoment
+{
+  Sh_Moment_One,
+  Sh_Moment_Cos,
+  Sh_Moment_Sin,
+  Sh_Moment_CosCos,
+  Sh_Moment_SinCos,
+  Sh_Moment_SinSin,
+  Sh_Moment_Count
+};
+
+struct ShColumnTables
+{
+  std::vector<float> weights[Sh_Moment_Count];
+};
+
+struct ShSums
+{
+  double rgb[QTZ_SH_COEFFICIENT_COUNT][3] = {};
+};
+
+// moments[m][c] += sum over the row of weights[m][x] * pixel[x][c]
+static void AccumulateRowMoments(const float* row, uint32_t width, const ShColumnTables& tables, float moments[Sh_Moment_Count][4])
+{
+  uint32_t x = 0;
+
+#ifdef QTZ_SH_SSE2
+  __m128 sums[Sh_Moment_Count];
+  for (uint32_t m = 0; m < Sh_Moment_Count; m++)
+  {
+    sums[m] = _mm_setzero_ps();
+  }
+
+  for (; x < width; x++)
+  {
+    const __m128 pixel = _mm_loadu_ps(row + 4 * x);
+    for (uint32_t m = 0; m < Sh_Moment_Count; m++)
+    {
+      sums[m] = _mm_add_ps(sums[m], _mm_mul_ps(pixel, _mm_set1_ps(tables.weights[m][x])));
+    }
+  }
+
+  for (uint32_t m = 0; m < Sh_Moment_Count; m++)
+  {
+    _mm_storeu_ps(moments[m], sums[m]);
+  }
+#else
+  for (uint32_t m = 0; m < Sh_Moment_Count; m++)
+  {
+    moments[m][0] = moments[m][1] = moments[m][2] = moments[m][3] = 0.0f;
+  }
+#endif // QTZ_SH_SSE2
+
+  for (; x < width; x++)
+  {
+    const float* pixel = row + 4 * x;
+    for (uint32_t m = 0; m < Sh_Moment_Count; m++)
+    {
+      const float weight = tables.weights[m][x];
+      for (uint32_t c = 0; c < 4; c++)
+      {
+        moments[m][c] += pixel[c] * weight;
+      }
+    }
+  }
+}
+
+static void AccumulateRow(const float moments[Sh_Moment_Count][4], double latitude, double weight, ShSums* sums)
+{
+  const double cl = cos(latitude);
+  const double sl = sin(latitude);
+
+  for (uint32_t c = 0; c < 3; c++)
+  {
+    const double one = moments[Sh_Moment_One][c];
+    const double mc = moments[Sh_Moment_Cos][c];
+    const double ms = moments[Sh_Moment_Sin][c];
+    const double mcc = moments[Sh_Moment_CosCos][c];
+    const double msc = moments[Sh_Moment_SinCos][c];
+    const double mss = moments[Sh_Moment_SinSin][c];
+
+    // Integrals of radiance times each basis function's polynomial, constants are applied at the end
+    sums->rgb[0][c] += weight * one;                         // 1
+    sums->rgb[1][c] += weight * sl * one;                    // y
+    sums->rgb[2][c] += weight * cl * ms;                     // z
+    sums->rgb[3][c] += weight * cl * mc;                     // x
+    sums->rgb[4][c] += weight * cl * sl * mc;                // xy
+    sums->rgb[5][c] += weight * sl * cl * ms;                // yz
+    sums->rgb[6][c] += weight * (3.0 * cl * cl * mss - one); // 3z^2 - 1
+    sums->rgb[7][c] += weight * cl * cl * msc;               // xz
+    sums->rgb[8][c] += weight * (cl * cl * mcc - sl * sl * one); // x^2 - y^2
+  }
+}
+
+QuartzResult ProjectIrradianceSh(const void* pixels, TextureFormat format, Vec2U extents, ShIrradiance* outSh)
+{
+  if (format != Texture_Format_RGBA32 && format != Texture_Format_RGBA16F)
+  {
+    QTZ_ERROR("Spherical harmonics can only be projected from RGBA32 or RGBA16F images (format {})", (uint32_t)format);
+    return Quartz_Failure;
+  }
+
+  if (extents.width == 0 || extents.height == 0)
+  {
+    QTZ_ERROR("Spherical harmonics can not be projected from an empty image");
+    return Quartz_Failure;
+  }
+
+  const uint32_t width = extents.width;
+  const uint32_t height = extents.height;
+
+  ShColumnTables tables;
+  for (uint32_t m = 0; m < Sh_Moment_Count; m++)
+  {
+    tables.weights[m].resize(width);
+  }
+  for (uint32_t x = 0; x < width; x++)
+  {
+    const double longitude = (((x + 0.5) / width) - 0.5) * 2.0 * g_pi;
+    const double c = cos(longitude);
+    const double s = sin(longitude);
+    tables.weights[Sh_Moment_One][x] = 1.0f;
+    tables.weights[Sh_Moment_Cos][x] = (float)c;
+    tables.weights[Sh_Moment_Sin][x] = (float)s;
+    tables.weights[Sh_Moment_CosCos][x] = (float)(c * c);
+    tables.weights[Sh_Moment_SinCos][x] = (float)(s * c);
+    tables.weights[Sh_Moment_SinSin][x] = (float)(s * s);
+  }
+
+  // Solid angle of a texel is dp dl cos(l)
+  const double texelArea = (2.0 * g_pi / width) * (g_pi / height);
+
+  // Every batch of rows sums on its own, the batches are added in order so the result does not depend on scheduling
+  const uint32_t batchCount = (height + g_rowsPerBatch - 1) / g_rowsPerBatch;
+  std::vector<ShSums> batchSums(batchCount);
+
+  ParallelForRange(batchCount, 1, [&](uint32_t begin, uint32_t end)
+  {
+    std::vector<float> halfRow;
+    if (format == Texture_Format_RGBA16F)
+    {
+      halfRow.resize(4ull * width);
+    }
+
+    for (uint32_t batch = begin; batch < end; batch++)
+    {
+      const uint32_t lastRow = PeriMin(height, (batch + 1) * g_rowsPerBatch);
+      for (uint32_t y = batch * g_rowsPerBatch; y < lastRow; y++)
+      {
+        const float* row;
+        if (format == Texture_Format_RGBA16F)
+        {
+          HalvesToFloats((const uint16_t*)pixels + 4ull * width * y, halfRow.data(), 4ull * width);
+          row = halfRow.data();
+        }
+        else
+        {
+          row = (const float*)pixels + 4ull * width * y;
+        }
+
+        float moments[Sh_Moment_Count][4];
+        AccumulateRowMoments(row, width, tables, moments);
+
+        // Row 0 is the top of the image, looking straight up
+        const double latitude = (0.5 - ((y + 0.5) / height)) * g_pi;
+        AccumulateRow(moments, latitude, texelArea * cos(latitude), &batchSums[batch]);
+      }
+    }
+  });
+
+  ShSums total;
+  for (const ShSums& sums : batchSums)
+  {
+    for (uint32_t i = 0; i < QTZ_SH_COEFFICIENT_COUNT; i++)
+    {
+      for (uint32_t c = 0; c < 3; c++)
+      {
+        total.rgb[i][c] += sums.rgb[i][c];
+      }
+    }
+  }
+
+  // Each coefficient is projected with its basis constant, then multiplied by it again for evaluation
+  const double basis[QTZ_SH_COEFFICIENT_COUNT] = {
+    g_shY0, g_shY1, g_shY1, g_shY1, g_shY2, g_shY2, g_shY20, g_shY2, g_shY22 };
+  const uint32_t band[QTZ_SH_COEFFICIENT_COUNT] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+  for (uint32_t i = 0; i < QTZ_SH_COEFFICIENT_COUNT; i++)
+  {
+    const double scale = basis[i] * basis[i] * g_bandScale[band[i]];
+    outSh->coefficients[i] = {
+      (float)(total.rgb[i][0] * scale),
+      (float)(total.rgb[i][1] * scale),
+      (float)(total.rgb[i][2] * scale),
+      0.0f };
+  }
+
+  return Quartz_Success;
+}
+
+// Evaluation
+// ============================================================
+
+Vec3 EvaluateIrradianceSh(const ShIrradiance& sh, const Vec3& n)
+{
+  const float basis[QTZ_SH_COEFFICIENT_COUNT] = {
+    1.0f,
+    n.y,
+    n.z,
+    n.x,
+    n.x * n.y,
+    n.y * n.z,
+    3.0f * n.z * n.z - 1.0f,
+    n.x * n.z,
+    n.x * n.x - n.y * n.y };
+
+  Vec3 result = { 0.0f, 0.0f, 0.0f };
+  for (uint32_t i = 0; i < QTZ_SH_COEFFICIENT_COUNT; i++)
+  {
+    result.x += sh.coefficients[i].x * basis[i];
+    result.y += sh.coefficients[i].y * basis[i];
+    result.z += sh.coefficients[i].z * basis[i];
+  }
+  return result;
+}
+
+void EvaluateIrradianceShMap(const ShIrradiance& sh, Vec2U extents, Vec4* outPixels)
+{
+  const uint32_t width = extents.width;
+  const uint32_t height = extents.height;
+
+  ParallelForRange(height, g_rowsPerBatch, [&](uint32_t begin, uint32_t end)
+  {
+    for (uint32_t y = begin; y < end; y++)
+    {
+      const double latitude = (0.5 - ((y + 0.5) / height)) * g_pi;
+      const float cl = (float)cos(latitude);
+      const float sl = (float)sin(latitude);
+
+      Vec4* row = outPixels + (uint64_t)width * y;
+      for (uint32_t x = 0; x < width; x++)
+      {
+        const double longitude = (((x + 0.5) / width) - 0.5) * 2.0 * g_pi;
+        const Vec3 direction = { cl * (float)cos(longitude), sl, cl * (float)sin(longitude) };
+        // Three bands ring below zero opposite very bright lights
+        const Vec3 irradiance = EvaluateIrradianceSh(sh, direction);
+        row[x] = Vec4{ PeriMax(irradiance.x, 0.0f), PeriMax(irradiance.y, 0.0f), PeriMax(irradiance.z, 0.0f), 1.0f };
+      }
+    }
+  });
+}
+
+} // namespace Quartz
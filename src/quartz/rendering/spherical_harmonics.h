@@ -0,0 +1,36 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/texture_format.h"
+
+namespace Quartz
+{
+
+// Spherical harmonic irradiance
+// ============================================================
+// Diffuse lighting from an environment as the first three SH bands (Ramamoorthi & Hanrahan)
+// Runs on the CPU, needs no gpu and takes a few milliseconds where the diffuse convolution pass renders a whole map
+//
+// Directions follow the skybox's equirectangular mapping : y is up, u = 0.5 faces +x, u = 0.75 faces +z
+
+#define QTZ_SH_COEFFICIENT_COUNT 9
+
+// Already convolved with the cosine lobe, divided by pi and scaled by the basis constants
+// The diffuse map's value in unit direction n is :
+//   c[0] + c[1] n.y + c[2] n.z + c[3] n.x
+//   + c[4] n.x n.y + c[5] n.y n.z + c[6] (3 n.z^2 - 1) + c[7] n.x n.z + c[8] (n.x^2 - n.y^2)
+struct ShIrradiance
+{
+  Vec4 coefficients[QTZ_SH_COEFFICIENT_COUNT]; // RGB, w is padding so the array matches a std140 uniform block
+};
+
+// Projects an equirectangular RGBA32 or RGBA16F image, every texel weighted by its solid angle
+// Rows are reduced in parallel across the job workers, texels are accumulated four channels at a time with SSE2
+QuartzResult ProjectIrradianceSh(const void* pixels, TextureFormat format, Vec2U extents, ShIrradiance* outSh);
+
+Vec3 EvaluateIrradianceSh(const ShIrradiance& sh, const Vec3& direction);
+
+// Renders the coefficients into an equirectangular diffuse map, rows are evaluated in parallel across the job workers
+void EvaluateIrradianceShMap(const ShIrradiance& sh, Vec2U extents, Vec4* outPixels);
+
+} // namespace Quartz
@@ -4,6 +4,9 @@
 #include "quartz/platform/filesystem/filesystem.h"
 #include "quartz/rendering/renderer.h"
 #include "quartz/core/core.h"
+#include "quartz/core/half.h"
+#include "quartz/core/pixel_convert.h"
+#include "quartz/assets/exr_loader.h"
 
 #define STBI_SUPPORT_ZLIB
 #define STB_IMAGE_IMPLEMENTATION
@@ -12,11 +15,6 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
 
-#define TINYEXR_USE_MINIZ 0
-#define TINYEXR_USE_STB_ZLIB 1
-#define TINYEXR_IMPLEMENTATION
-#include <tinyexr.h>
-
 namespace Quartz
 {
 
@@ -24,12 +22,48 @@ QuartzResult Texture::Init()
 {
   QTZ_ATTEMPT(InitOpalImage());
 
+  m_isValid = true;
   return Quartz_Success;
 }
 
 // Loaded
 // ============================================================
 
+static bool IsCookedPath(const char* path)
+{
+  const size_t extensionLength = sizeof(QTEX_EXTENSION) - 1;
+  size_t length = strlen(path);
+  return length >= extensionLength && strcmp(path + length - extensionLength, QTEX_EXTENSION) == 0;
+}
+
+static void ReleaseDecodeData(TextureDecodeData* data)
+{
+  free(data->pixels);
+  data->pixels = nullptr;
+  if (data->cooked.header != nullptr)
+  {
+    CloseQTex(&data->cooked);
+  }
+}
+
+// Where each decoded level's texels are, cooked levels stored uncompressed point into the mapped file
+// Starts at the first level held, levels left for the streamer are skipped
+static void DecodedLevelPixels(const TextureDecodeData& data, TextureFormat format, const void** outLevelPixels)
+{
+  const uint8_t* decoded = (const uint8_t*)data.pixels;
+  for (uint32_t i = data.firstLevel; i < data.levelCount; i++)
+  {
+    if (data.cooked.header != nullptr && data.cooked.header->levels[i].compression == QTex_Compression_None)
+    {
+      outLevelPixels[i - data.firstLevel] = data.cooked.Level(i);
+      continue;
+    }
+
+    outLevelPixels[i - data.firstLevel] = decoded;
+    decoded += TextureLevelSize(format, MipExtents(data.extents, i));
+  }
+}
+
 QuartzResult Texture::Init(const char* path)
 {
   if (m_isValid)
@@ -38,24 +72,65 @@ QuartzResult Texture::Init(const char* path)
     return Quartz_Success;
   }
 
-  int32_t width, height;
-  void* pixels;
+  TextureDecodeData data;
+  QTZ_ATTEMPT(Decode(path, &data));
+  return Init(&data);
+}
+
+QuartzResult Texture::Decode(const char* path, TextureDecodeData* outData)
+{
+  if (IsCookedPath(path))
+  {
+    return LoadCooked(path, false, outData);
+  }
+
+  if (IsBlockCompressed(format))
+  {
+    QTZ_ERROR("Block compressed textures are cooked offline, \"{}\" is not a cooked texture", path);
+    return Quartz_Failure;
+  }
 
   if (format == Texture_Format_RGBA8)
   {
-    QTZ_ATTEMPT(Load8BitImage(path, &width, &height, &pixels));
+    int32_t width, height;
+    QTZ_ATTEMPT(Load8BitImage(path, &width, &height, &outData->pixels));
+    outData->extents = Vec2U{ (uint32_t)width, (uint32_t)height };
   }
   else
   {
-    QTZ_ATTEMPT(Load32BitImage(path, &width, &height, &pixels));
+    QTZ_ATTEMPT(LoadExr(path, format, &outData->extents, &outData->pixels));
   }
 
-  extents = Vec2U{ (uint32_t)width, (uint32_t)height };
-  QTZ_ATTEMPT(InitOpalImage());
-  QTZ_ATTEMPT(FillImage(pixels));
+  outData->levelCount = 1;
+  return Quartz_Success;
+}
 
-  free(pixels);
+QuartzResult Texture::Init(TextureDecodeData* data)
+{
+  if (m_isValid)
+  {
+    QTZ_WARNING("Attempting to intialize a valid texture");
+    ReleaseDecodeData(data);
+    return Quartz_Success;
+  }
+
+  const void* levelPixels[QTEX_MAX_LEVELS];
+  DecodedLevelPixels(*data, format, levelPixels);
 
+  extents = data->extents;
+  m_residentLevel = data->firstLevel;
+  QTZ_ATTEMPT(InitOpalImage(), ReleaseDecodeData(data));
+  if (data->levelCount > 1)
+  {
+    QTZ_ATTEMPT(FillLevels(levelPixels, data->levelCount - data->firstLevel), ReleaseDecodeData(data), ShutdownOpalImage());
+  }
+  else
+  {
+    QTZ_ATTEMPT(FillImage(levelPixels[0]), ReleaseDecodeData(data), ShutdownOpalImage());
+  }
+
+  ReleaseDecodeData(data);
+  m_isValid = true;
   return Quartz_Success;
 }
 
@@ -83,59 +158,73 @@ QuartzResult Texture::Load8BitImage(const char* path, int32_t* outWidth, int32_t
   return Quartz_Success;
 }
 
-QuartzResult Texture::Load32BitImage(const char* path, int32_t* outWidth, int32_t* outHeight, void** outPixels)
+QuartzResult Texture::InitFromCooked(const char* path)
 {
-  float* pixelData = nullptr;
-  int width = 0, height = 0;
-  const char* err;
-
-  if (LoadEXR(&pixelData, &width, &height, path, &err) || width <= 0 || height <= 0 || pixelData == nullptr)
+  if (m_isValid)
   {
-    QTZ_ERROR("Failed to load 32-bit image \"{}\"\n    Width: {} -- Height: {} -- Channels: {}\n    Error: {}", path, width, height, 4, err);
-    width = 0;
-    return Quartz_Failure;
+    QTZ_WARNING("Attempting to intialize a valid texture");
+    return Quartz_Success;
   }
 
-  *outWidth = width;
-  *outHeight = height;
-  *outPixels = pixelData;
-  return Quartz_Success;
+  TextureDecodeData data;
+  QTZ_ATTEMPT(LoadCooked(path, true, &data));
+  return Init(&data);
 }
 
-QuartzResult Texture::InitFromDump(const char* path)
+// Sampling (usage, filtering and sample mode) is only taken from the file when requested
+//   textures decoded through Decode() keep the caller's
+QuartzResult Texture::LoadCooked(const char* path, bool includeSampling, TextureDecodeData* outData)
 {
-  if (m_isValid)
+  QTexFile cooked;
+  QTZ_ATTEMPT(OpenQTex(path, &cooked));
+  const QTexHeader* header = cooked.header;
+
+  // Levels over the stream extent are left on disk, the smallest level is always loaded
+  uint32_t firstLevel = 0;
+  while (outData->streamExtent > 0
+    && firstLevel + 1 < header->levelCount
+    && PeriMax(header->levels[firstLevel].width, header->levels[firstLevel].height) > outData->streamExtent)
   {
-    QTZ_WARNING("Attempting to intialize a valid texture");
-    return Quartz_Success;
+    firstLevel++;
   }
 
-  FILE* inFile;
-  errno_t error = fopen_s(&inFile, path, "rb");
-
-  if (error)
+  // Supercompressed levels are decompressed back to back, the rest stay in the mapping until the upload
+  uint64_t decompressedSize = 0;
+  for (uint32_t i = firstLevel; i < header->levelCount; i++)
   {
-    QTZ_ERROR("Failed to load texture dump \"{}\"", path);
-    return Quartz_Failure;
+    decompressedSize += (header->levels[i].compression != QTex_Compression_None) ? header->levels[i].size : 0;
   }
 
-  fread(&format,     sizeof(format),     1, inFile);
-  fread(&usage,      sizeof(usage),      1, inFile);
-  fread(&filtering,  sizeof(filtering),  1, inFile);
-  fread(&sampleMode, sizeof(sampleMode), 1, inFile);
-  fread(&mipLevels,  sizeof(mipLevels),  1, inFile);
-  fread(&extents,    sizeof(extents),    1, inFile);
-
-  uint64_t size;
-  fread(&size, sizeof(size), 1, inFile);
-  void* pixels = malloc(size);
-  fread(pixels, size, 1, inFile);
-
-  QTZ_ATTEMPT(Init(pixels));
+  uint8_t* pixels = nullptr;
+  if (decompressedSize > 0)
+  {
+    pixels = (uint8_t*)malloc(decompressedSize);
+    uint8_t* levelOut = pixels;
+    for (uint32_t i = firstLevel; i < header->levelCount; i++)
+    {
+      if (header->levels[i].compression != QTex_Compression_None)
+      {
+        QTZ_ATTEMPT(DecompressQTexLevel(cooked, i, levelOut), free(pixels), CloseQTex(&cooked));
+        levelOut += header->levels[i].size;
+      }
+    }
+  }
 
-  free(pixels);
-  fclose(inFile);
+  format = (TextureFormat)header->format;
+  // Single level files leave the rest of the chain to the gpu
+  mipLevels = (header->levelCount > 1) ? header->levelCount : 0;
+  if (includeSampling)
+  {
+    usage = (TextureUsageFlags)header->usage;
+    filtering = (TextureFilterMode)header->filtering;
+    sampleMode = (TextureSampleMode)header->sampleMode;
+  }
 
+  outData->extents = Vec2U{ header->levels[0].width, header->levels[0].height };
+  outData->pixels = pixels;
+  outData->levelCount = header->levelCount;
+  outData->firstLevel = firstLevel;
+  outData->cooked = cooked;
   return Quartz_Success;
 }
 
@@ -145,8 +234,9 @@ QuartzResult Texture::InitFromDump(const char* path)
 QuartzResult Texture::Init(const void* pixels)
 {
   QTZ_ATTEMPT(InitOpalImage());
-  QTZ_ATTEMPT(FillImage(pixels));
+  QTZ_ATTEMPT(FillImage(pixels), ShutdownOpalImage());
 
+  m_isValid = true;
   return Quartz_Success;
 }
 
@@ -158,49 +248,8 @@ QuartzResult Texture::Init(const std::vector<Vec3>& pixels)
     return Quartz_Success;
   }
 
-  void* pixelData;
-  std::vector<Vec4> pixelsRgba32;
-  std::vector<unsigned char> pixels8Bit;
-
-  switch (format)
-  {
-  case Quartz::Texture_Format_RGBA8:
-  {
-    uint32_t count = extents.width * extents.height * 4;
-    pixels8Bit.resize(count);
-
-    for (uint32_t i = 0, channelIndex = 0; i < extents.width * extents.height; i++, channelIndex += 4)
-    {
-      pixels8Bit[channelIndex    ] = (uint8_t)(255 * PeriClamp(pixels[i].x, 0.0f, 1.0f));
-      pixels8Bit[channelIndex + 1] = (uint8_t)(255 * PeriClamp(pixels[i].y, 0.0f, 1.0f));
-      pixels8Bit[channelIndex + 2] = (uint8_t)(255 * PeriClamp(pixels[i].z, 0.0f, 1.0f));
-      pixels8Bit[channelIndex + 3] = (uint8_t)(255);
-    }
-
-    pixelData = (void*)pixels8Bit.data();
-  } break;
-  case Quartz::Texture_Format_RGBA32:
-  {
-    pixelsRgba32.resize(pixels.size());
-
-    for (uint32_t i = 0; i < extents.width * extents.height; i++)
-    {
-      pixelsRgba32[i] = Vec4{ pixels[i].x, pixels[i].y, pixels[i].z, 0.0f };
-    }
-
-    pixelData = (void*)pixelsRgba32.data();
-  } break;
-  default:
-  {
-    QTZ_ERROR("Can not initialize a texture with the given format");
-    return Quartz_Failure;
-  }
-  }
-
-  QTZ_ATTEMPT(InitOpalImage());
-  QTZ_ATTEMPT(FillImage(pixelData));
-
-  return Quartz_Success;
+  static_assert(sizeof(Vec3) == 3 * sizeof(float), "Vec3 pixels are read as packed floats");
+  return InitFromFloats((const float*)pixels.data(), 3, pixels.size());
 }
 
 QuartzResult Texture::Init(const std::vector<Vec4>& pixels)
@@ -211,30 +260,41 @@ QuartzResult Texture::Init(const std::vector<Vec4>& pixels)
     return Quartz_Success;
   }
 
-  void* pixelData;
-  std::vector<Vec3> pixelsRgb32;
-  std::vector<unsigned char> pixels8Bit;
+  static_assert(sizeof(Vec4) == 4 * sizeof(float), "Vec4 pixels are read as packed floats");
+  return InitFromFloats((const float*)pixels.data(), 4, pixels.size());
+}
+
+// RGB pixels are given an opaque alpha
+QuartzResult Texture::InitFromFloats(const float* pixels, uint32_t channelCount, uint64_t pixelCount)
+{
+  const uint64_t count = (uint64_t)extents.width * extents.height;
+  if (pixelCount < count)
+  {
+    QTZ_ERROR("Attempting to initialize a {}x{} texture with {} pixels", extents.width, extents.height, pixelCount);
+    return Quartz_Failure;
+  }
 
+  // Converted into one upload buffer, RGBA32 input is uploaded as is
+  void* converted = nullptr;
   switch (format)
   {
   case Quartz::Texture_Format_RGBA8:
   {
-    uint32_t count = extents.width * extents.height * 4;
-    pixels8Bit.resize(count);
-
-    for (uint32_t i = 0, channelIndex = 0; i < extents.width * extents.height; i++, channelIndex += 4)
-    {
-      pixels8Bit[channelIndex    ] = (uint8_t)(255 * PeriClamp(pixels[i].x, 0.0f, 1.0f));
-      pixels8Bit[channelIndex + 1] = (uint8_t)(255 * PeriClamp(pixels[i].y, 0.0f, 1.0f));
-      pixels8Bit[channelIndex + 2] = (uint8_t)(255 * PeriClamp(pixels[i].z, 0.0f, 1.0f));
-      pixels8Bit[channelIndex + 3] = (uint8_t)(255 * PeriClamp(pixels[i].w, 0.0f, 1.0f));
-    }
-
-    pixelData = (void*)pixels8Bit.data();
+    converted = malloc(count * 4);
+    ConvertToUnorm8(pixels, channelCount, count, Pixel_Convert_None, (uint8_t*)converted);
+  } break;
+  case Quartz::Texture_Format_RGBA16F:
+  {
+    converted = malloc(count * 4 * sizeof(uint16_t));
+    ConvertToHalf(pixels, channelCount, count, Pixel_Convert_None, (uint16_t*)converted);
   } break;
   case Quartz::Texture_Format_RGBA32:
   {
-    pixelData = (void*)pixels.data();
+    if (channelCount != 4)
+    {
+      converted = malloc(count * 4 * sizeof(float));
+      ConvertToFloat(pixels, channelCount, count, Pixel_Convert_None, (float*)converted);
+    }
   } break;
   default:
   {
@@ -243,9 +303,12 @@ QuartzResult Texture::Init(const std::vector<Vec4>& pixels)
   }
   }
 
-  QTZ_ATTEMPT(InitOpalImage());
-  QTZ_ATTEMPT(FillImage(pixelData));
+  const void* pixelData = (converted != nullptr) ? converted : pixels;
+  QTZ_ATTEMPT(InitOpalImage(), free(converted));
+  QTZ_ATTEMPT(FillImage(pixelData), free(converted), ShutdownOpalImage());
 
+  free(converted);
+  m_isValid = true;
   return Quartz_Success;
 }
 
@@ -272,30 +335,91 @@ QuartzResult Texture::Init(OpalImage opalImage)
   return Quartz_Success;
 }
 
+// Without QTZ_OPAL_EXTENDED_FORMATS the pinned Opal has no RGBA16, half float images are held as RGBA32
+TextureFormat Texture::GpuFormatOf(TextureFormat format)
+{
+#ifndef QTZ_OPAL_EXTENDED_FORMATS
+  if (format == Texture_Format_RGBA16F)
+  {
+    return Texture_Format_RGBA32;
+  }
+#endif // !QTZ_OPAL_EXTENDED_FORMATS
+  return format;
+}
+
+OpalFormat Texture::OpalFormatOf(TextureFormat format)
+{
+  // Opal's 16-bit formats are half floats
+  // RGBA16 and the BC formats need an Opal built with them, BC textures map to the matching *_UNORM_BLOCK / BC6H_UFLOAT_BLOCK vulkan formats
+  switch (GpuFormatOf(format))
+  {
+  case Quartz::Texture_Format_RG16:    return Opal_Format_RG16;
+  case Quartz::Texture_Format_RGBA8:   return Opal_Format_RGBA8;
+  case Quartz::Texture_Format_RGBA32:  return Opal_Format_RGBA32;
+  case Quartz::Texture_Format_Depth:   return Opal_Format_D24_S8;
+#ifdef QTZ_OPAL_EXTENDED_FORMATS
+  case Quartz::Texture_Format_RGBA16F: return Opal_Format_RGBA16;
+  case Quartz::Texture_Format_BC1:     return Opal_Format_BC1;
+  case Quartz::Texture_Format_BC3:     return Opal_Format_BC3;
+  case Quartz::Texture_Format_BC4:     return Opal_Format_BC4;
+  case Quartz::Texture_Format_BC5:     return Opal_Format_BC5;
+  case Quartz::Texture_Format_BC6H:    return Opal_Format_BC6H;
+  case Quartz::Texture_Format_BC7:     return Opal_Format_BC7;
+#endif // QTZ_OPAL_EXTENDED_FORMATS
+  default:                             return Opal_Format_RGBA8;
+  }
+}
+
+// Texels are given in the texture's format, widened first when the image holds a wider one
+static QuartzResult PushLevel(OpalImage* image, TextureFormat format, Vec2U levelExtents, const void* pixels)
+{
+  if (Texture::GpuFormatOf(format) == format)
+  {
+    QTZ_ATTEMPT_OPAL(OpalImagePushData(image, pixels));
+    return Quartz_Success;
+  }
+
+  std::vector<float> widened(4ull * levelExtents.width * levelExtents.height);
+  HalvesToFloats((const uint16_t*)pixels, widened.data(), widened.size());
+  QTZ_ATTEMPT_OPAL(OpalImagePushData(image, widened.data()));
+  return Quartz_Success;
+}
+
 QuartzResult Texture::InitOpalImage()
 {
+  // Streamed textures leave their levels above the resident one off the gpu
+  const Vec2U residentExtents = MipExtents(extents, m_residentLevel);
   OpalImageInitInfo info = {};
-  info.width = extents.width;
-  info.height = extents.height;
+  info.width = residentExtents.width;
+  info.height = residentExtents.height;
+
+  if (IsBlockCompressed(format) && (usage & Texture_Usage_Framebuffer))
+  {
+    QTZ_ERROR("Block compressed textures can not be rendered to");
+    return Quartz_Failure;
+  }
+
+#ifndef QTZ_OPAL_EXTENDED_FORMATS
+  if (IsBlockCompressed(format))
+  {
+    QTZ_ERROR("Block compressed textures need an Opal with BC formats (QUARTZ_OPAL_EXTENDED_FORMATS)");
+    return Quartz_Failure;
+  }
+#endif // !QTZ_OPAL_EXTENDED_FORMATS
 
   if (mipLevels == 0)
   {
-    mipLevels = (uint32_t)floor(log2((double)PeriMax(extents.width, extents.height)));
+    // Compressed mips can not be generated with gpu blits, only cooked levels are used
+    mipLevels = IsBlockCompressed(format) ? 1 : (uint32_t)floor(log2((double)PeriMax(extents.width, extents.height)));
   }
-  info.mipCount = mipLevels;
+  info.mipCount = mipLevels - m_residentLevel;
 
   info.usage |= ((usage & Texture_Usage_Shader_Input) != 0) * Opal_Image_Usage_Uniform;
   info.usage |= ((usage & Texture_Usage_Framebuffer) != 0) * Opal_Image_Usage_Output;
   info.usage |= Opal_Image_Usage_Transfer_Dst;
   info.usage |= (info.mipCount > 1) * Opal_Image_Usage_Transfer_Src;
 
-  switch (format)
-  {
-  case Quartz::Texture_Format_RG16:   info.format = Opal_Format_RG16;   break;
-  case Quartz::Texture_Format_RGBA8:  info.format = Opal_Format_RGBA8;  break;
-  case Quartz::Texture_Format_RGBA32: info.format = Opal_Format_RGBA32; break;
-  case Quartz::Texture_Format_Depth:  info.format = Opal_Format_D24_S8; break;
-  }
+  info.format = OpalFormatOf(format);
 
   switch (filtering)
   {
@@ -321,13 +445,34 @@ QuartzResult Texture::InitOpalImage()
     setInfo.layout = g_coreState.renderer.GetSingleImageLayout();
     setInfo.pValues = &inValue;
 
-    QTZ_ATTEMPT_OPAL(OpalShaderInputInit(&m_inputSet, setInfo));
+    QTZ_ATTEMPT_OPAL(OpalShaderInputInit(&m_inputSet, setInfo), OpalImageShutdown(&m_opalImage));
   }
 
-  m_isValid = true;
   return Quartz_Success;
 }
 
+void Texture::Retire()
+{
+  if (!m_isValid)
+  {
+    return;
+  }
+  m_isValid = false;
+
+  g_coreState.renderer.Retire(m_opalImage);
+  g_coreState.renderer.Retire(m_inputSet);
+}
+
+// Releases what InitOpalImage() created when the texture fails before becoming valid
+void Texture::ShutdownOpalImage()
+{
+  OpalImageShutdown(&m_opalImage);
+  if (usage & Texture_Usage_Shader_Input)
+  {
+    OpalShaderInputShutdown(&m_inputSet);
+  }
+}
+
 QuartzResult Texture::FillImage(const void* pixels)
 {
   if (usage & Texture_Usage_Framebuffer)
@@ -336,11 +481,67 @@ QuartzResult Texture::FillImage(const void* pixels)
     return Quartz_Failure;
   }
 
-  QTZ_ATTEMPT_OPAL(OpalImagePushData(&m_opalImage, pixels));
+  QTZ_ATTEMPT(PushLevel(&m_opalImage, format, MipExtents(extents, m_residentLevel), pixels));
 
   return Quartz_Success;
 }
 
+// Uploads precomputed levels one at a time, nothing is generated on the gpu
+QuartzResult Texture::FillLevels(const void* const* levelPixels, uint32_t levelCount)
+{
+  if (usage & Texture_Usage_Framebuffer)
+  {
+    QTZ_ERROR("Can not manually fill a framebuffer texture");
+    return Quartz_Failure;
+  }
+
+  if (levelCount > mipLevels - m_residentLevel)
+  {
+    QTZ_ERROR("Attempting to fill {} mip levels of a texture with {}", levelCount, mipLevels - m_residentLevel);
+    return Quartz_Failure;
+  }
+
+  for (uint32_t i = 0; i < levelCount; i++)
+  {
+    OpalImage mipImage;
+    QTZ_ATTEMPT_OPAL(OpalImageGetMipAsImage(&m_opalImage, &mipImage, i));
+    QTZ_ATTEMPT(PushLevel(&mipImage, format, MipExtents(extents, m_residentLevel + i), levelPixels[i]), OpalImageShutdown(&mipImage));
+    OpalImageShutdown(&mipImage);
+  }
+
+  return Quartz_Success;
+}
+
+QuartzResult Texture::SetResidentLevel(uint32_t firstLevel, const void* const* levelPixels)
+{
+  if (!m_isValid || firstLevel >= mipLevels)
+  {
+    QTZ_ERROR("Attempting to make level {} of a texture with {} levels resident", firstLevel, mipLevels);
+    return Quartz_Failure;
+  }
+
+  // The current image is kept until its replacement is filled
+  OpalImage previousImage = m_opalImage;
+  OpalShaderInput previousSet = m_inputSet;
+  uint32_t previousLevel = m_residentLevel;
+  auto SwapBack = [&]()
+  {
+    std::swap(m_opalImage, previousImage);
+    std::swap(m_inputSet, previousSet);
+    std::swap(m_residentLevel, previousLevel);
+  };
+
+  m_residentLevel = firstLevel;
+  QTZ_ATTEMPT(InitOpalImage(), m_opalImage = previousImage, m_inputSet = previousSet, m_residentLevel = previousLevel);
+  // On failure the new image is the one released
+  QTZ_ATTEMPT(FillLevels(levelPixels, mipLevels - firstLevel), SwapBack(), OpalImageShutdown(&previousImage), OpalShaderInputShutdown(&previousSet));
+
+  // Frames in flight may still be sampling the previous image
+  g_coreState.renderer.Retire(previousImage);
+  g_coreState.renderer.Retire(previousSet);
+  return Quartz_Success;
+}
+
 // Other
 // ============================================================
 
@@ -2,22 +2,26 @@
 
 #include "quartz/defines.h"
 #include "quartz/rendering/defines.h"
+#include "quartz/rendering/buffer.h"
 #include "quartz/rendering/mesh.h"
+#include "quartz/rendering/spherical_harmonics.h"
+#include "quartz/rendering/texture_format.h"
+#include "quartz/assets/qtex.h"
 
 #include <opal.h>
 
+#include <string>
+
 #define STBI_SUPPORT_ZLIB
 #include <stb_image.h>
 
 #include <stb_image_write.h>
 
-#define TINYEXR_USE_MINIZ 0
-#define TINYEXR_USE_STB_ZLIB 1
-#include <tinyexr.h>
-
 namespace Quartz
 {
 
+struct MaterialInput; // quartz/rendering/material.h
+
 enum TextureSampleMode
 {
   Texture_Sample_Wrap,
@@ -31,12 +35,25 @@ enum TextureFilterMode
   Texture_Filter_Nearest
 };
 
-enum TextureFormat
+// Pixels read from a file, ready for upload
+struct TextureDecodeData
+{
+  Vec2U extents;
+  void* pixels = nullptr;
+  uint32_t levelCount = 1; // Mip levels held in pixels, back to back largest first. The gpu generates any others
+  // Open for cooked textures, levels stored uncompressed are uploaded straight from it and are not in pixels
+  QTexFile cooked;
+
+  // Cooked textures only : levels wider or taller than this are left on disk for the texture streamer, 0 loads all of them
+  uint32_t streamExtent = 0;
+  uint32_t firstLevel = 0; // Largest level held, the texture is created with levels [firstLevel, levelCount)
+};
+
+// How a skybox provides diffuse lighting
+enum TextureSkyboxDiffuseMode
 {
-  Texture_Format_RGBA8,
-  Texture_Format_RGBA32,
-  Texture_Format_RG16,
-  Texture_Format_Depth,
+  Skybox_Diffuse_Map, // Convolved equirectangular map, rendered on the gpu
+  Skybox_Diffuse_Sh   // Nine spherical harmonic coefficients projected on the cpu, bound as a uniform buffer instead of a map
 };
 
 enum TextureUsageFlagBits
@@ -52,6 +69,7 @@ class Texture
 friend class Renderer;
 friend class Material;
 friend class TextureSkybox;
+friend class TextureStreamer;
 
   // Variables
   // ============================================================
@@ -68,6 +86,9 @@ private:
   OpalImage         m_opalImage;
   OpalShaderInput   m_inputSet;
   bool              m_isValid   = false;
+  // Streamed textures only hold levels [m_residentLevel, mipLevels) on the gpu
+  uint32_t          m_residentLevel = 0;
+  uint32_t          m_streamingId   = ~0u; // Index of the texture's TextureStreamer entry
 
   // Functions
   // ============================================================
@@ -75,11 +96,16 @@ private:
 public:
   QuartzResult Init();
   QuartzResult Init(const char* path);
+  // Init(path) split in two so files can be decoded on any thread, only Init(data) touches the gpu
+  // Decoding only depends on the texture's format, cooked textures replace the format, extents and mip count with their own
+  QuartzResult Decode(const char* path, TextureDecodeData* outData);
+  QuartzResult Init(TextureDecodeData* data); // Frees the decoded pixels and closes the cooked file
   QuartzResult Init(const void* pixels);
   QuartzResult Init(const std::vector<Vec3>& pixels);
   QuartzResult Init(const std::vector<Vec4>& pixels);
 
-  QuartzResult InitFromDump(const char* path);
+  // Format and sampling are taken from the .qtex file (see quartz/assets/qtex.h)
+  QuartzResult InitFromCooked(const char* path);
 
   // TODO:
   QuartzResult Resize(Vec2U newExtents);
@@ -96,12 +122,25 @@ public:
     OpalImageShutdown(&m_opalImage);
     OpalShaderInputShutdown(&m_inputSet);
   }
+  // Shutdown() for a texture frames in flight may still sample, the renderer releases its image once they complete
+  void Retire();
 
   inline bool IsValid() const
   {
     return m_isValid;
   }
 
+  // Largest mip level on the gpu, only above 0 while a streamed texture's larger levels are on disk
+  inline uint32_t ResidentLevel() const
+  {
+    return m_residentLevel;
+  }
+
+  inline bool IsStreamed() const
+  {
+    return m_streamingId != ~0u;
+  }
+
   inline void* ForImgui() const
   {
     if (!m_isValid || (usage & Texture_Usage_Shader_Input) == 0)
@@ -114,44 +153,101 @@ public:
 
   //uint64_t Dump_Debug(void** outData) const;
 
+  // The format the gpu image is held in, RGBA16F is widened to RGBA32 without QTZ_OPAL_EXTENDED_FORMATS
+  static TextureFormat GpuFormatOf(TextureFormat format);
+
 private:
   QuartzResult Init(OpalImage opalImage);
   QuartzResult Load8BitImage(const char* path, int32_t* outWidth, int32_t* outHeight, void** outPixels);
-  QuartzResult Load32BitImage(const char* path, int32_t* outWidth, int32_t* outHeight, void** outPixels);
-  QuartzResult InitOpalImage();
+  QuartzResult LoadCooked(const char* path, bool includeSampling, TextureDecodeData* outData);
+  QuartzResult InitFromFloats(const float* pixels, uint32_t channelCount, uint64_t pixelCount);
+  QuartzResult InitOpalImage(); // The image and its input set, m_isValid is left to the caller
+  void ShutdownOpalImage();
+  QuartzResult FillLevels(const void* const* levelPixels, uint32_t levelCount);
+  // Replaces the gpu image with one holding levels [firstLevel, mipLevels), levelPixels has one pointer per level
+  // The old image and input set are retired to the renderer, frames in flight may keep sampling them
+  QuartzResult SetResidentLevel(uint32_t firstLevel, const void* const* levelPixels);
+  static OpalFormat OpalFormatOf(TextureFormat format);
 };
 
+// Skybox ibl maps
+// ============================================================
+// Both are equirectangular with the base image's aspect. quartz-cook precomputes them with the same layout,
+//   its diffuse map evaluated from spherical harmonics rather than convolved
+
+#define QTZ_SKYBOX_DIFFUSE_HEIGHT 128
+#define QTZ_SKYBOX_SPECULAR_HEIGHT 512
+#define QTZ_SKYBOX_SPECULAR_LEVEL_COUNT 5 // One per roughness step
+
+// A cooked ibl set sits next to the cooked base image : "sky_env.exr.qtex" has "sky_env.exr.diffuse.qtex" and "sky_env.exr.specular.qtex"
+#define QTZ_SKYBOX_DIFFUSE_EXTENSION ".diffuse" QTEX_EXTENSION
+#define QTZ_SKYBOX_SPECULAR_EXTENSION ".specular" QTEX_EXTENSION
+
+inline Vec2U SkyboxIblExtents(Vec2U baseExtents, uint32_t height)
+{
+  return Vec2U{ (uint32_t)(height * ((float)baseExtents.width / (float)baseExtents.height)), height };
+}
+
 class TextureSkybox
 {
   // Variables
   // ============================================================
 
 public:
-  TextureFormat     baseFormat = Texture_Format_RGBA32;
+  // Half floats by default, HDR environments lose nothing visible at half the memory and bandwidth
+  TextureFormat     baseFormat = Texture_Format_RGBA16F;
+  TextureFormat     iblFormat  = Texture_Format_RGBA16F; // Diffuse and specular maps
   Vec2U             extents = Vec2U{ 1, 1 };
+  // Sh needs the base image's texels on the cpu : cooked base images must be RGBA32 or RGBA16F, otherwise the map is used
+  TextureSkyboxDiffuseMode diffuseMode = Skybox_Diffuse_Map;
 
 private:
+  // diffuseMode as it was applied, the map when the base image can not be read for sh
+  TextureSkyboxDiffuseMode m_diffuseMode = Skybox_Diffuse_Map;
   Texture      m_baseImage;
   Texture      m_diffuseImage;
   Texture      m_specularImage;
-  Texture      m_brdfImage;
+  ShIrradiance m_irradianceSh;
+  Buffer       m_irradianceShBuffer; // m_irradianceSh as a uniform buffer
   bool         m_isValid  = false;
 
+  // The brdf lut does not depend on the environment, every skybox samples the same one
+  static Texture  m_sharedBrdfImage;
+  static uint32_t m_sharedBrdfUsers;
+  // Empty when results are not cached
+  static std::string m_cacheDirectory;
+
   static const uint32_t m_brdfSize = 512;
+  static const uint32_t m_diffuseHeight = QTZ_SKYBOX_DIFFUSE_HEIGHT;
+  static const uint32_t m_specularHeight = QTZ_SKYBOX_SPECULAR_HEIGHT;
+  static const uint32_t m_specularLevelCount = QTZ_SKYBOX_SPECULAR_LEVEL_COUNT;
 
   // Functions
   // ============================================================
 
 public:
   QuartzResult Init(const char* path);
-  QuartzResult Init(const void* pixels);
-  QuartzResult InitFromDump(const char* path);
+  QuartzResult Init(const void* pixels); // RGBA32 pixels, converted to baseFormat
+  // Reads the ibl set quartz-cook precomputed next to path when there is a usable one, otherwise generates it like Init()
+  QuartzResult InitFromCooked(const char* path);
   void Shutdown();
 
-  const inline Texture& GetBase()     const { return m_baseImage;     }
-  const inline Texture& GetDiffuse()  const { return m_diffuseImage;  }
-  const inline Texture& GetSpecular() const { return m_specularImage; }
-  const inline Texture& GetBrdf()     const { return m_brdfImage;     }
+  // Diffuse, specular and brdf images are read from here when their inputs match and written after being generated
+  // Keyed by a hash of the base image's texels and the ibl settings, stale files are never read
+  static void SetCacheDirectory(const char* directory);
+
+  const inline Texture& GetBase()     const { return m_baseImage;       }
+  const inline Texture& GetDiffuse()  const { return m_diffuseImage;    }
+  const inline Texture& GetSpecular() const { return m_specularImage;   }
+  const inline Texture& GetBrdf()     const { return m_sharedBrdfImage; }
+
+  // Sh diffuse mode only, GetDiffuse() is then left invalid
+  // Shaders reading the buffer evaluate it with rendering/shaders/sh_irradiance.glsl
+  inline bool HasIrradianceSh() const { return m_diffuseMode == Skybox_Diffuse_Sh; }
+  const inline ShIrradiance& GetIrradianceSh()       const { return m_irradianceSh;       }
+  const inline Buffer&       GetIrradianceShBuffer() const { return m_irradianceShBuffer; }
+  // The material input diffuse lighting is read from : the sh buffer in sh mode, the diffuse map otherwise
+  MaterialInput GetIrradianceInput() const;
 
   inline bool IsValid() const
   {
@@ -169,8 +265,19 @@ public:
   }
 
 private:
-  QuartzResult CreateBase(const void* pixels);
-  QuartzResult CreateIbl();
+  void ShutdownImages();
+  QuartzResult CreateBase(const float* pixels);
+  QuartzResult InitBaseImage(const void* pixels); // Pixels already in baseFormat
+  // sourceHash identifies the base image's contents, 0 when it could not be read : the ibl is then never cached
+  // iblCooked : The diffuse (map mode) and specular images were read from the cooker's set, only the brdf is left
+  QuartzResult CreateIbl(uint64_t sourceHash, bool iblCooked);
+  // Pixels in format, the base image's extents
+  QuartzResult CreateIrradianceSh(const void* pixels, TextureFormat format);
+
+  uint64_t IblCacheKey(uint64_t sourceHash) const;
+  // Also reads the cooker's sets, they are laid out like cached ones
+  bool ReadCachedIbl(const std::string& diffusePath, const std::string& specularPath);
+  static QuartzResult WriteCachedTexture(const Texture& texture, const std::string& path);
 
   QuartzResult CreateDiffuse(const Mesh& screenQuadMesh);
   QuartzResult CreateSpecular(const Mesh& screenQuadMesh);
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "quartz/defines.h"
+
+namespace Quartz
+{
+
+// Values are stored in cooked textures, new formats are only ever appended
+enum TextureFormat
+{
+  Texture_Format_RGBA8,
+  Texture_Format_RGBA32,
+  Texture_Format_RG16,    // Half float
+  Texture_Format_Depth,
+
+  // Block compressed, 4x4 pixel blocks (see quartz/assets/texture_compress.h)
+  Texture_Format_BC1,  // RGB, 8 bytes per block
+  Texture_Format_BC3,  // RGBA, 16 bytes per block
+  Texture_Format_BC4,  // R, 8 bytes per block
+  Texture_Format_BC5,  // RG, 16 bytes per block. Normal maps, z is reconstructed in the shader
+  Texture_Format_BC6H, // Unsigned half float RGB, 16 bytes per block
+  Texture_Format_BC7,  // RGBA, 16 bytes per block
+
+  Texture_Format_RGBA16F, // Half float, HDR images at half the size of RGBA32
+};
+
+inline bool IsBlockCompressed(TextureFormat format)
+{
+  return format >= Texture_Format_BC1 && format <= Texture_Format_BC7;
+}
+
+// Bytes per pixel, or per 4x4 block for compressed formats
+inline uint32_t TextureFormatElementSize(TextureFormat format)
+{
+  switch (format)
+  {
+  case Texture_Format_RGBA8:   return 4;
+  case Texture_Format_RGBA32:  return 16;
+  case Texture_Format_RG16:    return 4;
+  case Texture_Format_RGBA16F: return 8;
+  case Texture_Format_Depth:   return 4;
+  case Texture_Format_BC1:     return 8;
+  case Texture_Format_BC4:     return 8;
+  case Texture_Format_BC3:
+  case Texture_Format_BC5:
+  case Texture_Format_BC6H:
+  case Texture_Format_BC7:     return 16;
+  default: return 0;
+  }
+}
+
+// Size of one mip level's pixels, partial blocks at the edges are padded out to whole blocks
+inline uint64_t TextureLevelSize(TextureFormat format, Vec2U extents)
+{
+  if (IsBlockCompressed(format))
+  {
+    uint64_t blocksWide = (extents.width + 3) / 4;
+    uint64_t blocksHigh = (extents.height + 3) / 4;
+    return blocksWide * blocksHigh * TextureFormatElementSize(format);
+  }
+  return (uint64_t)extents.width * extents.height * TextureFormatElementSize(format);
+}
+
+// Every level halves (rounding down) until it reaches 1x1
+inline Vec2U MipExtents(Vec2U extents, uint32_t level)
+{
+  return Vec2U{ PeriMax(extents.width >> level, 1u), PeriMax(extents.height >> level, 1u) };
+}
+
+inline uint32_t FullMipCount(Vec2U extents)
+{
+  uint32_t count = 1;
+  while ((PeriMax(extents.width, extents.height) >> count) > 0)
+  {
+    count++;
+  }
+  return count;
+}
+
+// Size of levelCount mip levels stored back to back, largest first
+inline uint64_t TextureMipChainSize(TextureFormat format, Vec2U extents, uint32_t levelCount)
+{
+  uint64_t size = 0;
+  for (uint32_t level = 0; level < levelCount; level++)
+  {
+    size += TextureLevelSize(format, MipExtents(extents, level));
+  }
+  return size;
+}
+
+} // namespace Quartz
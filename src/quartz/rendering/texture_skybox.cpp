@@ -1,13 +1,27 @@
 
 #include "quartz/defines.h"
 #include "quartz/core/core.h"
+#include "quartz/core/hash.h"
+#include "quartz/core/pixel_convert.h"
+#include "quartz/assets/exr_loader.h"
+#include "quartz/assets/qtex.h"
 #include "quartz/rendering/texture.h"
 #include "quartz/rendering/material.h"
 #include "quartz/rendering/texture_skybox_shaders.inl"
 
+#include <filesystem>
+#include <stdio.h>
+
 namespace Quartz
 {
 
+// Bump when the cached results change without their inputs changing
+#define QTZ_IBL_CACHE_VERSION 1
+
+Texture TextureSkybox::m_sharedBrdfImage;
+uint32_t TextureSkybox::m_sharedBrdfUsers = 0;
+std::string TextureSkybox::m_cacheDirectory;
+
 QuartzResult TextureSkybox::Init(const char* path)
 {
   if (m_isValid)
@@ -16,29 +30,19 @@ QuartzResult TextureSkybox::Init(const char* path)
     return Quartz_Success;
   }
 
-  float* pixelData = nullptr;
-  int32_t width = 0, height = 0;
-  const char* err;
+  // Decoded directly into the base format
+  void* pixels = nullptr;
+  QTZ_ATTEMPT(LoadExr(path, baseFormat, &extents, &pixels));
 
-  if (LoadEXR(&pixelData, &width, &height, path, &err) || width <= 0 || height <= 0 || pixelData == nullptr)
+  m_diffuseMode = diffuseMode;
+  QTZ_ATTEMPT(InitBaseImage(pixels), free(pixels));
+  if (m_diffuseMode == Skybox_Diffuse_Sh)
   {
-    QTZ_ERROR(
-      "Failed to load 32-bit image \"{}\"\n"
-      "    Width: {} -- Height: {} -- Channels: {}\n"
-      "    Error: {}",
-      path,
-      width, height, 4,
-      err);
-
-    width = 0;
-    return Quartz_Failure;
+    QTZ_ATTEMPT(CreateIrradianceSh(pixels, baseFormat), free(pixels), ShutdownImages());
   }
-
-  extents.width = width;
-  extents.height = height;
-
-  QTZ_ATTEMPT(CreateBase((void*)pixelData));
-  QTZ_ATTEMPT(CreateIbl());
+  uint64_t sourceHash = m_cacheDirectory.empty() ? 0 : HashBytes(pixels, TextureLevelSize(baseFormat, extents));
+  free(pixels);
+  QTZ_ATTEMPT(CreateIbl(sourceHash, false), ShutdownImages());
 
   m_isValid = true;
   return Quartz_Success;
@@ -52,14 +56,20 @@ QuartzResult TextureSkybox::Init(const void* pixels)
     return Quartz_Success;
   }
 
-  QTZ_ATTEMPT(CreateBase(pixels));
-  QTZ_ATTEMPT(CreateIbl());
+  m_diffuseMode = diffuseMode;
+  QTZ_ATTEMPT(CreateBase((const float*)pixels));
+  if (m_diffuseMode == Skybox_Diffuse_Sh)
+  {
+    QTZ_ATTEMPT(CreateIrradianceSh(pixels, Texture_Format_RGBA32), ShutdownImages());
+  }
+  uint64_t sourceHash = m_cacheDirectory.empty() ? 0 : HashBytes(pixels, (uint64_t)extents.width * extents.height * 4 * sizeof(float));
+  QTZ_ATTEMPT(CreateIbl(sourceHash, false), ShutdownImages());
 
   m_isValid = true;
   return Quartz_Success;
 }
 
-QuartzResult TextureSkybox::InitFromDump(const char* path)
+QuartzResult TextureSkybox::InitFromCooked(const char* path)
 {
   if (m_isValid)
   {
@@ -67,12 +77,56 @@ QuartzResult TextureSkybox::InitFromDump(const char* path)
     return Quartz_Success;
   }
 
-  QTZ_ATTEMPT(m_baseImage.InitFromDump(path));
+  QTZ_ATTEMPT(m_baseImage.InitFromCooked(path));
 
   extents = m_baseImage.extents;
   baseFormat = m_baseImage.format;
 
-  QTZ_ATTEMPT(CreateIbl());
+  m_diffuseMode = diffuseMode;
+  if (m_diffuseMode == Skybox_Diffuse_Sh && baseFormat != Texture_Format_RGBA32 && baseFormat != Texture_Format_RGBA16F)
+  {
+    QTZ_WARNING("Skybox \"{}\" is block compressed, its diffuse lighting falls back to the convolved map", path);
+    m_diffuseMode = Skybox_Diffuse_Map;
+  }
+
+  // The cooker's set is read instead of generating, or caching, one
+  const std::string cookedStem = std::filesystem::path(path).replace_extension().generic_string();
+  const bool iblCooked = ReadCachedIbl(cookedStem + QTZ_SKYBOX_DIFFUSE_EXTENSION, cookedStem + QTZ_SKYBOX_SPECULAR_EXTENSION);
+  const bool hashSource = !iblCooked && !m_cacheDirectory.empty();
+
+  // The file's checksum already covers every texel
+  uint64_t sourceHash = 0;
+  QTexFile cooked;
+  if ((hashSource || m_diffuseMode == Skybox_Diffuse_Sh) && OpenQTex(path, &cooked, false) == Quartz_Success)
+  {
+    sourceHash = cooked.header->checksum;
+
+    QuartzResult shResult = Quartz_Success;
+    if (m_diffuseMode == Skybox_Diffuse_Sh)
+    {
+      std::vector<uint8_t> pixels(cooked.header->levels[0].size);
+      shResult = DecompressQTexLevel(cooked, 0, pixels.data());
+      if (shResult == Quartz_Success)
+      {
+        shResult = CreateIrradianceSh(pixels.data(), baseFormat);
+      }
+    }
+
+    CloseQTex(&cooked);
+    QTZ_ATTEMPT(shResult, ShutdownImages());
+  }
+  else if (m_diffuseMode == Skybox_Diffuse_Sh)
+  {
+    QTZ_ERROR("Failed to read skybox \"{}\" for its spherical harmonics", path);
+    ShutdownImages();
+    return Quartz_Failure;
+  }
+  else if (hashSource)
+  {
+    QTZ_WARNING("Failed to hash skybox \"{}\", its ibl will not be cached", path);
+  }
+
+  QTZ_ATTEMPT(CreateIbl(sourceHash, iblCooked), ShutdownImages());
 
   m_isValid = true;
   return Quartz_Success;
@@ -88,19 +142,70 @@ void TextureSkybox::Shutdown()
     return;
   }
 
-  m_baseImage.Shutdown();
-  m_specularImage.Shutdown();
-  m_diffuseImage.Shutdown();
-  m_brdfImage.Shutdown();
+  ShutdownImages();
+
+  m_sharedBrdfUsers--;
+  if (m_sharedBrdfUsers == 0)
+  {
+    m_sharedBrdfImage.Shutdown();
+  }
 
   m_isValid = false;
 }
 
+// Everything but the shared brdf lut, also releases a partially initialized skybox
+void TextureSkybox::ShutdownImages()
+{
+  m_baseImage.Shutdown();
+  m_diffuseImage.Shutdown();
+  m_specularImage.Shutdown();
+  m_irradianceShBuffer.Shutdown();
+}
+
 // Ibl
 // ============================================================
 
-QuartzResult TextureSkybox::CreateIbl()
+QuartzResult TextureSkybox::CreateIbl(uint64_t sourceHash, bool iblCooked)
 {
+  // Cache ==============================
+
+  // Without a hash of the contents every skybox of the same size and format would share one key
+  const bool cacheIbl = !iblCooked && !m_cacheDirectory.empty() && sourceHash != 0;
+
+  std::string diffusePath;
+  std::string specularPath;
+  std::string brdfPath;
+  bool iblCached = iblCooked;
+  if (!m_cacheDirectory.empty())
+  {
+    char keyName[64];
+    if (cacheIbl)
+    {
+      snprintf(keyName, sizeof(keyName), "%016llx", (unsigned long long)IblCacheKey(sourceHash));
+      diffusePath = m_cacheDirectory + "/ibl_" + keyName + "_diffuse" QTEX_EXTENSION;
+      specularPath = m_cacheDirectory + "/ibl_" + keyName + "_specular" QTEX_EXTENSION;
+    }
+
+    uint64_t brdfKey = HashBytes(resSkyboxBrdfFragShaderBytes, resSkyboxBrdfFragShaderByteCount, QTZ_IBL_CACHE_VERSION);
+    brdfKey = HashCombine(brdfKey, m_brdfSize);
+    snprintf(keyName, sizeof(keyName), "%016llx", (unsigned long long)brdfKey);
+    brdfPath = m_cacheDirectory + "/brdf_" + keyName + QTEX_EXTENSION;
+
+    iblCached = iblCached || (cacheIbl && ReadCachedIbl(diffusePath, specularPath));
+    if (!m_sharedBrdfImage.IsValid()
+      && std::filesystem::exists(brdfPath)
+      && m_sharedBrdfImage.InitFromCooked(brdfPath.c_str()) != Quartz_Success)
+    {
+      QTZ_WARNING("Cached brdf lut \"{}\" is unusable, regenerating it", brdfPath);
+    }
+  }
+
+  if (iblCached && m_sharedBrdfImage.IsValid())
+  {
+    m_sharedBrdfUsers++;
+    return Quartz_Success;
+  }
+
   // Mesh ==============================
 
   std::vector<Vertex> vertices(4);
@@ -122,29 +227,212 @@ QuartzResult TextureSkybox::CreateIbl()
   QTZ_ATTEMPT(screenQuadMesh.Init(vertices, indices));
 
   // Images ==============================
+  // Failing to write the cache only costs the next run its convolution
 
-  QTZ_ATTEMPT(CreateDiffuse(screenQuadMesh));
-  QTZ_ATTEMPT(CreateSpecular(screenQuadMesh));
-  QTZ_ATTEMPT(CreateBrdf(screenQuadMesh));
+  if (!iblCached)
+  {
+    const bool useDiffuseMap = m_diffuseMode == Skybox_Diffuse_Map;
+    if (useDiffuseMap)
+    {
+      QTZ_ATTEMPT(CreateDiffuse(screenQuadMesh), screenQuadMesh.Shutdown());
+    }
+    QTZ_ATTEMPT(CreateSpecular(screenQuadMesh), screenQuadMesh.Shutdown());
+
+    if (cacheIbl
+      && ((useDiffuseMap && WriteCachedTexture(m_diffuseImage, diffusePath) != Quartz_Success)
+        || WriteCachedTexture(m_specularImage, specularPath) != Quartz_Success))
+    {
+      QTZ_WARNING("Failed to cache skybox ibl in \"{}\"", m_cacheDirectory);
+    }
+  }
+
+  if (!m_sharedBrdfImage.IsValid())
+  {
+    QTZ_ATTEMPT(CreateBrdf(screenQuadMesh), screenQuadMesh.Shutdown());
+
+    if (!m_cacheDirectory.empty() && WriteCachedTexture(m_sharedBrdfImage, brdfPath) != Quartz_Success)
+    {
+      QTZ_WARNING("Failed to cache the brdf lut in \"{}\"", m_cacheDirectory);
+    }
+  }
 
   screenQuadMesh.Shutdown();
+  m_sharedBrdfUsers++;
+  return Quartz_Success;
+}
+
+// Everything that changes the diffuse and specular results, including the shaders that render them
+uint64_t TextureSkybox::IblCacheKey(uint64_t sourceHash) const
+{
+  uint64_t key = HashCombine(sourceHash, QTZ_IBL_CACHE_VERSION);
+  key = HashCombine(key, ((uint64_t)extents.width << 32) | extents.height);
+  key = HashCombine(key, ((uint64_t)baseFormat << 32) | (uint64_t)iblFormat);
+  key = HashCombine(key, ((uint64_t)m_diffuseHeight << 32) | m_specularHeight);
+  key = HashCombine(key, m_specularLevelCount);
+  key = HashBytes(resSkyboxVertShaderBytes, resSkyboxVertShaderByteCount, key);
+  key = HashBytes(resSkyboxDiffuseFragShaderBytes, resSkyboxDiffuseFragShaderByteCount, key);
+  key = HashBytes(resSkyboxSpecularFragShaderBytes, resSkyboxSpecularFragShaderByteCount, key);
+  return key;
+}
+
+// Both maps or neither, a partial hit is regenerated whole. The sh diffuse mode already evaluated its map
+bool TextureSkybox::ReadCachedIbl(const std::string& diffusePath, const std::string& specularPath)
+{
+  const bool useDiffuseMap = m_diffuseMode == Skybox_Diffuse_Map;
+  const Vec2U diffuseExtents = SkyboxIblExtents(extents, m_diffuseHeight);
+  const Vec2U specularExtents = SkyboxIblExtents(extents, m_specularHeight);
+  if ((useDiffuseMap && !std::filesystem::exists(diffusePath)) || !std::filesystem::exists(specularPath))
+  {
+    return false;
+  }
+
+  if ((useDiffuseMap
+      && (m_diffuseImage.InitFromCooked(diffusePath.c_str()) != Quartz_Success
+        || m_diffuseImage.format != iblFormat
+        || m_diffuseImage.extents.width != diffuseExtents.width
+        || m_diffuseImage.extents.height != diffuseExtents.height))
+    || m_specularImage.InitFromCooked(specularPath.c_str()) != Quartz_Success
+    || m_specularImage.format != iblFormat
+    || m_specularImage.mipLevels != m_specularLevelCount
+    || m_specularImage.extents.width != specularExtents.width
+    || m_specularImage.extents.height != specularExtents.height)
+  {
+    QTZ_WARNING("Skybox ibl \"{}\" is unusable, regenerating it", specularPath);
+    if (useDiffuseMap)
+    {
+      m_diffuseImage.Shutdown();
+    }
+    m_specularImage.Shutdown();
+    return false;
+  }
+
+  QTZ_DEBUG("Skybox ibl read from \"{}\"", specularPath);
+  return true;
+}
+
+// Reads every level back from the gpu, written to a temporary file first so a partial write is never read
+// OpalImageDumpData copies the image into a host buffer with a tightly packed buffer-image copy (no row padding)
+//   and returns its size, a level of any other size is rejected rather than written
+QuartzResult TextureSkybox::WriteCachedTexture(const Texture& texture, const std::string& path)
+{
+  const uint32_t levelCount = PeriMax(texture.mipLevels, 1u);
+  std::vector<uint8_t> pixels;
+  // Images held wider than their format are narrowed back before writing
+  const TextureFormat gpuFormat = Texture::GpuFormatOf(texture.format);
+  for (uint32_t i = 0; i < levelCount; i++)
+  {
+    const Vec2U levelExtents = MipExtents(texture.extents, i);
+    const uint64_t levelSize = TextureLevelSize(gpuFormat, levelExtents);
+
+    OpalImage mipImage;
+    QTZ_ATTEMPT_OPAL(OpalImageGetMipAsImage((OpalImage*)&texture.m_opalImage, &mipImage, i));
+    void* levelPixels = nullptr;
+    uint64_t dumpedSize = OpalImageDumpData(mipImage, &levelPixels);
+    OpalImageShutdown(&mipImage);
+
+    if (levelPixels == nullptr || dumpedSize != levelSize)
+    {
+      QTZ_ERROR("Read back {} bytes of a {} byte mip level", dumpedSize, levelSize);
+      free(levelPixels);
+      return Quartz_Failure;
+    }
+
+    if (gpuFormat != texture.format)
+    {
+      const uint64_t texelCount = (uint64_t)levelExtents.width * levelExtents.height;
+      const uint64_t offset = pixels.size();
+      pixels.resize(offset + TextureLevelSize(texture.format, levelExtents));
+      ConvertToHalf((const float*)levelPixels, 4, texelCount, Pixel_Convert_None, (uint16_t*)(pixels.data() + offset));
+    }
+    else
+    {
+      pixels.insert(pixels.end(), (uint8_t*)levelPixels, (uint8_t*)levelPixels + levelSize);
+    }
+    free(levelPixels);
+  }
+
+  QTexWriteInfo info;
+  info.format = texture.format;
+  info.usage = Texture_Usage_Shader_Input;
+  info.filtering = texture.filtering;
+  info.sampleMode = texture.sampleMode;
+  info.extents = texture.extents;
+  info.levelCount = levelCount;
+  info.pixels = pixels.data();
+
+  std::error_code error;
+  std::filesystem::create_directories(m_cacheDirectory, error);
+  return WriteQTex(path.c_str(), info);
+}
+
+void TextureSkybox::SetCacheDirectory(const char* directory)
+{
+  m_cacheDirectory = (directory != nullptr) ? std::filesystem::path(directory).generic_string() : std::string();
+}
+
+QuartzResult TextureSkybox::CreateBase(const float* pixels)
+{
+  switch (baseFormat)
+  {
+  case Texture_Format_RGBA32:
+  {
+    QTZ_ATTEMPT(InitBaseImage(pixels));
+  } break;
+  case Texture_Format_RGBA16F:
+  {
+    std::vector<uint16_t> halves((uint64_t)extents.width * extents.height * 4);
+    ConvertToHalf(pixels, 4, (uint64_t)extents.width * extents.height, Pixel_Convert_None, halves.data());
+    QTZ_ATTEMPT(InitBaseImage(halves.data()));
+  } break;
+  default:
+  {
+    QTZ_ERROR("Skybox base images must be RGBA32 or RGBA16F");
+    return Quartz_Failure;
+  }
+  }
+
   return Quartz_Success;
 }
 
-QuartzResult TextureSkybox::CreateBase(const void* pixels)
+QuartzResult TextureSkybox::InitBaseImage(const void* pixels)
 {
   m_baseImage.mipLevels = 1;
   m_baseImage.extents = extents;
-  m_baseImage.format = Texture_Format_RGBA32;
+  m_baseImage.format = baseFormat;
   m_baseImage.filtering = Texture_Filter_Linear;
   m_baseImage.sampleMode = Texture_Sample_Clamp;
   m_baseImage.usage = Texture_Usage_Shader_Input;
 
   QTZ_ATTEMPT(m_baseImage.Init(pixels));
+  return Quartz_Success;
+}
 
+// Uploaded once, the coefficients never change with the view
+// No diffuse map is made, materials bind the buffer through GetIrradianceInput()
+QuartzResult TextureSkybox::CreateIrradianceSh(const void* pixels, TextureFormat format)
+{
+  QTZ_ATTEMPT(ProjectIrradianceSh(pixels, format, extents, &m_irradianceSh));
+  QTZ_ATTEMPT(m_irradianceShBuffer.Init(sizeof(ShIrradiance)));
+  QTZ_ATTEMPT(m_irradianceShBuffer.PushData(&m_irradianceSh), m_irradianceShBuffer.Shutdown());
   return Quartz_Success;
 }
 
+MaterialInput TextureSkybox::GetIrradianceInput() const
+{
+  MaterialInput input;
+  if (m_diffuseMode == Skybox_Diffuse_Sh)
+  {
+    input.type = Input_Buffer;
+    input.value.buffer = &m_irradianceShBuffer;
+  }
+  else
+  {
+    input.type = Input_Texture;
+    input.value.texture = &m_diffuseImage;
+  }
+  return input;
+}
+
 // Diffuse
 // ============================================================
 
@@ -153,12 +441,12 @@ QuartzResult TextureSkybox::CreateDiffuse(const Mesh& screenQuadMesh)
   // Image creation ==============================
 
   OpalImageInitInfo imageInfo = {};
-  imageInfo.height = 128;
-  imageInfo.width = imageInfo.height * ((float)extents.width / (float)extents.height);
+  imageInfo.height = m_diffuseHeight;
+  imageInfo.width = SkyboxIblExtents(extents, m_diffuseHeight).width;
   imageInfo.mipCount = 1;
-  // For :          Rendering to            | Use in pbr shaders
-  imageInfo.usage = Opal_Image_Usage_Output | Opal_Image_Usage_Uniform;
-  imageInfo.format = Opal_Format_RGBA32;
+  // For :          Rendering to            | Use in pbr shaders       | Reading into the cache
+  imageInfo.usage = Opal_Image_Usage_Output | Opal_Image_Usage_Uniform | Opal_Image_Usage_Transfer_Src;
+  imageInfo.format = Texture::OpalFormatOf(iblFormat);
   imageInfo.filter = Opal_Image_Filter_Linear;
   imageInfo.sampleMode = Opal_Image_Sample_Clamp;
 
@@ -172,7 +460,7 @@ QuartzResult TextureSkybox::CreateDiffuse(const Mesh& screenQuadMesh)
   OpalAttachmentUsage attachmentUses[subpassCount] = { Opal_Attachment_Usage_Output_Uniform };
   OpalAttachmentInfo attachment;
   attachment.clearValue.color = OpalColorValue{ 1.0f, 0.0f, 1.0f, 1.0f };
-  attachment.format = Opal_Format_RGBA32;
+  attachment.format = imageInfo.format;
   attachment.loadOp = Opal_Attachment_Load_Op_Clear;
   attachment.shouldStore = true;
   attachment.pSubpassUsages = attachmentUses;
@@ -230,7 +518,7 @@ QuartzResult TextureSkybox::CreateDiffuse(const Mesh& screenQuadMesh)
 
   m_diffuseImage.mipLevels = 1;
   m_diffuseImage.extents = Vec2U{ imageInfo.width, imageInfo.height };
-  m_diffuseImage.format = Texture_Format_RGBA32;
+  m_diffuseImage.format = iblFormat;
   m_diffuseImage.usage = Texture_Usage_Shader_Input;
   m_diffuseImage.filtering = Texture_Filter_Linear;
   m_diffuseImage.sampleMode = Texture_Sample_Clamp;
@@ -250,7 +538,7 @@ QuartzResult TextureSkybox::CreateDiffuse(const Mesh& screenQuadMesh)
 QuartzResult TextureSkybox::CreateSpecular(const Mesh& screenQuadMesh)
 {
   // Number of mip/roughness levels to create and render
-  const uint32_t levelCount = 5;
+  const uint32_t levelCount = m_specularLevelCount;
 
   struct SpecularMipInfo
   {
@@ -267,12 +555,12 @@ QuartzResult TextureSkybox::CreateSpecular(const Mesh& screenQuadMesh)
   // Image creation ==============================
 
   OpalImageInitInfo imageInfo = {};
-  imageInfo.height = 512;
-  imageInfo.width = imageInfo.height * ((float)extents.width / (float)extents.height);
+  imageInfo.height = m_specularHeight;
+  imageInfo.width = SkyboxIblExtents(extents, m_specularHeight).width;
   imageInfo.mipCount = levelCount;
-  // For :          Rendering to            | Use in pbr shaders
-  imageInfo.usage = Opal_Image_Usage_Output | Opal_Image_Usage_Uniform;
-  imageInfo.format = Opal_Format_RGBA32;
+  // For :          Rendering to            | Use in pbr shaders       | Reading into the cache
+  imageInfo.usage = Opal_Image_Usage_Output | Opal_Image_Usage_Uniform | Opal_Image_Usage_Transfer_Src;
+  imageInfo.format = Texture::OpalFormatOf(iblFormat);
   imageInfo.filter = Opal_Image_Filter_Linear;
   imageInfo.sampleMode = Opal_Image_Sample_Clamp;
 
@@ -286,7 +574,7 @@ QuartzResult TextureSkybox::CreateSpecular(const Mesh& screenQuadMesh)
   OpalAttachmentUsage attachmentUses[subpassCount] = { Opal_Attachment_Usage_Output_Uniform };
   OpalAttachmentInfo attachment;
   attachment.clearValue.color = OpalColorValue{ 1.0f, 0.0f, 1.0f, 1.0f };
-  attachment.format = Opal_Format_RGBA32;
+  attachment.format = imageInfo.format;
   attachment.loadOp = Opal_Attachment_Load_Op_Clear;
   attachment.shouldStore = true;
   attachment.pSubpassUsages = attachmentUses;
@@ -394,7 +682,7 @@ QuartzResult TextureSkybox::CreateSpecular(const Mesh& screenQuadMesh)
 
   m_specularImage.mipLevels = levelCount;
   m_specularImage.extents = Vec2U{ imageInfo.width, imageInfo.height };
-  m_specularImage.format = Texture_Format_RGBA32;
+  m_specularImage.format = iblFormat;
   m_specularImage.usage = Texture_Usage_Shader_Input;
   m_specularImage.filtering = Texture_Filter_Linear;
   m_specularImage.sampleMode = Texture_Sample_Clamp;
@@ -429,8 +717,8 @@ QuartzResult TextureSkybox::CreateBrdf(const Mesh& screenQuadMesh)
   imageInfo.height = m_brdfSize;
   imageInfo.width = m_brdfSize;
   imageInfo.mipCount = 1;
-  // For :          Rendering to            | Use in pbr shaders
-  imageInfo.usage = Opal_Image_Usage_Output | Opal_Image_Usage_Uniform;
+  // For :          Rendering to            | Use in pbr shaders       | Reading into the cache
+  imageInfo.usage = Opal_Image_Usage_Output | Opal_Image_Usage_Uniform | Opal_Image_Usage_Transfer_Src;
   imageInfo.format = Opal_Format_RG16;
   imageInfo.filter = Opal_Image_Filter_Linear;
   imageInfo.sampleMode = Opal_Image_Sample_Clamp;
@@ -500,13 +788,13 @@ QuartzResult TextureSkybox::CreateBrdf(const Mesh& screenQuadMesh)
 
   // Convert to texture ==============================
 
-  m_brdfImage.mipLevels = 1;
-  m_brdfImage.extents = Vec2U{ m_brdfSize, m_brdfSize };
-  m_brdfImage.format = Texture_Format_RG16;
-  m_brdfImage.usage = Texture_Usage_Shader_Input;
-  m_brdfImage.filtering = Texture_Filter_Linear;
-  m_brdfImage.sampleMode = Texture_Sample_Clamp;
-  m_brdfImage.Init(brdfOpalImage);
+  m_sharedBrdfImage.mipLevels = 1;
+  m_sharedBrdfImage.extents = Vec2U{ m_brdfSize, m_brdfSize };
+  m_sharedBrdfImage.format = Texture_Format_RG16;
+  m_sharedBrdfImage.usage = Texture_Usage_Shader_Input;
+  m_sharedBrdfImage.filtering = Texture_Filter_Linear;
+  m_sharedBrdfImage.sampleMode = Texture_Sample_Clamp;
+  m_sharedBrdfImage.Init(brdfOpalImage);
 
   // Shutdown ==============================
 
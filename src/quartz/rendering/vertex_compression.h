@@ -0,0 +1,100 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/core/half.h"
+#include "quartz/rendering/defines.h"
+
+#include <math.h>
+
+namespace Quartz
+{
+
+// Octahedral unit vector encoding, components in [-1, 1]
+// Shaders reading the compact format decode it with rendering/shaders/vertex_decode.glsl, as OctDecode() does
+inline Vec2 OctEncode(Vec3 n)
+{
+  float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+  if (l1 == 0.0f)
+  {
+    return Vec2{ 0.0f, 0.0f };
+  }
+
+  Vec2 e = Vec2{ n.x / l1, n.y / l1 };
+  if (n.z < 0.0f)
+  {
+    Vec2 folded;
+    folded.x = (1.0f - fabsf(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f);
+    folded.y = (1.0f - fabsf(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+    e = folded;
+  }
+  return e;
+}
+
+inline Vec3 OctDecode(Vec2 e)
+{
+  Vec3 n = Vec3{ e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y) };
+  float t = n.z < 0.0f ? -n.z : 0.0f;
+  n.x += n.x >= 0.0f ? -t : t;
+  n.y += n.y >= 0.0f ? -t : t;
+  return n.Normal();
+}
+
+// Half float positions overflow past 65504 and lose precision far from the origin
+// A mesh fits if the half spacing at its largest coordinate is within 1/1024th of its largest extent,
+//   meshes that do not are kept in the full format
+inline bool CompactPositionsFit(const MeshBounds& bounds)
+{
+  const float largest = fmaxf(
+    fmaxf(fmaxf(fabsf(bounds.min.x), fabsf(bounds.max.x)), fmaxf(fabsf(bounds.min.y), fabsf(bounds.max.y))),
+    fmaxf(fabsf(bounds.min.z), fabsf(bounds.max.z)));
+  const float extent = fmaxf(fmaxf(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y), bounds.max.z - bounds.min.z);
+
+  // Also rejects NaN bounds
+  if (!(largest < 65504.0f))
+  {
+    return false;
+  }
+  if (largest == 0.0f || extent == 0.0f)
+  {
+    return true;
+  }
+
+  // Ten explicit mantissa bits, subnormals below 2^-14 are spaced 2^-24 apart
+  const float spacing = ldexpf(1.0f, (largest < 0.00006103515625f) ? -24 : (ilogbf(largest) - 10));
+  return spacing <= extent / 1024.0f;
+}
+
+inline CompactVertex CompressVertex(const Vertex& vertex)
+{
+  CompactVertex compact;
+  compact.position[0] = FloatToHalf(vertex.position.x);
+  compact.position[1] = FloatToHalf(vertex.position.y);
+  compact.position[2] = FloatToHalf(vertex.position.z);
+  compact.position[3] = FloatToHalf(vertex.bitangentSign < 0.0f ? -1.0f : 1.0f);
+
+  compact.uv[0] = FloatToHalf(vertex.uv.x);
+  compact.uv[1] = FloatToHalf(vertex.uv.y);
+
+  Vec2 normal = OctEncode(vertex.normal);
+  compact.normal[0] = FloatToHalf(normal.x);
+  compact.normal[1] = FloatToHalf(normal.y);
+
+  Vec2 tangent = OctEncode(vertex.tangent);
+  compact.tangent[0] = FloatToHalf(tangent.x);
+  compact.tangent[1] = FloatToHalf(tangent.y);
+
+  return compact;
+}
+
+inline Vertex DecompressVertex(const CompactVertex& compact)
+{
+  Vertex vertex;
+  vertex.position = Vec3{ HalfToFloat(compact.position[0]), HalfToFloat(compact.position[1]), HalfToFloat(compact.position[2]) };
+  vertex.uv = Vec2{ HalfToFloat(compact.uv[0]), HalfToFloat(compact.uv[1]) };
+  vertex.normal = OctDecode(Vec2{ HalfToFloat(compact.normal[0]), HalfToFloat(compact.normal[1]) });
+  vertex.tangent = OctDecode(Vec2{ HalfToFloat(compact.tangent[0]), HalfToFloat(compact.tangent[1]) });
+  vertex.bitangentSign = HalfToFloat(compact.position[3]);
+  return vertex;
+}
+
+} // namespace Quartz
@@ -0,0 +1,229 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/lz4.h"
+#include "quartz/assets/qtex.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace Quartz;
+
+// Round trips of Lz4Compress through Lz4Decompress, returns nonzero if any case does not come back byte for byte
+
+static uint32_t g_failedCount = 0;
+
+// xorshift, the cases must be the same on every run
+static uint32_t g_randomState = 0x9e3779b9;
+static inline uint32_t NextRandom()
+{
+  g_randomState ^= g_randomState << 13;
+  g_randomState ^= g_randomState >> 17;
+  g_randomState ^= g_randomState << 5;
+  return g_randomState;
+}
+
+static void Fail(const char* name, const char* reason, uint64_t size)
+{
+  printf("FAILED %s (%llu bytes) : %s\n", name, (unsigned long long)size, reason);
+  g_failedCount++;
+}
+
+// Returns the compressed size so cases can check it, 0 on failure
+static uint64_t RoundTrip(const char* name, const uint8_t* data, uint64_t size)
+{
+  std::vector<uint8_t> compressed(Lz4CompressBound(size));
+  const uint64_t compressedSize = Lz4Compress(data, size, compressed.data(), compressed.size());
+  if (compressedSize == 0 && size != 0)
+  {
+    Fail(name, "did not compress within Lz4CompressBound", size);
+    return 0;
+  }
+
+  // Guard bytes past the end catch writes outside of the output
+  std::vector<uint8_t> decompressed(size + 16, 0xcd);
+  if (Lz4Decompress(compressed.data(), compressedSize, decompressed.data(), size) != Quartz_Success)
+  {
+    Fail(name, "did not decompress", size);
+    return 0;
+  }
+  if (memcmp(decompressed.data(), data, size) != 0)
+  {
+    Fail(name, "decompressed bytes differ", size);
+    return 0;
+  }
+  for (uint64_t i = size; i < decompressed.size(); i++)
+  {
+    if (decompressed[i] != 0xcd)
+    {
+      Fail(name, "wrote past the end of the output", size);
+      return 0;
+    }
+  }
+
+  // A block only decompresses to its exact size
+  if (size > 0 && Lz4Decompress(compressed.data(), compressedSize, decompressed.data(), size - 1) == Quartz_Success)
+  {
+    Fail(name, "decompressed into a smaller output", size);
+  }
+  if (compressedSize > 1 && Lz4Decompress(compressed.data(), compressedSize - 1, decompressed.data(), size) == Quartz_Success)
+  {
+    Fail(name, "decompressed a truncated block", size);
+  }
+
+  return compressedSize;
+}
+
+// Cases
+// ============================================================
+
+// Short inputs fall entirely inside the block's literal-only tail
+static void TestSmallSizes()
+{
+  std::vector<uint8_t> data(64);
+  for (uint64_t size = 0; size <= data.size(); size++)
+  {
+    for (uint64_t i = 0; i < size; i++)
+    {
+      data[i] = (uint8_t)(i % 3);
+    }
+    RoundTrip("small repeating", data.data(), size);
+
+    for (uint64_t i = 0; i < size; i++)
+    {
+      data[i] = (uint8_t)NextRandom();
+    }
+    RoundTrip("small random", data.data(), size);
+  }
+}
+
+// Random bytes from a small alphabet : Short matches at every offset, mixed with literal runs
+static void TestRandom()
+{
+  for (uint32_t run = 0; run < 64; run++)
+  {
+    const uint64_t size = 1 + NextRandom() % (512 * 1024);
+    const uint32_t alphabet = 2 + NextRandom() % 16;
+    std::vector<uint8_t> data(size);
+    for (uint8_t& byte : data)
+    {
+      byte = (uint8_t)(NextRandom() % alphabet);
+    }
+    RoundTrip("random", data.data(), size);
+  }
+}
+
+// No matches at all, the output must still fit in Lz4CompressBound and literal lengths run past 255
+static void TestIncompressible()
+{
+  const uint64_t sizes[] = { 15, 16, 255 + 15, 255 + 16, 65536, 1024 * 1024 + 7 };
+  for (uint64_t size : sizes)
+  {
+    std::vector<uint8_t> data(size);
+    for (uint8_t& byte : data)
+    {
+      byte = (uint8_t)NextRandom();
+    }
+
+    const uint64_t compressedSize = RoundTrip("incompressible", data.data(), size);
+    if (compressedSize > Lz4CompressBound(size))
+    {
+      Fail("incompressible", "exceeded Lz4CompressBound", size);
+    }
+
+    // One byte short of what it needs must fail instead of overrunning
+    std::vector<uint8_t> compressed(compressedSize);
+    if (compressedSize > 0 && Lz4Compress(data.data(), size, compressed.data(), compressedSize - 1) != 0)
+    {
+      Fail("incompressible", "compressed into too small a capacity", size);
+    }
+  }
+}
+
+// Matches that overlap their own output (offset < length), which a plain memcpy would copy wrong
+static void TestOverlappingMatches()
+{
+  for (uint32_t period = 1; period <= 32; period++)
+  {
+    const uint64_t sizes[] = { period + 12, 255 + 19, 4096, 70000 };
+    for (uint64_t size : sizes)
+    {
+      std::vector<uint8_t> data(size);
+      for (uint64_t i = 0; i < size; i++)
+      {
+        data[i] = (i < period) ? (uint8_t)NextRandom() : data[i - period];
+      }
+
+      const uint64_t compressedSize = RoundTrip("overlapping", data.data(), size);
+      if (size >= 4096 && compressedSize > size / 16)
+      {
+        Fail("overlapping", "a repeating pattern did not compress", size);
+      }
+    }
+  }
+}
+
+// Matches right at the largest offset the format stores, and just past it where they must not be used
+static void TestMaxOffset()
+{
+  const uint64_t distances[] = { 65534, 65535, 65536, 65537 };
+  for (uint64_t distance : distances)
+  {
+    std::vector<uint8_t> data(distance + 4096);
+    for (uint64_t i = 0; i < data.size(); i++)
+    {
+      data[i] = (i < distance) ? (uint8_t)NextRandom() : data[i - distance];
+    }
+    RoundTrip("max offset", data.data(), data.size());
+  }
+}
+
+// Cooked textures compress every QTEX_CHUNK_SIZE chunk as its own block, so matches can not reach across chunks
+// A pattern straddling each boundary must decode from that chunk alone
+static void TestChunkBoundaries()
+{
+  const uint64_t sizes[] = { QTEX_CHUNK_SIZE - 1, QTEX_CHUNK_SIZE, QTEX_CHUNK_SIZE + 1, 3 * QTEX_CHUNK_SIZE + 13 };
+  for (uint64_t size : sizes)
+  {
+    std::vector<uint8_t> data(size);
+    for (uint64_t i = 0; i < size; i++)
+    {
+      // Repeats every 4KB with noise in between, the repeats cross chunk edges
+      data[i] = ((i / 64) % 2 == 0) ? (uint8_t)(i % 4096 * 31) : (uint8_t)NextRandom();
+    }
+
+    for (uint64_t begin = 0; begin < size; begin += QTEX_CHUNK_SIZE)
+    {
+      const uint64_t chunkSize = PeriMin(size - begin, (uint64_t)QTEX_CHUNK_SIZE);
+      RoundTrip("chunk", data.data() + begin, chunkSize);
+
+      // The tail of one chunk and the head of the next, as one block
+      if (begin + chunkSize < size)
+      {
+        const uint64_t straddleBegin = begin + chunkSize - PeriMin(chunkSize, (uint64_t)4099);
+        RoundTrip("chunk edge", data.data() + straddleBegin, PeriMin(size - straddleBegin, (uint64_t)8195));
+      }
+    }
+  }
+}
+
+int main()
+{
+  Logger::Init();
+
+  TestSmallSizes();
+  TestRandom();
+  TestIncompressible();
+  TestOverlappingMatches();
+  TestMaxOffset();
+  TestChunkBoundaries();
+
+  if (g_failedCount > 0)
+  {
+    printf("%u lz4 round trips failed\n", g_failedCount);
+    return 1;
+  }
+
+  printf("lz4 round trips passed\n");
+  return 0;
+}
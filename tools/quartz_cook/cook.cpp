@@ -0,0 +1,670 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/hash.h"
+#include "quartz/core/jobs.h"
+#include "quartz/core/pixel_convert.h"
+#include "quartz/assets/exr_loader.h"
+#include "quartz/assets/mesh_import.h"
+#include "quartz/assets/qmesh.h"
+#include "quartz/assets/qtex.h"
+#include "quartz/assets/texture_compress.h"
+#include "quartz/assets/texture_mips.h"
+#include "quartz/rendering/specular_prefilter.h"
+#include "quartz/rendering/spherical_harmonics.h"
+#include "quartz/rendering/texture.h"
+#include "quartz/platform/filesystem/filesystem.h"
+
+#include "cook.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+
+namespace Quartz
+{
+
+// Manifest
+// ============================================================
+// One output per line followed by one line per dependency :
+//   O <output> <settingsHash> <dependencyCount>
+//   D <path> <size> <writeTime> <contentHash>
+// Paths can not contain whitespace, which the cooker's gather step enforces
+
+QuartzResult CookManifest::Load(const std::string& path)
+{
+  records.clear();
+
+  FILE* inFile;
+  if (fopen_s(&inFile, path.c_str(), "r"))
+  {
+    // No manifest yet, everything will be cooked
+    return Quartz_Success;
+  }
+
+  char output[1024];
+  char dependency[1024];
+  unsigned long long settingsHash;
+  unsigned int dependencyCount;
+
+  while (fscanf(inFile, " O %1023s %llx %u", output, &settingsHash, &dependencyCount) == 3)
+  {
+    CookRecord record;
+    record.settingsHash = settingsHash;
+
+    for (uint32_t i = 0; i < dependencyCount; i++)
+    {
+      unsigned long long size;
+      long long writeTime;
+      unsigned long long contentHash;
+      if (fscanf(inFile, " D %1023s %llu %lld %llx", dependency, &size, &writeTime, &contentHash) != 4)
+      {
+        QTZ_WARNING("Cook manifest \"{}\" is corrupt, re-cooking everything", path);
+        records.clear();
+        fclose(inFile);
+        return Quartz_Success;
+      }
+      record.dependencies.push_back({ dependency, size, writeTime, contentHash });
+    }
+
+    records[output] = std::move(record);
+  }
+
+  fclose(inFile);
+  return Quartz_Success;
+}
+
+QuartzResult CookManifest::Save(const std::string& path) const
+{
+  FILE* outFile;
+  if (fopen_s(&outFile, path.c_str(), "w"))
+  {
+    QTZ_ERROR("Failed to write the cook manifest \"{}\"", path);
+    return Quartz_Failure;
+  }
+
+  // Sorted so the manifest diffs cleanly
+  std::vector<const std::pair<const std::string, CookRecord>*> sorted;
+  for (const auto& record : records)
+  {
+    sorted.push_back(&record);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+  for (const auto* entry : sorted)
+  {
+    const CookRecord& record = entry->second;
+    fprintf(outFile, "O %s %llx %u\n", entry->first.c_str(), (unsigned long long)record.settingsHash, (uint32_t)record.dependencies.size());
+    for (const CookDependency& dependency : record.dependencies)
+    {
+      fprintf(
+        outFile,
+        "D %s %llu %lld %llx\n",
+        dependency.path.c_str(),
+        (unsigned long long)dependency.size,
+        (long long)dependency.writeTime,
+        (unsigned long long)dependency.contentHash);
+    }
+  }
+
+  fclose(outFile);
+  return Quartz_Success;
+}
+
+// Dependencies
+// ============================================================
+
+static QuartzResult HashFile(const std::string& path, uint64_t* outHash)
+{
+  MappedFile file;
+  QTZ_ATTEMPT(PlatformMapFile(path.c_str(), &file));
+  *outHash = HashBytes(file.data, file.size);
+  PlatformUnmapFile(&file);
+  return Quartz_Success;
+}
+
+static QuartzResult StatFile(const std::string& path, uint64_t* outSize, int64_t* outWriteTime)
+{
+  std::error_code error;
+  *outSize = std::filesystem::file_size(path, error);
+  if (error)
+  {
+    return Quartz_Failure;
+  }
+  *outWriteTime = (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+  return error ? Quartz_Failure : Quartz_Success;
+}
+
+// Size and write time are checked first, contents are only hashed when those differ
+// A touched but unchanged file is up to date and has its record refreshed
+static bool IsDependencyCurrent(const std::string& sourceDirectory, CookDependency* dependency)
+{
+  std::string path = sourceDirectory + "/" + dependency->path;
+
+  uint64_t size;
+  int64_t writeTime;
+  if (StatFile(path, &size, &writeTime) != Quartz_Success || size != dependency->size)
+  {
+    return false;
+  }
+
+  if (writeTime == dependency->writeTime)
+  {
+    return true;
+  }
+
+  uint64_t contentHash;
+  if (HashFile(path, &contentHash) != Quartz_Success || contentHash != dependency->contentHash)
+  {
+    return false;
+  }
+
+  dependency->writeTime = writeTime;
+  return true;
+}
+
+static QuartzResult RecordDependency(const std::string& sourceDirectory, const std::string& relativePath, CookDependency* outDependency)
+{
+  std::string path = sourceDirectory + "/" + relativePath;
+  outDependency->path = relativePath;
+  QTZ_ATTEMPT(StatFile(path, &outDependency->size, &outDependency->writeTime));
+  QTZ_ATTEMPT(HashFile(path, &outDependency->contentHash));
+  return Quartz_Success;
+}
+
+// Cookers
+// ============================================================
+
+static QuartzResult CookMesh(
+  const std::string& sourcePath,
+  const std::string& outputPath,
+  const CookSettings& settings)
+{
+  MeshImportInfo importInfo = {};
+  importInfo.generateLods = settings.generateLods;
+  importInfo.buildMeshlets = settings.buildMeshlets;
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<MeshLod> lods;
+  std::vector<Meshlet> meshlets;
+  QTZ_ATTEMPT(ImportMesh(sourcePath.c_str(), importInfo, &vertices, &indices, &lods, &meshlets));
+
+  QMeshWriteInfo writeInfo = {};
+  writeInfo.vertices = &vertices;
+  writeInfo.indices = &indices;
+  writeInfo.vertexFormat = settings.vertexFormat;
+  if (lods.size() > 1)
+  {
+    writeInfo.extraSections.push_back({ QMesh_Section_Lods, sizeof(MeshLod), lods.size(), lods.data() });
+  }
+  if (!meshlets.empty())
+  {
+    writeInfo.extraSections.push_back({ QMesh_Section_Meshlets, sizeof(Meshlet), meshlets.size(), meshlets.data() });
+  }
+  QTZ_ATTEMPT(WriteQMesh(outputPath.c_str(), writeInfo));
+
+  return Quartz_Success;
+}
+
+// Texture roles are recognized by name, "brick_normal.png" is a normal map
+static const char* g_normalMapSuffixes[] = { "_normal", "_n", "_nrm" };
+static const char* g_linearDataSuffixes[] = { "_roughness", "_rough", "_metallic", "_metal", "_ao", "_orm", "_mask", "_height" };
+static const char* g_cutoutSuffixes[] = { "_cutout", "_alphatest" };
+// HDR images only, also cooked into an ibl set
+static const char* g_skyboxSuffixes[] = { "_skybox", "_sky", "_env", "_hdri" };
+
+template <size_t N>
+static bool HasNameSuffix(const std::string& sourcePath, const char* (&suffixes)[N])
+{
+  std::string stem = std::filesystem::path(sourcePath).stem().generic_string();
+  std::transform(stem.begin(), stem.end(), stem.begin(), [](char c) { return (char)tolower(c); });
+
+  for (const char* suffix : suffixes)
+  {
+    size_t length = strlen(suffix);
+    if (stem.size() > length && stem.compare(stem.size() - length, length, suffix) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// pixels : RGBA8, or RGBA32 for HDR formats
+static QuartzResult AppendTextureLevel(const void* pixels, Vec2U extents, TextureFormat format, std::vector<uint8_t>* payload)
+{
+  if (IsBlockCompressed(format))
+  {
+    std::vector<uint8_t> blocks;
+    QTZ_ATTEMPT(CompressTexture(pixels, extents, format, &blocks));
+    payload->insert(payload->end(), blocks.begin(), blocks.end());
+  }
+  else
+  {
+    const uint8_t* bytes = (const uint8_t*)pixels;
+    payload->insert(payload->end(), bytes, bytes + TextureLevelSize(format, extents));
+  }
+  return Quartz_Success;
+}
+
+// Filters the mip chain below the loaded level and appends every level to payload
+static QuartzResult AppendTextureMips(
+  const void* pixels,
+  Vec2U extents,
+  TextureFormat format,
+  bool isHdr,
+  const MipGenerateInfo& mipInfo,
+  bool isSrgb,
+  std::vector<uint8_t>* payload,
+  uint32_t* outLevelCount)
+{
+  // Filtering happens on linear floats, 8-bit images are expanded (and linearized when sRGB) first
+  const uint64_t pixelCount = (uint64_t)extents.width * extents.height;
+  const PixelConvertFlags convertFlags = isSrgb ? Pixel_Convert_Srgb : Pixel_Convert_None;
+  std::vector<float> expanded;
+  const float* source = (const float*)pixels;
+  if (!isHdr)
+  {
+    expanded.resize(pixelCount * 4);
+    ConvertFromUnorm8((const uint8_t*)pixels, pixelCount, convertFlags, expanded.data());
+    source = expanded.data();
+  }
+
+  std::vector<MipLevel> levels;
+  QTZ_ATTEMPT(GenerateMips(source, extents, mipInfo, &levels));
+
+  std::vector<uint8_t> levelPixels8;
+  for (const MipLevel& level : levels)
+  {
+    const void* levelPixels = level.pixels.data();
+    if (!isHdr)
+    {
+      levelPixels8.resize((uint64_t)level.extents.width * level.extents.height * 4);
+      ConvertToUnorm8(level.pixels.data(), 4, (uint64_t)level.extents.width * level.extents.height, convertFlags, levelPixels8.data());
+      levelPixels = levelPixels8.data();
+    }
+    QTZ_ATTEMPT(AppendTextureLevel(levelPixels, level.extents, format, payload));
+  }
+
+  *outLevelCount = 1 + (uint32_t)levels.size();
+  return Quartz_Success;
+}
+
+static std::string LowercaseExtension(const std::string& path)
+{
+  std::string extension = std::filesystem::path(path).extension().generic_string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+  return extension;
+}
+
+// outPixels : RGBA8, or RGBA32 for HDR formats. stb_image and tinyexr both allocate with malloc
+static QuartzResult LoadTexturePixels(const std::string& sourcePath, Vec2U* outExtents, void** outPixels)
+{
+  const std::string extension = LowercaseExtension(sourcePath);
+  if (extension == ".exr")
+  {
+    // Reports its own errors, stb_image's failure reason would be stale or empty
+    return LoadExr(sourcePath.c_str(), Texture_Format_RGBA32, outExtents, outPixels);
+  }
+
+  int width = 0, height = 0;
+  int channelCount;
+  void* pixels = nullptr;
+  if (extension == ".hdr")
+  {
+    pixels = stbi_loadf(sourcePath.c_str(), &width, &height, &channelCount, STBI_rgb_alpha);
+  }
+  else
+  {
+    pixels = stbi_load(sourcePath.c_str(), &width, &height, &channelCount, STBI_rgb_alpha);
+  }
+
+  if (pixels == nullptr || width <= 0 || height <= 0)
+  {
+    QTZ_ERROR("Failed to load \"{}\" : {}", sourcePath, stbi_failure_reason());
+    free(pixels);
+    return Quartz_Failure_Vendor;
+  }
+
+  *outExtents = Vec2U{ (uint32_t)width, (uint32_t)height };
+  *outPixels = pixels;
+  return Quartz_Success;
+}
+
+// pixels : RGBA8, or RGBA32 for HDR formats
+static QuartzResult CookTexturePixels(
+  const std::string& sourcePath,
+  const std::string& outputPath,
+  const void* pixels,
+  Vec2U extents,
+  bool isHdr,
+  TextureSampleMode sampleMode,
+  const CookSettings& settings)
+{
+  const bool isNormalMap = HasNameSuffix(sourcePath, g_normalMapSuffixes);
+  // Color is authored in sRGB, normal and data maps are already linear
+  const bool isSrgb = !isHdr && !isNormalMap && !HasNameSuffix(sourcePath, g_linearDataSuffixes);
+
+  TextureFormat format = isHdr ? Texture_Format_RGBA32 : Texture_Format_RGBA8;
+  if (settings.compressTextures)
+  {
+    format = isHdr ? Texture_Format_BC6H : (isNormalMap ? Texture_Format_BC5 : Texture_Format_BC7);
+  }
+
+  std::vector<uint8_t> payload;
+  uint32_t mipLevels = 1;
+  QTZ_ATTEMPT(AppendTextureLevel(pixels, extents, format, &payload));
+
+  if (settings.generateMips)
+  {
+    MipGenerateInfo mipInfo = {};
+    mipInfo.filter = settings.mipFilter;
+    mipInfo.levelCount = QTEX_MAX_LEVELS;
+    mipInfo.normalMap = isNormalMap;
+    mipInfo.alphaCoverageReference = HasNameSuffix(sourcePath, g_cutoutSuffixes) ? 0.5f : 0.0f;
+
+    QTZ_ATTEMPT(AppendTextureMips(pixels, extents, format, isHdr, mipInfo, isSrgb, &payload, &mipLevels));
+  }
+
+  QTexWriteInfo writeInfo = {};
+  writeInfo.format = format;
+  writeInfo.usage = Texture_Usage_Shader_Input;
+  writeInfo.filtering = Texture_Filter_Linear;
+  writeInfo.sampleMode = sampleMode;
+  writeInfo.extents = extents;
+  writeInfo.levelCount = mipLevels;
+  writeInfo.pixels = payload.data();
+  writeInfo.compression = settings.supercompressTextures ? QTex_Compression_Lz4 : QTex_Compression_None;
+  return WriteQTex(outputPath.c_str(), writeInfo);
+}
+
+static QuartzResult CookTexture(
+  const std::string& sourcePath,
+  const std::string& outputPath,
+  const CookSettings& settings)
+{
+  const std::string extension = LowercaseExtension(sourcePath);
+  const bool isHdr = extension == ".exr" || extension == ".hdr";
+
+  Vec2U extents;
+  void* pixels = nullptr;
+  QTZ_ATTEMPT(LoadTexturePixels(sourcePath, &extents, &pixels));
+
+  // stb_image and tinyexr both allocate with malloc
+  QTZ_ATTEMPT(CookTexturePixels(sourcePath, outputPath, pixels, extents, isHdr, Texture_Sample_Wrap, settings), free(pixels));
+  free(pixels);
+  return Quartz_Success;
+}
+
+// Skybox ibl sets ==============================
+// The maps TextureSkybox::InitFromCooked() reads next to the cooked base image instead of rendering them at load
+// Laid out as TextureSkybox generates them : iblFormat's default RGBA16F at QTZ_SKYBOX_*_HEIGHT
+
+static QuartzResult WriteIblTexture(
+  const std::string& outputPath,
+  const std::vector<Vec4>& pixels,
+  Vec2U extents,
+  uint32_t levelCount,
+  const CookSettings& settings)
+{
+  std::vector<uint16_t> halves(pixels.size() * 4);
+  ConvertToHalf((const float*)pixels.data(), 4, pixels.size(), Pixel_Convert_None, halves.data());
+
+  QTexWriteInfo writeInfo = {};
+  writeInfo.format = Texture_Format_RGBA16F;
+  writeInfo.usage = Texture_Usage_Shader_Input;
+  writeInfo.filtering = Texture_Filter_Linear;
+  writeInfo.sampleMode = Texture_Sample_Clamp;
+  writeInfo.extents = extents;
+  writeInfo.levelCount = levelCount;
+  writeInfo.pixels = halves.data();
+  writeInfo.compression = settings.supercompressTextures ? QTex_Compression_Lz4 : QTex_Compression_None;
+  return WriteQTex(outputPath.c_str(), writeInfo);
+}
+
+// Evaluated from spherical harmonics, a brute force cosine convolution like the gpu's takes minutes on the cpu
+static QuartzResult CookSkyboxDiffuse(const std::string& outputPath, const float* pixels, Vec2U extents, const CookSettings& settings)
+{
+  ShIrradiance sh;
+  QTZ_ATTEMPT(ProjectIrradianceSh(pixels, Texture_Format_RGBA32, extents, &sh));
+
+  const Vec2U diffuseExtents = SkyboxIblExtents(extents, QTZ_SKYBOX_DIFFUSE_HEIGHT);
+  std::vector<Vec4> diffuse((uint64_t)diffuseExtents.width * diffuseExtents.height);
+  EvaluateIrradianceShMap(sh, diffuseExtents, diffuse.data());
+  return WriteIblTexture(outputPath, diffuse, diffuseExtents, 1, settings);
+}
+
+static QuartzResult CookSkyboxSpecular(const std::string& outputPath, const float* pixels, Vec2U extents, const CookSettings& settings)
+{
+  const Vec2U specularExtents = SkyboxIblExtents(extents, QTZ_SKYBOX_SPECULAR_HEIGHT);
+  std::vector<Vec4> specular;
+  QTZ_ATTEMPT(PrefilterSpecularGgx(pixels, extents, specularExtents, QTZ_SKYBOX_SPECULAR_LEVEL_COUNT, &specular));
+
+  return WriteIblTexture(outputPath, specular, specularExtents, QTZ_SKYBOX_SPECULAR_LEVEL_COUNT, settings);
+}
+
+// The base image and both ibl maps from one load of the source, cooked side by side
+// The maps are named as TextureSkybox::InitFromCooked() looks for them next to the base
+static QuartzResult CookSkybox(
+  const std::string& sourcePath,
+  const std::string& outputPath,
+  const CookSettings& settings)
+{
+  Vec2U extents;
+  void* pixels = nullptr;
+  QTZ_ATTEMPT(LoadTexturePixels(sourcePath, &extents, &pixels));
+
+  const std::string outputStem = std::filesystem::path(outputPath).replace_extension().generic_string();
+  const float* floats = (const float*)pixels;
+
+  QuartzResult results[3];
+  ParallelFor(3, [&](uint32_t index)
+  {
+    switch (index)
+    {
+    case 0: results[index] = CookTexturePixels(sourcePath, outputPath, pixels, extents, true, Texture_Sample_Clamp, settings); break;
+    case 1: results[index] = CookSkyboxDiffuse(outputStem + QTZ_SKYBOX_DIFFUSE_EXTENSION, floats, extents, settings); break;
+    default: results[index] = CookSkyboxSpecular(outputStem + QTZ_SKYBOX_SPECULAR_EXTENSION, floats, extents, settings); break;
+    }
+  });
+  free(pixels);
+
+  for (QuartzResult result : results)
+  {
+    QTZ_ATTEMPT(result);
+  }
+  return Quartz_Success;
+}
+
+struct CookerInfo
+{
+  const char* sourceExtension;
+  const char* outputExtension; // Appended to the source name
+  QuartzResult (*cookFunction)(
+    const std::string& sourcePath,
+    const std::string& outputPath,
+    const CookSettings& settings);
+  uint64_t (*settingsHash)(const CookSettings& settings); // Only the settings the cooker reads
+};
+
+static uint64_t MeshSettingsHash(const CookSettings& settings)
+{
+  uint64_t hash = HashMix64(QMESH_VERSION);
+  hash = HashCombine(hash, (uint64_t)settings.vertexFormat);
+  hash = HashCombine(hash, (uint64_t)settings.generateLods);
+  hash = HashCombine(hash, (uint64_t)settings.buildMeshlets);
+  return hash;
+}
+
+static uint64_t TextureSettingsHash(const CookSettings& settings)
+{
+  uint64_t hash = HashMix64(QTEX_VERSION);
+  hash = HashCombine(hash, (uint64_t)settings.compressTextures);
+  hash = HashCombine(hash, (uint64_t)settings.generateMips);
+  hash = HashCombine(hash, (uint64_t)settings.mipFilter);
+  hash = HashCombine(hash, (uint64_t)settings.supercompressTextures);
+  return hash;
+}
+
+static uint64_t SkyboxSettingsHash(const CookSettings& settings)
+{
+  uint64_t hash = TextureSettingsHash(settings);
+  hash = HashCombine(hash, HashString("skybox"));
+  hash = HashCombine(hash, QTZ_SKYBOX_DIFFUSE_HEIGHT);
+  hash = HashCombine(hash, QTZ_SKYBOX_SPECULAR_HEIGHT);
+  hash = HashCombine(hash, QTZ_SKYBOX_SPECULAR_LEVEL_COUNT);
+  return hash;
+}
+
+static const CookerInfo g_cookers[] = {
+  { ".obj", QMESH_EXTENSION, CookMesh, MeshSettingsHash },
+  { ".png", QTEX_EXTENSION, CookTexture, TextureSettingsHash },
+  { ".jpg", QTEX_EXTENSION, CookTexture, TextureSettingsHash },
+  { ".jpeg", QTEX_EXTENSION, CookTexture, TextureSettingsHash },
+  { ".tga", QTEX_EXTENSION, CookTexture, TextureSettingsHash },
+  { ".bmp", QTEX_EXTENSION, CookTexture, TextureSettingsHash },
+  { ".hdr", QTEX_EXTENSION, CookTexture, TextureSettingsHash },
+  { ".exr", QTEX_EXTENSION, CookTexture, TextureSettingsHash },
+};
+
+// Replaces the texture cooker for HDR images named as skyboxes
+static const CookerInfo g_skyboxCooker = { nullptr, QTEX_EXTENSION, CookSkybox, SkyboxSettingsHash };
+
+// Jobs
+// ============================================================
+
+static CookJob MakeCookJob(const std::string& source, const CookerInfo& cooker, const CookSettings& settings)
+{
+  CookJob job = {};
+  job.source = source;
+  job.output = source + cooker.outputExtension;
+  job.cookFunction = cooker.cookFunction;
+  job.settingsHash = HashCombine(HashMix64(QUARTZ_COOK_VERSION), HashString(cooker.outputExtension));
+  job.settingsHash = HashCombine(job.settingsHash, cooker.settingsHash(settings));
+  return job;
+}
+
+std::vector<CookJob> GatherCookJobs(const CookSettings& settings)
+{
+  std::vector<CookJob> jobs;
+
+  std::error_code error;
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(settings.sourceDirectory, error))
+  {
+    if (!entry.is_regular_file())
+    {
+      continue;
+    }
+
+    std::string extension = entry.path().extension().generic_string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+
+    for (const CookerInfo& cooker : g_cookers)
+    {
+      if (extension != cooker.sourceExtension)
+      {
+        continue;
+      }
+
+      std::string relative = std::filesystem::relative(entry.path(), settings.sourceDirectory).generic_string();
+      if (relative.find_first_of(" \t\n") != std::string::npos)
+      {
+        QTZ_WARNING("Skipping \"{}\", cooked asset paths can not contain whitespace", relative);
+        break;
+      }
+
+      if (settings.cookSkyboxIbl && (extension == ".hdr" || extension == ".exr") && HasNameSuffix(relative, g_skyboxSuffixes))
+      {
+        CookJob job = MakeCookJob(relative, g_skyboxCooker, settings);
+        job.extraOutputs = { relative + QTZ_SKYBOX_DIFFUSE_EXTENSION, relative + QTZ_SKYBOX_SPECULAR_EXTENSION };
+        jobs.push_back(std::move(job));
+      }
+      else
+      {
+        jobs.push_back(MakeCookJob(relative, cooker, settings));
+      }
+      break;
+    }
+  }
+
+  if (error)
+  {
+    QTZ_ERROR("Failed to scan the source directory \"{}\" : {}", settings.sourceDirectory, error.message());
+  }
+
+  return jobs;
+}
+
+static CookResult RunCookJob(CookJob* job, const CookSettings& settings)
+{
+  std::string sourcePath = settings.sourceDirectory + "/" + job->source;
+  std::string outputPath = settings.outputDirectory + "/" + job->output;
+
+  if (!settings.force
+    && job->record.settingsHash == job->settingsHash
+    && !job->record.dependencies.empty()
+    && std::filesystem::exists(outputPath))
+  {
+    bool current = true;
+    for (const std::string& extraOutput : job->extraOutputs)
+    {
+      current = current && std::filesystem::exists(settings.outputDirectory + "/" + extraOutput);
+    }
+    for (CookDependency& dependency : job->record.dependencies)
+    {
+      current = current && IsDependencyCurrent(settings.sourceDirectory, &dependency);
+    }
+
+    if (current)
+    {
+      return Cook_Result_UpToDate;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::path(outputPath).parent_path(), error);
+
+  // Recorded before cooking so an edit made mid-cook is picked up next run
+  CookRecord record = {};
+  record.settingsHash = job->settingsHash;
+  record.dependencies.resize(1);
+  if (RecordDependency(settings.sourceDirectory, job->source, &record.dependencies[0]) != Quartz_Success
+    || job->cookFunction(sourcePath, outputPath, settings) != Quartz_Success)
+  {
+    QTZ_ERROR("Failed to cook \"{}\"", job->source);
+    return Cook_Result_Failed;
+  }
+
+  job->record = std::move(record);
+  return Cook_Result_Cooked;
+}
+
+void RunCookJobs(std::vector<CookJob>* jobs, CookManifest* manifest, const CookSettings& settings)
+{
+  for (CookJob& job : *jobs)
+  {
+    auto existing = manifest->records.find(job.output);
+    job.record = (existing != manifest->records.end()) ? existing->second : CookRecord{};
+  }
+
+  // One job per asset, importers parallelize internally as well
+  ParallelFor((uint32_t)jobs->size(), [&](uint32_t index)
+  {
+    CookJob& job = (*jobs)[index];
+    job.result = RunCookJob(&job, settings);
+  });
+
+  for (const CookJob& job : *jobs)
+  {
+    if (job.result == Cook_Result_Failed)
+    {
+      manifest->records.erase(job.output);
+    }
+    else
+    {
+      manifest->records[job.output] = job.record;
+    }
+  }
+}
+
+} // namespace Quartz
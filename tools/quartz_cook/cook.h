@@ -0,0 +1,95 @@
+#pragma once
+
+#include "quartz/defines.h"
+#include "quartz/rendering/defines.h"
+#include "quartz/assets/texture_mips.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Quartz
+{
+
+// Bump whenever a cooker's output changes for the same input, forces every asset to re-cook
+#define QUARTZ_COOK_VERSION 3
+
+struct CookSettings
+{
+  std::string sourceDirectory;
+  std::string outputDirectory;
+  QuartzVertexFormat vertexFormat = Quartz_Vertex_Format_Full;
+  bool generateLods = true;
+  bool buildMeshlets = true;
+#ifdef QTZ_OPAL_EXTENDED_FORMATS
+  bool compressTextures = true; // BC7 color, BC5 normal maps and BC6H HDR images, raw RGBA8 / RGBA32 otherwise
+#else
+  bool compressTextures = false; // The runtime's Opal can not sample BC formats
+#endif // QTZ_OPAL_EXTENDED_FORMATS
+  bool generateMips = true; // Full mip chains, loading a cooked texture is only an upload
+  MipFilter mipFilter = Mip_Filter_Kaiser;
+  bool supercompressTextures = true; // LZ4 over the gpu-ready levels, smaller files for a parallel decompress at load
+  bool cookSkyboxIbl = true; // HDR images named *_skybox, *_sky, *_env or *_hdri also get the diffuse and specular maps of their ibl
+  bool force = false; // Ignore the manifest and re-cook everything
+};
+
+// Manifest
+// ============================================================
+
+struct CookDependency
+{
+  std::string path; // Relative to the source directory
+  uint64_t size;
+  int64_t writeTime;
+  uint64_t contentHash;
+};
+
+struct CookRecord
+{
+  uint64_t settingsHash;
+  std::vector<CookDependency> dependencies;
+};
+
+// Records the inputs of every cooked output so unchanged assets can be skipped
+// Stored as text in <outputDirectory>/cook_manifest.txt
+class CookManifest
+{
+public:
+  QuartzResult Load(const std::string& path);
+  QuartzResult Save(const std::string& path) const;
+
+  std::unordered_map<std::string, CookRecord> records; // Keyed by output path relative to the output directory
+};
+
+// Cooking
+// ============================================================
+
+enum CookResult
+{
+  Cook_Result_UpToDate,
+  Cook_Result_Cooked,
+  Cook_Result_Failed,
+};
+
+struct CookJob
+{
+  std::string source; // Relative to the source directory
+  std::string output; // Relative to the output directory
+  std::vector<std::string> extraOutputs; // Written by the same cook, a skybox's ibl maps. Covered by output's record
+  QuartzResult (*cookFunction)(
+    const std::string& sourcePath,
+    const std::string& outputPath,
+    const CookSettings& settings);
+  uint64_t settingsHash;
+
+  CookResult result;
+  CookRecord record;
+};
+
+// Finds every source asset with a known cooker
+std::vector<CookJob> GatherCookJobs(const CookSettings& settings);
+
+// Cooks all out-of-date jobs across every job worker, updating the manifest's records
+void RunCookJobs(std::vector<CookJob>* jobs, CookManifest* manifest, const CookSettings& settings);
+
+} // namespace Quartz
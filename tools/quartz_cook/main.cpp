@@ -0,0 +1,128 @@
+
+#include "quartz/defines.h"
+#include "quartz/core/jobs.h"
+
+#include "cook.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+using namespace Quartz;
+
+static void PrintUsage()
+{
+  printf(
+    "Usage : quartz-cook <source directory> <output directory> [options]\n"
+    "  --force        Re-cook every asset\n"
+    "  --compact      Cook meshes in the compact vertex format\n"
+    "  --no-lods      Cook meshes without simplified levels of detail\n"
+    "  --no-meshlets  Cook meshes without meshlets for cluster culling\n"
+    "  --no-texture-compression  Cook textures as uncompressed RGBA8 / RGBA32\n"
+    "  --no-mips      Cook textures without mip chains, the gpu generates them at load\n"
+    "  --box-mips     Filter mip chains with a box filter instead of a Kaiser window\n"
+    "  --no-supercompression  Store cooked textures uncompressed, every level uploads straight from the mapped file\n"
+    "  --no-skybox-ibl  Cook skyboxes (*_skybox, *_sky, *_env, *_hdri .hdr / .exr) without their diffuse and specular maps\n");
+}
+
+int main(int argc, char** argv)
+{
+  Logger::Init();
+
+  if (argc < 3)
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  CookSettings settings = {};
+  settings.sourceDirectory = argv[1];
+  settings.outputDirectory = argv[2];
+
+  for (int i = 3; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--force") == 0)
+    {
+      settings.force = true;
+    }
+    else if (strcmp(argv[i], "--compact") == 0)
+    {
+      settings.vertexFormat = Quartz_Vertex_Format_Compact;
+    }
+    else if (strcmp(argv[i], "--no-lods") == 0)
+    {
+      settings.generateLods = false;
+    }
+    else if (strcmp(argv[i], "--no-meshlets") == 0)
+    {
+      settings.buildMeshlets = false;
+    }
+    else if (strcmp(argv[i], "--no-texture-compression") == 0)
+    {
+      settings.compressTextures = false;
+    }
+    else if (strcmp(argv[i], "--no-mips") == 0)
+    {
+      settings.generateMips = false;
+    }
+    else if (strcmp(argv[i], "--box-mips") == 0)
+    {
+      settings.mipFilter = Mip_Filter_Box;
+    }
+    else if (strcmp(argv[i], "--no-supercompression") == 0)
+    {
+      settings.supercompressTextures = false;
+    }
+    else if (strcmp(argv[i], "--no-skybox-ibl") == 0)
+    {
+      settings.cookSkyboxIbl = false;
+    }
+    else
+    {
+      printf("Unknown option \"%s\"\n", argv[i]);
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  auto startTime = std::chrono::steady_clock::now();
+
+  std::string manifestPath = settings.outputDirectory + "/cook_manifest.txt";
+  CookManifest manifest;
+  if (manifest.Load(manifestPath) != Quartz_Success)
+  {
+    return 1;
+  }
+
+  std::vector<CookJob> jobs = GatherCookJobs(settings);
+  RunCookJobs(&jobs, &manifest, settings);
+
+  uint32_t cookedCount = 0;
+  uint32_t upToDateCount = 0;
+  uint32_t failedCount = 0;
+  for (const CookJob& job : jobs)
+  {
+    switch (job.result)
+    {
+    case Cook_Result_Cooked: cookedCount++; break;
+    case Cook_Result_UpToDate: upToDateCount++; break;
+    default: failedCount++; break;
+    }
+  }
+
+  QuartzResult saveResult = manifest.Save(manifestPath);
+
+  // Printed directly, release builds only log errors
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  printf(
+    "Cooked %u, up to date %u, failed %u in %.2fs (%u workers)\n",
+    cookedCount,
+    upToDateCount,
+    failedCount,
+    seconds,
+    JobWorkerCount());
+
+  JobsShutdown();
+
+  return (failedCount == 0 && saveResult == Quartz_Success) ? 0 : 1;
+}